@@ -25,5 +25,11 @@ extern const struct bg_gattdb_def bg_gattdb_data;
 #define gattdb_intermediate_temperature         38
 #define gattdb_measurement_interval            41
 #define gattdb_valid_range                     43
+#define gattdb_i2c_error_counters              46
+#define gattdb_humidity                        49
+#define gattdb_history_control                 53
+#define gattdb_history_data                    55
+#define gattdb_batch_data                      59
+#define gattdb_batch_config                    62
 
 #endif
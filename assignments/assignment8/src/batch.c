@@ -0,0 +1,162 @@
+//!
+//! @file batch.c
+//! @brief Implements temperature batching. Readings are packed as they
+//! arrive into a buffer laid out like the notification. The batch is sent
+//! to every client that enabled Batch Data notifications. A stack soft
+//! timer started by the first reading bounds how long it waits
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources Silicon Labs Bluetooth API reference (UG136) for soft timers
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#include "batch.h"
+
+#include "log.h"
+#include "ble.h"
+#include "gatt_db.h"
+#include "gecko_ble_errors.h"
+#include "infrastructure.h"
+
+//! Soft timer ticks per second
+#define SOFT_TIMER_TICKS_PER_SECOND     ( 32768 )
+
+//! Batch being filled
+typedef struct
+{
+    uint8_t size;               //! Readings that complete a batch
+    uint16_t deadlineS;         //! Longest wait of the first reading
+    uint16_t sequence;          //! Sequence number of the batch
+    uint8_t count;              //! Readings in the batch
+    uint64_t timestampMs;       //! Time of the first reading
+    uint8_t packet[ BATCH_HEADER_SIZE + ( BATCH_MAX_READINGS * BATCH_RECORD_SIZE ) ];
+} batch_s;
+
+static batch_s batch = { .size = BATCH_DEFAULT_SIZE, .deadlineS = BATCH_DEFAULT_DEADLINE_S };
+
+//! getCapacity()
+//! @brief Returns the number of readings that complete a batch: the
+//! configured size, or fewer if the smallest MTU among the subscribed
+//! clients cannot carry that many
+//!
+//! @param void
+//! @returns number of readings, at least 1
+static uint8_t getCapacity()
+{
+    uint16_t mtu = bleGetSubscriberMtu( gattdb_batch_data );
+    uint8_t fit = ( mtu - 3 - BATCH_HEADER_SIZE ) / BATCH_RECORD_SIZE;
+    uint8_t capacity = ( fit < batch.size ) ? fit : batch.size;
+    return ( capacity > 0 ) ? capacity : 1;
+}
+
+//! batchFlush()
+//! @brief Send the readings batched so far, if any
+//!
+//! @param void
+//! @returns void
+void batchFlush()
+{
+    if( batch.count == 0 )
+    {
+        return;
+    }
+    BTSTACK_CHECK_RESPONSE( gecko_cmd_hardware_set_soft_timer( 0, BATCH_SOFT_TIMER_HANDLE, 1 ) );
+
+    uint8_t *p = batch.packet;
+    UINT16_TO_BITSTREAM( p, batch.sequence );
+    UINT8_TO_BITSTREAM( p, batch.count );
+    UINT32_TO_BITSTREAM( p, ( uint32_t ) batch.timestampMs );
+    UINT32_TO_BITSTREAM( p, ( uint32_t ) ( batch.timestampMs >> 32 ) );
+    uint8_t length = BATCH_HEADER_SIZE + ( batch.count * BATCH_RECORD_SIZE );
+    uint8_t sent = bleSendToSubscribers( gattdb_batch_data, length, batch.packet );
+    ( void ) sent;
+    LOG_DEBUG( "Batch %u: %u readings, %u bytes, sent to %u clients", batch.sequence, batch.count, length, sent );
+
+    batch.sequence++;
+    batch.count = 0;
+    return;
+}
+
+//! batchAdd()
+//! @brief Add a temperature reading to the batch, and send the batch if
+//! it is complete. The first reading of a batch starts the deadline
+//!
+//! @param timestampMs time the reading was taken
+//! @param temperatureMilliC
+//! @returns void
+void batchAdd( uint64_t timestampMs, int32_t temperatureMilliC )
+{
+    if( ( batch.count > 0 ) && ( ( timestampMs - batch.timestampMs ) > UINT32_MAX ) )
+    {
+        batchFlush();
+    }
+    if( batch.count == 0 )
+    {
+        batch.timestampMs = timestampMs;
+        BTSTACK_CHECK_RESPONSE( gecko_cmd_hardware_set_soft_timer(
+            ( uint32_t ) batch.deadlineS * SOFT_TIMER_TICKS_PER_SECOND, BATCH_SOFT_TIMER_HANDLE, 1 ) );
+    }
+
+    // Round to hundredths of a degree, saturated to the record field
+    int32_t centiC = ( temperatureMilliC + ( ( temperatureMilliC < 0 ) ? -5 : 5 ) ) / 10;
+    centiC = ( centiC > INT16_MAX ) ? INT16_MAX : ( ( centiC < INT16_MIN ) ? INT16_MIN : centiC );
+    uint8_t *p = &batch.packet[ BATCH_HEADER_SIZE + ( batch.count * BATCH_RECORD_SIZE ) ];
+    UINT32_TO_BITSTREAM( p, ( uint32_t ) ( timestampMs - batch.timestampMs ) );
+    UINT16_TO_BITSTREAM( p, ( uint16_t ) ( int16_t ) centiC );
+    batch.count++;
+
+    if( batch.count >= getCapacity() )
+    {
+        batchFlush();
+    }
+    return;
+}
+
+//! batchSetConfig()
+//! @brief Set the number of readings per batch and the deadline. The
+//! readings batched under the previous settings are sent first
+//!
+//! @param size readings per batch, 1 to BATCH_MAX_READINGS
+//! @param deadlineS longest wait of a reading in seconds, at least 1
+//! @returns true if the settings are valid and applied
+bool batchSetConfig( uint8_t size, uint16_t deadlineS )
+{
+    if( ( size == 0 ) || ( size > BATCH_MAX_READINGS ) || ( deadlineS == 0 ) )
+    {
+        return false;
+    }
+    batchFlush();
+    batch.size = size;
+    batch.deadlineS = deadlineS;
+    return true;
+}
+
+//! batchGetSize()
+//! @brief Returns the configured number of readings per batch
+//!
+//! @param void
+//! @returns size
+uint8_t batchGetSize()
+{
+    return batch.size;
+}
+
+//! batchGetDeadline()
+//! @brief Returns the configured deadline
+//!
+//! @param void
+//! @returns deadline in seconds
+uint16_t batchGetDeadline()
+{
+    return batch.deadlineS;
+}
@@ -0,0 +1,61 @@
+//!
+//! @file batch.h
+//! @brief Packs several timestamped temperature readings into one
+//! notification. A batch is sent when it holds the configured number of
+//! readings, when it fills the payload, or when its oldest reading has
+//! waited for the configured deadline
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources Silicon Labs Bluetooth API reference (UG136) for soft timers
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#ifndef __BATCH_H___
+#define __BATCH_H___
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//! Notification of the Batch Data characteristic:
+//! uint16 batch sequence number, uint8 number of readings, uint64
+//! timestamp of the first reading in milliseconds. Each reading follows
+//! as uint32 milliseconds since the first reading and int16 temperature
+//! in units of 0.01 degrees Celsius. All fields are little endian
+#define BATCH_HEADER_SIZE       ( 11 )
+#define BATCH_RECORD_SIZE       ( 6 )
+
+//! Most readings a batch can hold, for an ATT MTU of 247
+#define BATCH_MAX_READINGS      ( ( 244 - BATCH_HEADER_SIZE ) / BATCH_RECORD_SIZE )
+
+//! Length of the Batch Config characteristic: uint8 readings per batch,
+//! uint16 deadline in seconds
+#define BATCH_CONFIG_LENGTH     ( 3 )
+
+//! Defaults until a client writes the Batch Config characteristic
+static const uint8_t BATCH_DEFAULT_SIZE = 8;
+static const uint16_t BATCH_DEFAULT_DEADLINE_S = 60;
+
+//! Bluetooth stack soft timer that sends a batch at its deadline
+static const uint8_t BATCH_SOFT_TIMER_HANDLE = 3;
+
+bool batchSetConfig( uint8_t size, uint16_t deadlineS );
+
+uint8_t batchGetSize();
+
+uint16_t batchGetDeadline();
+
+void batchAdd( uint64_t timestampMs, int32_t temperatureMilliC );
+
+void batchFlush();
+
+#endif // __BATCH_H___
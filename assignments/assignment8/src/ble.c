@@ -22,23 +22,51 @@
 #include "log.h"
 #include "scheduler.h"
 #include "display.h"
+#include "main.h"
+#include "conversions.h"
+#include "i2c.h"
+#include "history.h"
+#include "timebase.h"
+#include "batch.h"
 
 #include "gatt_db.h"
 #include "ble_device_type.h"
 #include "gecko_ble_errors.h"
+#include "infrastructure.h"
 
 #include <stdbool.h>
-#include <math.h>
+#include <string.h>
+#include <stdlib.h>
+
+//! ATT error for a Measurement Interval outside its Valid Range, also
+//! used for Batch Config. An HTM profile error code, the stack has no
+//! bg_err_att_* value for it
+static const uint8_t ATT_OUT_OF_RANGE = 0xFF;
 
 static volatile uint32_t passkey = 0;
 
-static gattStates_e currentClientState = GATT_IDLE;
+//! Servers the client connects to
+static const bd_addr SERVER_ADDRESSES[] = SERVER_BT_ADDRESSES;
+
+//! Number of servers in @ref SERVER_ADDRESSES
+#define CLIENT_NUMBER_OF_SERVERS    ( sizeof( SERVER_ADDRESSES ) / sizeof( SERVER_ADDRESSES[ 0 ] ) )
 
-static const bd_addr serverAddress = SERVER_BT_ADDRESS;
+//! Connection and discovery state of each server, in the order of
+//! @ref SERVER_ADDRESSES
+static clientServer_s servers[ CLIENT_NUMBER_OF_SERVERS ];
 
-static handles_s handles = { 0, 0, 0 };
+//! Aggregated stream of the temperatures of all servers, oldest first
+//! from streamHead. streamSequence counts every reading ever added
+static clientReading_s stream[ CLIENT_STREAM_LENGTH ];
+static uint8_t streamHead = 0;
+static uint8_t streamCount = 0;
+static uint32_t streamSequence = 0;
 
-static btAddress_s advertiser = {};
+//! Server a connection is being set up with, NULL if none
+static clientServer_s *connecting = NULL;
+
+//! True while the client scans for servers
+static bool scanning = false;
 
 static uuid_s htmService =
 {
@@ -52,154 +80,403 @@ static uuid_s htmCharacteristic =
     .len = 2
 };
 
-//! Flag indicating whether we have an open connection
-static bool deviceConnected = false;
-
-//! Flag indicating whether indications for temperature measurement have been turned on
-static bool readyForTemperature = false;
-
-// Original code from Dan Walkes. I (Sluiter) fixed a sign extension bug with the mantissa.
-// convert IEEE-11073 32-bit float to integer
-int32_t gattFloat32ToInt( const uint8_t *value_start_little_endian )
-{
-    uint8_t signByte = 0;
-    int32_t mantissa;
-    // data format pointed at by value_start_little_endian is:
-    // [0] = contains the flags byte
-    // [3][2][1] = mantissa (24-bit 2's complement)
-    // [4] = exponent (8-bit 2's complement)
-    int8_t exponent = ( int8_t ) value_start_little_endian[ 4 ];
-    // sign extend the mantissa value if the mantissa is negative
-    if( value_start_little_endian[ 3 ] & 0x80 )
-    { // msb of [3] is the sign of the mantissa
-        signByte = 0xFF;
-    }
-    mantissa = ( int32_t ) ( value_start_little_endian[ 1 ] << 0 ) |
-        ( value_start_little_endian[ 2 ] << 8 ) |
-        ( value_start_little_endian[ 3 ] << 16 ) |
-        ( signByte << 24 );
-        // value = 10^exponent * mantissa, pow() returns a double type
-    return ( int32_t ) ( pow( 10, exponent ) * mantissa );
-} // gattFloat32ToInt
-
-float gattUint32ToFloat( const uint8_t *value_start_little_endian )
-{
-    uint8_t signByte = 0;
-    int32_t mantissa;
-    // data format pointed at by value_start_little_endian is:
-    // [0] = contains the flags byte
-    // [3][2][1] = mantissa (24-bit 2's complement)
-    // [4] = exponent (8-bit 2's complement)
-    int8_t exponent = ( int8_t ) value_start_little_endian[ 4 ];
-    // sign extend the mantissa value if the mantissa is negative
-    if( value_start_little_endian[ 3 ] & 0x80 )
-    { // msb of [3] is the sign of the mantissa
-        signByte = 0xFF;
-    }
-    mantissa = ( int32_t ) ( value_start_little_endian[ 1 ] << 0 ) |
-        ( value_start_little_endian[ 2 ] << 8 ) |
-        ( value_start_little_endian[ 3 ] << 16 ) |
-        ( signByte << 24 );
-        // value = 10^exponent * mantissa, pow() returns a double type
-    return ( float ) ( pow( 10, exponent ) * mantissa );
+//! Client connections of the server, one slot per link
+static bleConnection_s connections[ BLE_MAX_CONNECTIONS ];
+
+//! True while connectable advertising is running
+static bool advertising = false;
+
+//! Characteristic value handle of each bleCccd_e
+static const uint16_t CCCD_CHARACTERISTICS[ BLE_NUMBER_OF_CCCDS ] =
+{
+    [ BLE_CCCD_TEMPERATURE ]            = gattdb_temperature_measurement,
+    [ BLE_CCCD_MEASUREMENT_INTERVAL ]   = gattdb_measurement_interval,
+    [ BLE_CCCD_HUMIDITY ]               = gattdb_humidity,
+    [ BLE_CCCD_HISTORY_DATA ]           = gattdb_history_data,
+    [ BLE_CCCD_BATCH_DATA ]             = gattdb_batch_data
+};
+
+//! findConnection()
+//! @brief Returns the context of an open connection
+//!
+//! @param connection
+//! @return pointer to context, NULL if the connection has none
+static bleConnection_s *findConnection( uint8_t connection )
+{
+    for( uint8_t i = 0; i < BLE_MAX_CONNECTIONS; i++ )
+    {
+        if( connections[ i ].inUse && ( connections[ i ].connection == connection ) )
+        {
+            return &connections[ i ];
+        }
+    }
+    return NULL;
+}
+
+//! allocateConnection()
+//! @brief Returns a free connection context
+//!
+//! @param void
+//! @return pointer to context, NULL if all are in use
+static bleConnection_s *allocateConnection()
+{
+    for( uint8_t i = 0; i < BLE_MAX_CONNECTIONS; i++ )
+    {
+        if( !connections[ i ].inUse )
+        {
+            return &connections[ i ];
+        }
+    }
+    return NULL;
+}
+
+//! getCccdIndex()
+//! @brief Returns the bleCccd_e of a characteristic value handle
+//!
+//! @param characteristic
+//! @return index, BLE_NUMBER_OF_CCCDS if the characteristic has no CCCD
+static bleCccd_e getCccdIndex( uint16_t characteristic )
+{
+    bleCccd_e index = 0;
+    while( ( index < BLE_NUMBER_OF_CCCDS ) && ( CCCD_CHARACTERISTICS[ index ] != characteristic ) )
+    {
+        index++;
+    }
+    return index;
+}
+
+//! hasSubscribers()
+//! @brief Asserts whether any client enabled notifications or
+//! indications of a characteristic
+//!
+//! @param index
+//! @return true if at least one connection subscribed
+static bool hasSubscribers( bleCccd_e index )
+{
+    for( uint8_t i = 0; i < BLE_MAX_CONNECTIONS; i++ )
+    {
+        if( connections[ i ].inUse && ( connections[ i ].clientConfig[ index ] != gatt_disable ) )
+        {
+            return true;
+        }
+    }
+    return false;
 }
 
 //! isReadyForTemperature()
-//! @brief Asserts whether clients is ready for server to transmit
+//! @brief Asserts whether any client is ready for server to transmit
 //! a temperature measurement, i.e. it has turned on indications
 //!
 //! @return true if ready
 bool isReadyForTemperature()
 {
-    return readyForTemperature;
+    return hasSubscribers( BLE_CCCD_TEMPERATURE );
+}
+
+//! isReadyForHumidity()
+//! @brief Asserts whether any client enabled notifications of the
+//! humidity characteristic
+//!
+//! @return true if ready
+bool isReadyForHumidity()
+{
+    return hasSubscribers( BLE_CCCD_HUMIDITY );
 }
 
 //! isConnected()
 //! @brief Returns the connected status of the bluetooth device
 //!
-//! @return true if there is an open connection
+//! @return true if there is at least one open connection
 //! @return false if no open connection
 bool isConnected()
 {
-    return deviceConnected;
+    return ( bleGetConnectionCount() > 0 );
 }
 
-//! getConnectionHandle()
-//! @brief Get the Connection Handle object
+//! bleGetConnectionCount()
+//! @brief Returns the number of open client connections
 //!
 //! @param void
-//! @return connectionHandle
-uint8_t getConnectionHandle()
+//! @return number of connections
+uint8_t bleGetConnectionCount()
 {
-    return handles.connection;
+    uint8_t count = 0;
+    for( uint8_t i = 0; i < BLE_MAX_CONNECTIONS; i++ )
+    {
+        count += connections[ i ].inUse ? 1 : 0;
+    }
+    return count;
 }
 
+//! bleIsSubscribed()
+//! @brief Asserts whether a connection enabled notifications or
+//! indications of a characteristic
 //!
-//! @brief Determines tx power based on rssi value received
+//! @param connection
+//! @param characteristic characteristic value handle
+//! @return true if subscribed
+bool bleIsSubscribed( uint8_t connection, uint16_t characteristic )
+{
+    bleConnection_s *context = findConnection( connection );
+    bleCccd_e index = getCccdIndex( characteristic );
+    return ( context != NULL ) && ( index < BLE_NUMBER_OF_CCCDS ) && ( context->clientConfig[ index ] != gatt_disable );
+}
+
+//! bleGetMtu()
+//! @brief Returns the ATT MTU negotiated on a connection
 //!
-//! @param rssi
-//! @return int16_t
+//! @param connection
+//! @return MTU, the default of 23 until the client exchanges a larger one
+uint16_t bleGetMtu( uint8_t connection )
+{
+    bleConnection_s *context = findConnection( connection );
+    return ( context != NULL ) ? context->mtu : BLE_DEFAULT_MTU;
+}
+
+//! bleGetSubscriberMtu()
+//! @brief Returns the smallest ATT MTU among the connections that enabled
+//! notifications or indications of a characteristic, which bounds a
+//! value sent to all of them
 //!
-int16_t determineTxPower( int8_t rssi )
+//! @param characteristic characteristic value handle
+//! @return MTU, the default of 23 if no connection subscribed
+uint16_t bleGetSubscriberMtu( uint16_t characteristic )
 {
-    int16_t txPower = 0;
-    if( rssi > -35 )
+    bleCccd_e index = getCccdIndex( characteristic );
+    uint16_t mtu = 0;
+    for( uint8_t i = 0; ( i < BLE_MAX_CONNECTIONS ) && ( index < BLE_NUMBER_OF_CCCDS ); i++ )
     {
-        txPower = MIN_TX_POWER;
+        if( connections[ i ].inUse && ( connections[ i ].clientConfig[ index ] != gatt_disable ) &&
+            ( ( mtu == 0 ) || ( connections[ i ].mtu < mtu ) ) )
+        {
+            mtu = connections[ i ].mtu;
+        }
     }
-    else if( ( rssi <= -35 ) && ( rssi > -45 ) )
+    return ( mtu != 0 ) ? mtu : BLE_DEFAULT_MTU;
+}
+
+//! getConnParams()
+//! @brief Returns the connection parameters of a profile. Steady state
+//! parameters let the server sleep through the connection events of one
+//! measurement interval, up to STEADY_MAX_SLEEP_MS
+//!
+//! @param mode
+//! @param params returned parameters
+//! @returns void
+static void getConnParams( bleConnParamsMode_e mode, bleConnParams_s *params )
+{
+    if( BLE_CONN_PARAMS_STEADY != mode )
     {
-        txPower = -200; // -20 dBm
+        *params = ( bleConnParams_s ) {
+            .minInterval = FAST_MIN_CONNECTION_INTERVAL,
+            .maxInterval = FAST_MAX_CONNECTION_INTERVAL,
+            .latency = FAST_SLAVE_LATENCY,
+            .timeout = FAST_SUPERVISION_TIMEOUT
+        };
+        return;
     }
-    else if( ( rssi <= -45 ) && ( rssi > -55 ) )
+
+    uint32_t sleepMs = ( uint32_t ) schedulerGetMeasurementInterval() * 1000;
+    sleepMs = ( sleepMs < STEADY_MAX_SLEEP_MS ) ? sleepMs : STEADY_MAX_SLEEP_MS;
+    uint32_t intervalMs = sleepMs / STEADY_EVENTS_PER_SLEEP;
+    intervalMs = ( intervalMs < STEADY_MIN_CONNECTION_INTERVAL_MS ) ? STEADY_MIN_CONNECTION_INTERVAL_MS : intervalMs;
+    intervalMs = ( intervalMs > STEADY_MAX_CONNECTION_INTERVAL_MS ) ? STEADY_MAX_CONNECTION_INTERVAL_MS : intervalMs;
+    uint32_t latency = ( sleepMs > intervalMs ) ? ( sleepMs / intervalMs ) - 1 : 0;
+    latency = ( latency > MAX_SLAVE_LATENCY ) ? MAX_SLAVE_LATENCY : latency;
+    uint32_t timeout = ( ( latency + 1 ) * intervalMs * STEADY_SUPERVISION_FACTOR ) / 10;
+    timeout = ( timeout < FAST_SUPERVISION_TIMEOUT ) ? FAST_SUPERVISION_TIMEOUT : timeout;
+    timeout = ( timeout > MAX_SUPERVISION_TIMEOUT ) ? MAX_SUPERVISION_TIMEOUT : timeout;
+
+    // Interval in units of 1.25 ms
+    params->minInterval = ( uint16_t ) ( ( intervalMs * 4 ) / 5 );
+    params->maxInterval = params->minInterval;
+    params->latency = ( uint16_t ) latency;
+    params->timeout = ( uint16_t ) timeout;
+    return;
+}
+
+//! setConnParams()
+//! @brief Request new parameters on a connection. The master applies
+//! them directly, the slave sends a connection parameter update request
+//!
+//! @param connection
+//! @param params
+//! @return true if the stack accepted the request
+static bool setConnParams( uint8_t connection, const bleConnParams_s *params )
+{
+    struct gecko_msg_le_connection_set_parameters_rsp_t *rsp;
+    rsp = gecko_cmd_le_connection_set_parameters( connection, params->minInterval, params->maxInterval,
+        params->latency, params->timeout );
+    if( rsp->result != bg_err_success )
     {
-        txPower = -150; // -15 dBm
+        LOG_WARN( "Connection parameter request on connection %d failed: %s", connection,
+            bleResponseString( rsp->result ) );
+        return false;
     }
-    else if( ( rssi <= -55 ) && ( rssi > -65 ) )
+    LOG_INFO( "CONNECTION PARAMETERS REQUESTED: connection handle: %d : connection interval: %d-%d : "
+        "slave latency: %d : supervision timeout: %d",
+        connection, params->minInterval, params->maxInterval, params->latency, params->timeout );
+    return true;
+}
+
+//! bleRequestConnParams()
+//! @brief Renegotiate the parameters of a client connection for the
+//! traffic it carries. A request for the profile already in use is
+//! skipped, unless the steady state parameters changed with the
+//! measurement interval
+//!
+//! @param connection
+//! @param mode
+//! @return void
+void bleRequestConnParams( uint8_t connection, bleConnParamsMode_e mode )
+{
+    bleConnection_s *context = findConnection( connection );
+    if( context == NULL )
     {
-        txPower = -50; // -5 dBm
+        return;
     }
-    else if( ( rssi <= -65 ) && ( rssi > -75 ) )
+    bleConnParams_s params;
+    getConnParams( mode, &params );
+    if( ( context->connParamsMode == mode ) && ( context->connParams.minInterval == params.minInterval ) &&
+        ( context->connParams.latency == params.latency ) && ( context->connParams.timeout == params.timeout ) )
     {
-        txPower = 0; // 0 dBm
+        return;
     }
-    else if( ( rssi <= -75 ) && ( rssi > -85 ) )
+    if( setConnParams( connection, &params ) )
     {
-        txPower = 50; // 5 dBm
+        context->connParamsMode = mode;
+        context->connParams = params;
     }
-    else if( rssi <= -85 )
+    return;
+}
+
+//! updateSteadyConnParams()
+//! @brief Renegotiate every connection in steady state after the
+//! measurement interval changed
+//!
+//! @param void
+//! @returns void
+static void updateSteadyConnParams()
+{
+    for( uint8_t i = 0; i < BLE_MAX_CONNECTIONS; i++ )
+    {
+        if( connections[ i ].inUse && ( BLE_CONN_PARAMS_STEADY == connections[ i ].connParamsMode ) )
+        {
+            bleRequestConnParams( connections[ i ].connection, BLE_CONN_PARAMS_STEADY );
+        }
+    }
+    return;
+}
+
+//! bleSendToSubscribers()
+//! @brief Send a characteristic value to every connection that enabled
+//! notifications or indications of it, in one pass over the connections.
+//! A connection still waiting for the confirmation of an indication
+//! misses the value, since ATT allows one indication in flight
+//!
+//! @param characteristic characteristic value handle
+//! @param length
+//! @param data
+//! @return number of connections the value was sent to
+uint8_t bleSendToSubscribers( uint16_t characteristic, uint8_t length, const uint8_t *data )
+{
+    bleCccd_e index = getCccdIndex( characteristic );
+    uint8_t sent = 0;
+    if( index >= BLE_NUMBER_OF_CCCDS )
+    {
+        return 0;
+    }
+
+    for( uint8_t i = 0; i < BLE_MAX_CONNECTIONS; i++ )
+    {
+        bleConnection_s *context = &connections[ i ];
+        if( !context->inUse || ( context->clientConfig[ index ] == gatt_disable ) )
+        {
+            continue;
+        }
+        bool indication = ( context->clientConfig[ index ] == gatt_indication );
+        if( indication && context->indicationPending )
+        {
+            LOG_DEBUG( "Connection %d still waits for a confirmation, characteristic 0x%X skipped",
+                context->connection, characteristic );
+            continue;
+        }
+        struct gecko_msg_gatt_server_send_characteristic_notification_rsp_t *rsp;
+        rsp = gecko_cmd_gatt_server_send_characteristic_notification( context->connection, characteristic,
+            length, data );
+        if( rsp->result != bg_err_success )
+        {
+            LOG_WARN( "Send to connection %d failed: %s", context->connection, bleResponseString( rsp->result ) );
+            continue;
+        }
+        if( indication )
+        {
+            // Cleared only by the confirmation or when the connection closes
+            context->indicationPending = true;
+        }
+        sent++;
+    }
+    return sent;
+}
+
+//! startAdvertising()
+//! @brief Start connectable advertising while there is a free connection
+//! slot. Advertising stops by itself when a client connects
+//!
+//! @param void
+//! @returns void
+static void startAdvertising()
+{
+    if( advertising || ( bleGetConnectionCount() >= BLE_MAX_CONNECTIONS ) )
     {
-        txPower = MAX_TX_POWER;
+        return;
     }
-    return txPower;
+    BTSTACK_CHECK_RESPONSE( gecko_cmd_le_gap_start_advertising(
+        0,
+        le_gap_general_discoverable,
+        le_gap_connectable_scannable ) );
+    advertising = true;
+    return;
 }
 
-//! setTxPower()
-//! @brief Set the TX power for bluetooth in a safe way while @n
-//! connection is open by: halting the system, calling BT API @n
-//! to set the TX power, and resuming system operation
+//! showConnections()
+//! @brief Show the number of connected clients on the display
 //!
-//! @param power
+//! @param void
 //! @returns void
-void setTxPower( int16_t power )
+static void showConnections()
 {
-    BTSTACK_CHECK_RESPONSE( gecko_cmd_system_halt( 1 ) );
-    // Set power
-    struct gecko_msg_system_set_tx_power_rsp_t *rsp;
-    rsp = gecko_cmd_system_set_tx_power( power );
-    if( rsp->set_power != power )
+    uint8_t count = bleGetConnectionCount();
+    if( count == 0 )
     {
-        LOG_WARN( "SET TX POWER: %.1f dBm : REQUESTED TX POWER: %.1f dBm)",
-            rsp->set_power * .10, power * .10 );
+        displayPrintf( DISPLAY_ROW_CONNECTION, "Advertising" );
     }
     else
     {
-        LOG_DEBUG( "TX POWER: %.1f dBm", rsp->set_power * 0.10 );
+        displayPrintf( DISPLAY_ROW_CONNECTION, "Connected (%u/%u)", count, BLE_MAX_CONNECTIONS );
     }
-    BTSTACK_CHECK_RESPONSE( gecko_cmd_system_halt( 0 ) );
     return;
 }
 
+//! getTxPowerLevel()
+//! @brief Returns the power level the weakest client connection needs,
+//! since the TX power applies to every link
+//!
+//! @param void
+//! @returns highest power level among the open connections
+static uint8_t getTxPowerLevel()
+{
+    uint8_t level = 0;
+    for( uint8_t i = 0; i < BLE_MAX_CONNECTIONS; i++ )
+    {
+        if( connections[ i ].inUse && ( connections[ i ].txPower.level > level ) )
+        {
+            level = connections[ i ].txPower.level;
+        }
+    }
+    return level;
+}
+
 //!
 //! @brief
 //!
@@ -219,6 +496,214 @@ void handleSystemBootEvent()
         rsp->address.addr[ 5 ] );
 }
 
+//! loadMeasurementInterval()
+//! @brief Apply the measurement interval saved in the persistent store,
+//! if there is one. Client reads are answered from the scheduler
+//!
+//! @param void
+//! @returns void
+static void loadMeasurementInterval()
+{
+    struct gecko_msg_flash_ps_load_rsp_t *rsp = gecko_cmd_flash_ps_load( PS_KEY_MEASUREMENT_INTERVAL );
+    if( ( rsp->result == bg_err_success ) && ( rsp->value.len == sizeof( uint16_t ) ) )
+    {
+        uint16_t interval = rsp->value.data[ 0 ] | ( rsp->value.data[ 1 ] << 8 );
+        schedulerSetMeasurementInterval( interval );
+    }
+    return;
+}
+
+//! handleMeasurementIntervalRead()
+//! @brief Answer a client read of the measurement interval from the
+//! interval the scheduler uses
+//!
+//! @param request user read request event data
+//! @returns void
+static void handleMeasurementIntervalRead( const struct gecko_msg_gatt_server_user_read_request_evt_t *request )
+{
+    uint16_t interval = schedulerGetMeasurementInterval();
+    uint8_t value[ 2 ] = { ( uint8_t ) interval, ( uint8_t ) ( interval >> 8 ) };
+
+    // ATT error codes are the low byte of the stack's bg_err_att_* values
+    if( request->offset > sizeof( value ) )
+    {
+        BTSTACK_CHECK_RESPONSE(
+            gecko_cmd_gatt_server_send_user_read_response( request->connection, request->characteristic,
+                ( uint8_t ) bg_err_att_invalid_offset, 0, NULL ) );
+        return;
+    }
+    BTSTACK_CHECK_RESPONSE(
+        gecko_cmd_gatt_server_send_user_read_response( request->connection, request->characteristic, 0,
+            sizeof( value ) - request->offset, &value[ request->offset ] ) );
+    return;
+}
+
+//! handleMeasurementIntervalWrite()
+//! @brief Validate a new measurement interval written by the client. An
+//! interval outside the Valid Range is refused with the HTM Out of Range
+//! error, so the client sees the failure. A valid interval is applied to
+//! the scheduler, persisted, and indicated to the client if it enabled
+//! indications
+//!
+//! @param request user write request event data
+//! @returns void
+static void handleMeasurementIntervalWrite( const struct gecko_msg_gatt_server_user_write_request_evt_t *request )
+{
+    uint16_t previous = schedulerGetMeasurementInterval();
+    uint16_t interval = previous;
+    uint8_t result = 0;
+
+    // ATT error codes are the low byte of the stack's bg_err_att_* values
+    if( ( request->offset != 0 ) || ( request->value.len != sizeof( uint16_t ) ) )
+    {
+        result = ( uint8_t ) bg_err_att_invalid_att_length;
+    }
+    else
+    {
+        interval = request->value.data[ 0 ] | ( request->value.data[ 1 ] << 8 );
+        if( !schedulerSetMeasurementInterval( interval ) )
+        {
+            result = ATT_OUT_OF_RANGE;
+        }
+    }
+
+    if( request->att_opcode == gatt_write_request )
+    {
+        BTSTACK_CHECK_RESPONSE(
+            gecko_cmd_gatt_server_send_user_write_response( request->connection, request->characteristic, result ) );
+    }
+    if( result != 0 )
+    {
+        LOG_WARN( "Rejected measurement interval write (len %u) : ATT error 0x%02X", request->value.len, result );
+        return;
+    }
+    if( interval == previous )
+    {
+        return;
+    }
+
+    uint8_t data[ 2 ] = { request->value.data[ 0 ], request->value.data[ 1 ] };
+    BTSTACK_CHECK_RESPONSE( gecko_cmd_flash_ps_save( PS_KEY_MEASUREMENT_INTERVAL, sizeof( data ), data ) );
+    bleSendToSubscribers( gattdb_measurement_interval, sizeof( data ), data );
+    updateSteadyConnParams();
+    return;
+}
+
+//! loadBatchConfig()
+//! @brief Apply the batch settings saved in the persistent store, if
+//! there are any. Client reads are answered from the batch module
+//!
+//! @param void
+//! @returns void
+static void loadBatchConfig()
+{
+    struct gecko_msg_flash_ps_load_rsp_t *rsp = gecko_cmd_flash_ps_load( PS_KEY_BATCH_CONFIG );
+    if( ( rsp->result == bg_err_success ) && ( rsp->value.len == BATCH_CONFIG_LENGTH ) )
+    {
+        batchSetConfig( rsp->value.data[ 0 ], rsp->value.data[ 1 ] | ( rsp->value.data[ 2 ] << 8 ) );
+    }
+    return;
+}
+
+//! handleBatchConfigRead()
+//! @brief Answer a client read of the batch settings from those the
+//! batch module uses
+//!
+//! @param request user read request event data
+//! @returns void
+static void handleBatchConfigRead( const struct gecko_msg_gatt_server_user_read_request_evt_t *request )
+{
+    uint16_t deadline = batchGetDeadline();
+    uint8_t value[ BATCH_CONFIG_LENGTH ] = { batchGetSize(), ( uint8_t ) deadline, ( uint8_t ) ( deadline >> 8 ) };
+
+    // ATT error codes are the low byte of the stack's bg_err_att_* values
+    if( request->offset > sizeof( value ) )
+    {
+        BTSTACK_CHECK_RESPONSE(
+            gecko_cmd_gatt_server_send_user_read_response( request->connection, request->characteristic,
+                ( uint8_t ) bg_err_att_invalid_offset, 0, NULL ) );
+        return;
+    }
+    BTSTACK_CHECK_RESPONSE(
+        gecko_cmd_gatt_server_send_user_read_response( request->connection, request->characteristic, 0,
+            sizeof( value ) - request->offset, &value[ request->offset ] ) );
+    return;
+}
+
+//! handleBatchConfigWrite()
+//! @brief Validate new batch settings written by the client. Settings
+//! the batch module refuses are answered with the Out of Range error,
+//! like the measurement interval. Valid settings are applied and
+//! persisted
+//!
+//! @param request user write request event data
+//! @returns void
+static void handleBatchConfigWrite( const struct gecko_msg_gatt_server_user_write_request_evt_t *request )
+{
+    const uint8_t *data = request->value.data;
+    uint8_t result = 0;
+
+    // ATT error codes are the low byte of the stack's bg_err_att_* values
+    if( ( request->offset != 0 ) || ( request->value.len != BATCH_CONFIG_LENGTH ) )
+    {
+        result = ( uint8_t ) bg_err_att_invalid_att_length;
+    }
+    else if( !batchSetConfig( data[ 0 ], data[ 1 ] | ( data[ 2 ] << 8 ) ) )
+    {
+        result = ATT_OUT_OF_RANGE;
+    }
+
+    if( request->att_opcode == gatt_write_request )
+    {
+        BTSTACK_CHECK_RESPONSE(
+            gecko_cmd_gatt_server_send_user_write_response( request->connection, request->characteristic, result ) );
+    }
+    if( result != 0 )
+    {
+        LOG_WARN( "Rejected batch config write (len %u) : ATT error 0x%02X", request->value.len, result );
+        return;
+    }
+
+    uint8_t value[ BATCH_CONFIG_LENGTH ] = { data[ 0 ], data[ 1 ], data[ 2 ] };
+    BTSTACK_CHECK_RESPONSE( gecko_cmd_flash_ps_save( PS_KEY_BATCH_CONFIG, sizeof( value ), value ) );
+    LOG_INFO( "Batches of %u readings, deadline %u s", batchGetSize(), batchGetDeadline() );
+    return;
+}
+
+//! handleI2cErrorCountersRead()
+//! @brief Answer a client read of the I2C error counters from their
+//! current values. Long reads continue from the requested offset
+//!
+//! @param request user read request event data
+//! @returns void
+static void handleI2cErrorCountersRead( const struct gecko_msg_gatt_server_user_read_request_evt_t *request )
+{
+    const i2cErrorStats_s *stats = i2cGetErrorStats();
+    const uint32_t counters[] =
+    {
+        stats->nack, stats->busErr, stats->arbLost, stats->timeout, stats->busRecoveries
+    };
+    uint8_t value[ sizeof( counters ) ];
+    uint8_t *p = value;
+    for( uint8_t i = 0; i < ( sizeof( counters ) / sizeof( counters[ 0 ] ) ); i++ )
+    {
+        UINT32_TO_BITSTREAM( p, counters[ i ] );
+    }
+
+    // ATT error codes are the low byte of the stack's bg_err_att_* values
+    if( request->offset > sizeof( value ) )
+    {
+        BTSTACK_CHECK_RESPONSE(
+            gecko_cmd_gatt_server_send_user_read_response( request->connection, request->characteristic,
+                ( uint8_t ) bg_err_att_invalid_offset, 0, NULL ) );
+        return;
+    }
+    BTSTACK_CHECK_RESPONSE(
+        gecko_cmd_gatt_server_send_user_read_response( request->connection, request->characteristic, 0,
+            sizeof( value ) - request->offset, &value[ request->offset ] ) );
+    return;
+}
+
 //! handleServerEvent()
 //! @brief Handles any event from the Bluetooth Stack for Server funcionality @n
 //! For example, @ref gecko_evt_system_boot, gecko_evt_le_connection_opened_id
@@ -237,7 +722,10 @@ bool handleServerEvent( struct gecko_cmd_packet *evt )
             displayPrintf( DISPLAY_ROW_CONNECTION, "Advertising" );
 
             BTSTACK_CHECK_RESPONSE( gecko_cmd_sm_delete_bondings() );
-            BTSTACK_CHECK_RESPONSE( gecko_cmd_flash_ps_erase_all() );
+
+            // Restore measurement interval and batch settings from persistent store
+            loadMeasurementInterval();
+            loadBatchConfig();
 
             // Configure SM to use MITM protection and display yes/no IO capabilities
             BTSTACK_CHECK_RESPONSE( gecko_cmd_sm_configure( 0x01, sm_io_capability_displayyesno ) );
@@ -252,10 +740,7 @@ bool handleServerEvent( struct gecko_cmd_packet *evt )
                 0 ) );
 
             // Start general advertising and enable connections
-            BTSTACK_CHECK_RESPONSE( gecko_cmd_le_gap_start_advertising(
-                0,
-                le_gap_general_discoverable,
-                le_gap_connectable_scannable ) );
+            startAdvertising();
             break;
         }
         case gecko_evt_system_external_signal_id:
@@ -265,16 +750,27 @@ bool handleServerEvent( struct gecko_cmd_packet *evt )
         }
         case gecko_evt_le_connection_opened_id:
         {
-            displayPrintf( DISPLAY_ROW_CONNECTION, "Connected" );
-            handles.connection = evt->data.evt_le_connection_opened.connection;
-            deviceConnected = true;
-            // Setting connection parameters
-            BTSTACK_CHECK_RESPONSE(
-                gecko_cmd_le_connection_set_parameters( evt->data.evt_le_connection_opened.connection,
-                    MIN_CONNECTION_INTERVAL,
-                    MAX_CONNECTION_INTERVAL,
-                    SLAVE_LATENCY,
-                    SUPERVISION_TIMEOUT ) );
+            // The stack stops advertising when a client connects
+            advertising = false;
+            bleConnection_s *context = allocateConnection();
+            if( context == NULL )
+            {
+                LOG_WARN( "No free connection context, closing connection %d",
+                    evt->data.evt_le_connection_opened.connection );
+                BTSTACK_CHECK_RESPONSE( gecko_cmd_le_connection_close( evt->data.evt_le_connection_opened.connection ) );
+                break;
+            }
+            *context = ( bleConnection_s ) {
+                .inUse = true,
+                .connection = evt->data.evt_le_connection_opened.connection,
+                .mtu = BLE_DEFAULT_MTU,
+                .phy = le_gap_phy_1m
+            };
+            txPowerLinkReset( &context->txPower );
+            showConnections();
+            startAdvertising();
+            // Short connection interval while the client discovers the database
+            bleRequestConnParams( context->connection, BLE_CONN_PARAMS_FAST );
 
             LOG_INFO( "CONNECTION OPENED: address: %X:%X:%X:%X:%X:%X : address_type: %d : master: 0x%X : "
                 "connection: 0x%X : bonding: 0x%X : advertiser: 0x%X",
@@ -293,29 +789,34 @@ bool handleServerEvent( struct gecko_cmd_packet *evt )
         }
         case gecko_evt_le_connection_parameters_id:
         {
-            if( handles.connection != evt->data.evt_le_connection_parameters.connection )
+            bleConnection_s *context = findConnection( evt->data.evt_le_connection_parameters.connection );
+            if( context == NULL )
             {
-                LOG_WARN( "Opened Connection /= Received Connection (%d/=%d)",
-                    handles.connection,
-                    evt->data.evt_le_connection_parameters.connection );
+                LOG_WARN( "Parameters for unknown connection %d", evt->data.evt_le_connection_parameters.connection );
+                break;
             }
-            else
+            context->securityMode = evt->data.evt_le_connection_parameters.security_mode;
+            LOG_INFO( "CONNECTION PARAMETERS: connection handle: %d : connection interval: %d : slave latency: %d :"
+                "supervision timout: %d : security mode: %d : tx size: %d",
+                evt->data.evt_le_connection_parameters.connection,
+                evt->data.evt_le_connection_parameters.interval,
+                evt->data.evt_le_connection_parameters.latency,
+                evt->data.evt_le_connection_parameters.timeout,
+                evt->data.evt_le_connection_parameters.security_mode,
+                evt->data.evt_le_connection_parameters.txsize );
+            if( ( context->connParamsMode != BLE_CONN_PARAMS_NONE ) &&
+                ( ( evt->data.evt_le_connection_parameters.interval < context->connParams.minInterval ) ||
+                  ( evt->data.evt_le_connection_parameters.interval > context->connParams.maxInterval ) ||
+                  ( evt->data.evt_le_connection_parameters.latency != context->connParams.latency ) ) )
             {
-                LOG_INFO( "CONNECTION PARAMETERS: connection handle: %d : connection interval: %d : slave latency: %d :"
-                    "supervision timout: %d : security mode: %d : tx size: %d",
-                    evt->data.evt_le_connection_parameters.connection,
-                    evt->data.evt_le_connection_parameters.interval,
-                    evt->data.evt_le_connection_parameters.latency,
-                    evt->data.evt_le_connection_parameters.timeout,
-                    evt->data.evt_le_connection_parameters.security_mode,
-                    evt->data.evt_le_connection_parameters.txsize );
+                LOG_WARN( "Connection %d did not take the requested parameters: interval %d-%d : latency %d",
+                    context->connection, context->connParams.minInterval, context->connParams.maxInterval,
+                    context->connParams.latency );
             }
-            deviceConnected = true;
             break;
         }
         case gecko_evt_gatt_server_characteristic_status_id:
         {
-            deviceConnected = true;
             LOG_DEBUG( "GATT SERVER STATUS: connection: 0x%X : characteristic: 0x%X : "
                 "status_flags: 0x%X : client_config_flags: 0x%X",
                 evt->data.evt_gatt_server_characteristic_status.connection,
@@ -323,70 +824,141 @@ bool handleServerEvent( struct gecko_cmd_packet *evt )
                 evt->data.evt_gatt_server_characteristic_status.status_flags,
                 evt->data.evt_gatt_server_characteristic_status.client_config_flags );
 
-            if( evt->data.evt_gatt_server_characteristic_status.connection != handles.connection )
+            bleConnection_s *context = findConnection( evt->data.evt_gatt_server_characteristic_status.connection );
+            if( context == NULL )
             {
-                LOG_WARN( "Opened Connection /= Received Connection (%d/=%d)",
-                    handles.connection,
-                    evt->data.evt_gatt_server_characteristic_status.connection );
-                readyForTemperature = false;
+                LOG_WARN( "Status for unknown connection %d", evt->data.evt_gatt_server_characteristic_status.connection );
                 break;
             }
-            // Determine if client is ready for temperature measurements by checking client_config_flags
-            if( ( evt->data.evt_gatt_server_characteristic_status.characteristic == gattdb_temperature_measurement ) &&
-                ( evt->data.evt_gatt_server_characteristic_status.status_flags == gatt_server_client_config ) )
+            if( evt->data.evt_gatt_server_characteristic_status.status_flags == gatt_server_client_config )
             {
-                if( evt->data.evt_gatt_server_characteristic_status.client_config_flags == gatt_indication )
+                // Record which of notifications or indications this client enabled
+                bleCccd_e index = getCccdIndex( evt->data.evt_gatt_server_characteristic_status.characteristic );
+                if( index < BLE_NUMBER_OF_CCCDS )
                 {
-                    readyForTemperature = true;
+                    context->clientConfig[ index ] = evt->data.evt_gatt_server_characteristic_status.client_config_flags;
+                }
+                if( index == BLE_CCCD_HISTORY_DATA )
+                {
+                    historySetNotifications( context->connection,
+                        ( context->clientConfig[ index ] == gatt_notification ) );
+                }
+                else if( ( index < BLE_NUMBER_OF_CCCDS ) && ( context->clientConfig[ index ] != gatt_disable ) &&
+                    !historyIsActive( context->connection ) )
+                {
+                    // Subscribing ends discovery, readings now arrive once per measurement interval
+                    bleRequestConnParams( context->connection, BLE_CONN_PARAMS_STEADY );
                 }
             }
-            else if( evt->data.evt_gatt_server_characteristic_status.client_config_flags == gatt_disable )
+            else if( evt->data.evt_gatt_server_characteristic_status.status_flags == gatt_server_confirmation )
             {
-                readyForTemperature = false;
+                context->indicationPending = false;
             }
 
             BTSTACK_CHECK_RESPONSE(
                 gecko_cmd_le_connection_get_rssi( evt->data.evt_gatt_server_characteristic_status.connection ) );
             break;
         }
+        case gecko_evt_gatt_server_user_read_request_id:
+        {
+            if( evt->data.evt_gatt_server_user_read_request.characteristic == gattdb_i2c_error_counters )
+            {
+                handleI2cErrorCountersRead( &evt->data.evt_gatt_server_user_read_request );
+            }
+            else if( evt->data.evt_gatt_server_user_read_request.characteristic == gattdb_measurement_interval )
+            {
+                handleMeasurementIntervalRead( &evt->data.evt_gatt_server_user_read_request );
+            }
+            else if( evt->data.evt_gatt_server_user_read_request.characteristic == gattdb_batch_config )
+            {
+                handleBatchConfigRead( &evt->data.evt_gatt_server_user_read_request );
+            }
+            else
+            {
+                BTSTACK_CHECK_RESPONSE(
+                    gecko_cmd_gatt_server_send_user_read_response(
+                        evt->data.evt_gatt_server_user_read_request.connection,
+                        evt->data.evt_gatt_server_user_read_request.characteristic,
+                        ( uint8_t ) bg_err_att_request_not_supported, 0, NULL ) );
+            }
+            break;
+        }
+        case gecko_evt_gatt_server_user_write_request_id:
+        {
+            if( evt->data.evt_gatt_server_user_write_request.characteristic == gattdb_measurement_interval )
+            {
+                handleMeasurementIntervalWrite( &evt->data.evt_gatt_server_user_write_request );
+            }
+            else if( evt->data.evt_gatt_server_user_write_request.characteristic == gattdb_batch_config )
+            {
+                handleBatchConfigWrite( &evt->data.evt_gatt_server_user_write_request );
+            }
+            else if( evt->data.evt_gatt_server_user_write_request.characteristic == gattdb_history_control )
+            {
+                historyHandleControlWrite( &evt->data.evt_gatt_server_user_write_request );
+            }
+            else if( evt->data.evt_gatt_server_user_write_request.att_opcode == gatt_write_request )
+            {
+                BTSTACK_CHECK_RESPONSE(
+                    gecko_cmd_gatt_server_send_user_write_response(
+                        evt->data.evt_gatt_server_user_write_request.connection,
+                        evt->data.evt_gatt_server_user_write_request.characteristic,
+                        ( uint8_t ) bg_err_att_request_not_supported ) );
+            }
+            break;
+        }
+        case gecko_evt_hardware_soft_timer_id:
+        {
+            if( evt->data.evt_hardware_soft_timer.handle == HISTORY_SOFT_TIMER_HANDLE )
+            {
+                historyPump();
+            }
+            else if( evt->data.evt_hardware_soft_timer.handle == BATCH_SOFT_TIMER_HANDLE )
+            {
+                batchFlush();
+            }
+            break;
+        }
         case gecko_evt_le_connection_rssi_id:
         {
             LOG_INFO( "CONNECTION RSSI: connection: %d : status: %d : rssi: %d",
                 evt->data.evt_le_connection_rssi.connection,
                 evt->data.evt_le_connection_rssi.status,
                 evt->data.evt_le_connection_rssi.rssi );
-            int16_t txPower = determineTxPower( evt->data.evt_le_connection_rssi.rssi );
-            setTxPower( txPower );
+            bleConnection_s *context = findConnection( evt->data.evt_le_connection_rssi.connection );
+            if( context != NULL )
+            {
+                context->rssi = evt->data.evt_le_connection_rssi.rssi;
+                txPowerLinkUpdate( &context->txPower, evt->data.evt_le_connection_rssi.rssi );
+                txPowerApply( getTxPowerLevel() );
+            }
             break;
         }
         case gecko_evt_le_connection_closed_id:
         {
-            displayPrintf( DISPLAY_ROW_CONNECTION, "Advertising" );
-            displayPrintf( DISPLAY_ROW_TEMPVALUE, "Temp = ---- C" );
-            if( handles.connection == evt->data.evt_le_connection_closed.connection )
+            LOG_DEBUG( "CONNECTION CLOSED: connection: %d : reason: %d",
+                evt->data.evt_le_connection_closed.connection,
+                evt->data.evt_le_connection_closed.reason );
+            historyConnectionClosed( evt->data.evt_le_connection_closed.connection );
+            bleConnection_s *context = findConnection( evt->data.evt_le_connection_closed.connection );
+            if( context != NULL )
             {
-                LOG_DEBUG( "CONNECTION CLOSED: connection: %d : reason: %d",
-                    evt->data.evt_le_connection_closed.connection,
-                    evt->data.evt_le_connection_closed.reason );
-                // Reset connection handle
-                handles.connection = 0;
+                context->inUse = false;
+                context->indicationPending = false;
             }
             else
             {
-                LOG_WARN( "Opened Connection /= Closed Connection (%d/=%d)",
-                    handles.connection,
-                    evt->data.evt_le_connection_closed.connection );
+                LOG_WARN( "Closed unknown connection %d", evt->data.evt_le_connection_closed.connection );
             }
 
-            setTxPower( 0 );
-            BTSTACK_CHECK_RESPONSE(
-                gecko_cmd_le_gap_start_advertising(
-                    0,
-                    le_gap_general_discoverable,
-                    le_gap_connectable_scannable ) );
-
-            schedulerSetEventConnectionLost();
-            deviceConnected = false;
+            showConnections();
+            startAdvertising();
+            if( !isConnected() )
+            {
+                displayPrintf( DISPLAY_ROW_TEMPVALUE, "Temp = ---- C" );
+                txPowerReset();
+                schedulerSetEventConnectionLost();
+            }
             break;
         }
         case gecko_evt_sm_confirm_passkey_id:
@@ -410,6 +982,11 @@ bool handleServerEvent( struct gecko_cmd_packet *evt )
             LOG_DEBUG( "PHY STATUS: connection: %d : phy: %d",
                 evt->data.evt_le_connection_phy_status.connection,
                 evt->data.evt_le_connection_phy_status.phy );
+            bleConnection_s *context = findConnection( evt->data.evt_le_connection_phy_status.connection );
+            if( context != NULL )
+            {
+                context->phy = evt->data.evt_le_connection_phy_status.phy;
+            }
             break;
         }
         case gecko_evt_gatt_mtu_exchanged_id:
@@ -417,11 +994,11 @@ bool handleServerEvent( struct gecko_cmd_packet *evt )
             LOG_DEBUG( "MTU EXCHANED: connection: %d : mtu: %d",
                 evt->data.evt_gatt_mtu_exchanged.connection,
                 evt->data.evt_gatt_mtu_exchanged.mtu );
-            break;
-        }
-        case gecko_evt_hardware_soft_timer_id:
-        {
-            displayUpdate();
+            bleConnection_s *context = findConnection( evt->data.evt_gatt_mtu_exchanged.connection );
+            if( context != NULL )
+            {
+                context->mtu = evt->data.evt_gatt_mtu_exchanged.mtu;
+            }
             break;
         }
         default:
@@ -434,24 +1011,199 @@ bool handleServerEvent( struct gecko_cmd_packet *evt )
     return eventHandled;
 }
 
+//! findServerByConnection()
+//! @brief Returns the server entry of an open or pending connection
+//!
+//! @param connection
+//! @return pointer to entry, NULL if no server uses the connection
+static clientServer_s *findServerByConnection( uint8_t connection )
+{
+    for( uint8_t i = 0; i < CLIENT_NUMBER_OF_SERVERS; i++ )
+    {
+        if( ( servers[ i ].state != CLIENT_SERVER_DISCONNECTED ) && ( servers[ i ].connection == connection ) )
+        {
+            return &servers[ i ];
+        }
+    }
+    return NULL;
+}
+
+//! findServerByAddress()
+//! @brief Returns the entry of a target server
+//!
+//! @param address
+//! @return pointer to entry, NULL if the address is not a target
+static clientServer_s *findServerByAddress( const bd_addr *address )
+{
+    for( uint8_t i = 0; i < CLIENT_NUMBER_OF_SERVERS; i++ )
+    {
+        if( 0 == memcmp( servers[ i ].peer.address.addr, address->addr, sizeof( address->addr ) ) )
+        {
+            return &servers[ i ];
+        }
+    }
+    return NULL;
+}
+
+//! startScanning()
+//! @brief Scan for target servers while one is not connected and no
+//! connection is being set up. The stack sets up one connection at a time
+//!
+//! @param void
+//! @returns void
+static void startScanning()
+{
+    if( scanning || ( connecting != NULL ) )
+    {
+        return;
+    }
+    for( uint8_t i = 0; i < CLIENT_NUMBER_OF_SERVERS; i++ )
+    {
+        if( servers[ i ].state == CLIENT_SERVER_DISCONNECTED )
+        {
+            BTSTACK_CHECK_RESPONSE( gecko_cmd_le_gap_start_discovery(
+                le_gap_phy_1m,
+                le_gap_general_discoverable
+            ) );
+            scanning = true;
+            return;
+        }
+    }
+    return;
+}
+
+//! showServers()
+//! @brief Show the number of servers handling indications on the display
+//!
+//! @param void
+//! @returns void
+static void showServers()
+{
+    uint8_t count = 0;
+    for( uint8_t i = 0; i < CLIENT_NUMBER_OF_SERVERS; i++ )
+    {
+        count += ( servers[ i ].gattState == GATT_HANDLING_INDICATIONS ) ? 1 : 0;
+    }
+    displayPrintf( DISPLAY_ROW_CONNECTION, "Servers %u/%u", count, CLIENT_NUMBER_OF_SERVERS );
+    return;
+}
+
+//! getClientTxPowerLevel()
+//! @brief Returns the power level the weakest server connection needs,
+//! since the TX power applies to every link
+//!
+//! @param void
+//! @returns highest power level among the connected servers
+static uint8_t getClientTxPowerLevel()
+{
+    uint8_t level = 0;
+    for( uint8_t i = 0; i < CLIENT_NUMBER_OF_SERVERS; i++ )
+    {
+        if( ( servers[ i ].state == CLIENT_SERVER_CONNECTED ) && ( servers[ i ].txPower.level > level ) )
+        {
+            level = servers[ i ].txPower.level;
+        }
+    }
+    return level;
+}
+
+//! handleTemperatureIndication()
+//! @brief Add a temperature from one server to the aggregated stream.
+//! Each server numbers its readings from 1 from the time it connected,
+//! and the stream numbers the readings of all servers in the order the
+//! client receives them
+//!
+//! @param server
+//! @param value HTM temperature measurement value
+//! @returns void
+static void handleTemperatureIndication( clientServer_s *server, const uint8_t *value )
+{
+    // Scale the IEEE-11073 exponent by 10^3 so that the integer
+    // conversion returns milli-degrees
+    uint8_t scaled[ 5 ] = { value[ 0 ], value[ 1 ], value[ 2 ], value[ 3 ], ( uint8_t ) ( ( int8_t ) value[ 4 ] + 3 ) };
+    int32_t milliC = gattFloat32ToInt( scaled );
+    server->sequence++;
+
+    // Overwrite the oldest reading once the stream is full
+    clientReading_s *reading = &stream[ ( streamHead + streamCount ) % CLIENT_STREAM_LENGTH ];
+    if( streamCount < CLIENT_STREAM_LENGTH )
+    {
+        streamCount++;
+    }
+    else
+    {
+        streamHead = ( streamHead + 1 ) % CLIENT_STREAM_LENGTH;
+    }
+    *reading = ( clientReading_s ) {
+        .sequence = ++streamSequence,
+        .timeMs = timeNowMs(),
+        .server = ( uint8_t ) ( server - servers ),
+        .serverSequence = server->sequence,
+        .milliC = milliC
+    };
+
+    LOG_INFO( "TEMPERATURE %lu : %lu ms : server %u : %X:%X:%X:%X:%X:%X : sequence %lu : %ld mC",
+        reading->sequence, ( uint32_t ) reading->timeMs, reading->server,
+        server->peer.address.addr[ 0 ], server->peer.address.addr[ 1 ], server->peer.address.addr[ 2 ],
+        server->peer.address.addr[ 3 ], server->peer.address.addr[ 4 ], server->peer.address.addr[ 5 ],
+        reading->serverSequence, reading->milliC );
+    // Round milli-degrees to tenths of a degree for the display
+    int32_t tenths = ( milliC + ( ( milliC < 0 ) ? -50 : 50 ) ) / 100;
+    displayPrintf( DISPLAY_ROW_TEMPVALUE, "Temp[%u] = %s%ld.%ld C", reading->server,
+        ( tenths < 0 ) ? "-" : "", labs( tenths ) / 10, labs( tenths ) % 10 );
+    return;
+}
+
+//! bleGetClientReadings()
+//! @brief Copy the most recent readings of the aggregated stream, oldest
+//! first. Gaps in the stream sequence numbers of consecutive calls tell
+//! the caller how many readings were overwritten in between
+//!
+//! @param readings buffer for up to max readings
+//! @param max
+//! @returns number of readings copied
+uint8_t bleGetClientReadings( clientReading_s *readings, uint8_t max )
+{
+    uint8_t count = ( streamCount < max ) ? streamCount : max;
+    uint8_t first = streamCount - count;
+    for( uint8_t i = 0; i < count; i++ )
+    {
+        readings[ i ] = stream[ ( streamHead + first + i ) % CLIENT_STREAM_LENGTH ];
+    }
+    return count;
+}
+
 //! handleClientEvent()
 //! @brief Handles any event from the BT stack for Client functionality @n
-//! E.g. start discovery of advertising devices, connect to discovered device,
-//! start discovery of services and characteristics, enable indications
+//! E.g. start discovery of advertising devices, connect to discovered devices,
+//! start discovery of services and characteristics, enable indications. @n
+//! Each target server has its own GATT discovery state, so several
+//! servers are served at the same time
 //!
 //! @param evt
 //! @returns true if event was handled, otherwise false
 bool handleClientEvent( struct gecko_cmd_packet *evt )
 {
-    gattStates_e nextClientState = currentClientState;
     bool eventHandled = true;
     switch( BGLIB_MSG_ID( evt->header ) )
     {
         case gecko_evt_system_boot_id:
         {
-            handleSystemBootEvent( evt );
+            handleSystemBootEvent();
             displayPrintf( DISPLAY_ROW_CONNECTION, "Discovering" );
 
+            // The stack starts with no scan or connection in progress
+            scanning = false;
+            connecting = NULL;
+            for( uint8_t i = 0; i < CLIENT_NUMBER_OF_SERVERS; i++ )
+            {
+                servers[ i ] = ( clientServer_s ) {
+                    .peer = { .address = SERVER_ADDRESSES[ i ] },
+                    .state = CLIENT_SERVER_DISCONNECTED,
+                    .gattState = GATT_IDLE
+                };
+            }
+
             BTSTACK_CHECK_RESPONSE( gecko_cmd_le_gap_set_discovery_type(
                 le_gap_phy_1m,
                 SCAN_TYPE
@@ -463,74 +1215,91 @@ bool handleClientEvent( struct gecko_cmd_packet *evt )
                 SCAN_WINDOW
             ) );
 
-            BTSTACK_CHECK_RESPONSE( gecko_cmd_le_gap_start_discovery(
-                le_gap_phy_1m,
-                le_gap_general_discoverable
-            ) );
+            startScanning();
             break;
         }
         case gecko_evt_le_gap_scan_response_id:
         {
-            advertiser.address = evt->data.evt_le_gap_scan_response.address;
-            advertiser.addressType = evt->data.evt_le_gap_scan_response.address_type;
-
-            if( ( advertiser.address.addr[ 0 ] == serverAddress.addr[ 0 ] ) &&
-                ( advertiser.address.addr[ 1 ] == serverAddress.addr[ 1 ] ) &&
-                ( advertiser.address.addr[ 2 ] == serverAddress.addr[ 2 ] ) &&
-                ( advertiser.address.addr[ 3 ] == serverAddress.addr[ 3 ] ) &&
-                ( advertiser.address.addr[ 4 ] == serverAddress.addr[ 4 ] ) &&
-                ( advertiser.address.addr[ 5 ] == serverAddress.addr[ 5 ] ) )
+            clientServer_s *server = findServerByAddress( &evt->data.evt_le_gap_scan_response.address );
+            if( ( server == NULL ) || ( server->state != CLIENT_SERVER_DISCONNECTED ) || ( connecting != NULL ) )
             {
-                displayPrintf( DISPLAY_ROW_BTADDR2, "%X:%X:%X:%X:%X:%X",
-                    advertiser.address.addr[ 0 ], advertiser.address.addr[ 1 ], advertiser.address.addr[ 2 ],
-                    advertiser.address.addr[ 3 ], advertiser.address.addr[ 4 ], advertiser.address.addr[ 5 ] );
+                break;
+            }
+            server->peer.addressType = evt->data.evt_le_gap_scan_response.address_type;
+            displayPrintf( DISPLAY_ROW_BTADDR2, "%X:%X:%X:%X:%X:%X",
+                server->peer.address.addr[ 0 ], server->peer.address.addr[ 1 ], server->peer.address.addr[ 2 ],
+                server->peer.address.addr[ 3 ], server->peer.address.addr[ 4 ], server->peer.address.addr[ 5 ] );
 
-                BTSTACK_CHECK_RESPONSE( gecko_cmd_le_gap_end_procedure() );
+            BTSTACK_CHECK_RESPONSE( gecko_cmd_le_gap_end_procedure() );
+            scanning = false;
 
-                BTSTACK_CHECK_RESPONSE( gecko_cmd_le_gap_connect(
-                    advertiser.address,
-                    advertiser.addressType,
-                    le_gap_phy_1m
-                ) );
+            struct gecko_msg_le_gap_connect_rsp_t *rsp;
+            rsp = gecko_cmd_le_gap_connect( server->peer.address, server->peer.addressType, le_gap_phy_1m );
+            if( rsp->result != bg_err_success )
+            {
+                LOG_WARN( "Connect to server %u failed: %s", ( uint8_t ) ( server - servers ),
+                    bleResponseString( rsp->result ) );
+                startScanning();
+                break;
+            }
+            server->connection = rsp->connection;
+            server->state = CLIENT_SERVER_CONNECTING;
+            connecting = server;
+            // A server that stopped advertising would otherwise hold up the others
+            BTSTACK_CHECK_RESPONSE(
+                gecko_cmd_hardware_set_soft_timer( CLIENT_CONNECT_TIMEOUT_TICKS, CLIENT_CONNECT_SOFT_TIMER_HANDLE, 1 ) );
+            break;
+        }
+        case gecko_evt_hardware_soft_timer_id:
+        {
+            if( ( evt->data.evt_hardware_soft_timer.handle == CLIENT_CONNECT_SOFT_TIMER_HANDLE ) && ( connecting != NULL ) )
+            {
+                LOG_WARN( "Connect to server %u timed out", ( uint8_t ) ( connecting - servers ) );
+                // Cancels the attempt, gecko_evt_le_connection_closed_id follows
+                BTSTACK_CHECK_RESPONSE( gecko_cmd_le_connection_close( connecting->connection ) );
             }
             break;
         }
         case gecko_evt_le_connection_opened_id:
         {
-            if( currentClientState == GATT_IDLE )
+            clientServer_s *server = findServerByConnection( evt->data.evt_le_connection_opened.connection );
+            if( server == NULL )
             {
-                nextClientState = GATT_WAITING_FOR_SERVICES_DISCOVERY;
-                displayPrintf( DISPLAY_ROW_CONNECTION, "Connected" );
+                LOG_WARN( "Opened unknown connection %d", evt->data.evt_le_connection_opened.connection );
+                BTSTACK_CHECK_RESPONSE( gecko_cmd_le_connection_close( evt->data.evt_le_connection_opened.connection ) );
+                break;
             }
-            handles.connection = evt->data.evt_le_connection_opened.connection;
-            BTSTACK_CHECK_RESPONSE( gecko_cmd_le_connection_set_parameters(
-                handles.connection,
-                MIN_CONNECTION_INTERVAL,
-                MAX_CONNECTION_INTERVAL,
-                SLAVE_LATENCY,
-                SUPERVISION_TIMEOUT
-            ) );
+            if( server == connecting )
+            {
+                BTSTACK_CHECK_RESPONSE( gecko_cmd_hardware_set_soft_timer( 0, CLIENT_CONNECT_SOFT_TIMER_HANDLE, 1 ) );
+                connecting = NULL;
+            }
+            server->state = CLIENT_SERVER_CONNECTED;
+            server->sequence = 0;
+            txPowerLinkReset( &server->txPower );
+            // Short connection interval for discovery. The server knows its
+            // measurement interval and requests the steady state parameters
+            // once indications are enabled
+            bleConnParams_s params;
+            getConnParams( BLE_CONN_PARAMS_FAST, &params );
+            setConnParams( server->connection, &params );
 
             BTSTACK_CHECK_RESPONSE( gecko_cmd_gatt_discover_primary_services_by_uuid(
-                handles.connection,
+                server->connection,
                 htmService.len,
                 htmService.data
             ) );
+            server->gattState = GATT_WAITING_FOR_SERVICES_DISCOVERY;
 
-            if( currentClientState == GATT_IDLE )
-            {
-                nextClientState = GATT_WAITING_FOR_SERVICES_DISCOVERY;
-            }
-
+            // Look for the servers that are not connected yet
+            startScanning();
             break;
         }
         case gecko_evt_le_connection_parameters_id:
         {
-            if( handles.connection != evt->data.evt_le_connection_parameters.connection )
+            if( findServerByConnection( evt->data.evt_le_connection_parameters.connection ) == NULL )
             {
-                LOG_WARN( "Opened Connection /= Received Connection (%d/=%d)",
-                    handles.connection,
-                    evt->data.evt_le_connection_parameters.connection );
+                LOG_WARN( "Parameters for unknown connection %d", evt->data.evt_le_connection_parameters.connection );
             }
             else
             {
@@ -547,14 +1316,17 @@ bool handleClientEvent( struct gecko_cmd_packet *evt )
         }
         case gecko_evt_gatt_service_id:
         {
-            if( currentClientState == GATT_WAITING_FOR_SERVICES_DISCOVERY )
+            clientServer_s *server = findServerByConnection( evt->data.evt_gatt_service.connection );
+            if( ( server == NULL ) || ( server->gattState != GATT_WAITING_FOR_SERVICES_DISCOVERY ) )
             {
-                nextClientState = GATT_SERVICES_DISCOVERED;
+                break;
             }
-            handles.service = evt->data.evt_gatt_service.service;
             if( 0 == memcmp( evt->data.evt_gatt_service.uuid.data, htmService.data, htmService.len ) )
             {
-                LOG_INFO( "GATT Service: service: 0x%lX : uuid: 0x%02X%02X",
+                server->service = evt->data.evt_gatt_service.service;
+                server->gattState = GATT_SERVICES_DISCOVERED;
+                LOG_INFO( "GATT Service: connection: %d : service: 0x%lX : uuid: 0x%02X%02X",
+                    server->connection,
                     evt->data.evt_gatt_service.service,
                     evt->data.evt_gatt_service.uuid.data[ 0 ],
                     evt->data.evt_gatt_service.uuid.data[ 1 ] );
@@ -563,14 +1335,17 @@ bool handleClientEvent( struct gecko_cmd_packet *evt )
         }
         case gecko_evt_gatt_characteristic_id:
         {
-            if( currentClientState == GATT_WAITING_FOR_CHARACTERISTICS_DISCOVERY )
+            clientServer_s *server = findServerByConnection( evt->data.evt_gatt_characteristic.connection );
+            if( ( server == NULL ) || ( server->gattState != GATT_WAITING_FOR_CHARACTERISTICS_DISCOVERY ) )
             {
-                nextClientState = GATT_CHARACTERISTICS_DISCOVERED;
+                break;
             }
-            handles.characteristic = evt->data.evt_gatt_characteristic.characteristic;
             if( 0 == memcmp( evt->data.evt_gatt_characteristic.uuid.data, htmCharacteristic.data, htmCharacteristic.len ) )
             {
-                LOG_INFO( "GATT Characteristic: characteristic: 0x%04X : uuid: 0x%02X%02X",
+                server->characteristic = evt->data.evt_gatt_characteristic.characteristic;
+                server->gattState = GATT_CHARACTERISTICS_DISCOVERED;
+                LOG_INFO( "GATT Characteristic: connection: %d : characteristic: 0x%04X : uuid: 0x%02X%02X",
+                    server->connection,
                     evt->data.evt_gatt_characteristic.characteristic,
                     evt->data.evt_gatt_characteristic.uuid.data[ 1 ],
                     evt->data.evt_gatt_characteristic.uuid.data[ 0 ] );
@@ -579,61 +1354,77 @@ bool handleClientEvent( struct gecko_cmd_packet *evt )
         }
         case gecko_evt_gatt_characteristic_value_id:
         {
-            if( currentClientState == GATT_WAITING_FOR_CHARACTERISTIC_VALUE )
+            clientServer_s *server = findServerByConnection( evt->data.evt_gatt_characteristic_value.connection );
+            if( server == NULL )
             {
-                nextClientState = GATT_IDLE;
-                displayPrintf( DISPLAY_ROW_CONNECTION, "Handling Indications" );
+                break;
             }
 
             if( evt->data.evt_gatt_characteristic_value.att_opcode == gatt_handle_value_indication )
             {
-                BTSTACK_CHECK_RESPONSE( gecko_cmd_gatt_send_characteristic_confirmation( handles.connection ) );
+                BTSTACK_CHECK_RESPONSE( gecko_cmd_gatt_send_characteristic_confirmation( server->connection ) );
+            }
+
+            if( server->gattState == GATT_WAITING_FOR_CHARACTERISTIC_VALUE )
+            {
+                server->gattState = GATT_HANDLING_INDICATIONS;
+                showServers();
             }
 
-            if( evt->data.evt_gatt_characteristic_value.characteristic == gattdb_temperature_measurement )
+            if( evt->data.evt_gatt_characteristic_value.characteristic == server->characteristic )
             {
-                uint8_t *p = evt->data.evt_gatt_characteristic_value.value.data;
-                float ftemp = gattUint32ToFloat( p );
-                displayPrintf( DISPLAY_ROW_TEMPVALUE, "Temp = %3.1f C", ftemp );
+                handleTemperatureIndication( server, evt->data.evt_gatt_characteristic_value.value.data );
             }
 
             BTSTACK_CHECK_RESPONSE(
-                gecko_cmd_le_connection_get_rssi( handles.connection ) );
+                gecko_cmd_le_connection_get_rssi( server->connection ) );
 
             break;
         }
         case gecko_evt_gatt_procedure_completed_id:
         {
+            clientServer_s *server = findServerByConnection( evt->data.evt_gatt_procedure_completed.connection );
             if( evt->data.evt_gatt_procedure_completed.result != bg_err_success )
             {
                 LOG_WARN( "GATT Procedure Completed: connection: 0x%x : result: %s",
                     evt->data.evt_gatt_procedure_completed.connection,
                     bleResponseString( evt->data.evt_gatt_procedure_completed.result ) );
             }
-            switch( currentClientState )
+            if( server == NULL )
+            {
+                break;
+            }
+            switch( server->gattState )
             {
                 case GATT_SERVICES_DISCOVERED:
                 {
-                    handles.connection = evt->data.evt_gatt_procedure_completed.connection;
-
                     BTSTACK_CHECK_RESPONSE( gecko_cmd_gatt_discover_characteristics_by_uuid(
-                        handles.connection,
-                        handles.service,
+                        server->connection,
+                        server->service,
                         htmCharacteristic.len,
                         htmCharacteristic.data
                     ) );
 
-                    nextClientState = GATT_WAITING_FOR_CHARACTERISTICS_DISCOVERY;
+                    server->gattState = GATT_WAITING_FOR_CHARACTERISTICS_DISCOVERY;
                     break;
                 }
                 case GATT_CHARACTERISTICS_DISCOVERED:
                 {
                     BTSTACK_CHECK_RESPONSE( gecko_cmd_gatt_set_characteristic_notification(
-                        handles.connection,
-                        handles.characteristic,
+                        server->connection,
+                        server->characteristic,
                         gatt_indication
                     ) );
-                    nextClientState = GATT_WAITING_FOR_CHARACTERISTIC_VALUE;
+                    server->gattState = GATT_WAITING_FOR_CHARACTERISTIC_VALUE;
+                    break;
+                }
+                case GATT_WAITING_FOR_SERVICES_DISCOVERY:
+                case GATT_WAITING_FOR_CHARACTERISTICS_DISCOVERY:
+                {
+                    // Procedure ended without finding the Health Thermometer
+                    LOG_WARN( "Server %u does not expose a temperature measurement, disconnecting",
+                        ( uint8_t ) ( server - servers ) );
+                    BTSTACK_CHECK_RESPONSE( gecko_cmd_le_connection_close( server->connection ) );
                     break;
                 }
                 case GATT_WAITING_FOR_CHARACTERISTIC_VALUE:
@@ -641,7 +1432,6 @@ bool handleClientEvent( struct gecko_cmd_packet *evt )
                     // Remain in this state until gecko_evt_gatt_characteristic_value_id event occurs
                     // If timeout occurs, gecko_evt_le_connection_closed_id is triggered by the BT stack
                     // and the state machine is reset
-                    nextClientState = currentClientState;
                     break;
                 }
                 default:
@@ -651,18 +1441,25 @@ bool handleClientEvent( struct gecko_cmd_packet *evt )
         }
         case gecko_evt_le_connection_closed_id:
         {
+            clientServer_s *server = findServerByConnection( evt->data.evt_le_connection_closed.connection );
+            LOG_INFO( "CONNECTION CLOSED: connection: %d : reason: %s",
+                evt->data.evt_le_connection_closed.connection,
+                bleResponseString( evt->data.evt_le_connection_closed.reason ) );
+            if( server != NULL )
+            {
+                if( server == connecting )
+                {
+                    BTSTACK_CHECK_RESPONSE( gecko_cmd_hardware_set_soft_timer( 0, CLIENT_CONNECT_SOFT_TIMER_HANDLE, 1 ) );
+                    connecting = NULL;
+                }
+                server->state = CLIENT_SERVER_DISCONNECTED;
+                server->gattState = GATT_IDLE;
+                server->service = 0;
+                server->characteristic = 0;
+            }
+            showServers();
             displayPrintf( DISPLAY_ROW_BTADDR2, " " );
-            displayPrintf( DISPLAY_ROW_CONNECTION, "Discovering" );
-            displayPrintf( DISPLAY_ROW_TEMPVALUE, "" );
-
-            nextClientState = GATT_IDLE;
-            handles.connection = 0;
-            handles.service = 0;
-            handles.characteristic = 0;
-            BTSTACK_CHECK_RESPONSE( gecko_cmd_le_gap_start_discovery(
-                le_gap_phy_1m,
-                le_gap_general_discoverable
-            ) );
+            startScanning();
             break;
         }
         case gecko_evt_le_connection_rssi_id:
@@ -671,22 +1468,17 @@ bool handleClientEvent( struct gecko_cmd_packet *evt )
                 evt->data.evt_le_connection_rssi.connection,
                 evt->data.evt_le_connection_rssi.status,
                 evt->data.evt_le_connection_rssi.rssi );
-            int16_t txPower = determineTxPower( evt->data.evt_le_connection_rssi.rssi );
-            setTxPower( txPower );
-            break;
-        }
-        case gecko_evt_hardware_soft_timer_id:
-        {
-            displayUpdate();
+            clientServer_s *server = findServerByConnection( evt->data.evt_le_connection_rssi.connection );
+            if( server != NULL )
+            {
+                txPowerLinkUpdate( &server->txPower, evt->data.evt_le_connection_rssi.rssi );
+                txPowerApply( getClientTxPowerLevel() );
+            }
             break;
         }
         default:
             break;
     }
-    if( currentClientState != nextClientState )
-    {
-        currentClientState = nextClientState;
-    }
 
     return eventHandled;
 }
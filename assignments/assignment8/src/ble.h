@@ -22,6 +22,7 @@
 
 #include "native_gecko.h"
 #include "ble_device_type.h"
+#include "txpower.h"
 
 //! Advertising interval given in units of (value * 0.625) ms, so 400 * 0.625 = 250ms advertising interval
 static const uint16_t MAX_ADVERTISING_INTERVAL = 400;
@@ -37,28 +38,83 @@ static const uint16_t SCAN_INTERVAL = 64;
 static const uint16_t SCAN_WINDOW = 32;
 //static const uint16_t SCAN_WINDOW = 400;
 
-//! Connection interval given in units of (value * 1.25) ms, so 60 * 1.25 = 75 ms connection interval
-static const uint16_t MAX_CONNECTION_INTERVAL = 60;
-//! Connection interval given in units of (value * 1.25) ms, so 60 * 1.25 = 75 ms connection interval
-static const uint16_t MIN_CONNECTION_INTERVAL = 60;
-//! Number of connection intervals slave is allowed to skip if no data is present
-//! 4 * 75ms intervals = 300ms for slave latency
-static const uint16_t SLAVE_LATENCY = 4;
-//! Supervision timeout in milliseconds should be (1 + slave latency) * max_interval * 2
-//! The math works out to a timeout of at least 750 ms, but the input is in
-//! increments of 10 ms, so at least an input of value of 75 should work
-static const uint16_t SUPERVISION_TIMEOUT = 150;
-
-//! Maximum TX Power in steps of 0.1 dBm (10.5 dBm)
-static const int16_t MAX_TX_POWER = 105;
-//! Minimum TX Power in steps of 0.1 dBm (-30 dBm)
-static const int16_t MIN_TX_POWER = -300;
+//! Connection parameters while a client discovers the GATT database or
+//! downloads history: 7.5 to 15 ms connection interval in units of 1.25 ms,
+//! no slave latency, and a 1 s supervision timeout in units of 10 ms
+static const uint16_t FAST_MIN_CONNECTION_INTERVAL = 6;
+static const uint16_t FAST_MAX_CONNECTION_INTERVAL = 12;
+static const uint16_t FAST_SLAVE_LATENCY = 0;
+static const uint16_t FAST_SUPERVISION_TIMEOUT = 100;
+
+//! Bounds of the steady state connection interval in milliseconds. The
+//! interval is a quarter of the time the server sleeps between
+//! connection events, so writes from the client are served within a
+//! fraction of the measurement interval
+static const uint32_t STEADY_MIN_CONNECTION_INTERVAL_MS = 75;
+static const uint32_t STEADY_MAX_CONNECTION_INTERVAL_MS = 1000;
+static const uint32_t STEADY_EVENTS_PER_SLEEP = 4;
+//! Longest time the server skips connection events in steady state. Up to
+//! this bound it sleeps for a whole measurement interval, which is when it
+//! has data to send
+static const uint32_t STEADY_MAX_SLEEP_MS = 6000;
+//! Supervision timeout in milliseconds must exceed
+//! (1 + slave latency) * max_interval * 2. Steady state uses three times
+//! the sleep time so that two missed wake ups do not drop the link
+static const uint32_t STEADY_SUPERVISION_FACTOR = 3;
+//! Limits of the Bluetooth specification
+static const uint16_t MAX_SLAVE_LATENCY = 499;
+static const uint16_t MAX_SUPERVISION_TIMEOUT = 3200;
+
+//! Connection parameter profiles, renegotiated as the traffic changes
+typedef enum
+{
+    BLE_CONN_PARAMS_NONE,       //! Nothing requested yet
+    BLE_CONN_PARAMS_FAST,       //! Discovery and bulk history transfer
+    BLE_CONN_PARAMS_STEADY      //! Periodic sampling, derived from the measurement interval
+} bleConnParamsMode_e;
 
+//! Connection parameters in the units of gecko_cmd_le_connection_set_parameters
+typedef struct {
+    uint16_t minInterval;       //! Units of 1.25 ms
+    uint16_t maxInterval;       //! Units of 1.25 ms
+    uint16_t latency;           //! Connection events the slave may skip
+    uint16_t timeout;           //! Supervision timeout in units of 10 ms
+} bleConnParams_s;
+
+//! Number of simultaneous client connections the server keeps a context
+//! for. Must match MAX_CONNECTIONS in gecko_main.c, which sizes the
+//! Bluetooth stack heap
+#define BLE_MAX_CONNECTIONS     ( 4 )
+
+//! ATT MTU of a connection until the client exchanges a larger one
+static const uint16_t BLE_DEFAULT_MTU = 23;
+
+//! Characteristics a client can subscribe to, indexing the CCCD state
+//! kept per connection
+typedef enum
+{
+    BLE_CCCD_TEMPERATURE,
+    BLE_CCCD_MEASUREMENT_INTERVAL,
+    BLE_CCCD_HUMIDITY,
+    BLE_CCCD_HISTORY_DATA,
+    BLE_CCCD_BATCH_DATA,
+    BLE_NUMBER_OF_CCCDS
+} bleCccd_e;
+
+//! State of one client connection on the server
 typedef struct {
-    uint8_t connection;
-    uint32_t service;
-    uint16_t characteristic;
-} handles_s;
+    bool inUse;                 //! Slot holds an open connection
+    uint8_t connection;         //! Connection handle
+    uint8_t clientConfig[ BLE_NUMBER_OF_CCCDS ]; //! gatt_client_config_flag written by the client
+    bool indicationPending;     //! An indication waits for its confirmation
+    uint16_t mtu;               //! Negotiated ATT MTU
+    uint8_t phy;                //! PHY in use, le_gap_phy_type
+    int8_t rssi;                //! Last RSSI reading in dBm
+    uint8_t securityMode;       //! Security mode of the link, le_connection_security
+    bleConnParamsMode_e connParamsMode; //! Profile last requested for the link
+    bleConnParams_s connParams; //! Parameters last requested for the link
+    txPowerLink_s txPower;      //! Power control state of the link
+} bleConnection_s;
 
 typedef struct {
     bd_addr address;
@@ -77,6 +133,7 @@ typedef enum {
     GATT_WAITING_FOR_CHARACTERISTICS_DISCOVERY,
     GATT_CHARACTERISTICS_DISCOVERED,
     GATT_WAITING_FOR_CHARACTERISTIC_VALUE,
+    GATT_HANDLING_INDICATIONS,
     GATT_NUMBER_OF_STATES
 } gattStates_e;
 
@@ -87,9 +144,49 @@ static const char *clientStateStrings[] = {
     "GATT_SERVICES_DISCOVERED",
     "GATT_WAITING_FOR_CHARACTERISTICS_DISCOVERY",
     "GATT_CHARACTERISTICS_DISCOVERED",
-    "GATT_WAITING_FOR_CHARACTERISTIC_VALUE"
+    "GATT_WAITING_FOR_CHARACTERISTIC_VALUE",
+    "GATT_HANDLING_INDICATIONS"
 };
 
+//! Link state of a server on the client
+typedef enum {
+    CLIENT_SERVER_DISCONNECTED = 0,
+    CLIENT_SERVER_CONNECTING,
+    CLIENT_SERVER_CONNECTED
+} clientServerState_e;
+
+//! Server the client connects to, with its own GATT discovery state
+typedef struct {
+    btAddress_s peer;               //! Address of the server
+    clientServerState_e state;      //! Link state
+    uint8_t connection;             //! Connection handle while not disconnected
+    gattStates_e gattState;         //! Discovery state on this connection
+    uint32_t service;               //! Health Thermometer service handle
+    uint16_t characteristic;        //! Temperature Measurement value handle
+    uint32_t sequence;              //! Temperatures received since the server connected
+    txPowerLink_s txPower;          //! Power control state of the link
+} clientServer_s;
+
+//! Temperature in the aggregated stream of the client. The servers send
+//! no timestamp, so readings are stamped and ordered by the time the
+//! client receives them
+typedef struct {
+    uint32_t sequence;              //! Position in the aggregated stream, from 1
+    uint64_t timeMs;                //! Time the client received the reading
+    uint8_t server;                 //! Index of the server in SERVER_BT_ADDRESSES
+    uint32_t serverSequence;        //! Sequence number of the reading on its server
+    int32_t milliC;                 //! Temperature in milli-degrees Celsius
+} clientReading_s;
+
+//! Most recent readings of the aggregated stream kept by the client
+#define CLIENT_STREAM_LENGTH        ( 16 )
+
+//! Bluetooth stack soft timer that limits a connection attempt
+static const uint8_t CLIENT_CONNECT_SOFT_TIMER_HANDLE = 2;
+
+//! Time allowed to set up a connection in 32768 Hz ticks, 3 seconds
+static const uint32_t CLIENT_CONNECT_TIMEOUT_TICKS = 3 * 32768;
+
 //! getClientStateString()
 //! @brief Returns the string representation of the
 //! input schedulerStates_e by indexing into clientStateStrings
@@ -109,19 +206,25 @@ static inline const char *getClientStateString( gattStates_e st )
 }
 
 
-int32_t gattFloat32ToInt( const uint8_t *value_start_little_endian );
-
-float gattUint32ToFloat( const uint8_t *value_start_little_endian );
-
 bool isReadyForTemperature();
 
+bool isReadyForHumidity();
+
 bool isConnected();
 
-uint8_t getConnectionHandle();
+uint8_t bleGetConnectionCount();
+
+bool bleIsSubscribed( uint8_t connection, uint16_t characteristic );
+
+uint16_t bleGetMtu( uint8_t connection );
+
+uint16_t bleGetSubscriberMtu( uint16_t characteristic );
+
+uint8_t bleSendToSubscribers( uint16_t characteristic, uint8_t length, const uint8_t *data );
 
-int16_t determineTxPower( int8_t rssi );
+void bleRequestConnParams( uint8_t connection, bleConnParamsMode_e mode );
 
-void setTxPower( int16_t power );
+uint8_t bleGetClientReadings( clientReading_s *readings, uint8_t max );
 
 void handleSystemBootEvent();
 
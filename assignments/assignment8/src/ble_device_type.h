@@ -13,11 +13,20 @@
  * Set to 1 to configure this build as a BLE server.
  * Set to 0 to configure as a BLE client
  */
+#ifndef DEVICE_IS_BLE_SERVER
 #define DEVICE_IS_BLE_SERVER 1
+#endif
 
 //! Statically defined server address AA:2C:61:CC:CC:CC
 #define SERVER_BT_ADDRESS {{ 0xAA, 0x2C, 0x61, 0xCC, 0xCC, 0xCC }}
 
+//! Servers a client build connects to at the same time, at most
+//! BLE_MAX_CONNECTIONS. Add an entry per thermometer, or define the list
+//! for the build
+#ifndef SERVER_BT_ADDRESSES
+#define SERVER_BT_ADDRESSES { SERVER_BT_ADDRESS }
+#endif
+
 #if DEVICE_IS_BLE_SERVER
 #define BUILD_INCLUDES_BLE_SERVER 1
 #define BUILD_INCLUDES_BLE_CLIENT 0
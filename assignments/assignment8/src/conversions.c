@@ -0,0 +1,186 @@
+//!
+//! @file conversions.c
+//! @brief Implements the unit conversions without double precision math
+//! or pow()
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources Si7021-A20 datasheet for the conversion formulas
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#include "conversions.h"
+
+//! Si7021 temperature conversion, T = ( 175.72 * code / 65536 ) - 46.85,
+//! evaluated in milli-degrees as ( SCALE * code - OFFSET ) / DIVISOR.
+//! SCALE and OFFSET are 175720 and ( 46850 * 65536 ) scaled by 2^18, each
+//! with a small correction term so the result truncates exactly like the
+//! previous double-precision expression for every 16-bit raw code
+static const int64_t SI7021_TEMP_SCALE = ( 175720LL << 18 ) + 16;
+static const int64_t SI7021_TEMP_OFFSET = ( ( 46850LL << 18 ) + 7 ) << 16;
+static const int64_t SI7021_TEMP_DIVISOR = 1LL << 34;
+
+//! Si7021 humidity conversion, RH = ( 125 * code / 65536 ) - 6, evaluated
+//! in milli-percent with 125000 / 65536 reduced to 15625 / 8192
+static const int32_t SI7021_HUMIDITY_SCALE = 15625;
+static const uint8_t SI7021_HUMIDITY_SHIFT = 13;
+static const int32_t SI7021_HUMIDITY_OFFSET = 6000;
+static const int32_t SI7021_HUMIDITY_MAX = 100000;
+
+//! Powers of ten representable in an int32_t, indexed by exponent
+static const int32_t POWERS_OF_TEN[] =
+{
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+//! Largest exponent in @ref POWERS_OF_TEN
+static const int8_t MAX_POWER_OF_TEN = ( sizeof( POWERS_OF_TEN ) / sizeof( POWERS_OF_TEN[ 0 ] ) ) - 1;
+
+//! Powers of ten that are exact in single precision, indexed by exponent
+static const float POWERS_OF_TEN_F[] =
+{
+    1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+};
+
+//! Largest exponent in @ref POWERS_OF_TEN_F
+static const int8_t MAX_POWER_OF_TEN_F = ( sizeof( POWERS_OF_TEN_F ) / sizeof( POWERS_OF_TEN_F[ 0 ] ) ) - 1;
+
+//! si7021TemperatureMilliC()
+//! @brief Converts a raw Si7021 temperature code to milli-degrees Celsius
+//! using integer math only. See @ref SI7021_TEMP_SCALE
+//!
+//! @param code raw code, bits below the measurement resolution cleared
+//! @returns temperature in milli-degrees Celsius
+int32_t si7021TemperatureMilliC( uint16_t code )
+{
+    return ( int32_t ) ( ( ( SI7021_TEMP_SCALE * code ) - SI7021_TEMP_OFFSET ) / SI7021_TEMP_DIVISOR );
+}
+
+//! si7021HumidityMilliPct()
+//! @brief Converts a raw Si7021 RH code to milli-percent using integer
+//! math only, clamped to 0..100 % as the datasheet recommends
+//!
+//! @param code raw code, bits below the measurement resolution cleared
+//! @returns relative humidity in milli-percent
+int32_t si7021HumidityMilliPct( uint16_t code )
+{
+    int32_t humidity = ( ( SI7021_HUMIDITY_SCALE * ( int32_t ) code ) >> SI7021_HUMIDITY_SHIFT ) - SI7021_HUMIDITY_OFFSET;
+    if( humidity < 0 )
+    {
+        return 0;
+    }
+    if( humidity > SI7021_HUMIDITY_MAX )
+    {
+        return SI7021_HUMIDITY_MAX;
+    }
+    return humidity;
+}
+
+//! letimerPrescalerShift()
+//! @brief Returns the power of two the LETIMER0 clock is divided by so
+//! that a period of ticks fits the 16-bit counter. The prescaler is
+//! 1 << shift, and the period and tick frequency are shifted right by it
+//!
+//! @param ticks period in undivided clock ticks
+//! @returns shift, 0 if ticks already fits
+uint8_t letimerPrescalerShift( uint32_t ticks )
+{
+    if( ticks <= UINT16_MAX )
+    {
+        return 0;
+    }
+    return ( uint8_t ) ( ticks / UINT16_MAX );
+}
+
+// Original code from Dan Walkes. I (Sluiter) fixed a sign extension bug with the mantissa.
+// convert IEEE-11073 32-bit float to integer
+int32_t gattFloat32ToInt( const uint8_t *value_start_little_endian )
+{
+    uint8_t signByte = 0;
+    int32_t mantissa;
+    // data format pointed at by value_start_little_endian is:
+    // [0] = contains the flags byte
+    // [3][2][1] = mantissa (24-bit 2's complement)
+    // [4] = exponent (8-bit 2's complement)
+    int8_t exponent = ( int8_t ) value_start_little_endian[ 4 ];
+    // sign extend the mantissa value if the mantissa is negative
+    if( value_start_little_endian[ 3 ] & 0x80 )
+    { // msb of [3] is the sign of the mantissa
+        signByte = 0xFF;
+    }
+    mantissa = ( int32_t ) ( value_start_little_endian[ 1 ] << 0 ) |
+        ( value_start_little_endian[ 2 ] << 8 ) |
+        ( value_start_little_endian[ 3 ] << 16 ) |
+        ( signByte << 24 );
+    // value = 10^exponent * mantissa, scaled with a lookup table instead of pow()
+    if( ( mantissa == 0 ) || ( exponent < -MAX_POWER_OF_TEN ) )
+    {
+        // |mantissa| < 2^23, so the value truncates to 0
+        return 0;
+    }
+    if( exponent < 0 )
+    {
+        return mantissa / POWERS_OF_TEN[ -exponent ];
+    }
+    if( exponent <= MAX_POWER_OF_TEN )
+    {
+        int64_t value = ( int64_t ) mantissa * POWERS_OF_TEN[ exponent ];
+        if( ( value <= INT32_MAX ) && ( value >= INT32_MIN ) )
+        {
+            return ( int32_t ) value;
+        }
+    }
+    // Saturate values that do not fit in 32 bits
+    return ( mantissa > 0 ) ? INT32_MAX : INT32_MIN;
+} // gattFloat32ToInt
+
+// Same as gattFloat32ToInt() but returns the value in single precision.
+// Exponents of -10 to 10 round exactly like the double precision
+// pow( 10, exponent ) * mantissa did. Larger exponents are scaled by 10^10
+// more than once, each step may add an error of one unit in the last place
+float gattUint32ToFloat( const uint8_t *value_start_little_endian )
+{
+    uint8_t signByte = 0;
+    int32_t mantissa;
+    // data format pointed at by value_start_little_endian is:
+    // [0] = contains the flags byte
+    // [3][2][1] = mantissa (24-bit 2's complement)
+    // [4] = exponent (8-bit 2's complement)
+    int8_t exponent = ( int8_t ) value_start_little_endian[ 4 ];
+    // sign extend the mantissa value if the mantissa is negative
+    if( value_start_little_endian[ 3 ] & 0x80 )
+    { // msb of [3] is the sign of the mantissa
+        signByte = 0xFF;
+    }
+    mantissa = ( int32_t ) ( value_start_little_endian[ 1 ] << 0 ) |
+        ( value_start_little_endian[ 2 ] << 8 ) |
+        ( value_start_little_endian[ 3 ] << 16 ) |
+        ( signByte << 24 );
+    // value = 10^exponent * mantissa, computed in single precision. The
+    // 24-bit mantissa and the table entries are exact as floats
+    float value = ( float ) mantissa;
+    while( exponent > MAX_POWER_OF_TEN_F )
+    {
+        value *= POWERS_OF_TEN_F[ MAX_POWER_OF_TEN_F ];
+        exponent -= MAX_POWER_OF_TEN_F;
+    }
+    while( exponent < -MAX_POWER_OF_TEN_F )
+    {
+        value /= POWERS_OF_TEN_F[ MAX_POWER_OF_TEN_F ];
+        exponent += MAX_POWER_OF_TEN_F;
+    }
+    if( exponent < 0 )
+    {
+        return value / POWERS_OF_TEN_F[ -exponent ];
+    }
+    return value * POWERS_OF_TEN_F[ exponent ];
+}
@@ -0,0 +1,38 @@
+//!
+//! @file conversions.h
+//! @brief Integer and single precision unit conversions used by the timer,
+//! I2C and BLE modules. Kept free of hardware dependencies so the host
+//! checks in test/ can sweep them against the double precision
+//! expressions they replaced
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources Si7021-A20 datasheet for the conversion formulas
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#ifndef __CONVERSIONS_H___
+#define __CONVERSIONS_H___
+
+#include <stdint.h>
+
+int32_t si7021TemperatureMilliC( uint16_t code );
+
+int32_t si7021HumidityMilliPct( uint16_t code );
+
+uint8_t letimerPrescalerShift( uint32_t ticks );
+
+int32_t gattFloat32ToInt( const uint8_t *value_start_little_endian );
+
+float gattUint32ToFloat( const uint8_t *value_start_little_endian );
+
+#endif // __CONVERSIONS_H___
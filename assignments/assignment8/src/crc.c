@@ -0,0 +1,42 @@
+//!
+//! @file crc.c
+//! @brief Implements CRC-32 (IEEE 802.3, reflected)
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources None
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#include "crc.h"
+
+//! crc32()
+//! @brief Bitwise CRC-32. Only run once per flash record or page, so a
+//! table is not worth the flash
+//!
+//! @param data
+//! @param length in bytes
+//! @returns CRC
+uint32_t crc32( const void *data, size_t length )
+{
+    const uint8_t *p = data;
+    uint32_t crc = 0xFFFFFFFF;
+    while( length-- )
+    {
+        crc ^= *p++;
+        for( uint8_t bit = 0; bit < 8; bit++ )
+        {
+            crc = ( crc >> 1 ) ^ ( 0xEDB88320 & -( crc & 1 ) );
+        }
+    }
+    return ~crc;
+}
@@ -0,0 +1,28 @@
+//!
+//! @file crc.h
+//! @brief CRC-32 used to protect records stored in flash
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources None
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#ifndef __CRC_H___
+#define __CRC_H___
+
+#include <stdint.h>
+#include <stddef.h>
+
+uint32_t crc32( const void *data, size_t length );
+
+#endif // __CRC_H___
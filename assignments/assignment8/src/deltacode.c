@@ -0,0 +1,250 @@
+//!
+//! @file deltacode.c
+//! @brief Implements the variable length delta code. A zero delta that
+//! follows another is merged into the code before it, so a steady signal
+//! costs about a sixth of a bit per sample, and noise of one unit costs
+//! three bits per sample
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources None
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#include "deltacode.h"
+
+//! Codes with their prefix in the low bits, as they are written
+#define DELTA_CODE_PLUS_ONE     ( 0x1 )     //! 10 0
+#define DELTA_CODE_MINUS_ONE    ( 0x5 )     //! 10 1
+#define DELTA_CODE_SMALL        ( 0x3 )     //! 110, then 4 bits
+#define DELTA_CODE_RUN          ( 0x7 )     //! 1110, then 6 bits
+#define DELTA_CODE_LARGE        ( 0xF )     //! 1111, then 16 bits
+
+//! Length of each code in bits
+#define DELTA_CODE_ZERO_BITS    ( 1 )
+#define DELTA_CODE_ONE_BITS     ( 3 )
+#define DELTA_CODE_SMALL_BITS   ( 7 )
+#define DELTA_CODE_RUN_BITS     ( 10 )
+
+//! writeBits()
+//! @brief Write the low bits of a value at a bit position, least
+//! significant bit first
+//!
+//! @param data
+//! @param pos bit position
+//! @param value
+//! @param bits number of bits to write
+//! @returns void
+static void writeBits( uint8_t *data, uint16_t pos, uint32_t value, uint8_t bits )
+{
+    for( uint8_t i = 0; i < bits; i++, pos++ )
+    {
+        uint8_t mask = ( uint8_t ) ( 1 << ( pos & 7 ) );
+        if( value & ( 1UL << i ) )
+        {
+            data[ pos >> 3 ] |= mask;
+        }
+        else
+        {
+            data[ pos >> 3 ] &= ( uint8_t ) ~mask;
+        }
+    }
+    return;
+}
+
+//! readBits()
+//! @brief Read bits at the position of a reader and move past them
+//!
+//! @param reader
+//! @param bits number of bits to read
+//! @param value read bits, least significant bit first
+//! @returns false if the buffer ends first
+static bool readBits( deltaReader_s *reader, uint8_t bits, uint32_t *value )
+{
+    if( ( reader->pos + bits ) > reader->sizeBits )
+    {
+        return false;
+    }
+    *value = 0;
+    for( uint8_t i = 0; i < bits; i++, reader->pos++ )
+    {
+        if( reader->data[ reader->pos >> 3 ] & ( 1 << ( reader->pos & 7 ) ) )
+        {
+            *value |= ( 1UL << i );
+        }
+    }
+    return true;
+}
+
+//! deltaWriterInit()
+//! @brief Start writing codes at the beginning of a buffer
+//!
+//! @param writer
+//! @param data buffer, its content is overwritten as codes are added
+//! @param sizeBytes
+//! @returns void
+void deltaWriterInit( deltaWriter_s *writer, uint8_t *data, uint16_t sizeBytes )
+{
+    writer->data = data;
+    writer->sizeBits = sizeBytes * 8;
+    writer->lengthBits = 0;
+    writer->runPos = 0;
+    writer->run = 0;
+    return;
+}
+
+//! deltaWriterPut()
+//! @brief Append a delta. A zero delta extends the zero or run code
+//! before it when it can
+//!
+//! @param writer
+//! @param delta
+//! @returns false if the delta is outside 16 bits or the buffer is full
+bool deltaWriterPut( deltaWriter_s *writer, int32_t delta )
+{
+    if( ( delta < INT16_MIN ) || ( delta > INT16_MAX ) )
+    {
+        return false;
+    }
+
+    if( ( delta == 0 ) && ( writer->run >= 2 ) && ( writer->run < DELTA_CODE_RUN_MAX ) )
+    {
+        writer->run++;
+        writeBits( writer->data, writer->runPos + 4, writer->run - 2, 6 );
+        return true;
+    }
+    if( ( delta == 0 ) && ( writer->run == 1 ) &&
+        ( ( writer->runPos + DELTA_CODE_RUN_BITS ) <= writer->sizeBits ) )
+    {
+        // Turn the single zero, always the last code, into a run of two
+        writer->run = 2;
+        writeBits( writer->data, writer->runPos, DELTA_CODE_RUN, DELTA_CODE_RUN_BITS );
+        writer->lengthBits = writer->runPos + DELTA_CODE_RUN_BITS;
+        return true;
+    }
+
+    uint32_t zigzag = ( ( uint32_t ) delta << 1 ) ^ ( uint32_t ) ( delta >> 31 );
+    uint32_t code;
+    uint8_t bits;
+    if( delta == 0 )
+    {
+        code = 0;
+        bits = DELTA_CODE_ZERO_BITS;
+    }
+    else if( ( delta == 1 ) || ( delta == -1 ) )
+    {
+        code = ( delta > 0 ) ? DELTA_CODE_PLUS_ONE : DELTA_CODE_MINUS_ONE;
+        bits = DELTA_CODE_ONE_BITS;
+    }
+    else if( zigzag < 16 )
+    {
+        code = DELTA_CODE_SMALL | ( zigzag << 3 );
+        bits = DELTA_CODE_SMALL_BITS;
+    }
+    else
+    {
+        code = DELTA_CODE_LARGE | ( zigzag << 4 );
+        bits = DELTA_CODE_MAX_BITS;
+    }
+    if( ( writer->lengthBits + bits ) > writer->sizeBits )
+    {
+        return false;
+    }
+
+    writer->runPos = writer->lengthBits;
+    writer->run = ( delta == 0 ) ? 1 : 0;
+    writeBits( writer->data, writer->lengthBits, code, bits );
+    writer->lengthBits += bits;
+    return true;
+}
+
+//! deltaReaderInit()
+//! @brief Start reading codes at the beginning of a buffer
+//!
+//! @param reader
+//! @param data
+//! @param sizeBytes
+//! @returns void
+void deltaReaderInit( deltaReader_s *reader, const uint8_t *data, uint16_t sizeBytes )
+{
+    reader->data = data;
+    reader->sizeBits = sizeBytes * 8;
+    reader->pos = 0;
+    reader->run = 0;
+    return;
+}
+
+//! deltaReaderGet()
+//! @brief Read the next delta. The caller knows how many deltas were
+//! written and reads no more than that
+//!
+//! @param reader
+//! @param delta
+//! @returns false if the buffer ends in the middle of a code
+bool deltaReaderGet( deltaReader_s *reader, int32_t *delta )
+{
+    *delta = 0;
+    if( reader->run > 0 )
+    {
+        reader->run--;
+        return true;
+    }
+
+    // Count the ones of the prefix, up to four
+    uint8_t ones = 0;
+    uint32_t bit = 1;
+    while( ( ones < 4 ) && bit )
+    {
+        if( !readBits( reader, 1, &bit ) )
+        {
+            return false;
+        }
+        ones += bit;
+    }
+
+    uint32_t field = 0;
+    switch( ones )
+    {
+        case 0:
+            break;
+        case 1:
+            if( !readBits( reader, 1, &field ) )
+            {
+                return false;
+            }
+            *delta = field ? -1 : 1;
+            break;
+        case 2:
+            if( !readBits( reader, 4, &field ) )
+            {
+                return false;
+            }
+            *delta = ( int32_t ) ( field >> 1 ) ^ -( int32_t ) ( field & 1 );
+            break;
+        case 3:
+            if( !readBits( reader, 6, &field ) )
+            {
+                return false;
+            }
+            // This call returns the first zero of the run
+            reader->run = ( uint8_t ) ( field + 1 );
+            break;
+        default:
+            if( !readBits( reader, 16, &field ) )
+            {
+                return false;
+            }
+            *delta = ( int32_t ) ( field >> 1 ) ^ -( int32_t ) ( field & 1 );
+            break;
+    }
+    return true;
+}
@@ -0,0 +1,67 @@
+//!
+//! @file deltacode.h
+//! @brief Variable length code for the differences between consecutive
+//! samples of a slowly changing quantity. Codes are packed bit by bit,
+//! least significant bit first, and a run of unchanged samples shares one
+//! code:
+//!   0                      one zero delta
+//!   10 s                   +1 (s = 0) or -1 (s = 1)
+//!   110 zzzz               delta of -8 to 7, zigzag coded
+//!   1110 nnnnnn            n + 2 zero deltas
+//!   1111 zzzzzzzzzzzzzzzz  any 16-bit delta, zigzag coded
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources None
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#ifndef __DELTACODE_H___
+#define __DELTACODE_H___
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//! Most zero deltas a single run code holds
+#define DELTA_CODE_RUN_MAX      ( 65 )
+
+//! Longest code in bits
+#define DELTA_CODE_MAX_BITS     ( 20 )
+
+//! Writer appending codes to a caller owned buffer
+typedef struct
+{
+    uint8_t *data;          //! Code buffer
+    uint16_t sizeBits;      //! Capacity of the buffer in bits
+    uint16_t lengthBits;    //! Bits written
+    uint16_t runPos;        //! Bit position of the last code if it holds zeros
+    uint8_t run;            //! Zeros in the last code, 0 if it holds a nonzero delta
+} deltaWriter_s;
+
+//! Reader walking the codes of a buffer
+typedef struct
+{
+    const uint8_t *data;    //! Code buffer
+    uint16_t sizeBits;      //! Size of the buffer in bits
+    uint16_t pos;           //! Bit position of the next code
+    uint8_t run;            //! Zeros left from the last run code
+} deltaReader_s;
+
+void deltaWriterInit( deltaWriter_s *writer, uint8_t *data, uint16_t sizeBytes );
+
+bool deltaWriterPut( deltaWriter_s *writer, int32_t delta );
+
+void deltaReaderInit( deltaReader_s *reader, const uint8_t *data, uint16_t sizeBytes );
+
+bool deltaReaderGet( deltaReader_s *reader, int32_t *delta );
+
+#endif // __DELTACODE_H___
@@ -31,7 +31,8 @@
 #include "display.h"
 #include "hardware/kit/common/drivers/display.h"
 #include "scheduler.h" // Add a reference to your module supporting scheduler events for display update
-//#include "timer.h" // Add a reference to your module supporting configuration of underflow events here
+#include "swtimers.h" // Add a reference to your module supporting configuration of underflow events here
+#include "spibus.h"
 
 
 #if ECEN5823_INCLUDE_DISPLAY_SUPPORT
@@ -44,6 +45,10 @@
  * The number of rows
  */
 #define DISPLAY_ROW_NUMBER_OF_ROWS	 8
+/**
+ * Period of the EXTCOMIN toggle in microseconds
+ */
+#define DISPLAY_EXTCOMIN_PERIOD_US	 1000000
 
 /**
  * A structure containing information about the data we want to display on a given
@@ -54,6 +59,15 @@ struct display_data {
 	 * tracks the state of the extcomin pin for toggling purposes
 	 */
 	bool last_extcomin_state_high;
+	/**
+	 * software timer used to toggle the extcomin pin
+	 */
+	swTimer_s extcomin_timer;
+	/**
+	 * true if the frame buffer changed while the SPI bus was taken by the
+	 * external flash, and still has to be sent to the LCD
+	 */
+	bool update_pending;
 	/**
 	 * GLIB_Context required for use with GLIB_ functions
 	 */
@@ -80,6 +94,8 @@ static struct display_data *displayGetData() {
  */
 extern size_t strnlen(const char *, size_t);
 
+static void displaySendFrame(struct display_data *display);
+
 /**
  * Write the display data in the buffer represented by @param display to the device
  */
@@ -120,7 +136,22 @@ static void displayUpdateWriteBuffer(struct display_data *display)
 			}
 		}
 	}
-	result = DMD_updateDisplay();
+	displaySendFrame(display);
+}
+
+/**
+ * Send the frame buffer to the LCD, or leave it for displayFlush() if the
+ * SPI bus it shares with the external flash is taken
+ */
+static void displaySendFrame(struct display_data *display)
+{
+	if( !spiBusAcquire(SPI_BUS_DISPLAY) ) {
+		display->update_pending = true;
+		return;
+	}
+	display->update_pending = false;
+	EMSTATUS result = DMD_updateDisplay();
+	spiBusRelease(SPI_BUS_DISPLAY);
 	if( result != DMD_OK ) {
 		LOG_ERROR("DMD_updateDisplay failed with result %d",(int)result);
 	}
@@ -200,6 +231,26 @@ void displayPrintf(enum display_row row, const char *format, ... )
 
 
 
+/**
+ * Send a frame that could not be sent when it was drawn because the SPI
+ * bus was taken. Call from the main loop when idle
+ */
+void displayFlush()
+{
+	struct display_data *display = displayGetData();
+	if( display->update_pending ) {
+		displaySendFrame(display);
+	}
+}
+
+/**
+ * Software timer callback, runs in LETIMER0 interrupt context
+ */
+static void displayExtcominTimerCallback(void *arg)
+{
+	displayUpdate();
+}
+
 /**
  * Initialize the display.  Must call
  * @param header represents the content
@@ -229,23 +280,18 @@ void displayInit()
 #if TIMER_SUPPORTS_1HZ_TIMER_EVENT
 	//timerEnable1HzSchedulerEvent(Scheduler_DisplayUpdate);
 
-	  // The BT stack implements timers that we can setup and then have the stack pass back
-	  // events when the timer expires.
 	  // This assignment has us using the Sharp LCD which needs to be serviced approx
 	  // every 1 second, in order to toggle the input "EXTCOMIN" input to the LCD display.
 	  // The documentation is a bit sketchy, but apparently charge can build up within
 	  // the LCD and it needs to be bled off. So toggling the EXTCOMIN input is the method by
 	  // which this takes place.
-	  // We will get a gecko_evt_hardware_soft_timer_id event back to gecko_wait_event()
-	  struct gecko_msg_hardware_set_soft_timer_rsp_t     *timer_response;
-
-	  timer_response = gecko_cmd_hardware_set_soft_timer(
-			              32768,           // 1 second
-			              0,               // timer handle, up to 256 handles are available
-			              0);              // =0 timer runs repeating, =1, timer runs once
-	  if (timer_response->result != 0) {
-		  LOG_ERROR("BT soft timer failed to initiate, error code=%d", timer_response->result);
-	  }
+	  // A periodic software timer on LETIMER0 toggles the pin from the LETIMER0 interrupt,
+	  // so this shares wakeups with the other timers instead of using a BT stack soft timer.
+	  swTimerStart(&display->extcomin_timer,
+			  DISPLAY_EXTCOMIN_PERIOD_US,    // first toggle in 1 second
+			  DISPLAY_EXTCOMIN_PERIOD_US,    // then repeat every 1 second
+			  displayExtcominTimerCallback,
+			  NULL);
 
 #else
 #warning "Timer does not support scheduling 1Hz event.  Please implement for full display support"
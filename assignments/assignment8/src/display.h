@@ -84,10 +84,12 @@ enum display_row {
 void displayInit();
 bool displayUpdate();
 void displayPrintf(enum display_row row, const char *format, ... );
+void displayFlush();
 #else
 static inline void displayInit() { }
 static inline bool displayUpdate() { return true; }
 static inline void displayPrintf(enum display_row row, const char *format, ... ) { row=row; format=format;}
+static inline void displayFlush() { }
 #endif
 
 
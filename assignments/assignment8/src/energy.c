@@ -0,0 +1,78 @@
+//!
+//! @file energy.c
+//! @brief Estimated energy counters. Energy is computed as
+//! current * time * supply voltage from nominal currents, so the values
+//! are meant for comparing policies rather than absolute measurements
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources Si7021-A20 datasheet and EFR32BG13 datasheet for nominal currents
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#include "energy.h"
+
+#include <stddef.h>
+
+//! uA * us * mV is in 1e-15 J, so divide by 1e6 for nanojoules
+#define ENERGY_FJ_PER_NJ    ( 1000000ULL )
+
+//! energyAccumulate()
+//! @brief Add the energy of a load drawing currentUa for activeUs
+//!
+//! @param counter
+//! @param activeUs time the load was on in microseconds
+//! @param currentUa nominal current of the load in microamps
+//! @returns void
+void energyAccumulate( energyCounter_s *counter, uint32_t activeUs, uint32_t currentUa )
+{
+    counter->energyNj += ( ( uint64_t ) activeUs * currentUa * ENERGY_SUPPLY_MV ) / ENERGY_FJ_PER_NJ;
+    return;
+}
+
+//! energyAddSamples()
+//! @brief Count samples the accumulated energy was spent on
+//!
+//! @param counter
+//! @param samples
+//! @returns void
+void energyAddSamples( energyCounter_s *counter, uint32_t samples )
+{
+    counter->samples += samples;
+    return;
+}
+
+//! energyPerSampleNj()
+//! @brief Returns the average energy per sample
+//!
+//! @param counter
+//! @returns energy in nanojoules, 0 if no samples were counted
+uint32_t energyPerSampleNj( const energyCounter_s *counter )
+{
+    if( counter->samples == 0 )
+    {
+        return 0;
+    }
+    return ( uint32_t ) ( counter->energyNj / counter->samples );
+}
+
+//! energyReset()
+//! @brief Clear energy and sample count
+//!
+//! @param counter
+//! @returns void
+void energyReset( energyCounter_s *counter )
+{
+    counter->energyNj = 0;
+    counter->samples = 0;
+    return;
+}
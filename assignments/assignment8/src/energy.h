@@ -0,0 +1,51 @@
+//!
+//! @file energy.h
+//! @brief Estimated energy counters built from measured on-times and
+//! nominal supply currents
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources Si7021-A20 datasheet and EFR32BG13 datasheet for nominal currents
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#ifndef __ENERGY_H___
+#define __ENERGY_H___
+
+#include <stdint.h>
+
+//! Nominal supply voltage in millivolts
+static const uint32_t ENERGY_SUPPLY_MV = 3300;
+
+//! Nominal EFR32BG13 current in EM1 with the HFXO running, in microamps
+static const uint32_t ENERGY_EM1_CURRENT_UA = 1500;
+
+//! Nominal Si7021 supply current while powered, averaged over power-up
+//! and conversions, in microamps
+static const uint32_t ENERGY_SI7021_CURRENT_UA = 150;
+
+//! Accumulated energy estimate for a group of samples
+typedef struct
+{
+    uint64_t energyNj;  //! Estimated energy spent in nanojoules
+    uint32_t samples;   //! Number of samples the energy was spent on
+} energyCounter_s;
+
+void energyAccumulate( energyCounter_s *counter, uint32_t activeUs, uint32_t currentUa );
+
+void energyAddSamples( energyCounter_s *counter, uint32_t samples );
+
+uint32_t energyPerSampleNj( const energyCounter_s *counter );
+
+void energyReset( energyCounter_s *counter );
+
+#endif // __ENERGY_H___
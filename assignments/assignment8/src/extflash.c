@@ -0,0 +1,866 @@
+//!
+//! @file extflash.c
+//! @brief Implements a bulk sample log on the MX25 SPI flash. Samples
+//! are packed in RAM into 256-byte pages of variable length deltas, see
+//! deltacode.h. A full page is
+//! queued and a burst is started from a software timer: the flash is woken
+//! from deep power-down, the sector ahead is erased when a new sector is
+//! reached, the page is sent in one page program with LDMA on USART1 TX
+//! and RX, and busy status is polled from the timer until the flash is
+//! done. The flash then goes back to deep power-down. USART1 is shared
+//! with the LCD, so it is only held while talking to the flash, and its
+//! configuration is swapped in and out each time
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources Utilized Silicon Labs' EMLIB peripheral libraries to implement functionality @n
+//!            em_usart.h - for the SPI interface to the flash @n
+//!            em_gpio.h - for the flash chip select @n
+//!            em_core.h - for CORE_* critical section macros @n
+//!            MX25R8035F datasheet for command timings
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#include "extflash.h"
+
+#include "crc.h"
+#include "deltacode.h"
+#include "energy.h"
+#include "ldma.h"
+#include "log.h"
+#include "main.h"
+#include "samplering.h"
+#include "spibus.h"
+#include "swtimers.h"
+#include "timebase.h"
+#include "mx25flash_spi.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include "em_core.h"
+#include "em_gpio.h"
+#include "em_usart.h"
+#include "sleep.h"
+
+//! Number of pages in the flash and pages erased together
+#define EXT_FLASH_NUMBER_OF_PAGES   ( FlashSize / EXT_FLASH_PAGE_SIZE )
+#define EXT_FLASH_PAGES_PER_SECTOR  ( Sector_Offset / EXT_FLASH_PAGE_SIZE )
+
+//! Command and 3-byte address sent ahead of the page
+#define EXT_FLASH_COMMAND_SIZE      ( 4 )
+
+//! Value of an erased word
+#define EXT_FLASH_ERASED_WORD       ( 0xFFFFFFFFUL )
+
+//! Steps of a burst
+typedef enum
+{
+    EXT_FLASH_IDLE,             //! Deep power-down, no burst running
+    EXT_FLASH_WAKING,           //! Waiting for tRDP after the wake-up pulse
+    EXT_FLASH_NEXT,             //! Awake, next queued page to start or power down
+    EXT_FLASH_ERASING,          //! Sector erase in progress
+    EXT_FLASH_READY,            //! Awake, sector erased, page program to start
+    EXT_FLASH_SENDING,          //! LDMA sending the page program
+    EXT_FLASH_PROGRAMMING,      //! Page program in progress
+    EXT_FLASH_SETTLING          //! Waiting for a failed erase or program to end
+} extFlashState_e;
+
+//! USART1 registers that differ between the flash and the LCD
+typedef struct
+{
+    uint32_t ctrl;
+    uint32_t frame;
+    uint32_t clkdiv;
+    uint32_t routeloc0;
+    uint32_t routepen;
+    uint32_t status;
+} usartConfig_s;
+
+//! True if a flash answered with the expected identification and the
+//! log has not been stopped
+static volatile bool present = false;
+
+//! Page the next burst programs and the sequence number it gets
+static uint32_t writePage = 0;
+static uint32_t nextSequence = 0;
+
+//! Pages being filled, one per quantity, the code writer of each and the
+//! last value added to each, in units of EXT_FLASH_QUANTUM
+static extFlashPage_s filling[ FLASH_LOG_NUMBER_OF_TAGS ];
+static deltaWriter_s writers[ FLASH_LOG_NUMBER_OF_TAGS ];
+static int32_t lastValue[ FLASH_LOG_NUMBER_OF_TAGS ];
+
+//! Full pages waiting to be programmed. The burst only touches the head
+static extFlashPage_s queue[ EXT_FLASH_QUEUE_PAGES ];
+static volatile uint8_t queueHead = 0;
+static volatile uint8_t queueCount = 0;
+
+//! Burst state, advanced from stepTimer
+static volatile extFlashState_e state = EXT_FLASH_IDLE;
+static swTimer_s stepTimer;
+
+//! Time spent polling the current erase or program
+static uint32_t waitedUs = 0;
+
+//! Failed erases and programs of the page at the write position
+static uint8_t failures = 0;
+
+//! LDMA buffers for the page program
+static uint8_t commandBuffer[ EXT_FLASH_COMMAND_SIZE ];
+static volatile uint8_t rxDiscard;
+static DMA_DESCRIPTOR_TypeDef txDescriptors[ 2 ];
+static DMA_DESCRIPTOR_TypeDef rxDescriptor;
+
+//! USART1 set up for the flash, and the configuration it replaced
+static usartConfig_s flashConfig;
+static usartConfig_s savedConfig;
+
+//! Time the flash woke up and time EM2 was blocked for the transfer
+static uint64_t awakeStartTicks = 0;
+static uint64_t em1StartTicks = 0;
+
+//! Estimated flash and EM1 energy spent per sample written
+static energyCounter_s writeEnergy;
+
+static extFlashStats_s stats;
+
+static void extFlashStep( void *arg );
+
+//! usartSave()
+//! @brief Read the USART1 configuration
+//!
+//! @param config
+//! @returns void
+static void usartSave( usartConfig_s *config )
+{
+    config->ctrl = MX25_USART->CTRL;
+    config->frame = MX25_USART->FRAME;
+    config->clkdiv = MX25_USART->CLKDIV;
+    config->routeloc0 = MX25_USART->ROUTELOC0;
+    config->routepen = MX25_USART->ROUTEPEN;
+    config->status = MX25_USART->STATUS;
+    return;
+}
+
+//! usartRestore()
+//! @brief Apply a saved USART1 configuration and leave the receiver
+//! and transmitter enabled as they were when it was saved
+//!
+//! @param config
+//! @returns void
+static void usartRestore( const usartConfig_s *config )
+{
+    MX25_USART->CMD = USART_CMD_RXDIS | USART_CMD_TXDIS | USART_CMD_CLEARRX | USART_CMD_CLEARTX;
+    MX25_USART->CTRL = config->ctrl;
+    MX25_USART->FRAME = config->frame;
+    MX25_USART->CLKDIV = config->clkdiv;
+    MX25_USART->ROUTELOC0 = config->routeloc0;
+    MX25_USART->ROUTEPEN = config->routepen;
+    MX25_USART->CMD = ( ( config->status & USART_STATUS_RXENS ) ? USART_CMD_RXEN : 0 )
+        | ( ( config->status & USART_STATUS_TXENS ) ? USART_CMD_TXEN : 0 );
+    return;
+}
+
+//! busAcquire()
+//! @brief Take USART1 from the LCD and set it up for the flash
+//!
+//! @param void
+//! @returns true if the bus is ours
+static bool busAcquire()
+{
+    if( !spiBusAcquire( SPI_BUS_EXTFLASH ) )
+    {
+        return false;
+    }
+    usartSave( &savedConfig );
+    usartRestore( &flashConfig );
+    return true;
+}
+
+//! busRelease()
+//! @brief Put back the USART1 configuration the flash replaced
+//!
+//! @param void
+//! @returns void
+static void busRelease()
+{
+    usartRestore( &savedConfig );
+    spiBusRelease( SPI_BUS_EXTFLASH );
+    return;
+}
+
+//! flashCommand()
+//! @brief Send a command without data. The bus must be held
+//!
+//! @param command
+//! @returns void
+static void flashCommand( uint8_t command )
+{
+    GPIO_PinOutClear( MX25_PORT_CS, MX25_PIN_CS );
+    USART_SpiTransfer( MX25_USART, command );
+    GPIO_PinOutSet( MX25_PORT_CS, MX25_PIN_CS );
+    return;
+}
+
+//! flashAddressCommand()
+//! @brief Send a command followed by a 3-byte address. The bus must be held
+//!
+//! @param command
+//! @param address
+//! @returns void
+static void flashAddressCommand( uint8_t command, uint32_t address )
+{
+    GPIO_PinOutClear( MX25_PORT_CS, MX25_PIN_CS );
+    USART_SpiTransfer( MX25_USART, command );
+    USART_SpiTransfer( MX25_USART, ( uint8_t ) ( address >> 16 ) );
+    USART_SpiTransfer( MX25_USART, ( uint8_t ) ( address >> 8 ) );
+    USART_SpiTransfer( MX25_USART, ( uint8_t ) address );
+    GPIO_PinOutSet( MX25_PORT_CS, MX25_PIN_CS );
+    return;
+}
+
+//! flashBusy()
+//! @brief Read the write-in-progress bit. The bus must be held
+//!
+//! @param void
+//! @returns true if a program or erase is running
+static bool flashBusy()
+{
+    GPIO_PinOutClear( MX25_PORT_CS, MX25_PIN_CS );
+    USART_SpiTransfer( MX25_USART, FLASH_CMD_RDSR );
+    uint8_t status = USART_SpiTransfer( MX25_USART, 0xFF );
+    GPIO_PinOutSet( MX25_PORT_CS, MX25_PIN_CS );
+    return ( status & FLASH_WIP_MASK ) != 0;
+}
+
+//! flashWakePulse()
+//! @brief Pulse chip select to end deep power-down. The bus must be held
+//!
+//! @param void
+//! @returns void
+static void flashWakePulse()
+{
+    GPIO_PinOutClear( MX25_PORT_CS, MX25_PIN_CS );
+    GPIO_PinOutSet( MX25_PORT_CS, MX25_PIN_CS );
+    return;
+}
+
+//! readSequence()
+//! @brief Read the sequence number at the start of a page. Blocking,
+//! only used at boot. The bus must be held
+//!
+//! @param page
+//! @returns sequence number, EXT_FLASH_ERASED_WORD if the page is erased
+static uint32_t readSequence( uint32_t page )
+{
+    uint32_t sequence;
+    MX25_READ( page * EXT_FLASH_PAGE_SIZE, ( uint8_t * ) &sequence, sizeof( sequence ) );
+    return sequence;
+}
+
+//! pageErased()
+//! @brief Check that every byte of a page is erased. Blocking, only used
+//! at boot. The bus must be held
+//!
+//! @param page
+//! @returns true if the page can be programmed
+static bool pageErased( uint32_t page )
+{
+    uint32_t words[ EXT_FLASH_PAGE_SIZE / sizeof( uint32_t ) ];
+    MX25_READ( page * EXT_FLASH_PAGE_SIZE, ( uint8_t * ) words, sizeof( words ) );
+    for( uint8_t i = 0; i < ( EXT_FLASH_PAGE_SIZE / sizeof( uint32_t ) ); i++ )
+    {
+        if( EXT_FLASH_ERASED_WORD != words[ i ] )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+//! stepAfter()
+//! @brief Run the next step of the burst after a delay
+//!
+//! @param us
+//! @returns void
+static inline void stepAfter( uint32_t us )
+{
+    swTimerStart( &stepTimer, us, 0, extFlashStep, NULL );
+    return;
+}
+
+//! powerDown()
+//! @brief Put the flash in deep power-down and end the burst
+//!
+//! @param void
+//! @returns void
+static void powerDown()
+{
+    if( !busAcquire() )
+    {
+        stepAfter( EXT_FLASH_RETRY_US );
+        return;
+    }
+    flashCommand( FLASH_CMD_DP );
+    busRelease();
+    energyAccumulate( &writeEnergy, ( uint32_t ) timeTicksToUs( timeNowTicks() - awakeStartTicks ),
+        EXT_FLASH_ACTIVE_CURRENT_UA );
+    state = EXT_FLASH_IDLE;
+    return;
+}
+
+//! startProgram()
+//! @brief Send the page at the head of the queue in one page program.
+//! The LDMA RX channel drains every byte clocked back, so the transfer
+//! is over once it is done. EM2 is blocked while USART1 is running
+//!
+//! @param void
+//! @returns void
+static void startProgram()
+{
+    if( !busAcquire() )
+    {
+        state = EXT_FLASH_READY;
+        stepAfter( EXT_FLASH_RETRY_US );
+        return;
+    }
+
+    extFlashPage_s *page = &queue[ queueHead ];
+    page->sequence = nextSequence;
+    page->crc = crc32( page, offsetof( extFlashPage_s, crc ) );
+
+    uint32_t address = writePage * EXT_FLASH_PAGE_SIZE;
+    commandBuffer[ 0 ] = FLASH_CMD_PP;
+    commandBuffer[ 1 ] = ( uint8_t ) ( address >> 16 );
+    commandBuffer[ 2 ] = ( uint8_t ) ( address >> 8 );
+    commandBuffer[ 3 ] = ( uint8_t ) address;
+
+    ldmaDescriptorTransfer( &txDescriptors[ 0 ],
+        LDMA_CTRL_BYTE_PER_REQUEST | LDMA_CH_CTRL_SRCINC_ONE | LDMA_CH_CTRL_DSTINC_NONE,
+        commandBuffer, &MX25_USART->TXDATA, EXT_FLASH_COMMAND_SIZE, &txDescriptors[ 1 ] );
+    ldmaDescriptorTransfer( &txDescriptors[ 1 ],
+        LDMA_CTRL_BYTE_PER_REQUEST | LDMA_CH_CTRL_SRCINC_ONE | LDMA_CH_CTRL_DSTINC_NONE,
+        page, &MX25_USART->TXDATA, EXT_FLASH_PAGE_SIZE, NULL );
+    ldmaDescriptorTransfer( &rxDescriptor,
+        LDMA_CTRL_BYTE_PER_REQUEST | LDMA_CH_CTRL_SRCINC_NONE | LDMA_CH_CTRL_DSTINC_NONE,
+        &MX25_USART->RXDATA, &rxDiscard, EXT_FLASH_COMMAND_SIZE + EXT_FLASH_PAGE_SIZE, NULL );
+
+    flashCommand( FLASH_CMD_WREN );
+    MX25_USART->CMD = USART_CMD_CLEARRX;
+    em1StartTicks = timeNowTicks();
+    SLEEP_SleepBlockBegin( sleepEM2 );
+    GPIO_PinOutClear( MX25_PORT_CS, MX25_PIN_CS );
+    ldmaStartTransfer( LDMA_CHANNEL_EXTFLASH_RX,
+        LDMA_CH_REQSEL_SOURCESEL_USART1 | LDMA_CH_REQSEL_SIGSEL_USART1RXDATAV, &rxDescriptor );
+    ldmaStartTransfer( LDMA_CHANNEL_EXTFLASH_TX,
+        LDMA_CH_REQSEL_SOURCESEL_USART1 | LDMA_CH_REQSEL_SIGSEL_USART1TXBL, txDescriptors );
+    state = EXT_FLASH_SENDING;
+    stepAfter( ( uint32_t ) ( ( ( uint64_t ) ( EXT_FLASH_COMMAND_SIZE + EXT_FLASH_PAGE_SIZE ) * 8
+        * USEC_PER_SEC ) / MX25_BAUDRATE ) );
+    return;
+}
+
+//! startNextPage()
+//! @brief Program the next queued page, erasing its sector first if the
+//! page is the first of a sector, or power down if the queue is empty.
+//! Erasing ahead of the write position is what drops the oldest pages
+//! once the log wraps
+//!
+//! @param void
+//! @returns void
+static void startNextPage()
+{
+    if( queueCount == 0 )
+    {
+        powerDown();
+        return;
+    }
+    if( ( writePage % EXT_FLASH_PAGES_PER_SECTOR ) != 0 )
+    {
+        startProgram();
+        return;
+    }
+    if( !busAcquire() )
+    {
+        stepAfter( EXT_FLASH_RETRY_US );
+        return;
+    }
+    flashCommand( FLASH_CMD_WREN );
+    flashAddressCommand( FLASH_CMD_SE, writePage * EXT_FLASH_PAGE_SIZE );
+    busRelease();
+    stats.sectorsErased++;
+    waitedUs = 0;
+    state = EXT_FLASH_ERASING;
+    stepAfter( EXT_FLASH_ERASE_POLL_US );
+    return;
+}
+
+//! pageFailed()
+//! @brief The erase or program of the page at the write position failed.
+//! Skipping the page would leave a hole in the sequence numbers that
+//! extFlashInit() searches, so once the flash is no longer busy the page
+//! is tried again with the same sequence number. Programming the same
+//! bytes again is safe, and the sector is erased again if the page starts
+//! it
+//!
+//! @param void
+//! @returns void
+static void pageFailed()
+{
+    stats.errors++;
+    failures++;
+    waitedUs = 0;
+    state = EXT_FLASH_SETTLING;
+    stepAfter( EXT_FLASH_PROGRAM_POLL_US );
+    return;
+}
+
+//! stopLog()
+//! @brief Give up on the log until the next boot, which starts the sector
+//! of the failed page over, and power the flash down
+//!
+//! @param void
+//! @returns void
+static void stopLog()
+{
+    LOG_ERROR( "External flash page %lu failed %u times, log stopped", writePage, failures );
+    present = false;
+    uint32_t dropped = 0;
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_CRITICAL();
+    for( uint8_t i = 0; i < queueCount; i++ )
+    {
+        dropped += queue[ ( queueHead + i ) % EXT_FLASH_QUEUE_PAGES ].count;
+    }
+    queueCount = 0;
+    CORE_EXIT_CRITICAL();
+    stats.samplesDropped += dropped;
+    state = EXT_FLASH_NEXT;
+    startNextPage();
+    return;
+}
+
+//! pageDone()
+//! @brief Page program finished or timed out. A programmed page is
+//! retired from the head of the queue and the log moves to the next page
+//! of the flash
+//!
+//! @param programmed
+//! @returns void
+static void pageDone( bool programmed )
+{
+    if( !programmed )
+    {
+        pageFailed();
+        return;
+    }
+
+    uint16_t count = queue[ queueHead ].count;
+    stats.pagesProgrammed++;
+    stats.samplesProgrammed += count;
+    energyAddSamples( &writeEnergy, count );
+    failures = 0;
+
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_CRITICAL();
+    queueHead = ( queueHead + 1 ) % EXT_FLASH_QUEUE_PAGES;
+    queueCount--;
+    CORE_EXIT_CRITICAL();
+
+    writePage = ( writePage + 1 ) % EXT_FLASH_NUMBER_OF_PAGES;
+    nextSequence++;
+    state = EXT_FLASH_NEXT;
+    startNextPage();
+    return;
+}
+
+//! pollBusy()
+//! @brief Check whether the running erase or program is done
+//!
+//! @param pollUs time until the next check
+//! @param timeoutUs time after which the operation is given up on
+//! @param done called when the flash is no longer busy or timed out,
+//! with true if it finished in time
+//! @returns void
+static void pollBusy( uint32_t pollUs, uint32_t timeoutUs, void ( *done )( bool ) )
+{
+    if( !busAcquire() )
+    {
+        stepAfter( EXT_FLASH_RETRY_US );
+        return;
+    }
+    bool busy = flashBusy();
+    busRelease();
+    if( !busy )
+    {
+        done( true );
+        return;
+    }
+    waitedUs += pollUs;
+    if( waitedUs > timeoutUs )
+    {
+        done( false );
+        return;
+    }
+    stepAfter( pollUs );
+    return;
+}
+
+//! eraseDone()
+//! @brief Sector erase finished or timed out
+//!
+//! @param erased
+//! @returns void
+static void eraseDone( bool erased )
+{
+    if( erased )
+    {
+        startProgram();
+    }
+    else
+    {
+        pageFailed();
+    }
+    return;
+}
+
+//! settleDone()
+//! @brief Failed erase or program ended, or is still running after the
+//! erase timeout. After EXT_FLASH_ATTEMPTS failures the log is stopped
+//!
+//! @param idle
+//! @returns void
+static void settleDone( bool idle )
+{
+    if( failures >= EXT_FLASH_ATTEMPTS )
+    {
+        stopLog();
+    }
+    else if( idle )
+    {
+        state = EXT_FLASH_NEXT;
+        startNextPage();
+    }
+    else
+    {
+        pageFailed();
+    }
+    return;
+}
+
+//! extFlashStep()
+//! @brief Software timer callback that advances the burst.
+//! Runs in interrupt context
+//!
+//! @param arg unused
+//! @returns void
+static void extFlashStep( void *arg )
+{
+    ( void ) arg;
+    switch( state )
+    {
+        case EXT_FLASH_IDLE:
+            if( queueCount == 0 )
+            {
+                break;
+            }
+            if( !busAcquire() )
+            {
+                stepAfter( EXT_FLASH_RETRY_US );
+                break;
+            }
+            flashWakePulse();
+            busRelease();
+            stats.bursts++;
+            awakeStartTicks = timeNowTicks();
+            state = EXT_FLASH_WAKING;
+            stepAfter( EXT_FLASH_WAKE_US );
+            break;
+        case EXT_FLASH_WAKING:
+            state = EXT_FLASH_NEXT;
+            startNextPage();
+            break;
+        case EXT_FLASH_NEXT:
+            startNextPage();
+            break;
+        case EXT_FLASH_ERASING:
+            pollBusy( EXT_FLASH_ERASE_POLL_US, EXT_FLASH_ERASE_TIMEOUT_US, eraseDone );
+            break;
+        case EXT_FLASH_READY:
+            startProgram();
+            break;
+        case EXT_FLASH_SENDING:
+            if( !ldmaTransferDone( LDMA_CHANNEL_EXTFLASH_RX ) )
+            {
+                stepAfter( 0 );
+                break;
+            }
+            // Page program starts when chip select goes high
+            GPIO_PinOutSet( MX25_PORT_CS, MX25_PIN_CS );
+            energyAccumulate( &writeEnergy, ( uint32_t ) timeTicksToUs( timeNowTicks() - em1StartTicks ),
+                ENERGY_EM1_CURRENT_UA );
+            SLEEP_SleepBlockEnd( sleepEM2 );
+            busRelease();
+            waitedUs = 0;
+            state = EXT_FLASH_PROGRAMMING;
+            stepAfter( EXT_FLASH_PROGRAM_POLL_US );
+            break;
+        case EXT_FLASH_PROGRAMMING:
+            pollBusy( EXT_FLASH_PROGRAM_POLL_US, EXT_FLASH_PROGRAM_TIMEOUT_US, pageDone );
+            break;
+        case EXT_FLASH_SETTLING:
+            pollBusy( EXT_FLASH_PROGRAM_POLL_US, EXT_FLASH_ERASE_TIMEOUT_US, settleDone );
+            break;
+        default:
+            break;
+    }
+    return;
+}
+
+//! extFlashInit()
+//! @brief Set up USART1 for the flash, check the flash identification
+//! and find the write position. Pages are written in order from page 0
+//! and wrap, so the pages from page 0 up to the write position carry
+//! consecutive sequence numbers and the page at the write position does
+//! not. That boundary is found by binary search, reading one word per
+//! step. A page that is not erased there was cut short, and its sector
+//! is started over. The flash is left in deep power-down. Must be called
+//! before displayInit(), since it takes USART1 over
+//!
+//! @param void
+//! @returns true if the flash is present
+bool extFlashInit()
+{
+    memset( &stats, 0, sizeof( stats ) );
+    energyReset( &writeEnergy );
+    failures = 0;
+    queueCount = 0;
+    for( uint8_t tag = 0; tag < FLASH_LOG_NUMBER_OF_TAGS; tag++ )
+    {
+        filling[ tag ].count = 0;
+    }
+
+    MX25_init();
+    usartSave( &flashConfig );
+
+    // End deep power-down entered in initBoard() and wait tRDP
+    flashWakePulse();
+    uint64_t start = timeNowTicks();
+    while( timeTicksToUs( timeNowTicks() - start ) < EXT_FLASH_WAKE_US )
+    {
+    }
+
+    uint32_t id = 0;
+    MX25_RDID( &id );
+    present = ( FlashID == id );
+    if( !present )
+    {
+        LOG_WARN( "External flash not found (id 0x%06lX)", id );
+        MX25_deinit();
+        return false;
+    }
+
+    uint32_t first = readSequence( 0 );
+    if( EXT_FLASH_ERASED_WORD == first )
+    {
+        writePage = 0;
+        nextSequence = 0;
+    }
+    else
+    {
+        uint32_t low = 1;
+        uint32_t high = EXT_FLASH_NUMBER_OF_PAGES;
+        while( low < high )
+        {
+            uint32_t mid = ( low + high ) / 2;
+            if( readSequence( mid ) == ( first + mid ) )
+            {
+                low = mid + 1;
+            }
+            else
+            {
+                high = mid;
+            }
+        }
+        writePage = low % EXT_FLASH_NUMBER_OF_PAGES;
+        nextSequence = first + low;
+
+        // A program cut by a power loss or given up on leaves a page that
+        // ends the search but cannot be programmed over. Pages of the
+        // current sector are only erased from its first page on
+        uint32_t intoSector = writePage % EXT_FLASH_PAGES_PER_SECTOR;
+        if( ( intoSector != 0 ) && !pageErased( writePage ) )
+        {
+            LOG_WARN( "External flash page %lu not erased, starting its sector over", writePage );
+            writePage -= intoSector;
+            nextSequence -= intoSector;
+        }
+    }
+
+    flashCommand( FLASH_CMD_DP );
+    state = EXT_FLASH_IDLE;
+    LOG_INFO( "External flash log: page %lu of %lu, sequence %lu", writePage,
+        ( uint32_t ) EXT_FLASH_NUMBER_OF_PAGES, nextSequence );
+    return true;
+}
+
+//! closePage()
+//! @brief Queue the page being filled for a quantity and start a burst
+//! if none is running. The page is dropped if the queue is full or the
+//! log was stopped
+//!
+//! @param tag
+//! @returns void
+static void closePage( flashLogTag_e tag )
+{
+    extFlashPage_s *page = &filling[ tag ];
+    if( page->count == 0 )
+    {
+        return;
+    }
+
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_CRITICAL();
+    bool full = !present || ( queueCount >= EXT_FLASH_QUEUE_PAGES );
+    uint8_t tail = ( queueHead + queueCount ) % EXT_FLASH_QUEUE_PAGES;
+    CORE_EXIT_CRITICAL();
+    if( full )
+    {
+        stats.samplesDropped += page->count;
+        page->count = 0;
+        return;
+    }
+
+    // The burst only reads the head, which is never the tail slot
+    memcpy( &queue[ tail ], page, sizeof( *page ) );
+    page->count = 0;
+
+    CORE_ENTER_CRITICAL();
+    queueCount++;
+    if( ( EXT_FLASH_IDLE == state ) && !swTimerIsActive( &stepTimer ) )
+    {
+        stepAfter( 0 );
+    }
+    CORE_EXIT_CRITICAL();
+    return;
+}
+
+//! extFlashAppend()
+//! @brief Add a sample to the page of its quantity. A page holds samples
+//! on a regular time grid whose differences fit in 16 bits and in the
+//! code bits left, so a sample that does not fit closes the page and
+//! starts the next one
+//!
+//! @param tag
+//! @param timestampMs timeNowMs() when the sample was taken
+//! @param value
+//! @returns true if the sample was accepted
+bool extFlashAppend( flashLogTag_e tag, uint64_t timestampMs, int32_t value )
+{
+    if( !present )
+    {
+        return false;
+    }
+    if( tag >= FLASH_LOG_NUMBER_OF_TAGS )
+    {
+        LOG_WARN( "Invalid external flash log tag %d", tag );
+        return false;
+    }
+
+    // Round to the resolution of the log
+    int32_t half = ( value < 0 ) ? -( EXT_FLASH_QUANTUM / 2 ) : ( EXT_FLASH_QUANTUM / 2 );
+    int32_t quantized = ( value + half ) / EXT_FLASH_QUANTUM;
+
+    extFlashPage_s *page = &filling[ tag ];
+    if( page->count > 0 )
+    {
+        uint64_t elapsedMs = timestampMs - page->timestampMs;
+        bool fits = ( page->count < UINT16_MAX ) && ( timestampMs > page->timestampMs );
+        if( fits && ( page->count == 1 ) )
+        {
+            fits = ( elapsedMs <= UINT32_MAX );
+        }
+        else if( fits )
+        {
+            uint64_t expectedMs = ( uint64_t ) page->periodMs * page->count;
+            uint64_t errorMs = ( elapsedMs > expectedMs ) ? ( elapsedMs - expectedMs ) : ( expectedMs - elapsedMs );
+            fits = ( errorMs <= SAMPLE_RING_JITTER_MS );
+        }
+        // Only code the delta once the sample is known to be on the grid
+        if( fits )
+        {
+            fits = deltaWriterPut( &writers[ tag ], quantized - lastValue[ tag ] );
+        }
+        if( fits )
+        {
+            if( page->count == 1 )
+            {
+                page->periodMs = ( uint32_t ) elapsedMs;
+            }
+            page->count++;
+        }
+        else
+        {
+            closePage( tag );
+        }
+    }
+
+    if( page->count == 0 )
+    {
+        // Unused code bits are left erased
+        memset( page, 0xFF, sizeof( *page ) );
+        page->tag = tag;
+        page->count = 1;
+        page->timestampMs = timestampMs;
+        page->periodMs = 0;
+        page->value = quantized;
+        deltaWriterInit( &writers[ tag ], page->codes, sizeof( page->codes ) );
+    }
+    lastValue[ tag ] = quantized;
+    return true;
+}
+
+//! extFlashFlush()
+//! @brief Queue the partially filled pages, e.g. before a planned reset
+//!
+//! @param void
+//! @returns void
+void extFlashFlush()
+{
+    for( uint8_t tag = 0; tag < FLASH_LOG_NUMBER_OF_TAGS; tag++ )
+    {
+        closePage( tag );
+    }
+    return;
+}
+
+//! extFlashGetEnergyPerSampleNj()
+//! @brief Returns the estimated flash and EM1 energy spent per sample
+//! written, including wake-up, erase and programming
+//!
+//! @param void
+//! @returns energy in nanojoules
+uint32_t extFlashGetEnergyPerSampleNj()
+{
+    return energyPerSampleNj( &writeEnergy );
+}
+
+//! extFlashGetStats()
+//! @brief Returns the log counters
+//!
+//! @param void
+//! @returns pointer to counters
+const extFlashStats_s *extFlashGetStats()
+{
+    return &stats;
+}
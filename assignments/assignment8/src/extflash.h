@@ -0,0 +1,105 @@
+//!
+//! @file extflash.h
+//! @brief Bulk sample log on the MX25 SPI flash of the radio board.
+//! Pages are programmed in bursts with LDMA and the flash is kept in
+//! deep power-down between bursts
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources Utilized Silicon Labs' EMLIB peripheral libraries to implement functionality @n
+//!            em_usart.h - for the SPI interface to the flash @n
+//!            MX25R8035F datasheet for command timings
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#ifndef __EXTFLASH_H___
+#define __EXTFLASH_H___
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "flashlog.h"
+
+//! Size of a flash program page, the unit the log is written in
+#define EXT_FLASH_PAGE_SIZE         ( 256 )
+
+//! Bytes of delta codes that follow the first sample of a page
+#define EXT_FLASH_CODE_SIZE         ( 228 )
+
+//! Number of full pages that can wait for a burst
+#define EXT_FLASH_QUEUE_PAGES       ( 2 )
+
+//! Time from the CS pulse that ends deep power-down until the flash
+//! accepts commands. tRDP is 35 us
+static const uint32_t EXT_FLASH_WAKE_US = 100;
+
+//! Busy status polling periods and limits for page program (tPP 10 ms
+//! max) and sector erase (tSE 240 ms max)
+static const uint32_t EXT_FLASH_PROGRAM_POLL_US = 1000;
+static const uint32_t EXT_FLASH_PROGRAM_TIMEOUT_US = 20000;
+static const uint32_t EXT_FLASH_ERASE_POLL_US = 20000;
+static const uint32_t EXT_FLASH_ERASE_TIMEOUT_US = 480000;
+
+//! Samples are logged in units of EXT_FLASH_QUANTUM, i.e. 0.1 degrees
+//! Celsius and 0.1 %RH, the resolution of the display and well inside the
+//! sensor accuracy. Finer steps are mostly noise, and noise breaks the
+//! runs of unchanged samples that make the log last months
+static const int32_t EXT_FLASH_QUANTUM = 100;
+
+//! Erases or programs of a page that may fail before the log stops
+static const uint8_t EXT_FLASH_ATTEMPTS = 3;
+
+//! Time before trying again when the SPI bus is taken by the display
+static const uint32_t EXT_FLASH_RETRY_US = 1000;
+
+//! Nominal flash supply current while awake, averaged over program
+//! and erase, in microamps
+static const uint32_t EXT_FLASH_ACTIVE_CURRENT_UA = 3000;
+
+//! Page of samples of one quantity taken at a regular period. Each
+//! sample after the first is stored as its difference from the previous
+//! one in the variable length code of deltacode.h
+typedef struct
+{
+    uint32_t sequence;          //! Increases by one per page over the whole log
+    uint8_t tag;                //! flashLogTag_e
+    uint8_t reserved;           //! Left erased
+    uint16_t count;             //! Number of samples, first sample included
+    uint64_t timestampMs;       //! timeNowMs() of the first sample
+    uint32_t periodMs;          //! Time between samples
+    int32_t value;              //! First sample, in units of EXT_FLASH_QUANTUM
+    uint8_t codes[ EXT_FLASH_CODE_SIZE ];
+    uint32_t crc;               //! CRC-32 of the fields above
+} extFlashPage_s;
+
+//! Log counters
+typedef struct
+{
+    uint32_t pagesProgrammed;   //! Pages programmed since boot
+    uint32_t samplesProgrammed; //! Samples in those pages
+    uint32_t sectorsErased;     //! Sectors erased since boot
+    uint32_t bursts;            //! Wake-ups of the flash since boot
+    uint32_t samplesDropped;    //! Samples lost to a full queue or a stopped log
+    uint32_t errors;            //! Program or erase timeouts
+} extFlashStats_s;
+
+bool extFlashInit();
+
+bool extFlashAppend( flashLogTag_e tag, uint64_t timestampMs, int32_t value );
+
+void extFlashFlush();
+
+uint32_t extFlashGetEnergyPerSampleNj();
+
+const extFlashStats_s *extFlashGetStats();
+
+#endif // __EXTFLASH_H___
@@ -0,0 +1,488 @@
+//!
+//! @file flashlog.c
+//! @brief Implements an append-only log of sample batches in internal
+//! flash. Samples are batched in RAM per quantity and a full batch is
+//! programmed as one CRC-protected record. Pages are filled in order and
+//! the oldest page is erased when the log wraps, so every page is erased
+//! equally often. Each page starts with a header holding its erase count
+//! and the sequence number of its first record, which is all that is
+//! needed to find the write position at boot
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources Utilized Silicon Labs' EMLIB peripheral libraries to implement functionality @n
+//!            em_msc.h - for flash page erase and word writes
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#include "flashlog.h"
+
+#include "crc.h"
+#include "log.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#include "em_msc.h"
+
+//! Size of the log's flash region. Only its size is used: the linker
+//! script sizes .flash_log_dummy by it and places the region below the
+//! Bluetooth stack's NVM region, so FLASH_LOG_PAGES is the one definition
+static const uint8_t flashLogReserved[ FLASH_LOG_PAGES * FLASH_PAGE_SIZE ]
+    __attribute__ (( section( ".flash_log" ), used ));
+
+//! Start of the reserved flash region, defined in the linker script
+extern uint32_t __flashLogBase;
+
+//! Value of a programmed word that has not been written since erase
+#define FLASH_ERASED_WORD   ( 0xFFFFFFFFUL )
+
+//! Page header contents, cached at boot and kept up to date
+static bool pageValid[ FLASH_LOG_PAGES ];
+static uint32_t pageFirstSequence[ FLASH_LOG_PAGES ];
+static uint32_t pageEraseCount[ FLASH_LOG_PAGES ];
+
+//! Page records are written to, and slot of the next record in it
+static uint8_t activePage = 0;
+static uint32_t writeSlot = 0;
+
+//! Sequence number of the next record written
+static uint32_t nextSequence = 0;
+
+//! Number of resets since the log was created, stored in every record
+static uint16_t boot = 0;
+
+//! Batches being filled, one per quantity
+static flashLogRecord_s pending[ FLASH_LOG_NUMBER_OF_TAGS ];
+
+static flashLogStats_s stats;
+
+//! pageAddress()
+//! @brief Returns the address of a page of the log
+//!
+//! @param page
+//! @returns pointer to start of page
+static inline uint32_t *pageAddress( uint8_t page )
+{
+    return ( uint32_t * ) ( ( uintptr_t ) &__flashLogBase + ( ( uint32_t ) page * FLASH_PAGE_SIZE ) );
+}
+
+//! slotAddress()
+//! @brief Returns the flash record slot of a page
+//!
+//! @param page
+//! @param slot
+//! @returns pointer to record in flash
+static inline const flashLogRecord_s *slotAddress( uint8_t page, uint32_t slot )
+{
+    return ( const flashLogRecord_s * ) ( ( uintptr_t ) pageAddress( page )
+        + sizeof( flashLogPageHeader_s ) + ( slot * sizeof( flashLogRecord_s ) ) );
+}
+
+//! isBefore()
+//! @brief Wraparound-safe comparison of sequence numbers
+//!
+//! @param a
+//! @param b
+//! @returns true if a comes before b
+static inline bool isBefore( uint32_t a, uint32_t b )
+{
+    return ( ( int32_t ) ( a - b ) < 0 );
+}
+
+//! updateEraseStats()
+//! @brief Recompute the lowest and highest page erase counts
+//!
+//! @param void
+//! @returns void
+static void updateEraseStats()
+{
+    stats.minEraseCount = UINT32_MAX;
+    stats.maxEraseCount = 0;
+    for( uint8_t page = 0; page < FLASH_LOG_PAGES; page++ )
+    {
+        if( pageEraseCount[ page ] < stats.minEraseCount )
+        {
+            stats.minEraseCount = pageEraseCount[ page ];
+        }
+        if( pageEraseCount[ page ] > stats.maxEraseCount )
+        {
+            stats.maxEraseCount = pageEraseCount[ page ];
+        }
+    }
+    return;
+}
+
+//! startPage()
+//! @brief Erase a page and write its header, making it the active page.
+//! A page erased by a power loss before its header was written has no
+//! valid header and is picked up again as a free page at boot
+//!
+//! @param page
+//! @param firstSequence sequence number of the first record in the page
+//! @returns true on success
+static bool startPage( uint8_t page, uint32_t firstSequence )
+{
+    flashLogPageHeader_s header =
+    {
+        .magic = FLASH_LOG_PAGE_MAGIC,
+        .eraseCount = pageEraseCount[ page ] + 1,
+        .firstSequence = firstSequence
+    };
+    header.crc = crc32( &header, offsetof( flashLogPageHeader_s, crc ) );
+
+    pageValid[ page ] = false;
+    pageEraseCount[ page ] = header.eraseCount;
+    stats.pagesErased++;
+    MSC_Status_TypeDef status = MSC_ErasePage( pageAddress( page ) );
+    if( mscReturnOk == status )
+    {
+        status = MSC_WriteWord( pageAddress( page ), &header, sizeof( header ) );
+    }
+    updateEraseStats();
+    if( mscReturnOk != status )
+    {
+        stats.writeErrors++;
+        LOG_ERROR( "Could not start flash log page %u (%d)", page, status );
+        return false;
+    }
+
+    pageValid[ page ] = true;
+    pageFirstSequence[ page ] = firstSequence;
+    activePage = page;
+    writeSlot = 0;
+    nextSequence = firstSequence;
+    return true;
+}
+
+//! findPage()
+//! @brief Look up the page holding a record in the page header index
+//!
+//! @param sequence
+//! @param page set to the page holding the record
+//! @returns true if a valid page holds the record
+static bool findPage( uint32_t sequence, uint8_t *page )
+{
+    for( uint8_t i = 0; i < FLASH_LOG_PAGES; i++ )
+    {
+        if( pageValid[ i ] && ( ( sequence - pageFirstSequence[ i ] ) < FLASH_LOG_RECORDS_PER_PAGE ) )
+        {
+            *page = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+//! recordValid()
+//! @brief Check a record in flash against its expected sequence number
+//! and CRC. Records cut short by a power loss fail the CRC
+//!
+//! @param record
+//! @param sequence
+//! @returns true if record is intact
+static bool recordValid( const flashLogRecord_s *record, uint32_t sequence )
+{
+    return ( record->sequence == sequence )
+        && ( record->count <= FLASH_LOG_BATCH_SAMPLES )
+        && ( record->crc == crc32( record, offsetof( flashLogRecord_s, crc ) ) );
+}
+
+//! writeRecord()
+//! @brief Program a pending batch into the next slot, starting the next
+//! page first if the active one is full. The slot is used up even if
+//! programming fails, since it can no longer be written
+//!
+//! @param tag
+//! @returns void
+static void writeRecord( flashLogTag_e tag )
+{
+    flashLogRecord_s *record = &pending[ tag ];
+    if( record->count == 0 )
+    {
+        return;
+    }
+    if( !pageValid[ activePage ] )
+    {
+        // Starting the log failed before, try again
+        if( !startPage( activePage, nextSequence ) )
+        {
+            return;
+        }
+    }
+    else if( writeSlot >= FLASH_LOG_RECORDS_PER_PAGE )
+    {
+        // Erase the oldest page, so pages are worn in turn
+        if( !startPage( ( activePage + 1 ) % FLASH_LOG_PAGES, nextSequence ) )
+        {
+            // Batch is kept and written with the next sample
+            return;
+        }
+    }
+
+    record->sequence = nextSequence;
+    record->crc = crc32( record, offsetof( flashLogRecord_s, crc ) );
+    MSC_Status_TypeDef status = MSC_WriteWord( ( uint32_t * ) slotAddress( activePage, writeSlot ),
+        record, sizeof( *record ) );
+    writeSlot++;
+    nextSequence++;
+    record->count = 0;
+    if( mscReturnOk != status )
+    {
+        stats.writeErrors++;
+        LOG_ERROR( "Could not write flash log record %lu (%d)", record->sequence, status );
+        return;
+    }
+    stats.recordsWritten++;
+    return;
+}
+
+//! flashLogInit()
+//! @brief Rebuild the page header index from the page headers and find
+//! the write position: the page with the newest header is the active
+//! page, and since its slots are written in order, the first erased slot
+//! is found by binary search. An empty or corrupted region is started over
+//!
+//! @param void
+//! @returns void
+void flashLogInit()
+{
+    MSC_Init();
+    memset( &stats, 0, sizeof( stats ) );
+
+    bool found = false;
+    for( uint8_t page = 0; page < FLASH_LOG_PAGES; page++ )
+    {
+        const flashLogPageHeader_s *header = ( const flashLogPageHeader_s * ) pageAddress( page );
+        pageValid[ page ] = ( FLASH_LOG_PAGE_MAGIC == header->magic )
+            && ( header->crc == crc32( header, offsetof( flashLogPageHeader_s, crc ) ) );
+        pageEraseCount[ page ] = pageValid[ page ] ? header->eraseCount : 0;
+        pageFirstSequence[ page ] = header->firstSequence;
+        if( pageValid[ page ] && ( !found || isBefore( pageFirstSequence[ activePage ], header->firstSequence ) ) )
+        {
+            activePage = page;
+            found = true;
+        }
+    }
+
+    // Pages are erased in turn, so a page without a valid header, not yet
+    // used or lost to a power loss between erase and header write, was
+    // erased once less than the active page, not counting the cut erase.
+    // Its wear is carried on rather than started over from zero
+    for( uint8_t page = 0; page < FLASH_LOG_PAGES; page++ )
+    {
+        if( found && !pageValid[ page ] )
+        {
+            pageEraseCount[ page ] = pageEraseCount[ activePage ] - 1;
+        }
+    }
+    updateEraseStats();
+
+    for( uint8_t tag = 0; tag < FLASH_LOG_NUMBER_OF_TAGS; tag++ )
+    {
+        pending[ tag ].count = 0;
+    }
+
+    if( !found )
+    {
+        LOG_INFO( "No flash log found, creating one" );
+        boot = 0;
+        startPage( 0, 0 );
+        return;
+    }
+
+    uint32_t low = 0;
+    uint32_t high = FLASH_LOG_RECORDS_PER_PAGE;
+    while( low < high )
+    {
+        uint32_t mid = ( low + high ) / 2;
+        if( FLASH_ERASED_WORD == slotAddress( activePage, mid )->sequence )
+        {
+            high = mid;
+        }
+        else
+        {
+            low = mid + 1;
+        }
+    }
+    writeSlot = low;
+    nextSequence = pageFirstSequence[ activePage ] + writeSlot;
+
+    // Newest intact record tells the previous boot number. Look back at
+    // most two pages, the active page may have just been started
+    boot = 0;
+    for( uint32_t n = 1; n <= ( 2 * FLASH_LOG_RECORDS_PER_PAGE ); n++ )
+    {
+        uint32_t sequence = nextSequence - n;
+        uint8_t page;
+        if( !findPage( sequence, &page ) )
+        {
+            break;
+        }
+        const flashLogRecord_s *record = slotAddress( page, sequence - pageFirstSequence[ page ] );
+        if( recordValid( record, sequence ) )
+        {
+            boot = record->boot + 1;
+            break;
+        }
+    }
+    LOG_INFO( "Flash log: page %u slot %lu, records %lu to %lu, boot %u", activePage, writeSlot,
+        flashLogOldestSequence(), nextSequence, boot );
+    return;
+}
+
+//! flashLogAppend()
+//! @brief Add a sample to the batch of its quantity. The batch is
+//! programmed once it is full, or early if the sample's time does not
+//! fit the batch
+//!
+//! @param tag
+//! @param timestampMs timeNowMs() when the sample was taken
+//! @param value
+//! @returns true if the sample was accepted, false if the flash could
+//! not be programmed and the batch is still full
+bool flashLogAppend( flashLogTag_e tag, uint64_t timestampMs, int32_t value )
+{
+    if( tag >= FLASH_LOG_NUMBER_OF_TAGS )
+    {
+        LOG_WARN( "Invalid flash log tag %d", tag );
+        return false;
+    }
+
+    flashLogRecord_s *record = &pending[ tag ];
+    if( ( record->count > 0 ) && ( ( timestampMs < record->timestampMs )
+        || ( ( timestampMs - record->timestampMs ) > UINT32_MAX ) ) )
+    {
+        writeRecord( tag );
+    }
+    if( record->count >= FLASH_LOG_BATCH_SAMPLES )
+    {
+        // Batch could not be programmed yet
+        writeRecord( tag );
+        if( record->count >= FLASH_LOG_BATCH_SAMPLES )
+        {
+            return false;
+        }
+    }
+    if( record->count == 0 )
+    {
+        // Unused entries are left erased
+        memset( record, 0xFF, sizeof( *record ) );
+        record->boot = boot;
+        record->tag = tag;
+        record->count = 0;
+        record->timestampMs = timestampMs;
+    }
+    record->entries[ record->count ].offsetMs = ( uint32_t ) ( timestampMs - record->timestampMs );
+    record->entries[ record->count ].value = value;
+    record->count++;
+    if( record->count >= FLASH_LOG_BATCH_SAMPLES )
+    {
+        writeRecord( tag );
+    }
+    return true;
+}
+
+//! flashLogFlush()
+//! @brief Program every partial batch now, e.g. before a planned reset
+//!
+//! @param void
+//! @returns void
+void flashLogFlush()
+{
+    for( uint8_t tag = 0; tag < FLASH_LOG_NUMBER_OF_TAGS; tag++ )
+    {
+        writeRecord( tag );
+    }
+    return;
+}
+
+//! flashLogOldestSequence()
+//! @brief Returns the sequence number of the oldest record still in flash
+//!
+//! @param void
+//! @returns sequence number
+uint32_t flashLogOldestSequence()
+{
+    uint32_t oldest = nextSequence;
+    for( uint8_t page = 0; page < FLASH_LOG_PAGES; page++ )
+    {
+        if( pageValid[ page ] && isBefore( pageFirstSequence[ page ], oldest ) )
+        {
+            oldest = pageFirstSequence[ page ];
+        }
+    }
+    return oldest;
+}
+
+//! flashLogNextSequence()
+//! @brief Returns the sequence number the next record will get
+//!
+//! @param void
+//! @returns sequence number
+uint32_t flashLogNextSequence()
+{
+    return nextSequence;
+}
+
+//! flashLogRead()
+//! @brief Copy the first intact record at or after *sequence. Records
+//! that were erased are skipped up to the oldest record, and records that
+//! fail their CRC are skipped
+//!
+//! @param sequence in: record to start at, out: record to read next
+//! @param record copy of the record read
+//! @returns true if a record was read, false at the end of the log
+bool flashLogRead( uint32_t *sequence, flashLogRecord_s *record )
+{
+    uint32_t oldest = flashLogOldestSequence();
+    uint32_t s = isBefore( *sequence, oldest ) ? oldest : *sequence;
+    while( isBefore( s, nextSequence ) )
+    {
+        uint8_t page;
+        if( !findPage( s, &page ) )
+        {
+            s++;
+            continue;
+        }
+        const flashLogRecord_s *slot = slotAddress( page, s - pageFirstSequence[ page ] );
+        s++;
+        if( recordValid( slot, s - 1 ) )
+        {
+            memcpy( record, slot, sizeof( *record ) );
+            *sequence = s;
+            return true;
+        }
+    }
+    *sequence = s;
+    return false;
+}
+
+//! flashLogGetBoot()
+//! @brief Returns the number of resets since the log was created
+//!
+//! @param void
+//! @returns boot number
+uint16_t flashLogGetBoot()
+{
+    return boot;
+}
+
+//! flashLogGetStats()
+//! @brief Returns the wear and usage counters
+//!
+//! @param void
+//! @returns pointer to counters
+const flashLogStats_s *flashLogGetStats()
+{
+    return &stats;
+}
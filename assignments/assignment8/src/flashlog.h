@@ -0,0 +1,107 @@
+//!
+//! @file flashlog.h
+//! @brief Append-only log of sample batches in a reserved region of
+//! internal flash, kept across resets
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources Utilized Silicon Labs' EMLIB peripheral libraries to implement functionality @n
+//!            em_msc.h - for flash page erase and word writes
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#ifndef __FLASHLOG_H___
+#define __FLASHLOG_H___
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "em_device.h"
+
+//! Number of flash pages reserved for the log, below the Bluetooth
+//! stack's NVM region at __flashLogBase
+#define FLASH_LOG_PAGES             ( 16 )
+
+//! Number of samples batched in RAM and programmed as one record
+#define FLASH_LOG_BATCH_SAMPLES     ( 16 )
+
+//! Value of the first word of a page header written by the log
+static const uint32_t FLASH_LOG_PAGE_MAGIC = 0x474F4C46;   // "FLOG"
+
+//! Quantity a record holds samples of. Each has its own batch
+typedef enum
+{
+    FLASH_LOG_TEMPERATURE,      //! milli-degrees Celsius
+    FLASH_LOG_HUMIDITY,         //! milli-percent relative humidity
+    FLASH_LOG_NUMBER_OF_TAGS
+} flashLogTag_e;
+
+//! Header at the start of every page in use, written right after erase
+typedef struct
+{
+    uint32_t magic;             //! FLASH_LOG_PAGE_MAGIC
+    uint32_t eraseCount;        //! Number of times the page was erased
+    uint32_t firstSequence;     //! Sequence number of the first record in the page
+    uint32_t crc;               //! CRC-32 of the fields above
+} flashLogPageHeader_s;
+
+//! Sample within a record
+typedef struct
+{
+    uint32_t offsetMs;          //! Time since the record's timestamp
+    int32_t value;
+} flashLogEntry_s;
+
+//! Batch of samples of one quantity, programmed in a single write
+typedef struct
+{
+    uint32_t sequence;          //! Increases by one per record over the whole log
+    uint16_t boot;              //! Number of resets since the log was created
+    uint8_t tag;                //! flashLogTag_e
+    uint8_t count;              //! Number of valid entries
+    uint64_t timestampMs;       //! timeNowMs() of the first sample
+    flashLogEntry_s entries[ FLASH_LOG_BATCH_SAMPLES ];
+    uint32_t reserved;          //! Left erased
+    uint32_t crc;               //! CRC-32 of the fields above
+} flashLogRecord_s;
+
+//! Number of record slots that follow the header in a page
+#define FLASH_LOG_RECORDS_PER_PAGE  ( ( FLASH_PAGE_SIZE - sizeof( flashLogPageHeader_s ) ) \
+                                    / sizeof( flashLogRecord_s ) )
+
+//! Wear and usage counters
+typedef struct
+{
+    uint32_t recordsWritten;    //! Records programmed since boot
+    uint32_t pagesErased;       //! Pages erased since boot
+    uint32_t writeErrors;       //! Failed erases and writes since boot
+    uint32_t minEraseCount;     //! Lowest erase count over the log's pages
+    uint32_t maxEraseCount;     //! Highest erase count over the log's pages
+} flashLogStats_s;
+
+void flashLogInit();
+
+bool flashLogAppend( flashLogTag_e tag, uint64_t timestampMs, int32_t value );
+
+void flashLogFlush();
+
+uint32_t flashLogOldestSequence();
+
+uint32_t flashLogNextSequence();
+
+bool flashLogRead( uint32_t *sequence, flashLogRecord_s *record );
+
+uint16_t flashLogGetBoot();
+
+const flashLogStats_s *flashLogGetStats();
+
+#endif // __FLASHLOG_H___
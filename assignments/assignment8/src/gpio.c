@@ -119,6 +119,73 @@ void gpioI2cSclDisable()
     GPIO_PinOutClear( I2C0_SCL_PORT, I2C0_SCL_PIN );
 }
 
+//! gpioI2cBusRelease()
+//! @brief Hand I2C0 SCL and SDA to the GPIO as open-drain outputs with
+//! both lines released, e.g. to clock a stuck slave by hand
+//!
+//! @param void
+//! @returns void
+void gpioI2cBusRelease()
+{
+    // Release SCL first so SDA does not change while SCL is low
+    GPIO_PinModeSet( I2C0_SCL_PORT, I2C0_SCL_PIN, gpioModeWiredAndPullUp, 1 );
+    GPIO_PinModeSet( I2C0_SDA_PORT, I2C0_SDA_PIN, gpioModeWiredAndPullUp, 1 );
+}
+
+//! gpioI2cSclSet()
+//! @brief Drive I2C0 SCL low or release it high
+//!
+//! @param high
+//! @returns void
+void gpioI2cSclSet( bool high )
+{
+    if( high )
+    {
+        GPIO_PinOutSet( I2C0_SCL_PORT, I2C0_SCL_PIN );
+    }
+    else
+    {
+        GPIO_PinOutClear( I2C0_SCL_PORT, I2C0_SCL_PIN );
+    }
+}
+
+//! gpioI2cSdaSet()
+//! @brief Drive I2C0 SDA low or release it high
+//!
+//! @param high
+//! @returns void
+void gpioI2cSdaSet( bool high )
+{
+    if( high )
+    {
+        GPIO_PinOutSet( I2C0_SDA_PORT, I2C0_SDA_PIN );
+    }
+    else
+    {
+        GPIO_PinOutClear( I2C0_SDA_PORT, I2C0_SDA_PIN );
+    }
+}
+
+//! gpioI2cSclIsHigh()
+//! @brief Read the level of the I2C0 SCL line
+//!
+//! @param void
+//! @returns true if SCL is high
+bool gpioI2cSclIsHigh()
+{
+    return ( GPIO_PinInGet( I2C0_SCL_PORT, I2C0_SCL_PIN ) != 0 );
+}
+
+//! gpioI2cSdaIsHigh()
+//! @brief Read the level of the I2C0 SDA line
+//!
+//! @param void
+//! @returns true if SDA is high
+bool gpioI2cSdaIsHigh()
+{
+    return ( GPIO_PinInGet( I2C0_SDA_PORT, I2C0_SDA_PIN ) != 0 );
+}
+
 //! gpioSi7021Enable()
 //! @brief Set GPIO for Si7021 sensor
 //!
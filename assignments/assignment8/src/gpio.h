@@ -51,6 +51,11 @@ void gpioLed1Toggle();
 
 void gpioI2cSdaDisable();
 void gpioI2cSclDisable();
+void gpioI2cBusRelease();
+void gpioI2cSclSet( bool high );
+void gpioI2cSdaSet( bool high );
+bool gpioI2cSclIsHigh();
+bool gpioI2cSdaIsHigh();
 void gpioSi7021Enable();
 void gpioSi7021Disable();
 
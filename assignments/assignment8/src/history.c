@@ -0,0 +1,407 @@
+//!
+//! @file history.c
+//! @brief Implements the bulk history download. A request positions a
+//! reader on the temperature or humidity history ring. Samples are then
+//! delta coded into notifications sized to the connection's ATT MTU, and
+//! each notification spends one credit granted by the client. When the
+//! stack runs out of buffers, the unsent packet is rebuilt on a soft
+//! timer instead of being lost
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources Silicon Labs Bluetooth API reference (UG136) for
+//! gecko_cmd_gatt_server_send_characteristic_notification and soft timers
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#include "history.h"
+
+#include "log.h"
+#include "ble.h"
+#include "scheduler.h"
+#include "samplering.h"
+#include "timebase.h"
+#include "gatt_db.h"
+#include "gecko_ble_errors.h"
+#include "infrastructure.h"
+
+//! ATT error for a request sent before notifications were enabled. A
+//! common profile error code, the stack has no bg_err_att_* value for it
+static const uint8_t ATT_CCCD_IMPROPERLY_CONFIGURED = 0xFD;
+
+//! ATT error for a request while another client's download runs
+static const uint8_t ATT_PROCEDURE_ALREADY_IN_PROGRESS = 0xFE;
+
+//! State of the download and the connection that owns it
+typedef struct
+{
+    uint8_t connection;         //! Connection handle of the last requester
+    bool active;                //! A range is being sent
+    bool retryPending;          //! Soft timer is running
+    const sampleRing_s *ring;   //! Ring the range is read from
+    sampleRingCursor_s cursor;  //! Next sample to send
+    uint32_t endSample;         //! Sequence number after the last sample of the range
+    uint32_t reportedLost;      //! cursor.lost already flagged to the client
+    uint16_t credits;           //! Notifications the client allows
+    uint32_t packets;           //! Notifications sent for the range
+    uint32_t bytes;             //! Payload bytes sent for the range
+    uint64_t startMs;           //! Time the range was requested
+} historyTransfer_s;
+
+static historyTransfer_s transfer;
+
+static historyStats_s stats;
+
+//! endTransfer()
+//! @brief Stop sending and log the effective throughput of the range
+//!
+//! @param reason
+//! @returns void
+static void endTransfer( const char *reason )
+{
+    if( !transfer.active )
+    {
+        return;
+    }
+    transfer.active = false;
+    stats.packets = transfer.packets;
+    stats.bytes = transfer.bytes;
+    stats.elapsedMs = ( uint32_t ) ( timeNowMs() - transfer.startMs );
+    stats.bytesPerSecond = ( stats.elapsedMs > 0 ) ? ( uint32_t ) ( ( uint64_t ) stats.bytes * 1000 / stats.elapsedMs ) : 0;
+    stats.lost = transfer.cursor.lost;
+    ( void ) reason;
+    LOG_INFO( "History download %s: %lu packets : %lu bytes : %lu ms : %lu bytes/s : %lu samples lost",
+        reason, stats.packets, stats.bytes, stats.elapsedMs, stats.bytesPerSecond, stats.lost );
+    return;
+}
+
+//! finishTransfer()
+//! @brief End a download whose connection stays open and return the
+//! connection to the steady state parameters
+//!
+//! @param reason
+//! @returns void
+static void finishTransfer( const char *reason )
+{
+    if( !transfer.active )
+    {
+        return;
+    }
+    endTransfer( reason );
+    bleRequestConnParams( transfer.connection, BLE_CONN_PARAMS_STEADY );
+    return;
+}
+
+//! getPayloadSize()
+//! @brief Returns the largest notification payload for the MTU of the
+//! connection that owns the download
+//!
+//! @param void
+//! @returns payload size in bytes
+static uint16_t getPayloadSize()
+{
+    uint16_t payload = bleGetMtu( transfer.connection ) - 3;
+    return ( payload > HISTORY_MAX_PAYLOAD ) ? HISTORY_MAX_PAYLOAD : payload;
+}
+
+//! buildPacket()
+//! @brief Pack as many samples from the cursor as fit in one payload.
+//! A sample whose time step or value change does not fit a record starts
+//! the next packet. Advances transfer.cursor past the packed samples
+//!
+//! @param packet
+//! @param size payload size, at least HISTORY_HEADER_SIZE
+//! @returns number of bytes in the packet
+static uint16_t buildPacket( uint8_t *packet, uint16_t size )
+{
+    uint8_t *p = packet + HISTORY_HEADER_SIZE;
+    uint32_t firstSample = transfer.cursor.sample;
+    uint64_t firstMs = 0;
+    int32_t firstValue = 0;
+    uint64_t lastMs = 0;
+    int32_t lastValue = 0;
+    uint8_t count = 0;
+    bool exhausted = false;
+
+    while( count < UINT8_MAX )
+    {
+        if( ( int32_t ) ( transfer.cursor.sample - transfer.endSample ) >= 0 )
+        {
+            exhausted = true;
+            break;
+        }
+        sampleRingCursor_s next = transfer.cursor;
+        sampleRingSample_s sample;
+        if( !sampleRingRead( transfer.ring, &next, &sample ) )
+        {
+            exhausted = true;
+            break;
+        }
+        if( ( int32_t ) ( next.sample - 1 - transfer.endSample ) >= 0 )
+        {
+            // Skipped past the end of the range over overwritten samples
+            transfer.cursor = next;
+            exhausted = true;
+            break;
+        }
+        if( count == 0 )
+        {
+            firstSample = next.sample - 1;
+            firstMs = sample.timestampMs;
+            firstValue = sample.value;
+        }
+        else
+        {
+            uint64_t elapsedMs = sample.timestampMs - lastMs;
+            int64_t delta = ( int64_t ) sample.value - lastValue;
+            if( ( ( p + HISTORY_RECORD_SIZE ) > ( packet + size ) ) || ( elapsedMs > UINT32_MAX )
+                || ( delta < INT16_MIN ) || ( delta > INT16_MAX ) )
+            {
+                break;
+            }
+            UINT32_TO_BITSTREAM( p, ( uint32_t ) elapsedMs );
+            UINT16_TO_BITSTREAM( p, ( uint16_t ) ( int16_t ) delta );
+        }
+        transfer.cursor = next;
+        lastMs = sample.timestampMs;
+        lastValue = sample.value;
+        count++;
+    }
+
+    uint8_t flags = exhausted ? HISTORY_FLAG_END : 0;
+    if( transfer.cursor.lost != transfer.reportedLost )
+    {
+        flags |= HISTORY_FLAG_GAP;
+        transfer.reportedLost = transfer.cursor.lost;
+    }
+    uint8_t *h = packet;
+    UINT32_TO_BITSTREAM( h, firstSample );
+    UINT8_TO_BITSTREAM( h, count );
+    UINT8_TO_BITSTREAM( h, flags );
+    UINT32_TO_BITSTREAM( h, ( uint32_t ) firstMs );
+    UINT32_TO_BITSTREAM( h, ( uint32_t ) ( firstMs >> 32 ) );
+    UINT32_TO_BITSTREAM( h, ( uint32_t ) firstValue );
+    return p - packet;
+}
+
+//! historyPump()
+//! @brief Send notifications while the client has credits left. Called
+//! after each request and from the retry soft timer
+//!
+//! @param void
+//! @returns void
+void historyPump()
+{
+    transfer.retryPending = false;
+    uint8_t packet[ HISTORY_MAX_PAYLOAD ];
+    uint16_t size = getPayloadSize();
+
+    while( transfer.active && ( transfer.credits > 0 ) )
+    {
+        sampleRingCursor_s cursor = transfer.cursor;
+        uint32_t reportedLost = transfer.reportedLost;
+        uint16_t length = buildPacket( packet, size );
+
+        struct gecko_msg_gatt_server_send_characteristic_notification_rsp_t *rsp;
+        rsp = gecko_cmd_gatt_server_send_characteristic_notification( transfer.connection,
+            gattdb_history_data, length, packet );
+        if( rsp->result == bg_err_out_of_memory )
+        {
+            // Rebuild the same packet once the stack has sent what it holds
+            transfer.cursor = cursor;
+            transfer.reportedLost = reportedLost;
+            transfer.retryPending = true;
+            BTSTACK_CHECK_RESPONSE(
+                gecko_cmd_hardware_set_soft_timer( HISTORY_RETRY_TICKS, HISTORY_SOFT_TIMER_HANDLE, 1 ) );
+            return;
+        }
+        if( rsp->result != bg_err_success )
+        {
+            LOG_WARN( "History notification failed: %s", bleResponseString( rsp->result ) );
+            finishTransfer( "failed" );
+            return;
+        }
+
+        transfer.credits--;
+        transfer.packets++;
+        transfer.bytes += length;
+        if( packet[ 5 ] & HISTORY_FLAG_END )
+        {
+            finishTransfer( "complete" );
+        }
+    }
+    return;
+}
+
+//! startTransfer()
+//! @brief Position the reader for a HISTORY_OP_START request
+//!
+//! @param connection connection of the requester
+//! @param data request, HISTORY_START_LENGTH bytes
+//! @returns ATT error code, 0 if the download started
+static uint8_t startTransfer( uint8_t connection, const uint8_t *data )
+{
+    uint8_t tag = data[ 1 ];
+    uint32_t first = data[ 2 ] | ( data[ 3 ] << 8 ) | ( data[ 4 ] << 16 ) | ( ( uint32_t ) data[ 5 ] << 24 );
+    uint32_t count = data[ 6 ] | ( data[ 7 ] << 8 ) | ( data[ 8 ] << 16 ) | ( ( uint32_t ) data[ 9 ] << 24 );
+    uint16_t credits = data[ 10 ] | ( data[ 11 ] << 8 );
+
+    if( FLASH_LOG_TEMPERATURE == tag )
+    {
+        transfer.ring = schedulerGetTemperatureHistory();
+    }
+    else if( FLASH_LOG_HUMIDITY == tag )
+    {
+        transfer.ring = schedulerGetHumidityHistory();
+    }
+    else
+    {
+        return ( uint8_t ) bg_err_att_value_not_allowed;
+    }
+
+    endTransfer( "restarted" );
+    transfer.connection = connection;
+    sampleRingCursorSeek( transfer.ring, &transfer.cursor, first );
+    // A count of 0 takes every sample stored when the request arrived
+    transfer.endSample = ( count == 0 ) ? transfer.ring->appended : first + count;
+    transfer.reportedLost = 0;
+    transfer.credits = credits;
+    transfer.packets = 0;
+    transfer.bytes = 0;
+    transfer.startMs = timeNowMs();
+    transfer.active = true;
+    LOG_INFO( "History download: connection %d : tag %u : samples %lu to %lu : %lu lost : MTU %u",
+        connection, tag, transfer.cursor.sample, transfer.endSample, transfer.cursor.lost, bleGetMtu( connection ) );
+    // Short connection interval for the length of the download
+    bleRequestConnParams( connection, BLE_CONN_PARAMS_FAST );
+    return 0;
+}
+
+//! historyHandleControlWrite()
+//! @brief Answer a write to the History Control characteristic and send
+//! what the request allows
+//!
+//! @param request user write request event data
+//! @returns void
+void historyHandleControlWrite( const struct gecko_msg_gatt_server_user_write_request_evt_t *request )
+{
+    const uint8_t *data = request->value.data;
+    uint8_t length = request->value.len;
+    uint8_t result = 0;
+
+    // ATT error codes are the low byte of the stack's bg_err_att_* values
+    if( ( request->offset != 0 ) || ( length == 0 ) )
+    {
+        result = ( uint8_t ) bg_err_att_invalid_att_length;
+    }
+    else if( !bleIsSubscribed( request->connection, gattdb_history_data ) )
+    {
+        result = ATT_CCCD_IMPROPERLY_CONFIGURED;
+    }
+    else if( transfer.active && ( request->connection != transfer.connection ) )
+    {
+        result = ATT_PROCEDURE_ALREADY_IN_PROGRESS;
+    }
+    else if( HISTORY_OP_START == data[ 0 ] )
+    {
+        result = ( length == HISTORY_START_LENGTH ) ?
+            startTransfer( request->connection, data ) : ( uint8_t ) bg_err_att_invalid_att_length;
+    }
+    else if( HISTORY_OP_CREDIT == data[ 0 ] )
+    {
+        if( length == HISTORY_CREDIT_LENGTH )
+        {
+            uint32_t credits = transfer.credits + ( data[ 1 ] | ( data[ 2 ] << 8 ) );
+            transfer.credits = ( credits > UINT16_MAX ) ? UINT16_MAX : credits;
+        }
+        else
+        {
+            result = ( uint8_t ) bg_err_att_invalid_att_length;
+        }
+    }
+    else if( HISTORY_OP_ABORT == data[ 0 ] )
+    {
+        finishTransfer( "aborted" );
+    }
+    else
+    {
+        result = ( uint8_t ) bg_err_att_value_not_allowed;
+    }
+
+    if( request->att_opcode == gatt_write_request )
+    {
+        BTSTACK_CHECK_RESPONSE(
+            gecko_cmd_gatt_server_send_user_write_response( request->connection, request->characteristic, result ) );
+    }
+    if( ( result == 0 ) && !transfer.retryPending )
+    {
+        historyPump();
+    }
+    return;
+}
+
+//! historyConnectionClosed()
+//! @brief Stop a download whose connection closed. The client resumes it
+//! on its next connection from the last sample it received
+//!
+//! @param connection
+//! @returns void
+void historyConnectionClosed( uint8_t connection )
+{
+    if( connection != transfer.connection )
+    {
+        return;
+    }
+    endTransfer( "interrupted" );
+    if( transfer.retryPending )
+    {
+        BTSTACK_CHECK_RESPONSE( gecko_cmd_hardware_set_soft_timer( 0, HISTORY_SOFT_TIMER_HANDLE, 1 ) );
+        transfer.retryPending = false;
+    }
+    return;
+}
+
+//! historySetNotifications()
+//! @brief Stop a download in progress when its client disables History
+//! Data notifications
+//!
+//! @param connection
+//! @param enabled
+//! @returns void
+void historySetNotifications( uint8_t connection, bool enabled )
+{
+    if( ( connection == transfer.connection ) && !enabled )
+    {
+        finishTransfer( "aborted" );
+    }
+    return;
+}
+
+//! historyIsActive()
+//! @brief Asserts whether a download is running on a connection
+//!
+//! @param connection
+//! @returns true if a download is running
+bool historyIsActive( uint8_t connection )
+{
+    return transfer.active && ( connection == transfer.connection );
+}
+
+//! historyGetStats()
+//! @brief Returns the throughput of the last download that ended
+//!
+//! @param void
+//! @returns pointer to counters
+const historyStats_s *historyGetStats()
+{
+    return &stats;
+}
@@ -0,0 +1,105 @@
+//!
+//! @file history.h
+//! @brief Bulk download of the sample history rings over GATT. The
+//! client requests a range of samples and the server streams them packed
+//! in notifications as large as the negotiated ATT MTU allows, paced by
+//! credits the client grants
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources Silicon Labs Bluetooth API reference (UG136) for
+//! gecko_cmd_gatt_server_send_characteristic_notification and soft timers
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#ifndef __HISTORY_H___
+#define __HISTORY_H___
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "native_gecko.h"
+#include "flashlog.h"
+
+//! Requests written to the History Control characteristic. All fields
+//! are little endian
+//!
+//! HISTORY_OP_START: op, tag (flashLogTag_e), uint32 first sample,
+//! uint32 number of samples (0 for every sample stored now), uint16 credits.
+//! Samples are numbered from boot without gaps, so a client resumes an
+//! interrupted download by starting at the sample after the last one it
+//! received
+//!
+//! HISTORY_OP_CREDIT: op, uint16 credits. Each credit allows one more
+//! notification
+//!
+//! HISTORY_OP_ABORT: op
+//!
+//! One download runs at a time. Another client's requests are rejected
+//! until it ends
+typedef enum
+{
+    HISTORY_OP_START = 0x01,
+    HISTORY_OP_CREDIT = 0x02,
+    HISTORY_OP_ABORT = 0x03
+} historyOp_e;
+
+//! Length of each request, op included
+#define HISTORY_START_LENGTH    ( 12 )
+#define HISTORY_CREDIT_LENGTH   ( 3 )
+#define HISTORY_ABORT_LENGTH    ( 1 )
+
+//! Notification of the History Data characteristic:
+//! uint32 sequence number of the first sample, uint8 number of samples,
+//! uint8 flags, uint64 timestamp of the first sample in milliseconds,
+//! int32 value of the first sample. Each following sample is a record of
+//! uint32 milliseconds and int16 value change since the previous sample
+#define HISTORY_HEADER_SIZE     ( 18 )
+#define HISTORY_RECORD_SIZE     ( 6 )
+
+//! Flags of a notification
+#define HISTORY_FLAG_END        ( 0x01 )    //! Last notification of the range
+#define HISTORY_FLAG_GAP        ( 0x02 )    //! Samples before this one were overwritten
+
+//! Largest notification payload, for an ATT MTU of 247
+#define HISTORY_MAX_PAYLOAD     ( 244 )
+
+//! Bluetooth stack soft timer that retries notifications when the stack
+//! is out of buffers
+static const uint8_t HISTORY_SOFT_TIMER_HANDLE = 1;
+
+//! Retry delay in 32768 Hz ticks, about one connection event at 7.5 ms
+static const uint32_t HISTORY_RETRY_TICKS = 328;
+
+//! Throughput of the last download that ended
+typedef struct
+{
+    uint32_t packets;           //! Notifications sent
+    uint32_t bytes;             //! Payload bytes sent
+    uint32_t elapsedMs;         //! Time from the request to the end
+    uint32_t bytesPerSecond;    //! Effective payload throughput
+    uint32_t lost;              //! Samples overwritten before they were sent
+} historyStats_s;
+
+void historyConnectionClosed( uint8_t connection );
+
+void historySetNotifications( uint8_t connection, bool enabled );
+
+void historyHandleControlWrite( const struct gecko_msg_gatt_server_user_write_request_evt_t *request );
+
+void historyPump();
+
+bool historyIsActive( uint8_t connection );
+
+const historyStats_s *historyGetStats();
+
+#endif // __HISTORY_H___
@@ -23,18 +23,88 @@
 #include "log.h"
 #include "gpio.h"
 #include "timers.h"
+#include "conversions.h"
+#include "timebase.h"
+#include "scheduler.h"
+#include "swtimers.h"
+#include "ldma.h"
 
 #include "i2cspm.h"
 #include "em_cmu.h"
 
-//! Transfer Sequence structure passed to @ref I2C_TransferInit() that must
-//! exist until after I2C_Transfer() is called and the transfer is completed
-static I2C_TransferSeq_TypeDef seq;
+//! Queue of submitted transactions. The head is the transaction in
+//! progress on I2C0, the rest start back to back from interrupt context
+static i2cTransaction_s *queueHead = NULL;
+static i2cTransaction_s *queueTail = NULL;
+
+//! True while the transaction at the head of the queue is on the bus
+static bool transferStarted = false;
+
+//! True between i2cInit() and i2cDeinit()
+static bool busEnabled = false;
+
+//! LDMA descriptors for the transaction in progress. A read needs a
+//! transfer and a command write per byte, plus the STOP after the last one
+static DMA_DESCRIPTOR_TypeDef ldmaDescriptors[ ( 2 * I2C_LDMA_MAX_LEN ) + 1 ];
+
+//! True if eligible transactions are moved by the LDMA
+static bool ldmaEnabled = true;
+
+//! True if the transaction in progress is moved by the LDMA
+static bool transferUsesLdma = false;
+
+//! Interrupt counters for transactions run byte by byte and by the LDMA
+static i2cInterruptStats_s byteStats;
+static i2cInterruptStats_s ldmaStats;
+
+//! Deadline of the transaction in progress
+static swTimer_s timeoutTimer;
+
+//! Error counters for all transactions
+static i2cErrorStats_s errorStats;
+
+//! Number of SCL pulses that lets a slave finish any byte it is sending
+static const uint8_t I2C_RECOVERY_CLOCKS = 9;
+
+//! Transaction descriptor used for Si7021 transfers. Its completion
+//! signals the scheduler
+static i2cTransaction_s si7021Transaction;
+
+//! Per-resolution User Register 1 bits, maximum temperature conversion
+//! time in microseconds and number of valid bits in the temperature code,
+//! indexed by si7021Resolution_e
+static const uint8_t RESOLUTION_USER_REG_BITS[ SI7021_NUMBER_OF_RESOLUTIONS ] = { 0x00, 0x80, 0x01, 0x81 };
+static const uint32_t RESOLUTION_CONVERSION_US[ SI7021_NUMBER_OF_RESOLUTIONS ] = { 10800, 6200, 3800, 2400 };
+static const uint8_t RESOLUTION_BITS[ SI7021_NUMBER_OF_RESOLUTIONS ] = { 14, 13, 12, 11 };
+
+//! Per-resolution maximum RH conversion time in microseconds and number
+//! of valid bits in the RH code. An RH conversion is followed by a
+//! temperature conversion, so both times are spent per RH measurement
+static const uint32_t RESOLUTION_HUMIDITY_CONVERSION_US[ SI7021_NUMBER_OF_RESOLUTIONS ] = { 12000, 4500, 3100, 7000 };
+static const uint8_t RESOLUTION_HUMIDITY_BITS[ SI7021_NUMBER_OF_RESOLUTIONS ] = { 12, 10, 8, 11 };
+
+//! Resolution selected by i2cSetResolution()
+static si7021Resolution_e requestedResolution = SI7021_RESOLUTION_14_BIT;
+
+//! Resolution the sensor is configured for since its last power-up
+static si7021Resolution_e activeResolution = SI7021_RESOLUTION_14_BIT;
 
 //! Local copy of data structure used for I2C Transfers. Can be accessed by
 //! other modules via the i2cGetDataBuffer() routine
 static i2cData_s buffer;
 
+//! Final status of the last Si7021 transaction
+static volatile I2C_TransferReturn_TypeDef transferStatus = i2cTransferDone;
+
+//! True while this module holds a sleep block on EM2
+static bool em2Blocked = false;
+
+//! RTCC time at which the current EM2 block started
+static uint64_t em2BlockStartTicks = 0;
+
+//! RTCC ticks spent with EM2 blocked since i2cClearEM1Time()
+static uint64_t em1Ticks = 0;
+
 //! i2cGetDataBuffer()
 //! @brief Performs temperature conversion on raw data by calling
 //! the i2cGetTemperature() routine and returns pointer to our buffer
@@ -64,21 +134,66 @@ static I2CSPM_Init_TypeDef i2cConfiguration = {
 
 static void i2cSleepBlockStart( SLEEP_EnergyMode_t sleepMode );
 static void i2cSleepBlockEnd( SLEEP_EnergyMode_t sleepMode );
+static void i2cStartQueued();
 
 
-void i2cEM2BlockStart()
+//! i2cEM2BlockStart()
+//! @brief Block EM2 mode so I2C0 stays clocked while transactions are
+//! queued. Calling it while EM2 is already blocked has no effect
+//!
+//! @param void
+//! @returns void
+static void i2cEM2BlockStart()
 {
-    i2cSleepBlockStart( sleepEM2 );
+    if( !em2Blocked )
+    {
+        em2Blocked = true;
+        em2BlockStartTicks = timeNowTicks();
+        i2cSleepBlockStart( sleepEM2 );
+    }
 }
 
 //! i2cEM2BlockEnd()
-//! @brief Stop blocking EM2 mode
+//! @brief Stop blocking EM2 mode and add the time spent in EM1 to the
+//! running total. Calling it while EM2 is not blocked has no effect
+//!
+//! @param void
+//! @returns void
+static void i2cEM2BlockEnd()
+{
+    if( em2Blocked )
+    {
+        em2Blocked = false;
+        em1Ticks += timeNowTicks() - em2BlockStartTicks;
+        i2cSleepBlockEnd( sleepEM2 );
+    }
+}
+
+//! i2cGetEM1TimeUs()
+//! @brief Returns the time EM2 was blocked by this module since the last
+//! call to i2cClearEM1Time(), including a block still in progress
+//!
+//! @param void
+//! @returns time in microseconds
+uint32_t i2cGetEM1TimeUs()
+{
+    uint64_t ticks = em1Ticks;
+    if( em2Blocked )
+    {
+        ticks += timeNowTicks() - em2BlockStartTicks;
+    }
+    return ( uint32_t ) timeTicksToUs( ticks );
+}
+
+//! i2cClearEM1Time()
+//! @brief Reset the time accumulated by i2cGetEM1TimeUs()
 //!
 //! @param void
 //! @returns void
-void i2cEM2BlockEnd()
+void i2cClearEM1Time()
 {
-    i2cSleepBlockEnd( sleepEM2 );
+    em1Ticks = 0;
+    em2BlockStartTicks = timeNowTicks();
 }
 
 //! i2cInit()
@@ -93,6 +208,7 @@ void i2cInit()
     // Initialize I2C peripheral
     I2CSPM_Init( &i2cConfiguration );
     NVIC_EnableIRQ( I2C0_IRQn );
+    busEnabled = true;
     CORE_EXIT_CRITICAL();
 
     return;
@@ -100,7 +216,9 @@ void i2cInit()
 
 //! i2cDeinit()
 //! @brief Unitialize I2C0 device by disabling I2C controller,
-//! disabling GPIOs for SCL/SDA, and disabling I2C clock
+//! disabling GPIOs for SCL/SDA, and disabling I2C clock. Queued
+//! transactions are dropped and their callbacks are called with
+//! i2cTransferSwFault once the bus is down, outside the critical section
 //! @resources this code comes from an instructor example
 //!
 //! @param void
@@ -109,6 +227,19 @@ void i2cDeinit()
 {
     CORE_DECLARE_IRQ_STATE;
     CORE_ENTER_CRITICAL();
+    // Take the queue, the devices are being powered down with the bus
+    i2cTransaction_s *dropped = queueHead;
+    queueHead = NULL;
+    queueTail = NULL;
+    transferStarted = false;
+    busEnabled = false;
+    i2cEM2BlockEnd();
+    swTimerStop( &timeoutTimer );
+    if( transferUsesLdma )
+    {
+        ldmaStopTransfer( LDMA_CHANNEL_I2C );
+        transferUsesLdma = false;
+    }
     // Disable the I2C controller
     I2C_Reset( I2C0 );
     I2C_Enable( I2C0, false );
@@ -120,6 +251,22 @@ void i2cDeinit()
     NVIC_DisableIRQ( I2C0_IRQn );
     CORE_EXIT_CRITICAL();
 
+    if( dropped != NULL )
+    {
+        LOG_WARN( "Dropping queued I2C transactions" );
+    }
+    while( dropped != NULL )
+    {
+        i2cTransaction_s *transaction = dropped;
+        dropped = transaction->next;
+        transaction->next = NULL;
+        transaction->status = i2cTransferSwFault;
+        if( transaction->callback != NULL )
+        {
+            transaction->callback( transaction );
+        }
+    }
+
     return;
 }
 
@@ -127,12 +274,12 @@ void i2cDeinit()
 //! @brief Start transfer to command sensor to take a
 //! temperature measurement
 //!
-//! @param void
+//! @param cmd measurement command, e.g. TEMP_READ_NO_HOLD_CMD
 //! @returns i2cTransferInProgress when transfer is successfully initiated
-I2C_TransferReturn_TypeDef i2cSendCommand()
+I2C_TransferReturn_TypeDef i2cSendCommand( uint8_t cmd )
 {
     I2C_TransferReturn_TypeDef status;
-    buffer.data[ 0 ] = TEMP_READ_CMD;
+    buffer.data[ 0 ] = cmd;
     buffer.len = 1;
     status = i2cWrite( buffer.data, buffer.len );
     if( i2cTransferInProgress != status && i2cTransferDone != status )
@@ -160,6 +307,117 @@ I2C_TransferReturn_TypeDef i2cReceiveData()
     return status;
 }
 
+//! si7021CommandRead()
+//! @brief Start a single transfer that writes a command and, after a
+//! repeated start, reads the 2-byte result. Only one completion
+//! interrupt is raised for the whole measurement
+//!
+//! @param cmd
+//! @returns i2cTransferInProgress when transfer is successfully initiated
+static I2C_TransferReturn_TypeDef si7021CommandRead( uint8_t cmd )
+{
+    I2C_TransferReturn_TypeDef status;
+    // Command and result share the buffer: the command byte is sent
+    // before the first result byte is received
+    buffer.data[ 0 ] = cmd;
+    buffer.len = 2;
+    status = i2cWriteRead( buffer.data, 1, buffer.data, buffer.len );
+    if( i2cTransferInProgress != status && i2cTransferDone != status )
+    {
+        i2cReturnDecode( status );
+    }
+    return status;
+}
+
+//! i2cMeasureTemperature()
+//! @brief Start a Hold Master temperature measurement and read its result
+//! in the same transfer
+//!
+//! @param void
+//! @returns i2cTransferInProgress when transfer is successfully initiated
+I2C_TransferReturn_TypeDef i2cMeasureTemperature()
+{
+    return si7021CommandRead( TEMP_READ_CMD );
+}
+
+//! i2cMeasureHumidity()
+//! @brief Start a Hold Master RH measurement and read its result in the
+//! same transfer. The temperature measured with it can then be read
+//! with i2cReadPreviousTemperature()
+//!
+//! @param void
+//! @returns i2cTransferInProgress when transfer is successfully initiated
+I2C_TransferReturn_TypeDef i2cMeasureHumidity()
+{
+    return si7021CommandRead( HUMIDITY_READ_CMD );
+}
+
+//! i2cReadPreviousTemperature()
+//! @brief Read the temperature measured during the last RH conversion.
+//! No conversion is started, so the result is returned right away
+//!
+//! @param void
+//! @returns i2cTransferInProgress when transfer is successfully initiated
+I2C_TransferReturn_TypeDef i2cReadPreviousTemperature()
+{
+    return si7021CommandRead( TEMP_READ_PREVIOUS_CMD );
+}
+
+//! i2cProbe()
+//! @brief Start an address-only write to check whether the sensor ACKs
+//! its address, e.g. to detect when it has finished powering up
+//!
+//! @param void
+//! @returns i2cTransferInProgress when transfer is successfully initiated
+I2C_TransferReturn_TypeDef i2cProbe()
+{
+    buffer.len = 0;
+    return i2cWrite( buffer.data, buffer.len );
+}
+
+//! si7021TransactionDone()
+//! @brief Completion callback for Si7021 transactions. Signals the
+//! scheduler and keeps the status for i2cGetTransferStatus()
+//!
+//! @param transaction
+//! @returns void
+static void si7021TransactionDone( i2cTransaction_s *transaction )
+{
+    transferStatus = transaction->status;
+    if( !busEnabled )
+    {
+        // Dropped by i2cDeinit(), which the scheduler calls itself when
+        // it powers the sensor down
+        return;
+    }
+    if( i2cTransferDone == transaction->status )
+    {
+        schedulerSetEventTransactionDone();
+    }
+    else
+    {
+        schedulerSetEventTransactionError();
+    }
+    return;
+}
+
+//! si7021Submit()
+//! @brief Queue the Si7021 transaction descriptor
+//!
+//! @param void
+//! @returns i2cTransferInProgress if transaction was queued
+static I2C_TransferReturn_TypeDef si7021Submit()
+{
+    si7021Transaction.seq.addr = SI7021_ADDR << 1;
+    si7021Transaction.callback = si7021TransactionDone;
+    si7021Transaction.arg = NULL;
+    // In Hold Master mode the sensor stretches SCL for the whole
+    // conversion started by the command written first
+    si7021Transaction.stretchUs = ( I2C_FLAG_WRITE_READ == si7021Transaction.seq.flags ) ?
+        i2cGetConversionTimeUs( si7021Transaction.seq.buf[ 0 ].data[ 0 ] ) : 0;
+    return i2cSubmit( &si7021Transaction );
+}
+
 //! i2cRead()
 //! @brief Receive data from I2C slave
 //!
@@ -169,12 +427,11 @@ I2C_TransferReturn_TypeDef i2cReceiveData()
 //! Transfer is completed by calling I2C_Transfer() in interrupt context
 I2C_TransferReturn_TypeDef i2cRead( uint8_t *result, uint16_t resultLen )
 {
-    seq.addr = SI7021_ADDR << 1;
-    seq.flags = I2C_FLAG_READ;
-    seq.buf[ 0 ].data = result;
-    seq.buf[ 0 ].len = resultLen;
+    si7021Transaction.seq.flags = I2C_FLAG_READ;
+    si7021Transaction.seq.buf[ 0 ].data = result;
+    si7021Transaction.seq.buf[ 0 ].len = resultLen;
 
-    return I2C_TransferInit( I2C0, &seq );
+    return si7021Submit();
 }
 
 //! i2cWrite()
@@ -186,27 +443,604 @@ I2C_TransferReturn_TypeDef i2cRead( uint8_t *result, uint16_t resultLen )
 //! Transfer is completed by calling I2C_Transfer() in interrupt context
 I2C_TransferReturn_TypeDef i2cWrite( uint8_t *cmd, uint16_t cmdLen )
 {
-    seq.addr = SI7021_ADDR << 1;
-    seq.flags = I2C_FLAG_WRITE;
-    seq.buf[ 0 ].data = cmd;
-    seq.buf[ 0 ].len = cmdLen;
+    si7021Transaction.seq.flags = I2C_FLAG_WRITE;
+    si7021Transaction.seq.buf[ 0 ].data = cmd;
+    si7021Transaction.seq.buf[ 0 ].len = cmdLen;
 
-    return I2C_TransferInit( I2C0, &seq );
+    return si7021Submit();
+}
+
+//! i2cWriteRead()
+//! @brief Send data (a command) to I2C slave, then receive its response
+//! after a repeated start in the same transfer
+//!
+//! @param  *cmd
+//! @param  cmdLen
+//! @param  *result
+//! @param  resultLen
+//! @returns i2cTransferInProgress if transfer successfully started.
+//! Transfer is completed by calling I2C_Transfer() in interrupt context
+I2C_TransferReturn_TypeDef i2cWriteRead( uint8_t *cmd, uint16_t cmdLen, uint8_t *result, uint16_t resultLen )
+{
+    si7021Transaction.seq.flags = I2C_FLAG_WRITE_READ;
+    si7021Transaction.seq.buf[ 0 ].data = cmd;
+    si7021Transaction.seq.buf[ 0 ].len = cmdLen;
+    si7021Transaction.seq.buf[ 1 ].data = result;
+    si7021Transaction.seq.buf[ 1 ].len = resultLen;
+
+    return si7021Submit();
 }
 
 //! i2cGetTemperature()
-//! @brief Performs a temperature measurement using Si7021 sensor
+//! @brief Converts the raw Si7021 temperature code in the data buffer to
+//! milli-degrees Celsius using integer math only
 //!
 //! @param void
-//! @returns temperature in degrees Celsius
-double i2cGetTemperature()
+//! @returns temperature in milli-degrees Celsius
+int32_t i2cGetTemperature()
 {
-    buffer.temperature = 0;
-    buffer.temperature = ((uint32_t)buffer.data[0] << 8) | (buffer.data[1] & 0xFC);
-    buffer.temperature = ((175.72 * (buffer.temperature)) / 65536) - 46.85;
+    // Only the top RESOLUTION_BITS of the code are valid
+    uint16_t mask = ( uint16_t ) ( 0xFFFF << ( 16 - RESOLUTION_BITS[ activeResolution ] ) );
+    uint16_t code = ( ( ( uint16_t ) buffer.data[ 0 ] << 8 ) | buffer.data[ 1 ] ) & mask;
+    buffer.temperatureMilliC = si7021TemperatureMilliC( code );
 //    LOG_DEBUG("buffer.data [0x%X%X]", buffer.data[0], buffer.data[1]);
 
-    return buffer.temperature;
+    return buffer.temperatureMilliC;
+}
+
+//! i2cGetHumidity()
+//! @brief Converts the raw Si7021 RH code in the data buffer to
+//! milli-percent
+//!
+//! @param void
+//! @returns relative humidity in milli-percent
+int32_t i2cGetHumidity()
+{
+    // Only the top RESOLUTION_HUMIDITY_BITS of the code are valid
+    uint16_t mask = ( uint16_t ) ( 0xFFFF << ( 16 - RESOLUTION_HUMIDITY_BITS[ activeResolution ] ) );
+    uint16_t code = ( ( ( uint16_t ) buffer.data[ 0 ] << 8 ) | buffer.data[ 1 ] ) & mask;
+    buffer.humidityMilliPct = si7021HumidityMilliPct( code );
+    return buffer.humidityMilliPct;
+}
+
+//! i2cGetConversionTimeUs()
+//! @brief Returns how long a measurement command keeps the sensor busy,
+//! i.e. how long to wait after a No Hold Master command before the
+//! result can be read
+//!
+//! @param cmd command written to the sensor
+//! @returns maximum conversion time in microseconds, 0 if cmd does not
+//! start a conversion
+uint32_t i2cGetConversionTimeUs( uint8_t cmd )
+{
+    if( ( TEMP_READ_CMD == cmd ) || ( TEMP_READ_NO_HOLD_CMD == cmd ) )
+    {
+        return RESOLUTION_CONVERSION_US[ activeResolution ];
+    }
+    if( ( HUMIDITY_READ_CMD == cmd ) || ( HUMIDITY_READ_NO_HOLD_CMD == cmd ) )
+    {
+        return RESOLUTION_HUMIDITY_CONVERSION_US[ activeResolution ] + RESOLUTION_CONVERSION_US[ activeResolution ];
+    }
+    return 0;
+}
+
+//! i2cSetResolution()
+//! @brief Select the temperature resolution. Takes effect the next time
+//! i2cConfigureResolution() is called after the sensor powers up
+//!
+//! @param resolution
+//! @returns true if resolution is valid
+bool i2cSetResolution( si7021Resolution_e resolution )
+{
+    if( resolution >= SI7021_NUMBER_OF_RESOLUTIONS )
+    {
+        LOG_WARN( "Invalid Si7021 resolution %d", resolution );
+        return false;
+    }
+    requestedResolution = resolution;
+    return true;
+}
+
+//! i2cGetResolution()
+//! @brief Returns the resolution selected by i2cSetResolution()
+//!
+//! @param void
+//! @returns resolution
+si7021Resolution_e i2cGetResolution()
+{
+    return requestedResolution;
+}
+
+//! i2cGetResolutionBits()
+//! @brief Returns the number of bits in a temperature code
+//!
+//! @param resolution
+//! @returns number of bits, 0 if resolution is not valid
+uint8_t i2cGetResolutionBits( si7021Resolution_e resolution )
+{
+    return ( resolution < SI7021_NUMBER_OF_RESOLUTIONS ) ? RESOLUTION_BITS[ resolution ] : 0;
+}
+
+//! i2cConfigureResolution()
+//! @brief Apply the selected resolution to a sensor that just powered up.
+//! User Register 1 resets to SI7021_USER_REG_DEFAULT on every power-up,
+//! so it is written without reading it first, and not at all for the
+//! default 14-bit resolution
+//!
+//! @param void
+//! @returns i2cTransferDone if no write was needed, i2cTransferInProgress
+//! when the register write is successfully initiated
+I2C_TransferReturn_TypeDef i2cConfigureResolution()
+{
+    I2C_TransferReturn_TypeDef status = i2cTransferDone;
+    activeResolution = requestedResolution;
+    if( SI7021_RESOLUTION_14_BIT != activeResolution )
+    {
+        buffer.data[ 0 ] = USER_REG_WRITE_CMD;
+        buffer.data[ 1 ] = ( SI7021_USER_REG_DEFAULT & ~SI7021_USER_REG_RES_MASK )
+            | RESOLUTION_USER_REG_BITS[ activeResolution ];
+        buffer.len = 2;
+        status = i2cWrite( buffer.data, buffer.len );
+        if( i2cTransferInProgress != status )
+        {
+            i2cReturnDecode( status );
+        }
+    }
+    return status;
+}
+
+//! i2cLdmaEligible()
+//! @brief Returns whether a transfer sequence can be moved by the LDMA.
+//! Only plain reads and writes with a 7-bit address are, and only when
+//! long enough that saving the per-byte interrupts pays for the setup
+//!
+//! @param seq
+//! @returns true if the LDMA path should be used
+static bool i2cLdmaEligible( const I2C_TransferSeq_TypeDef *seq )
+{
+    if( !ldmaEnabled || ( ( seq->flags != I2C_FLAG_READ ) && ( seq->flags != I2C_FLAG_WRITE ) ) )
+    {
+        return false;
+    }
+    return ( seq->buf[ 0 ].len >= I2C_LDMA_MIN_LEN ) && ( seq->buf[ 0 ].len <= I2C_LDMA_MAX_LEN );
+}
+
+//! i2cLdmaStart()
+//! @brief Start a transfer sequence on the LDMA path. The core only
+//! issues START and the address. For writes, the LDMA feeds TXDATA and
+//! the controller sends STOP by itself once the data is out (AUTOSE).
+//! For reads, each received byte is moved by a transfer descriptor
+//! followed by a write descriptor that issues the ACK, or the NACK and
+//! STOP for the last byte, that I2C_Transfer() would have issued. Either way
+//! the only interrupt is MSTOP, plus NACK via AUTOSN and bus errors.
+//! Must be called with interrupts disabled
+//!
+//! @param seq
+//! @returns void
+static void i2cLdmaStart( I2C_TransferSeq_TypeDef *seq )
+{
+    uint16_t len = seq->buf[ 0 ].len;
+    uint8_t *data = seq->buf[ 0 ].data;
+    bool read = ( seq->flags == I2C_FLAG_READ );
+
+    // Same preparation as I2C_TransferInit()
+    if( I2C0->STATE & I2C_STATE_BUSY )
+    {
+        I2C0->CMD = I2C_CMD_ABORT;
+    }
+    I2C0->CMD = I2C_CMD_CLEARPC | I2C_CMD_CLEARTX;
+    while( I2C0->STATUS & I2C_STATUS_RXDATAV )
+    {
+        ( void ) I2C0->RXDATA;
+    }
+    I2C_IntClear( I2C0, _I2C_IF_MASK );
+
+    if( read )
+    {
+        DMA_DESCRIPTOR_TypeDef *desc = ldmaDescriptors;
+        for( uint16_t i = 0; i < len; i++ )
+        {
+            DMA_DESCRIPTOR_TypeDef *rx = desc++;
+            DMA_DESCRIPTOR_TypeDef *cmd = desc++;
+            ldmaDescriptorTransfer( rx, LDMA_CTRL_BYTE_PER_REQUEST | LDMA_CH_CTRL_SRCINC_NONE | LDMA_CH_CTRL_DSTINC_NONE,
+                &I2C0->RXDATA, &data[ i ], 1, cmd );
+            if( i < ( len - 1 ) )
+            {
+                // The ACK of each byte clocks in the next one
+                ldmaDescriptorWrite( cmd, I2C_CMD_ACK, &I2C0->CMD, desc );
+            }
+            else
+            {
+                // NACK the last byte, then STOP, as I2C_Transfer() does
+                DMA_DESCRIPTOR_TypeDef *stop = desc++;
+                ldmaDescriptorWrite( cmd, I2C_CMD_NACK, &I2C0->CMD, stop );
+                ldmaDescriptorWrite( stop, I2C_CMD_STOP, &I2C0->CMD, NULL );
+            }
+        }
+        I2C0->CTRL |= I2C_CTRL_AUTOSN;
+    }
+    else
+    {
+        ldmaDescriptorTransfer( &ldmaDescriptors[ 0 ],
+            LDMA_CTRL_BYTE_PER_REQUEST | LDMA_CH_CTRL_SRCINC_ONE | LDMA_CH_CTRL_DSTINC_NONE,
+            data, &I2C0->TXDATA, len, NULL );
+        I2C0->CTRL |= I2C_CTRL_AUTOSE | I2C_CTRL_AUTOSN;
+    }
+
+    I2C0->IEN = I2C_IEN_MSTOP | I2C_IEN_ARBLOST | I2C_IEN_BUSERR;
+    I2C0->CMD = I2C_CMD_START;
+    I2C0->TXDATA = ( seq->addr & 0xFE ) | ( read ? 1 : 0 );
+    // Start the LDMA after the address is in TXDATA so a write cannot
+    // put payload ahead of it
+    ldmaStartTransfer( LDMA_CHANNEL_I2C, LDMA_CH_REQSEL_SOURCESEL_I2C0 |
+        ( read ? LDMA_CH_REQSEL_SIGSEL_I2C0RXDATAV : LDMA_CH_REQSEL_SIGSEL_I2C0TXBL ), ldmaDescriptors );
+    return;
+}
+
+//! i2cLdmaTransfer()
+//! @brief Interrupt handling for the LDMA path. Completes the transfer
+//! on MSTOP, or aborts it on a bus error or lost arbitration.
+//! Must be called with interrupts disabled
+//!
+//! @param void
+//! @returns i2cTransferInProgress until the transfer completes, then
+//! its final status
+static I2C_TransferReturn_TypeDef i2cLdmaTransfer()
+{
+    I2C_TransferReturn_TypeDef status = i2cTransferInProgress;
+    uint32_t flags = I2C_IntGet( I2C0 );
+    I2C_IntClear( I2C0, flags );
+
+    if( flags & I2C_IF_ARBLOST )
+    {
+        status = i2cTransferArbLost;
+    }
+    else if( flags & I2C_IF_BUSERR )
+    {
+        status = i2cTransferBusErr;
+    }
+    else if( flags & I2C_IF_MSTOP )
+    {
+        if( flags & I2C_IF_NACK )
+        {
+            status = i2cTransferNack;
+        }
+        else if( !ldmaTransferDone( LDMA_CHANNEL_I2C ) )
+        {
+            status = i2cTransferSwFault;
+        }
+        else
+        {
+            status = i2cTransferDone;
+        }
+    }
+
+    if( i2cTransferInProgress != status )
+    {
+        if( i2cTransferDone != status && !( flags & I2C_IF_MSTOP ) )
+        {
+            I2C0->CMD = I2C_CMD_ABORT;
+        }
+        ldmaStopTransfer( LDMA_CHANNEL_I2C );
+        I2C0->IEN = 0;
+        I2C0->CTRL &= ~( I2C_CTRL_AUTOSE | I2C_CTRL_AUTOSN );
+    }
+    return status;
+}
+
+//! i2cComplete()
+//! @brief Remove the transaction at the head of the queue, count its
+//! error if any and call its callback.
+//! Must be called with interrupts disabled
+//!
+//! @param status final status of the transaction
+//! @returns void
+static void i2cComplete( I2C_TransferReturn_TypeDef status )
+{
+    i2cTransaction_s *transaction = queueHead;
+    swTimerStop( &timeoutTimer );
+    transferStarted = false;
+    queueHead = transaction->next;
+    transaction->next = NULL;
+    transaction->status = status;
+    if( i2cTransferNack == status )
+    {
+        errorStats.nack++;
+    }
+    else if( i2cTransferBusErr == status )
+    {
+        errorStats.busErr++;
+    }
+    else if( i2cTransferArbLost == status )
+    {
+        errorStats.arbLost++;
+    }
+    else if( I2C_TRANSFER_TIMEOUT == status )
+    {
+        errorStats.timeout++;
+    }
+    if( transaction->callback != NULL )
+    {
+        transaction->callback( transaction );
+    }
+}
+
+//! i2cTimeout()
+//! @brief Software timer callback for the deadline of the transaction in
+//! progress. Aborts the transfer, completes it with I2C_TRANSFER_TIMEOUT
+//! and starts the next queued transaction
+//!
+//! @param arg unused
+//! @returns void
+static void i2cTimeout( void *arg )
+{
+    ( void ) arg;
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_CRITICAL();
+    if( queueHead != NULL )
+    {
+        LOG_WARN( "I2C transaction to 0x%X timed out", queueHead->seq.addr >> 1 );
+        if( transferUsesLdma )
+        {
+            ldmaStopTransfer( LDMA_CHANNEL_I2C );
+            I2C0->CTRL &= ~( I2C_CTRL_AUTOSE | I2C_CTRL_AUTOSN );
+            transferUsesLdma = false;
+        }
+        I2C0->IEN = 0;
+        I2C0->CMD = I2C_CMD_ABORT;
+        I2C_IntClear( I2C0, _I2C_IF_MASK );
+        NVIC_ClearPendingIRQ( I2C0_IRQn );
+        i2cComplete( I2C_TRANSFER_TIMEOUT );
+        i2cStartQueued();
+    }
+    CORE_EXIT_CRITICAL();
+    return;
+}
+
+//! i2cStartTimeout()
+//! @brief Start the deadline of a transaction that was just started. It
+//! allows I2C_TIMEOUT_PER_BYTE_US for the address and every data byte,
+//! plus I2C_TIMEOUT_BASE_US and the transaction's clock stretching time
+//!
+//! @param transaction
+//! @returns void
+static void i2cStartTimeout( const i2cTransaction_s *transaction )
+{
+    uint32_t bytes = transaction->seq.buf[ 0 ].len + 1;
+    if( transaction->seq.flags & ( I2C_FLAG_WRITE_READ | I2C_FLAG_WRITE_WRITE ) )
+    {
+        // Repeated start and address before the second buffer
+        bytes += transaction->seq.buf[ 1 ].len + 1;
+    }
+    swTimerStart( &timeoutTimer, I2C_TIMEOUT_BASE_US + ( bytes * I2C_TIMEOUT_PER_BYTE_US ) + transaction->stretchUs,
+        0, i2cTimeout, NULL );
+}
+
+//! i2cStartQueued()
+//! @brief Start the transaction at the head of the queue unless it is
+//! already on the bus, as when a completion callback submitted it to the
+//! empty queue. Transactions that fail to start are completed with their
+//! error and the next one is tried. Releases the EM2 block once the
+//! queue is empty.
+//! Must be called with interrupts disabled
+//!
+//! @param void
+//! @returns void
+static void i2cStartQueued()
+{
+    if( transferStarted )
+    {
+        return;
+    }
+    while( queueHead != NULL )
+    {
+        i2cTransaction_s *transaction = queueHead;
+        transferUsesLdma = i2cLdmaEligible( &transaction->seq );
+        if( transferUsesLdma )
+        {
+            i2cLdmaStart( &transaction->seq );
+            transferStarted = true;
+            i2cStartTimeout( transaction );
+            return;
+        }
+        I2C_TransferReturn_TypeDef status = I2C_TransferInit( I2C0, &transaction->seq );
+        if( i2cTransferInProgress == status )
+        {
+            transferStarted = true;
+            i2cStartTimeout( transaction );
+            return;
+        }
+        byteStats.transactions++;
+        i2cComplete( status );
+    }
+    queueTail = NULL;
+    i2cEM2BlockEnd();
+}
+
+//! i2cSubmit()
+//! @brief Queue a transaction on I2C0. It starts immediately if the bus
+//! is idle, otherwise as soon as the transactions ahead of it complete.
+//! Its callback is called from interrupt context when it completes
+//!
+//! @param transaction caller owned descriptor with seq, callback and arg
+//! filled in. Must not be modified until its callback is called
+//! @returns i2cTransferInProgress if the transaction was queued, or
+//! i2cTransferUsageFault if it is already queued
+I2C_TransferReturn_TypeDef i2cSubmit( i2cTransaction_s *transaction )
+{
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_CRITICAL();
+    if( i2cTransferInProgress == transaction->status )
+    {
+        CORE_EXIT_CRITICAL();
+        LOG_ERROR( "I2C transaction is already queued" );
+        return i2cTransferUsageFault;
+    }
+    transaction->status = i2cTransferInProgress;
+    transaction->next = NULL;
+    if( queueHead == NULL )
+    {
+        queueHead = transaction;
+        queueTail = transaction;
+        i2cEM2BlockStart();
+        i2cStartQueued();
+    }
+    else
+    {
+        queueTail->next = transaction;
+        queueTail = transaction;
+    }
+    CORE_EXIT_CRITICAL();
+    return i2cTransferInProgress;
+}
+
+//! i2cQueueIsEmpty()
+//! @brief Returns whether any transaction is queued or in progress
+//!
+//! @param void
+//! @returns true if I2C0 is idle
+bool i2cQueueIsEmpty()
+{
+    return ( queueHead == NULL );
+}
+
+//! i2cIrqHandler()
+//! @brief Called from I2C0_IRQHandler() to advance the transaction in
+//! progress. When it completes, its callback is called and the next
+//! queued transaction is started without returning to the main loop
+//!
+//! @param void
+//! @returns void
+void i2cIrqHandler()
+{
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_CRITICAL();
+    if( queueHead == NULL )
+    {
+        CORE_EXIT_CRITICAL();
+        return;
+    }
+    i2cInterruptStats_s *stats = transferUsesLdma ? &ldmaStats : &byteStats;
+    stats->interrupts++;
+    I2C_TransferReturn_TypeDef status = transferUsesLdma ? i2cLdmaTransfer() : I2C_Transfer( I2C0 );
+    if( i2cTransferInProgress != status )
+    {
+        stats->transactions++;
+        transferUsesLdma = false;
+        i2cComplete( status );
+        i2cStartQueued();
+    }
+    CORE_EXIT_CRITICAL();
+    return;
+}
+
+//! i2cSetLdmaEnabled()
+//! @brief Enable or disable the LDMA path. When disabled, every
+//! transaction runs byte by byte from the interrupt handler. Takes effect
+//! from the next transaction
+//!
+//! @param enable
+//! @returns void
+void i2cSetLdmaEnabled( bool enable )
+{
+    ldmaEnabled = enable;
+    return;
+}
+
+//! i2cGetInterruptStats()
+//! @brief Returns the number of completed transactions and I2C0
+//! interrupts taken for them, on the LDMA path or the byte by byte path
+//!
+//! @param ldma true for the LDMA path counters
+//! @returns pointer to counters
+const i2cInterruptStats_s *i2cGetInterruptStats( bool ldma )
+{
+    return ldma ? &ldmaStats : &byteStats;
+}
+
+//! i2cGetErrorStats()
+//! @brief Returns the error counters for all transactions on I2C0
+//!
+//! @param void
+//! @returns pointer to counters
+const i2cErrorStats_s *i2cGetErrorStats()
+{
+    return &errorStats;
+}
+
+//! i2cRecoveryDelay()
+//! @brief Busy wait for at least one full RTCC tick, about 30 us, which
+//! keeps the recovery clock well below the slowest standard bus rate
+//!
+//! @param void
+//! @returns void
+static void i2cRecoveryDelay()
+{
+    uint64_t start = timeNowTicks();
+    while( ( timeNowTicks() - start ) < 2 )
+    {
+    }
+}
+
+//! i2cBusRecover()
+//! @brief Free a bus held by a slave that was interrupted in the middle
+//! of a transfer. SCL is clocked by hand until the slave releases SDA,
+//! at most I2C_RECOVERY_CLOCKS times, then a STOP resets the slave's bus
+//! state and I2C0 is initialized again. Must only be called while no
+//! transaction is queued
+//!
+//! @param void
+//! @returns true if both SDA and SCL are high after the recovery
+bool i2cBusRecover()
+{
+    if( queueHead != NULL )
+    {
+        LOG_WARN( "Cannot recover I2C bus while transactions are queued" );
+        return false;
+    }
+    errorStats.busRecoveries++;
+
+    // Take the pins away from I2C0
+    I2C_Reset( I2C0 );
+    I2C0->ROUTEPEN = 0;
+    gpioI2cBusRelease();
+    i2cRecoveryDelay();
+    for( uint8_t i = 0; ( i < I2C_RECOVERY_CLOCKS ) && !gpioI2cSdaIsHigh(); i++ )
+    {
+        gpioI2cSclSet( false );
+        i2cRecoveryDelay();
+        gpioI2cSclSet( true );
+        i2cRecoveryDelay();
+    }
+    // STOP condition, SDA rises while SCL is high
+    gpioI2cSclSet( false );
+    i2cRecoveryDelay();
+    gpioI2cSdaSet( false );
+    i2cRecoveryDelay();
+    gpioI2cSclSet( true );
+    i2cRecoveryDelay();
+    gpioI2cSdaSet( true );
+    i2cRecoveryDelay();
+    bool released = gpioI2cSdaIsHigh() && gpioI2cSclIsHigh();
+
+    // Give the pins back to I2C0
+    i2cInit();
+    if( !released )
+    {
+        LOG_ERROR( "I2C bus is still held low after recovery" );
+    }
+    return released;
+}
+
+//! i2cGetTransferStatus()
+//! @brief Returns the final status of the last Si7021 transaction, e.g.
+//! to tell a NACK apart from other transfer errors
+//!
+//! @param void
+//! @returns status of the last completed Si7021 transaction
+I2C_TransferReturn_TypeDef i2cGetTransferStatus()
+{
+    return transferStatus;
 }
 
 //! i2cReturnDecode()
@@ -217,6 +1051,12 @@ double i2cGetTemperature()
 //! @returns void
 void i2cReturnDecode( I2C_TransferReturn_TypeDef _retVal )
 {
+    // Not a value of the emlib enum, so it cannot be a case label below
+    if( I2C_TRANSFER_TIMEOUT == _retVal )
+    {
+        LOG_ERROR( "I2C transfer TIMED OUT" );
+        return;
+    }
     switch( _retVal )
     {
         case i2cTransferDone:
@@ -36,7 +36,119 @@ static const uint8_t SI7021_ADDR = 0x40;
 static const uint8_t TEMP_READ_CMD = 0xE3;
 
 //! Measure Temperature, No Hold Master Mode Command
-//static const uint8_t TEMP_READ_CMD = 0xF3;
+static const uint8_t TEMP_READ_NO_HOLD_CMD = 0xF3;
+
+//! Measure Relative Humidity, Hold Master Mode Command
+static const uint8_t HUMIDITY_READ_CMD = 0xE5;
+
+//! Measure Relative Humidity, No Hold Master Mode Command
+static const uint8_t HUMIDITY_READ_NO_HOLD_CMD = 0xF5;
+
+//! Read Temperature Value from Previous RH Measurement Command. Returns
+//! the temperature measured during the last RH conversion without
+//! starting a new conversion
+static const uint8_t TEMP_READ_PREVIOUS_CMD = 0xE0;
+
+//! Write User Register 1 Command
+static const uint8_t USER_REG_WRITE_CMD = 0xE6;
+
+//! User Register 1 value after power-up: 14-bit temperature, heater off
+static const uint8_t SI7021_USER_REG_DEFAULT = 0x3A;
+
+//! Measurement resolution bits RES1 (D7) and RES0 (D0) of User Register 1
+static const uint8_t SI7021_USER_REG_RES_MASK = 0x81;
+
+//! Delay before retrying a read the Si7021 NACKed because the
+//! conversion had not completed yet, in microseconds
+static const uint32_t SI7021_NACK_RETRY_US = 2000;
+
+//! Number of times a NACKed read is retried before giving up
+static const uint8_t SI7021_NACK_RETRY_MAX = 5;
+
+//! Time allowed for any transaction to complete in addition to its bus
+//! time, and bus time allowed per byte, in microseconds. A transaction
+//! that is still in progress at its deadline is aborted and completes
+//! with I2C_TRANSFER_TIMEOUT
+static const uint32_t I2C_TIMEOUT_BASE_US = 2000;
+static const uint32_t I2C_TIMEOUT_PER_BYTE_US = 100;
+
+//! Completion status of a transaction aborted at its deadline. Extends
+//! I2C_TransferReturn_TypeDef, whose error values are all negative
+#define I2C_TRANSFER_TIMEOUT    ( ( I2C_TransferReturn_TypeDef ) ( i2cTransferSwFault - 1 ) )
+
+//! Number of times a failed Si7021 transaction is retried per sensor
+//! power cycle, and the backoff before the first retry in microseconds.
+//! The backoff doubles with every retry
+static const uint8_t I2C_RETRY_MAX = 3;
+static const uint32_t I2C_RETRY_BACKOFF_US = 1000;
+
+//! Si7021 measurement modes
+typedef enum
+{
+    SI7021_MODE_HOLD_MASTER,    //! Sensor stretches SCL until conversion completes
+    SI7021_MODE_NO_HOLD_MASTER, //! Sensor NACKs reads until conversion completes
+    SI7021_NUMBER_OF_MODES
+} si7021MeasurementMode_e;
+
+//! Quantities acquired per Si7021 conversion
+typedef enum
+{
+    SI7021_ACQUIRE_TEMPERATURE,             //! Temperature only
+    SI7021_ACQUIRE_HUMIDITY_TEMPERATURE,    //! Relative humidity, then the temperature from the same conversion
+    SI7021_NUMBER_OF_ACQUISITIONS
+} si7021Acquisition_e;
+
+//! Si7021 temperature measurement resolutions, from most to least precise
+typedef enum
+{
+    SI7021_RESOLUTION_14_BIT,
+    SI7021_RESOLUTION_13_BIT,
+    SI7021_RESOLUTION_12_BIT,
+    SI7021_RESOLUTION_11_BIT,
+    SI7021_NUMBER_OF_RESOLUTIONS
+} si7021Resolution_e;
+
+struct i2cTransaction_s;
+
+//! Called from interrupt context when a queued transaction completes, or
+//! from i2cDeinit() with i2cTransferSwFault when it drops the transaction.
+//! The final status is in transaction->status
+typedef void ( *i2cCallback_f )( struct i2cTransaction_s *transaction );
+
+//! Queued I2C transaction. Owned by the caller and must exist until its
+//! callback is called
+typedef struct i2cTransaction_s
+{
+    struct i2cTransaction_s *next;                  //! Next transaction in the queue
+    I2C_TransferSeq_TypeDef seq;                    //! Address, flags and buffers
+    i2cCallback_f callback;                         //! Completion callback, may be NULL
+    void *arg;                                      //! Caller context for the callback
+    uint32_t stretchUs;                             //! Clock stretching allowed on top of the timeout
+    volatile I2C_TransferReturn_TypeDef status;     //! In progress while queued, then final status
+} i2cTransaction_s;
+
+//! Transactions with a single buffer of I2C_LDMA_MIN_LEN to
+//! I2C_LDMA_MAX_LEN bytes are moved by the LDMA, others byte by byte
+static const uint16_t I2C_LDMA_MIN_LEN = 4;
+#define I2C_LDMA_MAX_LEN    ( 16 )
+
+//! Interrupt counters used to compare the LDMA and byte by byte paths
+typedef struct
+{
+    uint32_t transactions;  //! Number of transactions completed
+    uint32_t interrupts;    //! Number of I2C0 interrupts taken for them
+} i2cInterruptStats_s;
+
+//! Error counters for all transactions on I2C0. NACKs include the
+//! NACKed probes used to detect Si7021 power-up
+typedef struct
+{
+    uint32_t nack;          //! Transactions NACKed by the slave
+    uint32_t busErr;        //! Transactions ended by a misplaced START or STOP
+    uint32_t arbLost;       //! Transactions ended by lost arbitration
+    uint32_t timeout;       //! Transactions aborted at their deadline
+    uint32_t busRecoveries; //! Bus recoveries performed
+} i2cErrorStats_s;
 
 //! Data structure to contain I2C commands or data from slave
 typedef struct
@@ -45,8 +157,8 @@ typedef struct
         uint16_t len;
         union
         {
-            double temperature;
-            double humidity;
+            int32_t temperatureMilliC;  //! Temperature in milli-degrees Celsius
+            int32_t humidityMilliPct;   //! Relative humidity in milli-percent
         };
 
 } i2cData_s;
@@ -55,21 +167,59 @@ void i2cInit();
 
 void i2cDeinit();
 
-I2C_TransferReturn_TypeDef i2cSendCommand();
+I2C_TransferReturn_TypeDef i2cSendCommand( uint8_t cmd );
 
 I2C_TransferReturn_TypeDef i2cReceiveData();
 
+I2C_TransferReturn_TypeDef i2cMeasureTemperature();
+
+I2C_TransferReturn_TypeDef i2cMeasureHumidity();
+
+I2C_TransferReturn_TypeDef i2cReadPreviousTemperature();
+
+I2C_TransferReturn_TypeDef i2cProbe();
+
 I2C_TransferReturn_TypeDef i2cRead( uint8_t *result, uint16_t resultLen );
 
 I2C_TransferReturn_TypeDef i2cWrite( uint8_t *cmd, uint16_t cmdLen );
 
-double i2cGetTemperature();
+I2C_TransferReturn_TypeDef i2cWriteRead( uint8_t *cmd, uint16_t cmdLen, uint8_t *result, uint16_t resultLen );
 
-void i2cReturnDecode( I2C_TransferReturn_TypeDef _retVal );
+int32_t i2cGetTemperature();
+
+int32_t i2cGetHumidity();
+
+uint32_t i2cGetConversionTimeUs( uint8_t cmd );
+
+bool i2cSetResolution( si7021Resolution_e resolution );
+
+si7021Resolution_e i2cGetResolution();
+
+uint8_t i2cGetResolutionBits( si7021Resolution_e resolution );
 
-void i2cEM2BlockStart();
+I2C_TransferReturn_TypeDef i2cConfigureResolution();
 
-void i2cEM2BlockEnd();
+I2C_TransferReturn_TypeDef i2cSubmit( i2cTransaction_s *transaction );
+
+bool i2cQueueIsEmpty();
+
+void i2cIrqHandler();
+
+void i2cSetLdmaEnabled( bool enable );
+
+const i2cInterruptStats_s *i2cGetInterruptStats( bool ldma );
+
+const i2cErrorStats_s *i2cGetErrorStats();
+
+bool i2cBusRecover();
+
+I2C_TransferReturn_TypeDef i2cGetTransferStatus();
+
+uint32_t i2cGetEM1TimeUs();
+
+void i2cClearEM1Time();
+
+void i2cReturnDecode( I2C_TransferReturn_TypeDef _retVal );
 
 i2cData_s* i2cGetDataBuffer();
 
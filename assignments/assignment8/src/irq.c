@@ -25,6 +25,8 @@
 #include "main.h"
 #include "scheduler.h"
 #include "timers.h"
+#include "swtimers.h"
+#include "i2c.h"
 
 #include "em_core.h"
 #include "em_letimer.h"
@@ -32,12 +34,9 @@
 
 //! LETIMER0_IRQHandler()
 //! @brief Handles interrupts from LETIMER0. If the interrupt
-//! is an UF interrupt, then sets the EVENT_MEASURE_TEMPERATURE
-//! event for the scheduler and increment our coarse runtime value.
-//! Otherwise, if the event is a COMP1 interrupt, then sets the
-//! EVENT_LETIMER0_COMP1 event for the scheduler. Only for this
-//! interrupt, we also disable future COMP1 interrupts after we
-//! have cleared it, since the amount we had to wait has passed
+//! is an UF interrupt, then increment our underflow count.
+//! On both UF and COMP1 interrupts, the software timer service
+//! expires any due timers and reprograms COMP1 for the next deadline
 //!
 //! @param void
 //! @returns void
@@ -49,26 +48,29 @@ void LETIMER0_IRQHandler()
     flags = LETIMER_IntGet( LETIMER0 );
     if( flags & LETIMER_IF_UF )
     {
-        schedulerSetEventMeasureTemperature();
-        timerUnderflowHandler();
+        // Clear flag before updating runtime so timerGetTicks() does
+        // not count this underflow twice
         LETIMER_IntClear( LETIMER0, LETIMER_IFC_UF );
+        timerUnderflowHandler();
     }
-    else if( flags & LETIMER_IF_COMP1 )
+    if( flags & LETIMER_IF_COMP1 )
     {
-        schedulerSetEventTimerDone();
         LETIMER_IntClear( LETIMER0, LETIMER_IFC_COMP1 );
-        LETIMER_IntDisable( LETIMER0, LETIMER_IEN_COMP1 );
+    }
+    if( flags & ( LETIMER_IF_UF | LETIMER_IF_COMP1 ) )
+    {
+        // Expire software timers and load COMP1 with next deadline
+        swTimerIrqHandler();
     }
 
     CORE_ATOMIC_IRQ_ENABLE();
 }
 
 //! I2C0_IRQHandler()
-//! @brief Handles interrupts from I2C0 by calling @ref I2C_Transfer()
-//! which returns the status of the on-going transfer. If the returned
-//! status is i2cTransferDone, then sets the EVENT_TRANSACTION_DONE event
-//! Otherwise, if the status is not equal i2cTransferInProgress, then
-//! sets the EVENT_TRANSACTION_ERROR event for the scheduler
+//! @brief Handles interrupts from I2C0 by advancing the queued I2C
+//! transaction in progress. Completed transactions report to their
+//! owners through their callbacks, e.g. the Si7021 transaction sets the
+//! EVENT_I2C_TRANSACTION_DONE or EVENT_I2C_TRANSACTION_ERROR event
 //!
 //! @param void
 //! @returns void
@@ -76,17 +78,7 @@ void I2C0_IRQHandler()
 {
     CORE_ATOMIC_IRQ_DISABLE();
 
-    I2C_TransferReturn_TypeDef ret = I2C_Transfer( I2C0 );
-
-    if( ret == i2cTransferDone )
-    {
-        schedulerSetEventTransactionDone();
-    }
-    else if( ret != i2cTransferInProgress )
-    {
-        schedulerSetEventTransactionError();
-    }
+    i2cIrqHandler();
 
     CORE_ATOMIC_IRQ_ENABLE();
 }
-
@@ -0,0 +1,97 @@
+//!
+//! @file ldma.c
+//! @brief Minimal LDMA channel control written directly against the
+//! EFR32BG13P register definitions. Channels are started from a linked
+//! list of caller owned descriptors and run without LDMA interrupts;
+//! completion is detected by the peripheral being served
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources Utilized Silicon Labs' EMLIB peripheral libraries to implement functionality @n
+//!            em_cmu.h - for enabling the LDMA clock @n
+//!            em_bus.h - for single-cycle RMW register access
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#include "ldma.h"
+
+#include "em_bus.h"
+#include "em_cmu.h"
+#include "em_core.h"
+
+//! ldmaInit()
+//! @brief Enable the LDMA clock and reset the controller with all
+//! channels disabled and no interrupts
+//!
+//! @param void
+//! @returns void
+void ldmaInit()
+{
+    CMU_ClockEnable( cmuClock_LDMA, true );
+    LDMA->CTRL = 0;
+    LDMA->IEN = 0;
+    LDMA->CHEN = 0;
+    LDMA->REQDIS = 0;
+    LDMA->DBGHALT = 0;
+    LDMA->IFC = _LDMA_IFC_MASK;
+    return;
+}
+
+//! ldmaStartTransfer()
+//! @brief Load the first descriptor of a linked list into a channel and
+//! start it. Transfer descriptors wait for the selected peripheral
+//! request, write descriptors run immediately
+//!
+//! @param channel
+//! @param reqsel LDMA_CH_REQSEL_SOURCESEL_* | LDMA_CH_REQSEL_SIGSEL_*
+//! @param desc first descriptor, must stay valid until the channel is done
+//! @returns void
+void ldmaStartTransfer( uint8_t channel, uint32_t reqsel, const DMA_DESCRIPTOR_TypeDef *desc )
+{
+    uint32_t mask = 1UL << channel;
+
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_CRITICAL();
+    LDMA->CH[ channel ].REQSEL = reqsel;
+    LDMA->CH[ channel ].LOOP = 0;
+    LDMA->CH[ channel ].CFG = 0;
+    LDMA->CH[ channel ].LINK = ( uint32_t ) desc & _LDMA_CH_LINK_LINKADDR_MASK;
+    LDMA->IFC = mask;
+    LDMA->REQCLEAR = mask;
+    BUS_RegMaskedClear( &LDMA->CHDONE, mask );
+    // Loading the link enables the channel
+    LDMA->LINKLOAD = mask;
+    CORE_EXIT_CRITICAL();
+    return;
+}
+
+//! ldmaStopTransfer()
+//! @brief Disable a channel, abandoning any descriptors not yet run
+//!
+//! @param channel
+//! @returns void
+void ldmaStopTransfer( uint8_t channel )
+{
+    uint32_t mask = 1UL << channel;
+    BUS_RegMaskedClear( &LDMA->CHEN, mask );
+    return;
+}
+
+//! ldmaTransferDone()
+//! @brief Returns whether a channel ran its whole descriptor list
+//!
+//! @param channel
+//! @returns true if the last descriptor completed
+bool ldmaTransferDone( uint8_t channel )
+{
+    return ( LDMA->CHDONE & ( 1UL << channel ) ) != 0;
+}
@@ -0,0 +1,91 @@
+//!
+//! @file ldma.h
+//! @brief Minimal LDMA channel control and descriptor helpers written
+//! directly against the EFR32BG13P register definitions
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources EFR32xG13 Reference Manual, LDMA chapter
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#ifndef __LDMA_H___
+#define __LDMA_H___
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "em_device.h"
+
+//! LDMA channel used by the I2C driver
+static const uint8_t LDMA_CHANNEL_I2C = 0;
+
+//! LDMA channels feeding and draining USART1 for the external flash log
+static const uint8_t LDMA_CHANNEL_EXTFLASH_TX = 1;
+static const uint8_t LDMA_CHANNEL_EXTFLASH_RX = 2;
+
+//! Descriptor control word for a transfer of one byte per request.
+//! OR in the source/destination increments
+#define LDMA_CTRL_BYTE_PER_REQUEST  ( LDMA_CH_CTRL_STRUCTTYPE_TRANSFER  \
+                                    | LDMA_CH_CTRL_BLOCKSIZE_UNIT1      \
+                                    | LDMA_CH_CTRL_REQMODE_BLOCK        \
+                                    | LDMA_CH_CTRL_SIZE_BYTE )
+
+//! ldmaDescriptorTransfer()
+//! @brief Fill in a transfer descriptor that moves count units
+//!
+//! @param desc descriptor to fill in, must be word aligned
+//! @param ctrl control word without the transfer count
+//! @param src source address
+//! @param dst destination address
+//! @param count number of units to move, at least 1
+//! @param next descriptor to load when done, NULL to stop
+//! @returns void
+static inline void ldmaDescriptorTransfer( DMA_DESCRIPTOR_TypeDef *desc, uint32_t ctrl,
+    volatile const void *src, volatile void *dst, uint16_t count, const DMA_DESCRIPTOR_TypeDef *next )
+{
+    desc->CTRL = ctrl | ( ( uint32_t ) ( count - 1 ) << _LDMA_CH_CTRL_XFERCNT_SHIFT );
+    desc->SRC = ( void * ) src;
+    desc->DST = dst;
+    desc->LINK = ( next == NULL ) ? NULL :
+        ( void * ) ( ( ( uintptr_t ) next & _LDMA_CH_LINK_LINKADDR_MASK ) | LDMA_CH_LINK_LINK );
+}
+
+//! ldmaDescriptorWrite()
+//! @brief Fill in a descriptor that writes an immediate value to a
+//! register as soon as it is loaded, without waiting for a request
+//!
+//! @param desc descriptor to fill in, must be word aligned
+//! @param value immediate value
+//! @param address register to write
+//! @param next descriptor to load when done, NULL to stop
+//! @returns void
+static inline void ldmaDescriptorWrite( DMA_DESCRIPTOR_TypeDef *desc, uint32_t value,
+    volatile void *address, const DMA_DESCRIPTOR_TypeDef *next )
+{
+    desc->CTRL = LDMA_CH_CTRL_STRUCTTYPE_WRITE | LDMA_CH_CTRL_STRUCTREQ;
+    desc->SRC = ( void * ) ( uintptr_t ) value;
+    desc->DST = address;
+    desc->LINK = ( next == NULL ) ? NULL :
+        ( void * ) ( ( ( uintptr_t ) next & _LDMA_CH_LINK_LINKADDR_MASK ) | LDMA_CH_LINK_LINK );
+}
+
+void ldmaInit();
+
+void ldmaStartTransfer( uint8_t channel, uint32_t reqsel, const DMA_DESCRIPTOR_TypeDef *desc );
+
+void ldmaStopTransfer( uint8_t channel );
+
+bool ldmaTransferDone( uint8_t channel );
+
+#endif // __LDMA_H___
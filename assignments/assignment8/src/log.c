@@ -22,7 +22,7 @@
 #include <stdbool.h>
 
 #include "irq.h"
-#include "timers.h"
+#include "timebase.h"
 
 #if (defined(INCLUDE_LOGGING) || defined(LOG_TEMPERATURE_ONLY))
 /**
@@ -31,7 +31,7 @@
  */
 uint32_t loggerGetTimestamp(void)
 {
-    return timerGetRunTimeMilliseconds();
+    return ( uint32_t ) timeNowMs();
 }
 
 /**
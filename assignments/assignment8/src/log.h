@@ -20,6 +20,7 @@
 #ifndef SRC_LOG_H_
 #define SRC_LOG_H_
 #include "stdio.h"
+#include <stdlib.h>
 #include <inttypes.h>
 
 // Un-comment the following line to enable Debug-level logging  (LOG_DEBUG)
@@ -86,9 +87,10 @@
 	printf( "%5"PRIu32":%s:%s: " message "\n", loggerGetTimestamp(), level, __func__, ##__VA_ARGS__ )
 #endif
 #if (defined(INCLUDE_LOGGING) || defined(LOG_TEMPERATURE_ONLY))
-// Define LOG_TEMP_DO to report the temperature measurement
+// Define LOG_TEMP_DO to report the temperature measurement, given in milli-degrees Celsius
 #define LOG_TEMP_DO(measurement,  temperature) \
-        printf( "%5"PRIu32":%s:%s: %3.1f C\n" , loggerGetTimestamp(), temperature, __func__, measurement )
+        printf( "%5"PRIu32":%s:%s: %s%ld.%03ld C\n" , loggerGetTimestamp(), temperature, __func__, \
+            ( (measurement) < 0 ) ? "-" : "", labs( (measurement) / 1000 ), labs( (measurement) % 1000 ) )
 void logInit();
 uint32_t loggerGetTimestamp();
 void logFlush();
@@ -24,7 +24,11 @@
 #include "gpio.h"
 #include "i2c.h"
 #include "timers.h"
+#include "timebase.h"
 #include "oscillators.h"
+#include "ldma.h"
+#include "flashlog.h"
+#include "extflash.h"
 #include "irq.h"
 #include "display.h"
 #include "ble.h"
@@ -40,6 +44,9 @@
 
 int appMain( gecko_configuration_t *config )
 {
+    //! Initialize RTCC timebase used for log timestamps
+    timebaseInit();
+
     //! Initialize logging
     logInit();
 
@@ -57,12 +64,25 @@ int appMain( gecko_configuration_t *config )
     //! Initialize Clock Management Unit
     oscillatorsInit();
 
+    //! Initialize LDMA used by the I2C driver
+    ldmaInit();
+
+    //! Find the write position of the sample log kept in flash
+    flashLogInit();
+
+    //! Find the write position of the bulk log on the external SPI flash.
+    //! Before displayInit(), which shares USART1 with it
+    extFlashInit();
+
     //! Initialize LETIMER0
     timerInit();
 
     //! Enable LETIMER0 so it begins counting
     LETIMER_Enable( LETIMER0, true );
 
+    //! Start periodic temperature measurements
+    schedulerInit();
+
     displayInit();
     displayPrintf( DISPLAY_ROW_NAME, "Server" );
     NVIC_EnableIRQ( LETIMER0_IRQn );
@@ -75,6 +95,7 @@ int appMain( gecko_configuration_t *config )
         if( !gecko_event_pending() )
         {
             logFlush();
+            displayFlush();
         }
         evt = gecko_wait_event();
 
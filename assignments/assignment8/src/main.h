@@ -26,12 +26,26 @@
 //! Constants for time conversions
 static const uint16_t USEC_PER_MSEC = 1000;
 static const uint16_t MSEC_PER_SEC = 1000;
+static const uint32_t USEC_PER_SEC = 1000000;
 
 //! Constant specifying LETIMER0 COMP0 interrupt period in milliseconds.
 //! Changing this value changes the period, e.g. setting it to 2250
 //! would set the period to 2.25 seconds
 static const uint16_t TIMER_PERIOD_MS = 3000;
 
+//! Limits and default for the temperature measurement interval in seconds,
+//! as exposed by the Health Thermometer Measurement Interval characteristic
+static const uint16_t MEASUREMENT_INTERVAL_MIN_S = 1;
+static const uint16_t MEASUREMENT_INTERVAL_MAX_S = 65535;
+static const uint16_t MEASUREMENT_INTERVAL_DEFAULT_S = 3;
+
+//! Persistent store key holding the measurement interval. User keys
+//! start at 0x4000
+static const uint16_t PS_KEY_MEASUREMENT_INTERVAL = 0x4000;
+
+//! Persistent store key holding the Batch Config characteristic value
+static const uint16_t PS_KEY_BATCH_CONFIG = 0x4001;
+
 //! Uncomment once of the following lines to define the operating energy mode
 // #define SLEEP_MODE sleepEM0
 // #define SLEEP_MODE sleepEM1
@@ -0,0 +1,360 @@
+//!
+//! @file samplering.c
+//! @brief Implements a RAM ring buffer of timestamped samples. Samples
+//! are grouped in blocks taken at a regular period: the block keeps the
+//! keyframe's 32-bit value, its timestamp and the period, and every other
+//! sample costs a 16-bit delta. A sample that is off the block's time
+//! grid, or too far from the keyframe value, starts a new block. When the
+//! ring is full, the oldest block is dropped or new samples are rejected
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources Utilized Silicon Labs' EMLIB peripheral libraries to implement functionality @n
+//!            em_core.h - for CORE_* critical section macros
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#include "samplering.h"
+
+#include <stddef.h>
+
+#include "em_core.h"
+
+//! getBlock()
+//! @brief Returns the storage of the block with sequence number seq
+//!
+//! @param ring
+//! @param seq
+//! @returns pointer to block
+static inline sampleRingBlock_s *getBlock( const sampleRing_s *ring, uint32_t seq )
+{
+    return &ring->blocks[ seq % ring->numBlocks ];
+}
+
+//! blockAppend()
+//! @brief Add a sample to a block if it is on the block's time grid and
+//! its value fits in a delta. The second sample sets the period.
+//! Must be called with interrupts disabled
+//!
+//! @param block
+//! @param timestampMs
+//! @param value
+//! @returns true if the sample was added
+static bool blockAppend( sampleRingBlock_s *block, uint64_t timestampMs, int32_t value )
+{
+    if( block->count >= SAMPLE_RING_SAMPLES_PER_BLOCK )
+    {
+        return false;
+    }
+    int64_t delta = ( int64_t ) value - block->value;
+    if( ( delta < INT16_MIN ) || ( delta > INT16_MAX ) || ( timestampMs <= block->timestampMs ) )
+    {
+        return false;
+    }
+
+    uint64_t elapsedMs = timestampMs - block->timestampMs;
+    if( block->count == 1 )
+    {
+        if( elapsedMs > UINT32_MAX )
+        {
+            return false;
+        }
+        block->periodMs = ( uint32_t ) elapsedMs;
+    }
+    else
+    {
+        uint64_t expectedMs = ( uint64_t ) block->periodMs * block->count;
+        uint64_t errorMs = ( elapsedMs > expectedMs ) ? ( elapsedMs - expectedMs ) : ( expectedMs - elapsedMs );
+        if( errorMs > SAMPLE_RING_JITTER_MS )
+        {
+            return false;
+        }
+    }
+    block->deltas[ block->count - 1 ] = ( int16_t ) delta;
+    block->count++;
+    return true;
+}
+
+//! sampleRingInit()
+//! @brief Initialize an empty ring on caller owned block storage. A
+//! block holds SAMPLE_RING_SAMPLES_PER_BLOCK samples taken at a regular
+//! period, fewer if sampling is irregular or values jump
+//!
+//! @param ring
+//! @param blocks block storage, must exist for as long as the ring
+//! @param numBlocks number of blocks in storage, at least 1
+//! @param policy behavior when the ring is full
+//! @returns void
+void sampleRingInit( sampleRing_s *ring, sampleRingBlock_s *blocks, uint16_t numBlocks,
+    sampleRingPolicy_e policy )
+{
+    ring->blocks = blocks;
+    ring->numBlocks = numBlocks;
+    ring->policy = policy;
+    ring->firstBlock = 0;
+    ring->nextBlock = 0;
+    ring->appended = 0;
+    ring->stored = 0;
+    ring->dropped = 0;
+    return;
+}
+
+//! sampleRingClear()
+//! @brief Remove all samples. Readers skip to the oldest remaining
+//! sample the next time they read
+//!
+//! @param ring
+//! @returns void
+void sampleRingClear( sampleRing_s *ring )
+{
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_CRITICAL();
+    ring->firstBlock = ring->nextBlock;
+    ring->stored = 0;
+    CORE_EXIT_CRITICAL();
+    return;
+}
+
+//! sampleRingAppend()
+//! @brief Append a sample in O(1). Safe to call from interrupt context
+//!
+//! @param ring
+//! @param timestampMs time the sample was taken, in milliseconds
+//! @param value
+//! @returns true if the sample was stored, false if the ring is full
+//! and its policy is SAMPLE_RING_STOP_WHEN_FULL
+bool sampleRingAppend( sampleRing_s *ring, uint64_t timestampMs, int32_t value )
+{
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_CRITICAL();
+    if( ( ring->nextBlock != ring->firstBlock )
+        && blockAppend( getBlock( ring, ring->nextBlock - 1 ), timestampMs, value ) )
+    {
+        ring->appended++;
+        ring->stored++;
+        CORE_EXIT_CRITICAL();
+        return true;
+    }
+
+    if( ( ring->nextBlock - ring->firstBlock ) >= ring->numBlocks )
+    {
+        if( SAMPLE_RING_STOP_WHEN_FULL == ring->policy )
+        {
+            ring->dropped++;
+            CORE_EXIT_CRITICAL();
+            return false;
+        }
+        sampleRingBlock_s *oldest = getBlock( ring, ring->firstBlock );
+        ring->stored -= oldest->count;
+        ring->dropped += oldest->count;
+        ring->firstBlock++;
+    }
+
+    sampleRingBlock_s *block = getBlock( ring, ring->nextBlock );
+    block->timestampMs = timestampMs;
+    block->periodMs = 0;
+    block->firstSample = ring->appended;
+    block->value = value;
+    block->count = 1;
+    ring->nextBlock++;
+    ring->appended++;
+    ring->stored++;
+    CORE_EXIT_CRITICAL();
+    return true;
+}
+
+//! sampleRingStored()
+//! @brief Returns the number of samples currently in the ring
+//!
+//! @param ring
+//! @returns number of samples
+uint32_t sampleRingStored( const sampleRing_s *ring )
+{
+    return ring->stored;
+}
+
+//! sampleRingDropped()
+//! @brief Returns the number of samples overwritten or rejected because
+//! the ring was full
+//!
+//! @param ring
+//! @returns number of samples
+uint32_t sampleRingDropped( const sampleRing_s *ring )
+{
+    return ring->dropped;
+}
+
+//! sampleRingCursorOldest()
+//! @brief Position a reader on the oldest sample in the ring
+//!
+//! @param ring
+//! @param cursor
+//! @returns void
+void sampleRingCursorOldest( const sampleRing_s *ring, sampleRingCursor_s *cursor )
+{
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_CRITICAL();
+    cursor->block = ring->firstBlock;
+    cursor->index = 0;
+    cursor->sample = ( ring->firstBlock != ring->nextBlock ) ?
+        getBlock( ring, ring->firstBlock )->firstSample : ring->appended;
+    cursor->lost = 0;
+    CORE_EXIT_CRITICAL();
+    return;
+}
+
+//! sampleRingCursorNewest()
+//! @brief Position a reader after the newest sample, so it only reads
+//! samples appended from now on
+//!
+//! @param ring
+//! @param cursor
+//! @returns void
+void sampleRingCursorNewest( const sampleRing_s *ring, sampleRingCursor_s *cursor )
+{
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_CRITICAL();
+    if( ring->firstBlock != ring->nextBlock )
+    {
+        cursor->block = ring->nextBlock - 1;
+        cursor->index = getBlock( ring, cursor->block )->count;
+    }
+    else
+    {
+        cursor->block = ring->nextBlock;
+        cursor->index = 0;
+    }
+    cursor->sample = ring->appended;
+    cursor->lost = 0;
+    CORE_EXIT_CRITICAL();
+    return;
+}
+
+//! sampleRingCursorSeek()
+//! @brief Position a reader on the sample with sequence number sample, as
+//! counted by cursor->sample. A sample that was already overwritten puts
+//! the reader on the oldest sample and counts the difference in
+//! cursor->lost. A sample not appended yet puts the reader after the newest
+//!
+//! @param ring
+//! @param cursor
+//! @param sample sequence number among all appended samples
+//! @returns void
+void sampleRingCursorSeek( const sampleRing_s *ring, sampleRingCursor_s *cursor, uint32_t sample )
+{
+    if( ( int32_t ) ( sample - ring->appended ) >= 0 )
+    {
+        sampleRingCursorNewest( ring, cursor );
+        return;
+    }
+
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_CRITICAL();
+    cursor->block = ring->firstBlock;
+    cursor->index = 0;
+    cursor->lost = 0;
+    if( ring->firstBlock == ring->nextBlock )
+    {
+        cursor->sample = ring->appended;
+        CORE_EXIT_CRITICAL();
+        return;
+    }
+
+    uint32_t oldestSample = getBlock( ring, ring->firstBlock )->firstSample;
+    if( ( int32_t ) ( sample - oldestSample ) < 0 )
+    {
+        cursor->lost = oldestSample - sample;
+        cursor->sample = oldestSample;
+        CORE_EXIT_CRITICAL();
+        return;
+    }
+
+    // Samples are numbered without gaps from block to block
+    while( ( cursor->block + 1 ) != ring->nextBlock )
+    {
+        const sampleRingBlock_s *block = getBlock( ring, cursor->block );
+        if( ( sample - block->firstSample ) < block->count )
+        {
+            break;
+        }
+        cursor->block++;
+    }
+    cursor->index = sample - getBlock( ring, cursor->block )->firstSample;
+    cursor->sample = sample;
+    CORE_EXIT_CRITICAL();
+    return;
+}
+
+//! sampleRingRead()
+//! @brief Decode the sample at the cursor and advance it. If the
+//! samples at the cursor were overwritten, the cursor first skips to the
+//! oldest sample and adds the skipped samples to cursor->lost
+//!
+//! @param ring
+//! @param cursor
+//! @param sample decoded sample
+//! @returns true if a sample was read, false if the cursor is at the end
+bool sampleRingRead( const sampleRing_s *ring, sampleRingCursor_s *cursor, sampleRingSample_s *sample )
+{
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_CRITICAL();
+    if( ( int32_t ) ( cursor->block - ring->firstBlock ) < 0 )
+    {
+        // Block was dropped, or the ring was cleared
+        if( ring->firstBlock != ring->nextBlock )
+        {
+            uint32_t oldestSample = getBlock( ring, ring->firstBlock )->firstSample;
+            if( ( int32_t ) ( oldestSample - cursor->sample ) > 0 )
+            {
+                cursor->lost += oldestSample - cursor->sample;
+            }
+            cursor->sample = oldestSample;
+        }
+        cursor->block = ring->firstBlock;
+        cursor->index = 0;
+    }
+
+    while( cursor->block != ring->nextBlock )
+    {
+        const sampleRingBlock_s *block = getBlock( ring, cursor->block );
+        if( cursor->index < block->count )
+        {
+            sample->timestampMs = block->timestampMs + ( ( uint64_t ) block->periodMs * cursor->index );
+            sample->value = block->value + ( ( cursor->index == 0 ) ? 0 : block->deltas[ cursor->index - 1 ] );
+            cursor->index++;
+            cursor->sample = block->firstSample + cursor->index;
+            CORE_EXIT_CRITICAL();
+            return true;
+        }
+        if( ( cursor->block + 1 ) == ring->nextBlock )
+        {
+            // Newest block may still grow
+            break;
+        }
+        cursor->block++;
+        cursor->index = 0;
+    }
+    CORE_EXIT_CRITICAL();
+    return false;
+}
+
+//! sampleRingUnread()
+//! @brief Returns the number of samples a reader has yet to read
+//!
+//! @param ring
+//! @param cursor
+//! @returns number of samples
+uint32_t sampleRingUnread( const sampleRing_s *ring, const sampleRingCursor_s *cursor )
+{
+    uint32_t unread = ring->appended - cursor->sample;
+    return ( unread > ring->stored ) ? ring->stored : unread;
+}
@@ -0,0 +1,109 @@
+//!
+//! @file samplering.h
+//! @brief RAM ring buffer of timestamped samples stored as 16-bit deltas
+//! from a 32-bit keyframe
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources Utilized Silicon Labs' EMLIB peripheral libraries to implement functionality @n
+//!            em_core.h - for CORE_* critical section macros
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#ifndef __SAMPLERING_H___
+#define __SAMPLERING_H___
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//! Number of delta-coded samples that follow the keyframe in a block
+#define SAMPLE_RING_DELTAS_PER_BLOCK    ( 32 )
+
+//! Number of samples a block holds, keyframe included
+#define SAMPLE_RING_SAMPLES_PER_BLOCK   ( SAMPLE_RING_DELTAS_PER_BLOCK + 1 )
+
+//! How far a sample's timestamp may be from the block's regular sampling
+//! grid and still be stored in the block, in milliseconds. Timestamps
+//! are read back on the grid
+static const uint32_t SAMPLE_RING_JITTER_MS = 100;
+
+//! What an append does when the ring is full
+typedef enum
+{
+    SAMPLE_RING_OVERWRITE_OLDEST,   //! Drop the oldest block to make room
+    SAMPLE_RING_STOP_WHEN_FULL,     //! Reject new samples
+    SAMPLE_RING_NUMBER_OF_POLICIES
+} sampleRingPolicy_e;
+
+//! Block of samples taken at a regular period. The first sample is the
+//! keyframe, the others are stored as their difference from it
+typedef struct
+{
+    uint64_t timestampMs;   //! Time of the keyframe
+    uint32_t periodMs;      //! Time between samples, set by the second sample
+    uint32_t firstSample;   //! Sequence number of the keyframe among all appended samples
+    int32_t value;          //! Keyframe value
+    uint16_t count;         //! Number of samples in the block, keyframe included
+    int16_t deltas[ SAMPLE_RING_DELTAS_PER_BLOCK ]; //! Sample values minus the keyframe value
+} sampleRingBlock_s;
+
+//! Ring of blocks. Owned by the caller together with its block storage
+typedef struct
+{
+    sampleRingBlock_s *blocks;  //! Block storage
+    uint16_t numBlocks;         //! Number of blocks in storage
+    sampleRingPolicy_e policy;  //! Behavior when full
+    uint32_t firstBlock;        //! Sequence number of the oldest block
+    uint32_t nextBlock;         //! Sequence number the next block will get
+    uint32_t appended;          //! Number of samples ever appended
+    uint32_t stored;            //! Number of samples currently stored
+    uint32_t dropped;           //! Samples overwritten or rejected
+} sampleRing_s;
+
+//! Decoded sample
+typedef struct
+{
+    uint64_t timestampMs;   //! Time the sample was taken
+    int32_t value;          //! Sample value
+} sampleRingSample_s;
+
+//! Reader position. Any number of readers can walk a ring independently
+typedef struct
+{
+    uint32_t block;         //! Sequence number of the block being read
+    uint16_t index;         //! Next sample within the block
+    uint32_t sample;        //! Sequence number of the next sample
+    uint32_t lost;          //! Samples overwritten before this reader got to them
+} sampleRingCursor_s;
+
+void sampleRingInit( sampleRing_s *ring, sampleRingBlock_s *blocks, uint16_t numBlocks,
+    sampleRingPolicy_e policy );
+
+void sampleRingClear( sampleRing_s *ring );
+
+bool sampleRingAppend( sampleRing_s *ring, uint64_t timestampMs, int32_t value );
+
+uint32_t sampleRingStored( const sampleRing_s *ring );
+
+uint32_t sampleRingDropped( const sampleRing_s *ring );
+
+void sampleRingCursorOldest( const sampleRing_s *ring, sampleRingCursor_s *cursor );
+
+void sampleRingCursorNewest( const sampleRing_s *ring, sampleRingCursor_s *cursor );
+
+void sampleRingCursorSeek( const sampleRing_s *ring, sampleRingCursor_s *cursor, uint32_t sample );
+
+bool sampleRingRead( const sampleRing_s *ring, sampleRingCursor_s *cursor, sampleRingSample_s *sample );
+
+uint32_t sampleRingUnread( const sampleRing_s *ring, const sampleRingCursor_s *cursor );
+
+#endif // __SAMPLERING_H___
@@ -23,13 +23,23 @@
 #include "gpio.h"
 #include "i2c.h"
 #include "timers.h"
+#include "swtimers.h"
+#include "main.h"
 #include "ble.h"
 #include "display.h"
+#include "energy.h"
+#include "timebase.h"
+#include "si7021.h"
+#include "flashlog.h"
+#include "extflash.h"
+#include "batch.h"
 
 #include "gecko_ble_errors.h"
 #include "gatt_db.h"
 #include "infrastructure.h"
 
+#include <stdlib.h>
+
 //! Stores the current state of the scheduler's state machine
 static schedulerStates_e currentState = STATE_SENSOR_OFF;
 
@@ -38,7 +48,116 @@ static schedulerStates_e nextState = STATE_WAIT_FOR_POWERUP;
 
 //! Constant defining the starting state for the state machine
 //! Used when resetting the state machine when a connection is closed
-static const schedulerEvents_e startState = STATE_SENSOR_OFF;
+static const schedulerStates_e startState = STATE_SENSOR_OFF;
+
+//! Mask of events signalled to the stack but not yet processed. Used
+//! to detect signals that get coalesced into an already pending one
+static volatile uint32_t pendingEvents = 0;
+
+//! Per-event signal delivery counters
+static schedulerEventStats_s eventStats[ NUMBER_OF_EVENTS ];
+
+//! Signals for values outside schedulerEvents_e, which are discarded
+static uint32_t unknownEvents = 0;
+
+//! Periodic timer that triggers temperature measurements
+static swTimer_s measurementTimer;
+
+//! Si7021 measurement mode selected by schedulerSetMeasurementMode()
+static si7021MeasurementMode_e requestedMode = SI7021_MODE_HOLD_MASTER;
+
+//! Si7021 measurement mode used for the measurement in progress. Latched
+//! from requestedMode at power-up so a change never affects a measurement
+//! that has already started
+static si7021MeasurementMode_e activeMode = SI7021_MODE_HOLD_MASTER;
+
+//! Quantities acquired per conversion selected by schedulerSetAcquisition()
+//! and the value latched at power-up
+static si7021Acquisition_e requestedAcquisition = SI7021_ACQUIRE_TEMPERATURE;
+static si7021Acquisition_e activeAcquisition = SI7021_ACQUIRE_TEMPERATURE;
+
+//! Number of NACKed reads retried for the conversion in progress
+static uint8_t nackRetries = 0;
+
+//! Number of failed transactions retried in the current power cycle
+static uint8_t transactionRetries = 0;
+
+//! State waiting for the transaction being retried, entered again when
+//! the retry starts
+static schedulerStates_e retryState = STATE_SENSOR_OFF;
+
+//! Number of conversions per sensor power cycle selected by
+//! schedulerSetBurstSize() and the value latched at power-up
+static uint8_t requestedBurstSize = 1;
+static uint8_t activeBurstSize = 1;
+
+//! How a burst of conversions is reduced to the reported temperature
+static schedulerBurstReduction_e burstReduction = BURST_REDUCTION_MEDIAN;
+
+//! Temperatures captured during the current burst in milli-degrees Celsius
+static int32_t burstSamples[ SCHEDULER_BURST_MAX ];
+
+//! Relative humidities captured during the current burst in milli-percent
+static int32_t humiditySamples[ SCHEDULER_BURST_MAX ];
+
+//! Reported temperatures in milli-degrees Celsius and relative
+//! humidities in milli-percent, kept while no client is listening
+static sampleRingBlock_s temperatureHistoryBlocks[ SCHEDULER_TEMPERATURE_HISTORY_BLOCKS ];
+static sampleRingBlock_s humidityHistoryBlocks[ SCHEDULER_HUMIDITY_HISTORY_BLOCKS ];
+static sampleRing_s temperatureHistory;
+static sampleRing_s humidityHistory;
+
+//! Time the current power cycle started, used as the timestamp of the
+//! samples it produces
+static uint64_t sampleTimeMs = 0;
+
+//! Number of valid entries in burstSamples
+static uint8_t burstCount = 0;
+
+//! True between sensor power-up and shutdown()
+static bool sensorPowered = false;
+
+//! RTCC time at which the sensor was powered up
+static uint64_t sensorOnTicks = 0;
+
+//! True if the resolution policy picks the resolution of each measurement
+static bool adaptiveResolution = false;
+
+//! Last reported temperature, used to pick the learned power-up time.
+//! Room temperature until the first measurement
+static int32_t lastTemperatureMilliC = 25000;
+
+//! Estimated sensor and EM1 energy spent per reported sample
+static energyCounter_s sampleEnergy;
+
+//! Time between temperature measurements in seconds, set in schedulerInit()
+//! unless a persisted value was applied beforehand
+static uint16_t measurementIntervalS = 0;
+
+//! Order in which pending events are handled when several are set in
+//! the same external signal mask, highest priority first
+static const schedulerEvents_e eventPriority[] =
+{
+    EVENT_BT_CONNECTION_LOST,
+    EVENT_I2C_TRANSACTION_ERROR,
+    EVENT_I2C_TRANSACTION_DONE,
+    EVENT_LETIMER0_COMP1,
+    EVENT_MEASURE_TEMPERATURE
+};
+
+//! Action executed on a state/event transition. Returns true if the
+//! transition to the table's next state should be taken, false to
+//! remain in the current state
+typedef bool ( *schedulerAction_f )( schedulerEvents_e event );
+
+//! Entry in the scheduler's transition table
+typedef struct
+{
+    schedulerAction_f action;   //! Action to execute, NULL if none
+    schedulerStates_e next;     //! State to transition to after action
+} schedulerTransition_s;
+
+static bool actionTransactionError( schedulerEvents_e event );
 
 //! shutdown()
 //! @brief Convenience function to disable Si7021, I2C and @n
@@ -50,224 +169,949 @@ static void shutdown()
 {
     // Disable sensor and I2C peripheral
     gpioSi7021Disable();
+    // Also drops queued transactions and releases their EM2 block
     i2cDeinit();
-    // Remove Sleep Block on EM2/EM3 so timer waits put us back into EM3
-    i2cEM2BlockEnd();
+    // A wait still armed would signal a stale EVENT_LETIMER0_COMP1
+    timerCancelWait();
+    if( sensorPowered )
+    {
+        // Charge this power cycle to the samples it produced, or to the
+        // next samples if it failed
+        sensorPowered = false;
+        energyAccumulate( &sampleEnergy, ( uint32_t ) timeTicksToUs( timeNowTicks() - sensorOnTicks ),
+            ENERGY_SI7021_CURRENT_UA );
+        energyAccumulate( &sampleEnergy, i2cGetEM1TimeUs(), ENERGY_EM1_CURRENT_UA );
+    }
     nextState = startState;
 }
 
+//! actionPowerUpSensor()
+//! @brief Power up Si7021 and start timer for the learned power-up time,
+//! after which the sensor is probed until it responds
 //!
-//! @brief Process the pending event depending on current state.
-//! First, we check if the event to process is one of our defined
-//! signals, i.e. an external signal. If not, we return immediately
+//! @param event
+//! @returns true
+static bool actionPowerUpSensor( schedulerEvents_e event )
+{
+    activeMode = requestedMode;
+    activeBurstSize = requestedBurstSize;
+    activeAcquisition = requestedAcquisition;
+    burstCount = 0;
+    transactionRetries = 0;
+    i2cClearEM1Time();
+    sensorPowered = true;
+    sensorOnTicks = timeNowTicks();
+    sampleTimeMs = timeNowMs();
+    gpioSi7021Enable();
+    timerWaitUs( si7021PowerUpStart( lastTemperatureMilliC ) );
+
+    i2cInit();
+    return true;
+}
+
+//! noHoldCommand()
+//! @brief Returns the No Hold Master measurement command for the
+//! quantities being acquired
 //!
-//! @param evt
-//! @return eventHandled - true if successful, false otherwise
+//! @param void
+//! @returns command
+static uint8_t noHoldCommand()
+{
+    return ( SI7021_ACQUIRE_HUMIDITY_TEMPERATURE == activeAcquisition ) ?
+        HUMIDITY_READ_NO_HOLD_CMD : TEMP_READ_NO_HOLD_CMD;
+}
+
+//! startHoldMeasurement()
+//! @brief Start the Hold Master measurement for the quantities being
+//! acquired. With humidity, the RH is measured first
 //!
-bool schedulerMain( struct gecko_cmd_packet *evt )
+//! @param void
+//! @returns i2cTransferInProgress if transfer was started
+static I2C_TransferReturn_TypeDef startHoldMeasurement()
 {
-    bool eventHandled = true;
-    uint32_t eventToProcess = 0;
-    if( BGLIB_MSG_ID( evt->header ) == gecko_evt_system_external_signal_id )
+    if( SI7021_ACQUIRE_HUMIDITY_TEMPERATURE == activeAcquisition )
     {
-        eventToProcess = evt->data.evt_system_external_signal.extsignals;
+        return i2cMeasureHumidity();
+    }
+    return i2cMeasureTemperature();
+}
+
+//! actionStartConversion()
+//! @brief In Hold Master mode, start the combined I2C write of the measure
+//! command and read of the measurement. In No Hold Master mode, only
+//! write the command and go to STATE_WAIT_FOR_I2C_WRITE
+//!
+//! @param event
+//! @returns true if transfer was started
+static bool actionStartConversion( schedulerEvents_e event )
+{
+    I2C_TransferReturn_TypeDef ret;
+    nackRetries = 0;
+    if( SI7021_MODE_NO_HOLD_MASTER == activeMode )
+    {
+        ret = i2cSendCommand( noHoldCommand() );
+        nextState = STATE_WAIT_FOR_I2C_WRITE;
     }
     else
     {
-        // not an event for our state machine
-        eventHandled = false;
-        return eventHandled;
+        ret = startHoldMeasurement();
+        nextState = STATE_WAIT_FOR_I2C_WRITE_READ;
     }
+    return ( i2cTransferInProgress == ret );
+}
+
+//! actionProbeSensor()
+//! @brief Probe the sensor address to check if power-up has completed
+//!
+//! @param event
+//! @returns true if transfer was started
+static bool actionProbeSensor( schedulerEvents_e event )
+{
+    I2C_TransferReturn_TypeDef ret = i2cProbe();
+    return ( i2cTransferInProgress == ret );
+}
 
-    if( !isConnected() && ( eventToProcess != EVENT_BT_CONNECTION_LOST ) )
+//! actionSensorConfigured()
+//! @brief Start the first conversion of the burst
+//!
+//! @param event
+//! @returns true
+static bool actionSensorConfigured( schedulerEvents_e event )
+{
+    if( !actionStartConversion( event ) )
     {
-        // There is no open BT connection and the connection was not _just_ lost
-        eventHandled = true;
-        return eventHandled;
+        return actionTransactionError( event );
     }
+    return true;
+}
 
-    switch( currentState )
+//! actionSensorReady()
+//! @brief Sensor ACKed the probe, so learn from the power-up time and
+//! configure the resolution. If the default resolution is selected no
+//! write is needed and the first conversion starts right away
+//!
+//! @param event
+//! @returns true
+static bool actionSensorReady( schedulerEvents_e event )
+{
+    si7021PowerUpDone();
+    I2C_TransferReturn_TypeDef ret = i2cConfigureResolution();
+    if( i2cTransferDone == ret )
+    {
+        return actionSensorConfigured( event );
+    }
+    else if( i2cTransferInProgress != ret )
+    {
+        return actionTransactionError( event );
+    }
+    return true;
+}
+
+//! actionProbeError()
+//! @brief Sensor NACKed the probe because it is still powering up, so
+//! wait in EM3 and probe again until the worst case power-up time passes
+//!
+//! @param event
+//! @returns true
+static bool actionProbeError( schedulerEvents_e event )
+{
+    if( ( i2cTransferNack == i2cGetTransferStatus() ) && si7021PowerUpProbeNacked() )
     {
-        case STATE_SENSOR_OFF:
+        timerWaitUs( SI7021_POWERUP_PROBE_US );
+        return true;
+    }
+    return actionTransactionError( event );
+}
+
+//! actionWaitForConversion()
+//! @brief Wait in EM3 for the conversion time of the configured
+//! resolution and command. The EM2 block was released when the I2C
+//! queue emptied
+//!
+//! @param event
+//! @returns true
+static bool actionWaitForConversion( schedulerEvents_e event )
+{
+    timerWaitUs( i2cGetConversionTimeUs( noHoldCommand() ) );
+    return true;
+}
+
+//! actionReceiveData()
+//! @brief Start I2C read of the temperature or RH measurement
+//!
+//! @param event
+//! @returns true if transfer was started
+static bool actionReceiveData( schedulerEvents_e event )
+{
+    I2C_TransferReturn_TypeDef ret = i2cReceiveData();
+    return ( i2cTransferInProgress == ret );
+}
+
+//! actionReadError()
+//! @brief Retry a read the Si7021 NACKed because the conversion has not
+//! completed yet after a short wait in EM3. Any other error, or too many
+//! NACKs, is handled like other transaction errors
+//!
+//! @param event
+//! @returns true
+static bool actionReadError( schedulerEvents_e event )
+{
+    if( ( i2cTransferNack == i2cGetTransferStatus() ) && ( nackRetries < SI7021_NACK_RETRY_MAX ) )
+    {
+        nackRetries++;
+        LOG_DEBUG( "Si7021 read NACKed, retry %u of %u", nackRetries, SI7021_NACK_RETRY_MAX );
+        timerWaitUs( SI7021_NACK_RETRY_US );
+        return true;
+    }
+    return actionTransactionError( event );
+}
+
+//! reduceBurst()
+//! @brief Reduce the values captured in the burst to one value
+//! according to burstReduction
+//!
+//! @param samples burstCount temperatures or humidities
+//! @returns reduced value in the unit of samples
+static int32_t reduceBurst( const int32_t *samples )
+{
+    if( BURST_REDUCTION_AVERAGE == burstReduction )
+    {
+        int64_t sum = 0;
+        for( uint8_t i = 0; i < burstCount; i++ )
+        {
+            sum += samples[ i ];
+        }
+        return ( int32_t ) ( sum / burstCount );
+    }
+
+    // Insertion sort is plenty for SCHEDULER_BURST_MAX samples
+    int32_t sorted[ SCHEDULER_BURST_MAX ];
+    for( uint8_t i = 0; i < burstCount; i++ )
+    {
+        int32_t value = samples[ i ];
+        uint8_t j = i;
+        while( ( j > 0 ) && ( sorted[ j - 1 ] > value ) )
+        {
+            sorted[ j ] = sorted[ j - 1 ];
+            j--;
+        }
+        sorted[ j ] = value;
+    }
+    if( burstCount % 2 )
+    {
+        return sorted[ burstCount / 2 ];
+    }
+    return ( sorted[ ( burstCount / 2 ) - 1 ] + sorted[ burstCount / 2 ] ) / 2;
+}
+
+//! reportTemperature()
+//! @brief Send temperature indication to every client that enabled
+//! indications, then log and display the temperature
+//!
+//! @param temperatureMilliC
+//! @returns void
+static void reportTemperature( int32_t temperatureMilliC )
+{
+    // Buffer to store temperature data as a bitstream
+    uint8_t bitstreamBuffer[ 5 ];
+    // HTM flags set to 0 for Celsius, no timestamp and no temperature type
+    uint8_t flags = 0x00;
+    // Pointer to buffer needed to convert values to bitstream
+    uint8_t *p = bitstreamBuffer;
+    // Convert flags to bitstream and append to bitstreamBuffer
+    UINT8_TO_BITSTREAM( p, flags );
+    // Prepare temperature data to convert to bitstream
+    uint32_t temperature = FLT_TO_UINT32( temperatureMilliC, -3 );
+    UINT32_TO_BITSTREAM( p, temperature );
+
+    // Send temperature indication to every subscribed client
+    bleSendToSubscribers( gattdb_temperature_measurement, sizeof( bitstreamBuffer ), bitstreamBuffer );
+    LOG_TEMPERATURE( temperatureMilliC );
+    // Per-sample diagnostics, kept off the UART unless debugging
+    LOG_DEBUG( "EM1 time for burst of %u: %lu us (%s), energy per sample: %lu nJ", burstCount,
+        i2cGetEM1TimeUs(), ( SI7021_MODE_NO_HOLD_MASTER == activeMode ) ? "no hold master" : "hold master",
+        energyPerSampleNj( &sampleEnergy ) );
+    LOG_DEBUG( "Si7021 power-up estimate: %lu us, NACKed power-up probes: %lu",
+        si7021GetPowerUpEstimateUs( temperatureMilliC ), si7021GetPowerUpProbeCount() );
+    LOG_DEBUG( "External flash log: %lu samples in %lu pages, write energy per sample: %lu nJ",
+        extFlashGetStats()->samplesProgrammed, extFlashGetStats()->pagesProgrammed,
+        extFlashGetEnergyPerSampleNj() );
+    // Round milli-degrees to tenths of a degree for the display
+    int32_t tenths = ( temperatureMilliC + ( ( temperatureMilliC < 0 ) ? -50 : 50 ) ) / 100;
+    displayPrintf( DISPLAY_ROW_TEMPVALUE, "Temp = %s%ld.%ld C",
+        ( tenths < 0 ) ? "-" : "", labs( tenths ) / 10, labs( tenths ) % 10 );
+    return;
+}
+
+//! reportHumidity()
+//! @brief Publish the relative humidity in the Environmental Sensing
+//! Humidity characteristic, in units of 0.01 %, notify the clients that
+//! enabled notifications, then log it
+//!
+//! @param humidityMilliPct
+//! @returns void
+static void reportHumidity( int32_t humidityMilliPct )
+{
+    uint16_t humidity = ( uint16_t ) ( ( humidityMilliPct + 5 ) / 10 );
+    uint8_t value[ 2 ] = { ( uint8_t ) humidity, ( uint8_t ) ( humidity >> 8 ) };
+    BTSTACK_CHECK_RESPONSE(
+        gecko_cmd_gatt_server_write_attribute_value( gattdb_humidity, 0, sizeof( value ), value ) );
+    bleSendToSubscribers( gattdb_humidity, sizeof( value ), value );
+    LOG_INFO( "Humidity = %ld.%02ld %%", humidityMilliPct / 1000, ( humidityMilliPct % 1000 ) / 10 );
+    return;
+}
+
+//! actionSampleDone()
+//! @brief Store the converted temperature. Start the next conversion if
+//! the burst is not complete, otherwise power down the sensor and report
+//! the reduced burst
+//!
+//! @param event
+//! @returns true
+static bool actionSampleDone( schedulerEvents_e event )
+{
+    burstSamples[ burstCount++ ] = i2cGetDataBuffer()->temperatureMilliC;
+    if( burstCount < activeBurstSize )
+    {
+        if( !actionStartConversion( event ) )
+        {
+            return actionTransactionError( event );
+        }
+        return true;
+    }
+
+    shutdown();
+    energyAddSamples( &sampleEnergy, burstCount );
+    lastTemperatureMilliC = reduceBurst( burstSamples );
+    sampleRingAppend( &temperatureHistory, sampleTimeMs, lastTemperatureMilliC );
+    flashLogAppend( FLASH_LOG_TEMPERATURE, sampleTimeMs, lastTemperatureMilliC );
+    extFlashAppend( FLASH_LOG_TEMPERATURE, sampleTimeMs, lastTemperatureMilliC );
+    batchAdd( sampleTimeMs, lastTemperatureMilliC );
+    reportTemperature( lastTemperatureMilliC );
+    if( SI7021_ACQUIRE_HUMIDITY_TEMPERATURE == activeAcquisition )
+    {
+        int32_t humidityMilliPct = reduceBurst( humiditySamples );
+        sampleRingAppend( &humidityHistory, sampleTimeMs, humidityMilliPct );
+        flashLogAppend( FLASH_LOG_HUMIDITY, sampleTimeMs, humidityMilliPct );
+        extFlashAppend( FLASH_LOG_HUMIDITY, sampleTimeMs, humidityMilliPct );
+        reportHumidity( humidityMilliPct );
+    }
+    if( adaptiveResolution )
+    {
+        i2cSetResolution( si7021ResolutionPolicy( i2cGetResolution(), lastTemperatureMilliC ) );
+    }
+    return true;
+}
+
+//! actionConversionDone()
+//! @brief The result of a conversion was read. With humidity, it is the
+//! RH, so keep it and read the temperature measured during the same
+//! conversion. Otherwise it is the temperature sample
+//!
+//! @param event
+//! @returns true
+static bool actionConversionDone( schedulerEvents_e event )
+{
+    if( SI7021_ACQUIRE_HUMIDITY_TEMPERATURE != activeAcquisition )
+    {
+        return actionSampleDone( event );
+    }
+    humiditySamples[ burstCount ] = i2cGetHumidity();
+    if( i2cTransferInProgress != i2cReadPreviousTemperature() )
+    {
+        return actionTransactionError( event );
+    }
+    nextState = STATE_WAIT_FOR_I2C_RH_TEMP;
+    return true;
+}
+
+//! actionTransactionError()
+//! @brief Retry a failed I2C transaction after a backoff that doubles with
+//! every retry, up to I2C_RETRY_MAX times per power cycle. Errors other
+//! than a NACK may leave a slave holding the bus, so the bus is recovered
+//! first. Shutdown once the retries are used up, or if the transaction
+//! could not be started at all
+//!
+//! @param event
+//! @returns true
+static bool actionTransactionError( schedulerEvents_e event )
+{
+    I2C_TransferReturn_TypeDef status = i2cGetTransferStatus();
+    if( ( EVENT_I2C_TRANSACTION_ERROR == event ) && ( transactionRetries < I2C_RETRY_MAX ) )
+    {
+        if( i2cTransferNack != status )
+        {
+            i2cBusRecover();
+        }
+        uint32_t backoffUs = I2C_RETRY_BACKOFF_US << transactionRetries;
+        transactionRetries++;
+        retryState = currentState;
+        LOG_WARN( "I2C error %d in %s, retry %u of %u in %lu us", status,
+            getStateString( currentState ), transactionRetries, I2C_RETRY_MAX, backoffUs );
+        timerWaitUs( backoffUs );
+        nextState = STATE_WAIT_FOR_RETRY;
+        return true;
+    }
+    shutdown();
+    LOG_ERROR( "%s in %s", getEventString( event ), getStateString( currentState ) );
+    return true;
+}
+
+//! actionRetryTransaction()
+//! @brief Start the transaction that failed in retryState again and go
+//! back to waiting for it
+//!
+//! @param event
+//! @returns true
+static bool actionRetryTransaction( schedulerEvents_e event )
+{
+    I2C_TransferReturn_TypeDef ret;
+    switch( retryState )
+    {
+        case STATE_WAIT_FOR_PROBE:
         {
-            switch( eventToProcess )
-            {
-                case EVENT_MEASURE_TEMPERATURE:
-                {
-                    nextState = STATE_WAIT_FOR_POWERUP;
-                    gpioSi7021Enable();
-                    // wait 80ms for sensor power-up sequence
-                    timerWaitUs( 80000 );
-
-                    i2cInit();
-                    break;
-                }
-                case EVENT_IDLE:
-                {
-                    nextState = currentState;
-                    break;
-                }
-                case EVENT_BT_CONNECTION_LOST:
-                {
-                    shutdown();
-                    break;
-                }
-                default:
-                {
-                    LOG_WARN( "Invalid event/state combination (%s)/(%s)",
-                        getEventString( eventToProcess ), getStateString( currentState ) );
-                    nextState = startState; // reset state machine
-                    break;
-                }
-            }
+            ret = i2cProbe();
             break;
         }
-        case STATE_WAIT_FOR_POWERUP:
+        case STATE_WAIT_FOR_I2C_CONFIG:
         {
-            switch( eventToProcess )
-            {
-                case EVENT_LETIMER0_COMP1:
-                {
-                    i2cEM2BlockStart();
-                    I2C_TransferReturn_TypeDef ret = i2cSendCommand();
-                    if( i2cTransferInProgress == ret )
-                    {
-                        nextState = STATE_WAIT_FOR_I2C_WRITE;
-                    }
-                    break;
-                }
-                case EVENT_IDLE:
-                {
-                    nextState = currentState;
-                    break;
-                }
-                case EVENT_BT_CONNECTION_LOST:
-                {
-                    shutdown();
-                    break;
-                }
-                default:
-                {
-                    LOG_WARN( "Invalid event/state combination (%s)/(%s)",
-                        getEventString( eventToProcess ), getStateString( currentState ) );
-                    nextState = startState; // reset state machine
-                    break;
-                }
-            }
+            ret = i2cConfigureResolution();
             break;
         }
         case STATE_WAIT_FOR_I2C_WRITE:
         {
-            switch( eventToProcess )
-            {
-                case EVENT_I2C_TRANSACTION_DONE:
-                {
-                    I2C_TransferReturn_TypeDef ret = i2cReceiveData();
-                    if( i2cTransferInProgress == ret )
-                    {
-                        nextState = STATE_WAIT_FOR_I2C_READ;
-                    }
-                    break;
-                }
-                case EVENT_I2C_TRANSACTION_ERROR:
-                {
-                    shutdown();
-                    LOG_ERROR( "%s in %s", getEventString( eventToProcess ), getStateString( currentState ) );
-                    break;
-                }
-                case EVENT_IDLE:
-                {
-                    nextState = currentState;
-                    break;
-                }
-                case EVENT_BT_CONNECTION_LOST:
-                {
-                    shutdown();
-                    break;
-                }
-                default:
-                {
-                    LOG_WARN( "Invalid event/state combination (%s)/(%s)",
-                        getEventString( eventToProcess ), getStateString( currentState ) );
-                    nextState = startState; // reset state machine
-                    break;
-                }
-            }
+            ret = i2cSendCommand( noHoldCommand() );
             break;
         }
         case STATE_WAIT_FOR_I2C_READ:
         {
-            switch( eventToProcess )
-            {
-                case EVENT_I2C_TRANSACTION_DONE:
-                {
-                    shutdown();
-                    // Convert raw data to degrees Celsius and log
-                    i2cData_s *data = i2cGetDataBuffer();
-                    // Buffer to store temperature data as a bitstream
-                    uint8_t bitstreamBuffer[ 5 ];
-                    // HTM flags set to 0 for Celsius, no timestamp and no temperature type
-                    uint8_t flags = 0x00;
-                    // Pointer to buffer needed to convert values to bitstream
-                    uint8_t *p = bitstreamBuffer;
-                    // Convert flags to bitstream and append to bitstreamBuffer
-                    UINT8_TO_BITSTREAM( p, flags );
-                    // Prepare temperature data to convert to bitstream
-                    uint32_t temperature = FLT_TO_UINT32( data->temperature * 1000, -3 );
-                    UINT32_TO_BITSTREAM( p, temperature );
-
-                    if( isReadyForTemperature() )
-                    {
-                        // Send temperature indication to client
-                        BTSTACK_CHECK_RESPONSE(
-                            gecko_cmd_gatt_server_send_characteristic_notification(
-                                getConnectionHandle(),   // Send to open connection
-                                gattdb_temperature_measurement, // Temperature characteristic
-                                5,  // Length of data to send in bytes
-                                bitstreamBuffer ) );    // Bitstream buffer
-                    }
-                    LOG_TEMPERATURE( data->temperature );
-                    displayPrintf( DISPLAY_ROW_TEMPVALUE, "Temp = %3.1f C", data->temperature );
-                    break;
-                }
-                case EVENT_I2C_TRANSACTION_ERROR:
-                {
-                    shutdown();
-                    LOG_ERROR( "%s in %s", getEventString( eventToProcess ), getStateString( currentState ) );
-                    break;
-                }
-                case EVENT_IDLE:
-                {
-                    nextState = currentState;
-                    break;
-                }
-                case EVENT_BT_CONNECTION_LOST:
-                {
-                    shutdown();
-                    break;
-                }
-                default:
-                {
-                    LOG_WARN( "Invalid event/state combination (%s)/(%s)",
-                        getEventString( eventToProcess ), getStateString( currentState ) );
-                    nextState = startState; // reset state machine
-                    break;
-                }
-            }
+            ret = i2cReceiveData();
+            break;
+        }
+        case STATE_WAIT_FOR_I2C_WRITE_READ:
+        {
+            ret = startHoldMeasurement();
+            break;
+        }
+        case STATE_WAIT_FOR_I2C_RH_TEMP:
+        {
+            ret = i2cReadPreviousTemperature();
             break;
         }
         default:
         {
-            eventHandled = false;
+            ret = i2cTransferUsageFault;
             break;
         }
     }
+    if( i2cTransferInProgress != ret )
+    {
+        shutdown();
+        LOG_ERROR( "Could not retry I2C transaction for %s", getStateString( retryState ) );
+        return true;
+    }
+    nextState = retryState;
+    return true;
+}
+
+//! actionConnectionLost()
+//! @brief The bluetooth connection was lost. A measurement in progress
+//! carries on and its sample is kept in the history
+//!
+//! @param event
+//! @returns true
+static bool actionConnectionLost( schedulerEvents_e event )
+{
+    LOG_INFO( "Connection lost in %s, measurements continue", getStateString( currentState ) );
+    return true;
+}
+
+//! actionInvalid()
+//! @brief Log an invalid event/state combination, power down the sensor
+//! and reset state machine
+//!
+//! @param event
+//! @returns true
+static bool actionInvalid( schedulerEvents_e event )
+{
+    LOG_WARN( "Invalid event/state combination (%s)/(%s)",
+        getEventString( event ), getStateString( currentState ) );
+    shutdown();
+    return true;
+}
+
+//! Shorthand for table entries below. A measurement tick that arrives
+//! while the previous measurement is still running is ignored, the
+//! next tick starts a new one. A lost connection leaves the measurement
+//! in progress in its state
+#define IGNORE( state )             { NULL, ( state ) }
+#define INVALID                     { actionInvalid, STATE_SENSOR_OFF }
+#define CONNECTION_LOST( state )    { actionConnectionLost, ( state ) }
+
+//! Transition table indexed by [ currentState ][ event ]. Kept const so
+//! that it is placed in flash. Adding a state or event is one row/column
+static const schedulerTransition_s transitionTable[ NUMBER_OF_STATES ][ NUMBER_OF_EVENTS ] =
+{
+    [ STATE_SENSOR_OFF ] =
+    {
+        [ EVENT_IDLE ]                  = IGNORE( STATE_SENSOR_OFF ),
+        [ EVENT_MEASURE_TEMPERATURE ]   = { actionPowerUpSensor, STATE_WAIT_FOR_POWERUP },
+        [ EVENT_LETIMER0_COMP1 ]        = INVALID,
+        [ EVENT_I2C_TRANSACTION_DONE ]  = INVALID,
+        [ EVENT_I2C_TRANSACTION_ERROR ] = INVALID,
+        [ EVENT_BT_CONNECTION_LOST ]    = CONNECTION_LOST( STATE_SENSOR_OFF )
+    },
+    [ STATE_WAIT_FOR_POWERUP ] =
+    {
+        [ EVENT_IDLE ]                  = IGNORE( STATE_WAIT_FOR_POWERUP ),
+        [ EVENT_MEASURE_TEMPERATURE ]   = IGNORE( STATE_WAIT_FOR_POWERUP ),
+        [ EVENT_LETIMER0_COMP1 ]        = { actionProbeSensor, STATE_WAIT_FOR_PROBE },
+        [ EVENT_I2C_TRANSACTION_DONE ]  = INVALID,
+        [ EVENT_I2C_TRANSACTION_ERROR ] = INVALID,
+        [ EVENT_BT_CONNECTION_LOST ]    = CONNECTION_LOST( STATE_WAIT_FOR_POWERUP )
+    },
+    [ STATE_WAIT_FOR_PROBE ] =
+    {
+        [ EVENT_IDLE ]                  = IGNORE( STATE_WAIT_FOR_PROBE ),
+        [ EVENT_MEASURE_TEMPERATURE ]   = IGNORE( STATE_WAIT_FOR_PROBE ),
+        [ EVENT_LETIMER0_COMP1 ]        = INVALID,
+        [ EVENT_I2C_TRANSACTION_DONE ]  = { actionSensorReady, STATE_WAIT_FOR_I2C_CONFIG },
+        [ EVENT_I2C_TRANSACTION_ERROR ] = { actionProbeError, STATE_WAIT_FOR_POWERUP },
+        [ EVENT_BT_CONNECTION_LOST ]    = CONNECTION_LOST( STATE_WAIT_FOR_PROBE )
+    },
+    [ STATE_WAIT_FOR_I2C_CONFIG ] =
+    {
+        [ EVENT_IDLE ]                  = IGNORE( STATE_WAIT_FOR_I2C_CONFIG ),
+        [ EVENT_MEASURE_TEMPERATURE ]   = IGNORE( STATE_WAIT_FOR_I2C_CONFIG ),
+        [ EVENT_LETIMER0_COMP1 ]        = INVALID,
+        [ EVENT_I2C_TRANSACTION_DONE ]  = { actionSensorConfigured, STATE_WAIT_FOR_I2C_WRITE_READ },
+        [ EVENT_I2C_TRANSACTION_ERROR ] = { actionTransactionError, STATE_SENSOR_OFF },
+        [ EVENT_BT_CONNECTION_LOST ]    = CONNECTION_LOST( STATE_WAIT_FOR_I2C_CONFIG )
+    },
+    [ STATE_WAIT_FOR_I2C_WRITE ] =
+    {
+        [ EVENT_IDLE ]                  = IGNORE( STATE_WAIT_FOR_I2C_WRITE ),
+        [ EVENT_MEASURE_TEMPERATURE ]   = IGNORE( STATE_WAIT_FOR_I2C_WRITE ),
+        [ EVENT_LETIMER0_COMP1 ]        = INVALID,
+        [ EVENT_I2C_TRANSACTION_DONE ]  = { actionWaitForConversion, STATE_WAIT_FOR_CONVERSION },
+        [ EVENT_I2C_TRANSACTION_ERROR ] = { actionTransactionError, STATE_SENSOR_OFF },
+        [ EVENT_BT_CONNECTION_LOST ]    = CONNECTION_LOST( STATE_WAIT_FOR_I2C_WRITE )
+    },
+    [ STATE_WAIT_FOR_CONVERSION ] =
+    {
+        [ EVENT_IDLE ]                  = IGNORE( STATE_WAIT_FOR_CONVERSION ),
+        [ EVENT_MEASURE_TEMPERATURE ]   = IGNORE( STATE_WAIT_FOR_CONVERSION ),
+        [ EVENT_LETIMER0_COMP1 ]        = { actionReceiveData, STATE_WAIT_FOR_I2C_READ },
+        [ EVENT_I2C_TRANSACTION_DONE ]  = INVALID,
+        [ EVENT_I2C_TRANSACTION_ERROR ] = INVALID,
+        [ EVENT_BT_CONNECTION_LOST ]    = CONNECTION_LOST( STATE_WAIT_FOR_CONVERSION )
+    },
+    [ STATE_WAIT_FOR_I2C_READ ] =
+    {
+        [ EVENT_IDLE ]                  = IGNORE( STATE_WAIT_FOR_I2C_READ ),
+        [ EVENT_MEASURE_TEMPERATURE ]   = IGNORE( STATE_WAIT_FOR_I2C_READ ),
+        [ EVENT_LETIMER0_COMP1 ]        = INVALID,
+        [ EVENT_I2C_TRANSACTION_DONE ]  = { actionConversionDone, STATE_SENSOR_OFF },
+        [ EVENT_I2C_TRANSACTION_ERROR ] = { actionReadError, STATE_WAIT_FOR_CONVERSION },
+        [ EVENT_BT_CONNECTION_LOST ]    = CONNECTION_LOST( STATE_WAIT_FOR_I2C_READ )
+    },
+    [ STATE_WAIT_FOR_I2C_WRITE_READ ] =
+    {
+        [ EVENT_IDLE ]                  = IGNORE( STATE_WAIT_FOR_I2C_WRITE_READ ),
+        [ EVENT_MEASURE_TEMPERATURE ]   = IGNORE( STATE_WAIT_FOR_I2C_WRITE_READ ),
+        [ EVENT_LETIMER0_COMP1 ]        = INVALID,
+        [ EVENT_I2C_TRANSACTION_DONE ]  = { actionConversionDone, STATE_SENSOR_OFF },
+        [ EVENT_I2C_TRANSACTION_ERROR ] = { actionTransactionError, STATE_SENSOR_OFF },
+        [ EVENT_BT_CONNECTION_LOST ]    = CONNECTION_LOST( STATE_WAIT_FOR_I2C_WRITE_READ )
+    },
+    [ STATE_WAIT_FOR_I2C_RH_TEMP ] =
+    {
+        [ EVENT_IDLE ]                  = IGNORE( STATE_WAIT_FOR_I2C_RH_TEMP ),
+        [ EVENT_MEASURE_TEMPERATURE ]   = IGNORE( STATE_WAIT_FOR_I2C_RH_TEMP ),
+        [ EVENT_LETIMER0_COMP1 ]        = INVALID,
+        [ EVENT_I2C_TRANSACTION_DONE ]  = { actionSampleDone, STATE_SENSOR_OFF },
+        [ EVENT_I2C_TRANSACTION_ERROR ] = { actionTransactionError, STATE_SENSOR_OFF },
+        [ EVENT_BT_CONNECTION_LOST ]    = CONNECTION_LOST( STATE_WAIT_FOR_I2C_RH_TEMP )
+    },
+    [ STATE_WAIT_FOR_RETRY ] =
+    {
+        [ EVENT_IDLE ]                  = IGNORE( STATE_WAIT_FOR_RETRY ),
+        [ EVENT_MEASURE_TEMPERATURE ]   = IGNORE( STATE_WAIT_FOR_RETRY ),
+        [ EVENT_LETIMER0_COMP1 ]        = { actionRetryTransaction, STATE_SENSOR_OFF },
+        [ EVENT_I2C_TRANSACTION_DONE ]  = INVALID,
+        [ EVENT_I2C_TRANSACTION_ERROR ] = INVALID,
+        [ EVENT_BT_CONNECTION_LOST ]    = CONNECTION_LOST( STATE_WAIT_FOR_RETRY )
+    }
+};
+
+#undef IGNORE
+#undef INVALID
+#undef CONNECTION_LOST
+
+//! measurementTimerCallback()
+//! @brief Called from interrupt context every measurement interval
+//!
+//! @param arg unused
+//! @returns void
+static void measurementTimerCallback( void *arg )
+{
+    ( void ) arg;
+    schedulerSetEventMeasureTemperature();
+    return;
+}
+
+//! schedulerInit()
+//! @brief Start the periodic software timer that triggers temperature
+//! measurements and clear the sample history. Must be called after
+//! timerInit()
+//!
+//! @param void
+//! @returns void
+void schedulerInit()
+{
+    sampleRingInit( &temperatureHistory, temperatureHistoryBlocks, SCHEDULER_TEMPERATURE_HISTORY_BLOCKS,
+        SAMPLE_RING_OVERWRITE_OLDEST );
+    sampleRingInit( &humidityHistory, humidityHistoryBlocks, SCHEDULER_HUMIDITY_HISTORY_BLOCKS,
+        SAMPLE_RING_OVERWRITE_OLDEST );
+    if( measurementIntervalS == 0 )
+    {
+        measurementIntervalS = MEASUREMENT_INTERVAL_DEFAULT_S;
+    }
+    uint32_t periodTicks = timerMsToTicks( ( uint32_t ) measurementIntervalS * MSEC_PER_SEC );
+    swTimerStartTicks( &measurementTimer, periodTicks, periodTicks, measurementTimerCallback, NULL );
+    return;
+}
+
+//! schedulerSetMeasurementInterval()
+//! @brief Change the time between temperature measurements. Takes effect
+//! from the last measurement, so a shorter interval that has already
+//! elapsed triggers a measurement right away
+//!
+//! @param seconds new interval, between MEASUREMENT_INTERVAL_MIN_S and
+//! MEASUREMENT_INTERVAL_MAX_S
+//! @returns true if interval is valid and was applied
+bool schedulerSetMeasurementInterval( uint16_t seconds )
+{
+    if( ( seconds < MEASUREMENT_INTERVAL_MIN_S ) || ( seconds > MEASUREMENT_INTERVAL_MAX_S ) )
+    {
+        LOG_WARN( "Invalid measurement interval %u s", seconds );
+        return false;
+    }
+    if( seconds != measurementIntervalS )
+    {
+        LOG_INFO( "Measurement interval changed from %u s to %u s", measurementIntervalS, seconds );
+        measurementIntervalS = seconds;
+        swTimerSetPeriod( &measurementTimer, timerMsToTicks( ( uint32_t ) seconds * MSEC_PER_SEC ) );
+    }
+    return true;
+}
+
+//! schedulerSetMeasurementMode()
+//! @brief Select Hold Master or No Hold Master measurements. Takes effect
+//! from the next measurement
+//!
+//! @param mode
+//! @returns true if mode is valid
+bool schedulerSetMeasurementMode( si7021MeasurementMode_e mode )
+{
+    if( mode >= SI7021_NUMBER_OF_MODES )
+    {
+        LOG_WARN( "Invalid measurement mode %d", mode );
+        return false;
+    }
+    requestedMode = mode;
+    return true;
+}
+
+//! schedulerSetAcquisition()
+//! @brief Select whether each conversion acquires the temperature only,
+//! or the relative humidity and the temperature from the same conversion.
+//! Takes effect from the next power cycle
+//!
+//! @param acquisition
+//! @returns true if acquisition is valid
+bool schedulerSetAcquisition( si7021Acquisition_e acquisition )
+{
+    if( acquisition >= SI7021_NUMBER_OF_ACQUISITIONS )
+    {
+        LOG_WARN( "Invalid acquisition %d", acquisition );
+        return false;
+    }
+    requestedAcquisition = acquisition;
+    return true;
+}
+
+//! schedulerGetAcquisition()
+//! @brief Returns the quantities acquired from the next power cycle
+//!
+//! @param void
+//! @returns acquisition
+si7021Acquisition_e schedulerGetAcquisition()
+{
+    return requestedAcquisition;
+}
+
+//! schedulerGetMeasurementMode()
+//! @brief Returns the mode used for the next measurement
+//!
+//! @param void
+//! @returns mode
+si7021MeasurementMode_e schedulerGetMeasurementMode()
+{
+    return requestedMode;
+}
+
+//! schedulerSetBurstSize()
+//! @brief Set the number of conversions taken per sensor power cycle.
+//! Takes effect from the next power cycle
+//!
+//! @param size between 1 and SCHEDULER_BURST_MAX
+//! @returns true if size is valid
+bool schedulerSetBurstSize( uint8_t size )
+{
+    if( ( size == 0 ) || ( size > SCHEDULER_BURST_MAX ) )
+    {
+        LOG_WARN( "Invalid burst size %u", size );
+        return false;
+    }
+    requestedBurstSize = size;
+    return true;
+}
+
+//! schedulerGetBurstSize()
+//! @brief Returns the number of conversions per sensor power cycle
+//!
+//! @param void
+//! @returns burst size
+uint8_t schedulerGetBurstSize()
+{
+    return requestedBurstSize;
+}
+
+//! schedulerSetBurstReduction()
+//! @brief Select how a burst is reduced to the reported temperature
+//!
+//! @param reduction
+//! @returns true if reduction is valid
+bool schedulerSetBurstReduction( schedulerBurstReduction_e reduction )
+{
+    if( reduction >= NUMBER_OF_BURST_REDUCTIONS )
+    {
+        LOG_WARN( "Invalid burst reduction %d", reduction );
+        return false;
+    }
+    burstReduction = reduction;
+    return true;
+}
+
+//! schedulerGetEnergyPerSampleNj()
+//! @brief Returns the estimated sensor and EM1 energy spent per reported
+//! temperature conversion, including failed power cycles
+//!
+//! @param void
+//! @returns energy in nanojoules
+uint32_t schedulerGetEnergyPerSampleNj()
+{
+    return energyPerSampleNj( &sampleEnergy );
+}
+
+//! schedulerResetEnergy()
+//! @brief Clear the energy per sample counter, e.g. after changing policy
+//!
+//! @param void
+//! @returns void
+void schedulerResetEnergy()
+{
+    energyReset( &sampleEnergy );
+    return;
+}
+
+//! schedulerSetAdaptiveResolution()
+//! @brief Enable or disable the Si7021 resolution policy. When disabled,
+//! the resolution set with i2cSetResolution() is kept
+//!
+//! @param enable
+//! @returns void
+void schedulerSetAdaptiveResolution( bool enable )
+{
+    adaptiveResolution = enable;
+    return;
+}
+
+//! schedulerGetMeasurementInterval()
+//! @brief Returns the current time between temperature measurements
+//!
+//! @param void
+//! @returns interval in seconds
+uint16_t schedulerGetMeasurementInterval()
+{
+    return measurementIntervalS;
+}
+
+//! schedulerSignalEvent()
+//! @brief Set the bit for ev in the external signal mask. Safe to call
+//! from interrupt and thread context. If the event is already pending,
+//! the signal is merged and counted as coalesced. A value that is not a
+//! valid event is discarded and counted
+//!
+//! @param ev
+//! @returns void
+void schedulerSignalEvent( schedulerEvents_e ev )
+{
+    CORE_DECLARE_IRQ_STATE;
+    if( ev >= NUMBER_OF_EVENTS )
+    {
+        CORE_ENTER_CRITICAL();
+        unknownEvents++;
+        CORE_EXIT_CRITICAL();
+        return;
+    }
+    uint32_t mask = SCHEDULER_EVENT_MASK( ev );
+    CORE_ENTER_CRITICAL();
+    eventStats[ ev ].signalled++;
+    if( pendingEvents & mask )
+    {
+        eventStats[ ev ].coalesced++;
+    }
+    pendingEvents |= mask;
+    gecko_external_signal( mask );
+    CORE_EXIT_CRITICAL();
+    return;
+}
+
+//! schedulerGetEventStats()
+//! @brief Returns the signal delivery counters for ev
+//!
+//! @param ev
+//! @returns pointer to counters, NULL if ev is not valid
+const schedulerEventStats_s *schedulerGetEventStats( schedulerEvents_e ev )
+{
+    if( ev < NUMBER_OF_EVENTS )
+    {
+        return &eventStats[ ev ];
+    }
+    return NULL;
+}
+
+//! schedulerGetUnknownEventCount()
+//! @brief Returns the number of signals discarded because they did not
+//! name a valid event
+//!
+//! @param void
+//! @returns count
+uint32_t schedulerGetUnknownEventCount()
+{
+    return unknownEvents;
+}
+
+//! schedulerGetTemperatureHistory()
+//! @brief Returns the ring of reported temperatures in milli-degrees
+//! Celsius, timestamped with timeNowMs() at sensor power-up
+//!
+//! @param void
+//! @returns pointer to ring
+const sampleRing_s *schedulerGetTemperatureHistory()
+{
+    return &temperatureHistory;
+}
+
+//! schedulerGetHumidityHistory()
+//! @brief Returns the ring of reported relative humidities in milli-percent,
+//! timestamped with timeNowMs() at sensor power-up
+//!
+//! @param void
+//! @returns pointer to ring
+const sampleRing_s *schedulerGetHumidityHistory()
+{
+    return &humidityHistory;
+}
+
+//! schedulerDispatch()
+//! @brief Look up the transition for event in the current state, execute
+//! its action and update the current state
+//!
+//! @param event
+//! @returns void
+static void schedulerDispatch( schedulerEvents_e event )
+{
+    const schedulerTransition_s *transition = &transitionTable[ currentState ][ event ];
+    if( ( NULL == transition->action ) || ( actionInvalid == transition->action ) )
+    {
+        // Ignored or invalid in this state, the signal does no work
+        eventStats[ event ].dropped++;
+    }
+    // Actions may redirect the transition by writing nextState
+    nextState = transition->next;
+    if( ( NULL != transition->action ) && !transition->action( event ) )
+    {
+        nextState = currentState;
+    }
+
     if( currentState != nextState )
     {
         LOG_INFO( "Transition [%s]-->[%s]",
             getStateString( currentState ), getStateString( nextState ) );
         currentState = nextState;
     }
+}
+
+//!
+//! @brief Process all pending events depending on current state.
+//! First, we check if the event to process is one of our defined
+//! signals, i.e. an external signal. If not, we return immediately.
+//! Otherwise, every bit set in the signal mask is dispatched through
+//! @ref transitionTable in @ref eventPriority order
+//!
+//! @param evt
+//! @return eventHandled - true if successful, false otherwise
+//!
+bool schedulerMain( struct gecko_cmd_packet *evt )
+{
+    bool eventHandled = true;
+    uint32_t eventsToProcess = 0;
+    if( BGLIB_MSG_ID( evt->header ) == gecko_evt_system_external_signal_id )
+    {
+        eventsToProcess = evt->data.evt_system_external_signal.extsignals;
+    }
+    else
+    {
+        // not an event for our state machine
+        eventHandled = false;
+        return eventHandled;
+    }
+
+    // These events are now being handled, so any new signal for them
+    // is no longer coalesced into this one
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_CRITICAL();
+    pendingEvents &= ~eventsToProcess;
+    CORE_EXIT_CRITICAL();
+
+    if( eventsToProcess & ~SCHEDULER_EVENT_MASK_ALL )
+    {
+        unknownEvents++;
+        LOG_WARN( "Unknown events in external signal mask (0x%lX)", eventsToProcess );
+        eventHandled = false;
+    }
+
+    if( currentState >= NUMBER_OF_STATES )
+    {
+        LOG_WARN( "Invalid state (%d), resetting state machine", currentState );
+        currentState = startState;
+    }
+
+    for( uint8_t i = 0; i < ( sizeof( eventPriority ) / sizeof( eventPriority[ 0 ] ) ); i++ )
+    {
+        schedulerEvents_e event = eventPriority[ i ];
+        if( !( eventsToProcess & SCHEDULER_EVENT_MASK( event ) ) )
+        {
+            continue;
+        }
+
+        // Measurements continue without a connection, the samples are
+        // kept in the history until a client reads them
+        schedulerDispatch( event );
+    }
 
     return eventHandled;
-}
\ No newline at end of file
+}
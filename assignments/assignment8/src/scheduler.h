@@ -25,8 +25,12 @@
 #include "native_gecko.h"
 #include "em_core.h"
 #include "ble_device_type.h"
+#include "i2c.h"
+#include "samplering.h"
 
-//! Enum defining possible events that scheduler can process
+//! Enum defining possible events that scheduler can process. Each
+//! value is a bit position in the mask passed to gecko_external_signal()
+//! so that several events signalled in the same wakeup are not lost
 typedef enum
 {
     EVENT_IDLE,
@@ -38,6 +42,36 @@ typedef enum
     NUMBER_OF_EVENTS
 } schedulerEvents_e;
 
+//! Converts a schedulerEvents_e into its bit in the external signal mask
+#define SCHEDULER_EVENT_MASK( ev )  ( ( uint32_t ) 1 << ( ev ) )
+
+//! Mask of all bits that correspond to a valid event
+#define SCHEDULER_EVENT_MASK_ALL    ( SCHEDULER_EVENT_MASK( NUMBER_OF_EVENTS ) - 1 )
+
+//! Maximum number of conversions per sensor power cycle
+#define SCHEDULER_BURST_MAX     ( 16 )
+
+//! Number of ring blocks of temperature and humidity history. A block
+//! holds up to SAMPLE_RING_SAMPLES_PER_BLOCK samples
+#define SCHEDULER_TEMPERATURE_HISTORY_BLOCKS    ( 64 )
+#define SCHEDULER_HUMIDITY_HISTORY_BLOCKS       ( 32 )
+
+//! How a burst of conversions is reduced to the reported temperature
+typedef enum
+{
+    BURST_REDUCTION_MEDIAN,
+    BURST_REDUCTION_AVERAGE,
+    NUMBER_OF_BURST_REDUCTIONS
+} schedulerBurstReduction_e;
+
+//! Per-event counters for signal delivery
+typedef struct
+{
+    uint32_t signalled;     //! Number of times event was signalled
+    uint32_t coalesced;     //! Signals merged with an already pending signal
+    uint32_t dropped;       //! Signals discarded without being processed
+} schedulerEventStats_s;
+
 //! String representations for events
 static const char *eventStrings[] = {
     "EVENT_IDLE",
@@ -71,8 +105,14 @@ typedef enum
 {
     STATE_SENSOR_OFF,
     STATE_WAIT_FOR_POWERUP,
+    STATE_WAIT_FOR_PROBE,
+    STATE_WAIT_FOR_I2C_CONFIG,
     STATE_WAIT_FOR_I2C_WRITE,
+    STATE_WAIT_FOR_CONVERSION,
     STATE_WAIT_FOR_I2C_READ,
+    STATE_WAIT_FOR_I2C_WRITE_READ,
+    STATE_WAIT_FOR_I2C_RH_TEMP,
+    STATE_WAIT_FOR_RETRY,
     NUMBER_OF_STATES
 } schedulerStates_e;
 
@@ -80,8 +120,14 @@ typedef enum
 static const char *stateStrings[] = {
     "STATE_SENSOR_OFF",
     "STATE_WAIT_FOR_POWERUP",
+    "STATE_WAIT_FOR_PROBE",
+    "STATE_WAIT_FOR_I2C_CONFIG",
     "STATE_WAIT_FOR_I2C_WRITE",
-    "STATE_WAIT_FOR_I2C_READ"
+    "STATE_WAIT_FOR_CONVERSION",
+    "STATE_WAIT_FOR_I2C_READ",
+    "STATE_WAIT_FOR_I2C_WRITE_READ",
+    "STATE_WAIT_FOR_I2C_RH_TEMP",
+    "STATE_WAIT_FOR_RETRY"
 };
 
 //! getStateString()
@@ -102,81 +148,106 @@ static inline const char *getStateString( schedulerStates_e st )
     }
 }
 
+void schedulerInit();
+
+bool schedulerSetMeasurementInterval( uint16_t seconds );
+
+uint16_t schedulerGetMeasurementInterval();
+
+bool schedulerSetMeasurementMode( si7021MeasurementMode_e mode );
+
+si7021MeasurementMode_e schedulerGetMeasurementMode();
+
+bool schedulerSetAcquisition( si7021Acquisition_e acquisition );
+
+si7021Acquisition_e schedulerGetAcquisition();
+
+bool schedulerSetBurstSize( uint8_t size );
+
+uint8_t schedulerGetBurstSize();
+
+bool schedulerSetBurstReduction( schedulerBurstReduction_e reduction );
+
+uint32_t schedulerGetEnergyPerSampleNj();
+
+void schedulerResetEnergy();
+
+void schedulerSetAdaptiveResolution( bool enable );
+
 bool schedulerMain( struct gecko_cmd_packet *evt );
 
+void schedulerSignalEvent( schedulerEvents_e ev );
+
+const schedulerEventStats_s *schedulerGetEventStats( schedulerEvents_e ev );
+
+uint32_t schedulerGetUnknownEventCount();
+
+const sampleRing_s *schedulerGetTemperatureHistory();
+
+const sampleRing_s *schedulerGetHumidityHistory();
+
 static inline bool handleSchedulerEvent( struct gecko_cmd_packet *evt )
 {
 #if DEVICE_IS_BLE_SERVER == 1
     return schedulerMain( evt );
 #else
+    ( void ) evt;
     return true;
 #endif
 }
 
-//! schedulerSetEventMeasureTemperature()
+//! schedulerSetEventConnectionLost()
 //! @brief Trigger a Bluetooth connection lost event for our state machine
-//! Call CORE_ATOMIC_IRQ_DISABLE() or CORE_ATOMIC_IRQ_ENABLE() inside here
 //!
 //! @param void
 //! @returns void
 static inline void schedulerSetEventConnectionLost()
 {
-    CORE_DECLARE_IRQ_STATE;
-    CORE_ENTER_CRITICAL();
-    gecko_external_signal( EVENT_BT_CONNECTION_LOST );
-    CORE_EXIT_CRITICAL();
+    schedulerSignalEvent( EVENT_BT_CONNECTION_LOST );
     return;
 }
 
 //! schedulerSetEventMeasureTemperature()
-//! @brief Set event to EVENT_MEASURE_TEMPERATURE, only if there is no pending event
-//! Always called from an interrupt context, so don't want to call
-//! CORE_ATOMIC_IRQ_DISABLE() or CORE_ATOMIC_IRQ_ENABLE() inside here
+//! @brief Set the EVENT_MEASURE_TEMPERATURE bit in the pending signal mask
 //!
 //! @param void
 //! @returns void
 static inline void schedulerSetEventMeasureTemperature()
 {
-    gecko_external_signal( EVENT_MEASURE_TEMPERATURE );
+    schedulerSignalEvent( EVENT_MEASURE_TEMPERATURE );
     return;
 }
 
 //! schedulerSetEventTimerDone()
-//! @brief Set event to EVENT_LETIMER0_COMP1, only if there is no pending event
-//! Always called from an interrupt context, so don't want to call
-//! CORE_ATOMIC_IRQ_DISABLE() or CORE_ATOMIC_IRQ_ENABLE() inside here
+//! @brief Set the EVENT_LETIMER0_COMP1 bit in the pending signal mask
 //!
 //! @param void
 //! @returns void
 static inline void schedulerSetEventTimerDone()
 {
-    gecko_external_signal( EVENT_LETIMER0_COMP1 );
+    schedulerSignalEvent( EVENT_LETIMER0_COMP1 );
     return;
 }
 
 //! schedulerSetEventTransactionDone()
-//! @brief Set event to EVENT_I2C_TRANSACTION_DONE, only if there is no pending event
-//! Always called from an interrupt context, so don't want to call
-//! CORE_ATOMIC_IRQ_DISABLE() or CORE_ATOMIC_IRQ_ENABLE() inside here
+//! @brief Set the EVENT_I2C_TRANSACTION_DONE bit in the pending signal mask
 //!
 //! @param void
 //! @returns void
 static inline void schedulerSetEventTransactionDone()
 {
-    gecko_external_signal( EVENT_I2C_TRANSACTION_DONE );
+    schedulerSignalEvent( EVENT_I2C_TRANSACTION_DONE );
     return;
 }
 
 //! schedulerSetEventTransactionError()
-//! @brief Set event to EVENT_I2C_TRANSACTION_ERROR, only if there is no pending event
-//! Always called from an interrupt context, so don't want to call
-//! CORE_ATOMIC_IRQ_DISABLE() or CORE_ATOMIC_IRQ_ENABLE() inside here
+//! @brief Set the EVENT_I2C_TRANSACTION_ERROR bit in the pending signal mask
 //!
 //! @param void
 //! @returns void
 static inline void schedulerSetEventTransactionError()
 {
-    gecko_external_signal( EVENT_I2C_TRANSACTION_ERROR );
+    schedulerSignalEvent( EVENT_I2C_TRANSACTION_ERROR );
     return;
 }
 
@@ -0,0 +1,219 @@
+//!
+//! @file si7021.c
+//! @brief Si7021 power-up time estimation and resolution policy. Instead of always waiting the
+//! worst case power-up time, the sensor address is probed until it ACKs
+//! and the measured time is used to learn a per-temperature estimate of
+//! when to send the first probe. The resolution policy trades precision
+//! for conversion time depending on how fast the temperature changes
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources Si7021-A20 datasheet
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#include "si7021.h"
+
+#include "log.h"
+#include "timebase.h"
+
+#include <stdlib.h>
+
+//! Learned power-up time per temperature band in microseconds. A zero
+//! entry has not been learned yet and uses SI7021_POWERUP_MAX_US
+static uint32_t powerUpEstimateUs[ SI7021_POWERUP_BANDS ];
+
+//! Total number of address probes NACKed while powering up
+static uint32_t powerUpProbeNacks = 0;
+
+//! RTCC time at which the current power-up started
+static uint64_t powerUpStartTicks = 0;
+
+//! Temperature band and NACK count of the current power-up
+static uint8_t powerUpBand = 0;
+static uint32_t powerUpNacks = 0;
+
+//! Previous reading seen by the resolution policy
+static int32_t previousTemperatureMilliC = 0;
+static bool havePreviousTemperature = false;
+
+//! Number of stable readings in a row seen by the resolution policy
+static uint8_t stableReadings = 0;
+
+//! getBand()
+//! @brief Map a temperature to its power-up estimate band
+//!
+//! @param temperatureMilliC
+//! @returns index into powerUpEstimateUs
+static uint8_t getBand( int32_t temperatureMilliC )
+{
+    if( temperatureMilliC <= SI7021_POWERUP_BAND_MIN_MILLIC )
+    {
+        return 0;
+    }
+    int32_t band = ( temperatureMilliC - SI7021_POWERUP_BAND_MIN_MILLIC ) / SI7021_POWERUP_BAND_MILLIC;
+    return ( band >= SI7021_POWERUP_BANDS ) ? ( SI7021_POWERUP_BANDS - 1 ) : ( uint8_t ) band;
+}
+
+//! getBandEstimateUs()
+//! @brief Returns the learned power-up time of a band
+//!
+//! @param band
+//! @returns power-up time in microseconds
+static uint32_t getBandEstimateUs( uint8_t band )
+{
+    uint32_t estimate = powerUpEstimateUs[ band ];
+    return ( estimate == 0 ) ? SI7021_POWERUP_MAX_US : estimate;
+}
+
+//! si7021GetPowerUpEstimateUs()
+//! @brief Returns the learned power-up time for a temperature
+//!
+//! @param temperatureMilliC
+//! @returns power-up time in microseconds
+uint32_t si7021GetPowerUpEstimateUs( int32_t temperatureMilliC )
+{
+    return getBandEstimateUs( getBand( temperatureMilliC ) );
+}
+
+//! si7021GetPowerUpProbeCount()
+//! @brief Returns the total number of address probes NACKed by the
+//! sensor because it had not finished powering up
+//!
+//! @param void
+//! @returns number of NACKed probes
+uint32_t si7021GetPowerUpProbeCount()
+{
+    return powerUpProbeNacks;
+}
+
+//! si7021PowerUpStart()
+//! @brief Called when the sensor is powered. Returns how long to wait
+//! before the first address probe, which is one probe interval short of
+//! the learned estimate so the first probe usually finds the sensor
+//! just ready
+//!
+//! @param temperatureMilliC last known temperature
+//! @returns time to wait in microseconds
+uint32_t si7021PowerUpStart( int32_t temperatureMilliC )
+{
+    powerUpStartTicks = timeNowTicks();
+    powerUpBand = getBand( temperatureMilliC );
+    powerUpNacks = 0;
+
+    uint32_t estimate = getBandEstimateUs( powerUpBand );
+    if( estimate <= ( 2 * SI7021_POWERUP_PROBE_US ) )
+    {
+        return SI7021_POWERUP_PROBE_US;
+    }
+    return estimate - SI7021_POWERUP_PROBE_US;
+}
+
+//! si7021PowerUpProbeNacked()
+//! @brief Called when an address probe is NACKed
+//!
+//! @param void
+//! @returns true if another probe should be sent after
+//! SI7021_POWERUP_PROBE_US, false if the worst case power-up time has
+//! passed and the sensor is not responding
+bool si7021PowerUpProbeNacked()
+{
+    powerUpNacks++;
+    powerUpProbeNacks++;
+    return ( timeTicksToUs( timeNowTicks() - powerUpStartTicks ) < SI7021_POWERUP_MAX_US );
+}
+
+//! si7021PowerUpDone()
+//! @brief Called when an address probe is ACKed. If earlier probes were
+//! NACKed, the measured time is accurate to one probe interval and the
+//! estimate moves a quarter of the way toward it. If the first probe was
+//! ACKed, the real time is unknown but shorter, so the estimate is cut
+//! by an eighth to search for it
+//!
+//! @param void
+//! @returns void
+void si7021PowerUpDone()
+{
+    uint32_t elapsedUs = ( uint32_t ) timeTicksToUs( timeNowTicks() - powerUpStartTicks );
+    int32_t estimate = ( int32_t ) getBandEstimateUs( powerUpBand );
+
+    if( powerUpNacks == 0 )
+    {
+        estimate -= estimate / 8;
+    }
+    else
+    {
+        estimate += ( ( int32_t ) elapsedUs - estimate ) / 4;
+    }
+
+    if( estimate < ( int32_t ) SI7021_POWERUP_PROBE_US )
+    {
+        estimate = SI7021_POWERUP_PROBE_US;
+    }
+    else if( estimate > ( int32_t ) SI7021_POWERUP_MAX_US )
+    {
+        estimate = SI7021_POWERUP_MAX_US;
+    }
+    powerUpEstimateUs[ powerUpBand ] = ( uint32_t ) estimate;
+
+    LOG_DEBUG( "Si7021 powered up in %lu us after %lu NACKed probes, estimate %ld us",
+        elapsedUs, powerUpNacks, estimate );
+    return;
+}
+
+//! si7021ResolutionPolicy()
+//! @brief Choose the resolution for the next measurement from how much
+//! the temperature moved since the previous one. Resolution drops one
+//! step after SI7021_STABLE_READINGS stable readings, rises one step on
+//! a moderate change and returns to 14-bit on a fast change
+//!
+//! @param current resolution used for temperatureMilliC
+//! @param temperatureMilliC latest reading
+//! @returns resolution for the next measurement
+si7021Resolution_e si7021ResolutionPolicy( si7021Resolution_e current, int32_t temperatureMilliC )
+{
+    si7021Resolution_e next = current;
+    if( havePreviousTemperature )
+    {
+        int32_t delta = labs( temperatureMilliC - previousTemperatureMilliC );
+        if( delta >= SI7021_FAST_DELTA_MILLIC )
+        {
+            next = SI7021_RESOLUTION_14_BIT;
+            stableReadings = 0;
+        }
+        else if( delta >= SI7021_STABLE_DELTA_MILLIC )
+        {
+            if( current > SI7021_RESOLUTION_14_BIT )
+            {
+                next = current - 1;
+            }
+            stableReadings = 0;
+        }
+        else if( ++stableReadings >= SI7021_STABLE_READINGS )
+        {
+            if( current < SI7021_RESOLUTION_11_BIT )
+            {
+                next = current + 1;
+            }
+            stableReadings = 0;
+        }
+    }
+    previousTemperatureMilliC = temperatureMilliC;
+    havePreviousTemperature = true;
+
+    if( next != current )
+    {
+        LOG_INFO( "Si7021 resolution changed from %u-bit to %u-bit",
+            i2cGetResolutionBits( current ), i2cGetResolutionBits( next ) );
+    }
+    return next;
+}
@@ -0,0 +1,61 @@
+//!
+//! @file si7021.h
+//! @brief Si7021 power-up time estimation and resolution policy
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources Si7021-A20 datasheet
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#ifndef __SI7021_H___
+#define __SI7021_H___
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "i2c.h"
+
+//! Worst case power-up time over the full temperature range in microseconds
+static const uint32_t SI7021_POWERUP_MAX_US = 80000;
+
+//! Time between address probes while waiting for the sensor to power up
+static const uint32_t SI7021_POWERUP_PROBE_US = 2000;
+
+//! Power-up estimates are learned separately for each temperature band
+//! of SI7021_POWERUP_BAND_MILLIC, starting at SI7021_POWERUP_BAND_MIN_MILLIC
+#define SI7021_POWERUP_BANDS            ( 13 )
+static const int32_t SI7021_POWERUP_BAND_MIN_MILLIC = -40000;
+static const int32_t SI7021_POWERUP_BAND_MILLIC = 10000;
+
+//! Consecutive readings closer than this are considered stable
+static const int32_t SI7021_STABLE_DELTA_MILLIC = 200;
+
+//! Consecutive readings further apart than this are considered fast moving
+static const int32_t SI7021_FAST_DELTA_MILLIC = 1000;
+
+//! Number of stable readings in a row before resolution is lowered a step
+static const uint8_t SI7021_STABLE_READINGS = 4;
+
+uint32_t si7021PowerUpStart( int32_t temperatureMilliC );
+
+bool si7021PowerUpProbeNacked();
+
+void si7021PowerUpDone();
+
+uint32_t si7021GetPowerUpEstimateUs( int32_t temperatureMilliC );
+
+uint32_t si7021GetPowerUpProbeCount();
+
+si7021Resolution_e si7021ResolutionPolicy( si7021Resolution_e current, int32_t temperatureMilliC );
+
+#endif // __SI7021_H___
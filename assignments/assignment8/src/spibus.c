@@ -0,0 +1,82 @@
+//!
+//! @file spibus.c
+//! @brief Implements arbitration of USART1 between the LCD and the MX25
+//! SPI flash. The bus is never waited for: a user that finds it taken
+//! retries later, so it can be acquired from interrupt context
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources Utilized Silicon Labs' EMLIB peripheral libraries to implement functionality @n
+//!            em_core.h - for CORE_* critical section macros
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#include "spibus.h"
+
+#include "log.h"
+
+#include "em_core.h"
+
+//! Current user of the bus
+static volatile spiBusOwner_e busOwner = SPI_BUS_FREE;
+
+//! spiBusAcquire()
+//! @brief Take the bus if it is free
+//!
+//! @param owner
+//! @returns true if owner now holds the bus
+bool spiBusAcquire( spiBusOwner_e owner )
+{
+    bool acquired = false;
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_CRITICAL();
+    if( SPI_BUS_FREE == busOwner )
+    {
+        busOwner = owner;
+        acquired = true;
+    }
+    CORE_EXIT_CRITICAL();
+    return acquired;
+}
+
+//! spiBusRelease()
+//! @brief Give the bus back
+//!
+//! @param owner must be the current owner
+//! @returns void
+void spiBusRelease( spiBusOwner_e owner )
+{
+    spiBusOwner_e heldBy;
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_CRITICAL();
+    heldBy = busOwner;
+    if( owner == busOwner )
+    {
+        busOwner = SPI_BUS_FREE;
+    }
+    CORE_EXIT_CRITICAL();
+    if( owner != heldBy )
+    {
+        LOG_WARN( "SPI bus released by %d but held by %d", owner, heldBy );
+    }
+    return;
+}
+
+//! spiBusGetOwner()
+//! @brief Returns the current user of the bus
+//!
+//! @param void
+//! @returns owner, SPI_BUS_FREE if nobody holds the bus
+spiBusOwner_e spiBusGetOwner()
+{
+    return busOwner;
+}
@@ -0,0 +1,43 @@
+//!
+//! @file spibus.h
+//! @brief Arbitration of USART1, which the LCD and the MX25 SPI flash
+//! share on the radio board
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources Utilized Silicon Labs' EMLIB peripheral libraries to implement functionality @n
+//!            em_core.h - for CORE_* critical section macros
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#ifndef __SPIBUS_H___
+#define __SPIBUS_H___
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//! Users of the shared SPI bus
+typedef enum
+{
+    SPI_BUS_FREE,
+    SPI_BUS_DISPLAY,
+    SPI_BUS_EXTFLASH,
+    SPI_BUS_NUMBER_OF_OWNERS
+} spiBusOwner_e;
+
+bool spiBusAcquire( spiBusOwner_e owner );
+
+void spiBusRelease( spiBusOwner_e owner );
+
+spiBusOwner_e spiBusGetOwner();
+
+#endif // __SPIBUS_H___
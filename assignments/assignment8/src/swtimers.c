@@ -0,0 +1,322 @@
+//!
+//! @file swtimers.c
+//! @brief Implements a software timer service on top of LETIMER0. Active
+//! timers are kept in a queue sorted by deadline and COMP1 is always
+//! programmed to the earliest deadline in the current LETIMER0 period
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources Utilized Silicon Labs' EMLIB peripheral libraries to implement functionality @n
+//!            em_core.h - for CORE_* critical section macros @n
+//!            em_letimer.h - for LETIMER0 interface macros and functions
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#include "swtimers.h"
+
+#include "log.h"
+#include "timers.h"
+
+#include <stddef.h>
+
+#include "em_core.h"
+#include "em_letimer.h"
+
+//! Longest delay or period supported, in ticks
+#define SWTIMER_MAX_TICKS   ( ( uint32_t ) INT32_MAX )
+
+//! Head of the queue of active timers, sorted by deadline
+static swTimer_s *timerQueue = NULL;
+
+//! isExpired()
+//! @brief Wraparound-safe check of deadline against now
+//!
+//! @param deadline
+//! @param now
+//! @returns true if deadline is at or before now
+static inline bool isExpired( uint32_t deadline, uint32_t now )
+{
+    return ( ( int32_t ) ( deadline - now ) <= 0 );
+}
+
+//! swTimerInsert()
+//! @brief Insert timer into the queue sorted by deadline. Timers with
+//! equal deadlines expire in the order they were inserted.
+//! Must be called with interrupts disabled
+//!
+//! @param timer
+//! @returns void
+static void swTimerInsert( swTimer_s *timer )
+{
+    swTimer_s **pp = &timerQueue;
+    while( ( *pp != NULL ) && !( ( int32_t ) ( timer->deadline - ( *pp )->deadline ) < 0 ) )
+    {
+        pp = &( *pp )->next;
+    }
+    timer->next = *pp;
+    *pp = timer;
+    timer->active = true;
+}
+
+//! swTimerRemove()
+//! @brief Remove timer from the queue if present.
+//! Must be called with interrupts disabled
+//!
+//! @param timer
+//! @returns void
+static void swTimerRemove( swTimer_s *timer )
+{
+    swTimer_s **pp = &timerQueue;
+    while( *pp != NULL )
+    {
+        if( *pp == timer )
+        {
+            *pp = timer->next;
+            break;
+        }
+        pp = &( *pp )->next;
+    }
+    timer->next = NULL;
+    timer->active = false;
+}
+
+//! swTimerSchedule()
+//! @brief Expire every timer whose deadline has passed, then program
+//! COMP1 for the earliest remaining deadline if it falls within the
+//! current LETIMER0 period. Deadlines in later periods are picked up
+//! again from the underflow interrupt.
+//! Must be called with interrupts disabled
+//!
+//! @param void
+//! @returns void
+static void swTimerSchedule()
+{
+    while( 1 )
+    {
+        uint32_t now = timerGetTicks();
+        while( ( timerQueue != NULL ) && isExpired( timerQueue->deadline, now ) )
+        {
+            swTimer_s *timer = timerQueue;
+            timerQueue = timer->next;
+            timer->next = NULL;
+            timer->active = false;
+            if( timer->periodTicks != 0 )
+            {
+                timer->deadline += timer->periodTicks;
+                swTimerInsert( timer );
+            }
+            if( timer->callback != NULL )
+            {
+                timer->callback( timer->arg );
+            }
+            now = timerGetTicks();
+        }
+
+        if( timerQueue == NULL )
+        {
+            LETIMER_IntDisable( LETIMER0, LETIMER_IEN_COMP1 );
+            return;
+        }
+
+        uint32_t periodEnd = timerGetPeriodStartTicks() + timerGetPeriodTicks();
+        if( !isExpired( timerQueue->deadline, periodEnd - 1 ) )
+        {
+            // Earliest deadline is not in this period, wait for underflow
+            LETIMER_IntDisable( LETIMER0, LETIMER_IEN_COMP1 );
+            return;
+        }
+
+        // LETIMER0 counts down to 0 and reloads on the next tick, so the
+        // counter value at the deadline is one less than the number of
+        // ticks between the deadline and the next underflow
+        LETIMER_IntClear( LETIMER0, LETIMER_IFC_COMP1 );
+        LETIMER_CompareSet( LETIMER0, 1, periodEnd - 1 - timerQueue->deadline );
+        LETIMER_IntEnable( LETIMER0, LETIMER_IEN_COMP1 );
+
+        // If the counter passed the compare value while we were loading
+        // it, the interrupt will not fire, so go around again
+        if( !isExpired( timerQueue->deadline, timerGetTicks() ) )
+        {
+            return;
+        }
+    }
+}
+
+//! swTimerInit()
+//! @brief Reset the software timer queue. Called from timerInit()
+//!
+//! @param void
+//! @returns void
+void swTimerInit()
+{
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_CRITICAL();
+    timerQueue = NULL;
+    LETIMER_IntDisable( LETIMER0, LETIMER_IEN_COMP1 );
+    LETIMER_IntClear( LETIMER0, LETIMER_IFC_COMP1 );
+    CORE_EXIT_CRITICAL();
+    return;
+}
+
+//! swTimerStart()
+//! @brief (Re)start a software timer. If the timer is already active
+//! it is first removed from the queue. The first expiration is at least
+//! delayUs away: the delay is rounded up to whole ticks, plus one tick
+//! because the current tick is already partly over. The period is
+//! rounded to the nearest tick since it counts from the previous deadline
+//!
+//! @param timer caller owned descriptor
+//! @param delayUs time until first expiration in microseconds
+//! @param periodUs reload period in microseconds, 0 for one-shot
+//! @param callback function called from interrupt context on expiration
+//! @param arg argument passed to callback
+//! @returns void
+void swTimerStart( swTimer_s *timer, uint32_t delayUs, uint32_t periodUs,
+    swTimerCallback_f callback, void *arg )
+{
+    uint32_t periodTicks = timerUsToTicks( periodUs );
+    if( ( periodUs != 0 ) && ( periodTicks == 0 ) )
+    {
+        periodTicks = 1;
+    }
+    uint32_t delayTicks = timerUsToTicksCeil( delayUs );
+    if( delayTicks < UINT32_MAX )
+    {
+        delayTicks++;
+    }
+    swTimerStartTicks( timer, delayTicks, periodTicks, callback, arg );
+    return;
+}
+
+//! swTimerStartTicks()
+//! @brief (Re)start a software timer with delay and period given in
+//! LETIMER0 ticks. Used for delays too long to express in microseconds.
+//! The delay counts from the current tick, which is already partly over,
+//! so the first expiration comes up to one tick early
+//!
+//! @param timer caller owned descriptor
+//! @param delayTicks time until first expiration in ticks
+//! @param periodTicks reload period in ticks, 0 for one-shot
+//! @param callback function called from interrupt context on expiration
+//! @param arg argument passed to callback
+//! @returns void
+void swTimerStartTicks( swTimer_s *timer, uint32_t delayTicks, uint32_t periodTicks,
+    swTimerCallback_f callback, void *arg )
+{
+    if( delayTicks == 0 )
+    {
+        // Shortest wait we can support is one tick
+        delayTicks = 1;
+    }
+    else if( delayTicks > SWTIMER_MAX_TICKS )
+    {
+        // Deadlines are compared with wraparound-safe arithmetic,
+        // so they must be less than half the tick range away
+        delayTicks = SWTIMER_MAX_TICKS;
+        LOG_WARN( "Requested delay is longer than what is supported. Capped delay to %lu ticks", delayTicks );
+    }
+    if( periodTicks > SWTIMER_MAX_TICKS )
+    {
+        periodTicks = SWTIMER_MAX_TICKS;
+        LOG_WARN( "Requested period is longer than what is supported. Capped period to %lu ticks", periodTicks );
+    }
+
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_CRITICAL();
+    if( timer->active )
+    {
+        swTimerRemove( timer );
+    }
+    timer->callback = callback;
+    timer->arg = arg;
+    timer->periodTicks = periodTicks;
+    timer->deadline = timerGetTicks() + delayTicks;
+    swTimerInsert( timer );
+    swTimerSchedule();
+    CORE_EXIT_CRITICAL();
+    return;
+}
+
+//! swTimerSetPeriod()
+//! @brief Change the period of an active periodic timer. The next
+//! expiration is moved to one new period after the previous expiration,
+//! or happens immediately if that time has already passed, so no
+//! expiration is skipped by the change
+//!
+//! @param timer
+//! @param periodTicks new reload period in ticks, must not be 0
+//! @returns void
+void swTimerSetPeriod( swTimer_s *timer, uint32_t periodTicks )
+{
+    if( ( periodTicks == 0 ) || ( periodTicks > SWTIMER_MAX_TICKS ) )
+    {
+        LOG_WARN( "Invalid software timer period %lu ticks", periodTicks );
+        return;
+    }
+
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_CRITICAL();
+    if( timer->active && ( timer->periodTicks != 0 ) )
+    {
+        uint32_t lastExpiration = timer->deadline - timer->periodTicks;
+        swTimerRemove( timer );
+        timer->periodTicks = periodTicks;
+        timer->deadline = lastExpiration + periodTicks;
+        swTimerInsert( timer );
+        swTimerSchedule();
+    }
+    CORE_EXIT_CRITICAL();
+    return;
+}
+
+//! swTimerStop()
+//! @brief Stop a software timer. Safe to call on an inactive timer
+//!
+//! @param timer
+//! @returns void
+void swTimerStop( swTimer_s *timer )
+{
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_CRITICAL();
+    if( timer->active )
+    {
+        swTimerRemove( timer );
+        swTimerSchedule();
+    }
+    CORE_EXIT_CRITICAL();
+    return;
+}
+
+//! swTimerIsActive()
+//! @brief Returns whether timer is queued
+//!
+//! @param timer
+//! @returns true if timer has not yet expired or is periodic
+bool swTimerIsActive( const swTimer_s *timer )
+{
+    return timer->active;
+}
+
+//! swTimerIrqHandler()
+//! @brief Called from LETIMER0_IRQHandler() on COMP1 and UF interrupts
+//! to expire timers and reprogram COMP1
+//!
+//! @param void
+//! @returns void
+void swTimerIrqHandler()
+{
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_CRITICAL();
+    swTimerSchedule();
+    CORE_EXIT_CRITICAL();
+    return;
+}
@@ -0,0 +1,58 @@
+//!
+//! @file swtimers.h
+//! @brief Software timer service multiplexed on LETIMER0 COMP1
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources Utilized Silicon Labs' EMLIB peripheral libraries to implement functionality
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#ifndef __SWTIMERS_H___
+#define __SWTIMERS_H___
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//! Callback executed when a software timer expires.
+//! Always called from interrupt context
+typedef void ( *swTimerCallback_f )( void *arg );
+
+//! Software timer descriptor. Owned by the caller and must exist for as
+//! long as the timer is active
+typedef struct swTimer_s
+{
+    struct swTimer_s *next;         //! Next timer in the queue, sorted by deadline
+    uint32_t deadline;              //! Absolute expiration time in LETIMER0 ticks
+    uint32_t periodTicks;           //! Reload period in ticks, 0 for one-shot timers
+    swTimerCallback_f callback;     //! Function called on expiration
+    void *arg;                      //! Argument passed to callback
+    bool active;                    //! True while timer is in the queue
+} swTimer_s;
+
+void swTimerInit();
+
+void swTimerStart( swTimer_s *timer, uint32_t delayUs, uint32_t periodUs,
+    swTimerCallback_f callback, void *arg );
+
+void swTimerStartTicks( swTimer_s *timer, uint32_t delayTicks, uint32_t periodTicks,
+    swTimerCallback_f callback, void *arg );
+
+void swTimerSetPeriod( swTimer_s *timer, uint32_t periodTicks );
+
+void swTimerStop( swTimer_s *timer );
+
+bool swTimerIsActive( const swTimer_s *timer );
+
+void swTimerIrqHandler();
+
+#endif // __SWTIMERS_H___
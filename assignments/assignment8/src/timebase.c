@@ -0,0 +1,127 @@
+//!
+//! @file timebase.c
+//! @brief Implements a monotonic 64-bit timebase by extending the 32-bit
+//! RTCC counter (started in initMcu()) in software. The RTCC is owned by
+//! the BT stack, so no RTCC interrupt is used here: the upper 32 bits
+//! are advanced whenever a read observes that the counter wrapped. The
+//! LETIMER0 underflow handler reads the timebase every period, which is
+//! far more often than the RTCC wraps (~36 hours at 32768 Hz)
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources Utilized Silicon Labs' EMLIB peripheral libraries to implement functionality @n
+//!            em_rtcc.h - for RTCC_CounterGet() @n
+//!            em_cmu.h - for RTCC clock frequency
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#include "timebase.h"
+
+#include "main.h"
+
+#include "em_core.h"
+#include "em_cmu.h"
+#include "em_rtcc.h"
+
+//! RTCC counter frequency in Hz
+static uint32_t rtccFrequencyHz = 1;
+
+//! Upper 32 bits of the extended counter
+static uint32_t rtccHigh = 0;
+
+//! Last RTCC counter value observed, used to detect wraps
+static uint32_t rtccLast = 0;
+
+//! timebaseInit()
+//! @brief Cache the RTCC counter frequency. RTCC itself is initialized
+//! and enabled in initMcu()
+//!
+//! @param void
+//! @returns void
+void timebaseInit()
+{
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_CRITICAL();
+    rtccFrequencyHz = CMU_ClockFreqGet( cmuClock_RTCC );
+    if( rtccFrequencyHz == 0 )
+    {
+        rtccFrequencyHz = 1;
+    }
+    rtccLast = RTCC_CounterGet();
+    CORE_EXIT_CRITICAL();
+    return;
+}
+
+//! timebaseGetFrequencyHz()
+//! @brief Returns the frequency of the timebase ticks
+//!
+//! @param void
+//! @returns ticks per second
+uint32_t timebaseGetFrequencyHz()
+{
+    return rtccFrequencyHz;
+}
+
+//! timeNowTicks()
+//! @brief Returns the 64-bit RTCC tick count. Safe to call from interrupt
+//! context and must be called at least once per RTCC wrap
+//!
+//! @param void
+//! @returns monotonic time in RTCC ticks
+uint64_t timeNowTicks()
+{
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_CRITICAL();
+    uint32_t count = RTCC_CounterGet();
+    if( count < rtccLast )
+    {
+        rtccHigh++;
+    }
+    rtccLast = count;
+    uint64_t ticks = ( ( uint64_t ) rtccHigh << 32 ) | count;
+    CORE_EXIT_CRITICAL();
+    return ticks;
+}
+
+//! timeTicksToUs()
+//! @brief Converts RTCC ticks to microseconds using integer math only.
+//! Whole seconds and the remainder are converted separately so the
+//! multiplication cannot overflow
+//!
+//! @param ticks
+//! @returns microseconds
+uint64_t timeTicksToUs( uint64_t ticks )
+{
+    uint64_t seconds = ticks / rtccFrequencyHz;
+    uint32_t remainder = ( uint32_t ) ( ticks - ( seconds * rtccFrequencyHz ) );
+    return ( seconds * USEC_PER_SEC ) + ( ( ( uint64_t ) remainder * USEC_PER_SEC ) / rtccFrequencyHz );
+}
+
+//! timeNowUs()
+//! @brief Returns monotonic time since reset in microseconds
+//!
+//! @param void
+//! @returns microseconds
+uint64_t timeNowUs()
+{
+    return timeTicksToUs( timeNowTicks() );
+}
+
+//! timeNowMs()
+//! @brief Returns monotonic time since reset in milliseconds
+//!
+//! @param void
+//! @returns milliseconds
+uint64_t timeNowMs()
+{
+    return timeNowUs() / USEC_PER_MSEC;
+}
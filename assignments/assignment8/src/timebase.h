@@ -0,0 +1,37 @@
+//!
+//! @file timebase.h
+//! @brief Monotonic 64-bit timebase built on the RTCC
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources Utilized Silicon Labs' EMLIB peripheral libraries to implement functionality
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#ifndef __TIMEBASE_H___
+#define __TIMEBASE_H___
+
+#include <stdint.h>
+
+void timebaseInit();
+
+uint32_t timebaseGetFrequencyHz();
+
+uint64_t timeNowTicks();
+
+uint64_t timeNowUs();
+
+uint64_t timeNowMs();
+
+uint64_t timeTicksToUs( uint64_t ticks );
+
+#endif // __TIMEBASE_H___
@@ -21,9 +21,12 @@
 
 #include "log.h"
 #include "main.h"
+#include "scheduler.h"
+#include "swtimers.h"
+#include "timebase.h"
+#include "conversions.h"
 
 #include "stdint.h"
-#include "math.h"
 
 #include "em_core.h"
 
@@ -33,18 +36,29 @@
 //! Globally accessible clock frequency in Hz (initialized in oscillatorsInit()
 extern uint32_t clockFrequencyHz;
 
-//! Coarse Runtime in milliseconds, i.e. increments by 1000 ms on each underflow interrupt
-static uint32_t coarseRuntimeMs;
-
-//! Fine Runtime in milliseconds, i.e. time into the current execution period
-static uint32_t fineRuntimeMs;
-
 //! Number of times that the underflow interrupt has occurred
 static uint32_t underflows;
 
 //! LETIMER0 ticks corresponding to our defined TIMER_PERIOD_MS
 static uint16_t periodTicks;
 
+//! LETIMER0 tick frequency in Hz after prescaling
+static uint32_t tickFrequencyHz;
+
+//! LETIMER0 ticks per microsecond as an unsigned Q32 fixed-point value,
+//! precomputed in timerInit() so conversions need no division
+static uint64_t ticksPerUsQ32;
+
+//! Same rate rounded up, so that conversions for minimum waits never
+//! come out short
+static uint64_t ticksPerUsQ32Ceil;
+
+//! Number of fractional bits in @ref ticksPerUsQ32
+#define TICKS_PER_US_FRAC_BITS  ( 32 )
+
+//! Software timer used by timerWaitUs()
+static swTimer_s waitTimer;
+
 //! Data structure used to initialized LETIMER0 using LETIMER_Init
 static const LETIMER_Init_TypeDef timerConfiguration =
 {
@@ -68,30 +82,33 @@ static const LETIMER_Init_TypeDef timerConfiguration =
 //! @returns void
 static void calculateAndLoadCompValues()
 {
-    double ticks = 0;
+    uint32_t ticks = 0;
     periodTicks = 0;
 
     ticks = ( clockFrequencyHz * TIMER_PERIOD_MS ) / MSEC_PER_SEC;
 
     if( ticks > UINT16_MAX )
     {
-        int i = 0;
-        int prescaler = 0;
-        i = ticks / UINT16_MAX;
-        prescaler = pow( 2, i );
+        uint32_t i = 0;
+        uint32_t prescaler = 0;
+        i = letimerPrescalerShift( ticks );
+        prescaler = ( uint32_t ) 1 << i;
 
-        periodTicks = ticks / prescaler;
+        periodTicks = ticks >> i;
+        tickFrequencyHz = clockFrequencyHz >> i;
 
         CMU_ClockDivSet( cmuClock_LETIMER0, prescaler );
     }
     else if( ticks <= UINT16_MAX )
     {
         periodTicks = ( uint16_t ) ticks;
+        tickFrequencyHz = clockFrequencyHz;
     }
 
-    //! COMP0 is set to the number of ticks
-    //! corresponding to TIMER_PERIOD_MS
-    LETIMER_CompareSet( LETIMER0, 0, periodTicks );
+    //! COMP0 is set to one less than the number of ticks
+    //! corresponding to TIMER_PERIOD_MS, since the counter is reloaded
+    //! on the tick after it reaches 0 and so counts COMP0 + 1 ticks
+    LETIMER_CompareSet( LETIMER0, 0, periodTicks - 1 );
     return;
 }
 
@@ -113,87 +130,149 @@ void timerInit()
 
     calculateAndLoadCompValues();
 
-    coarseRuntimeMs = 0;
-    fineRuntimeMs = 0;
+    // Round to nearest so that conversions are accurate to within one tick
+    ticksPerUsQ32 = ( ( ( uint64_t ) tickFrequencyHz << TICKS_PER_US_FRAC_BITS ) + ( USEC_PER_SEC / 2 ) )
+        / USEC_PER_SEC;
+    ticksPerUsQ32Ceil = ( ( ( uint64_t ) tickFrequencyHz << TICKS_PER_US_FRAC_BITS ) + ( USEC_PER_SEC - 1 ) )
+        / USEC_PER_SEC;
+
     underflows = 0;
+    swTimerInit();
     // Enable LETIMER0 UF Interrupts
     LETIMER_IntEnable( LETIMER0, LETIMER_IEN_UF );
     LOG_DEBUG( "exiting" );
     return;
 }
 
+//! timerWaitDone()
+//! @brief Software timer callback for timerWaitUs(). Signals the
+//! scheduler that the requested wait has elapsed
+//!
+//! @param arg unused
+//! @returns void
+static void timerWaitDone( void *arg )
+{
+    ( void ) arg;
+    schedulerSetEventTimerDone();
+    return;
+}
+
 //! timerWaitUs()
-//! @brief Blocks execution for the requested number of microseconds.
-//! Performs range checking to handle underflow cases or if
-//! the timer cannot support the requested wait time.
+//! @brief Starts a non-blocking wait for the requested number of microseconds.
+//! EVENT_LETIMER0_COMP1 is signalled to the scheduler once the time has passed.
+//! Restarting the wait before it expires replaces the previous deadline.
+//! The wait lasts at least waitUs and at most one LETIMER0 tick more than
+//! that rounded up. Waits longer than one period are carried across
+//! underflows by the software timer service
 //!
 //! @param waitUs Wait time in microseconds
 //! @returns
 void timerWaitUs( uint32_t waitUs )
 {
-    // Disable interrupts while we calculate COMP1 value
-    CORE_ATOMIC_IRQ_DISABLE();
-    uint32_t startTicks = LETIMER_CounterGet( LETIMER0 );
+    swTimerStart( &waitTimer, waitUs, 0, timerWaitDone, NULL );
+    return;
+}
 
-    if( waitUs > ( TIMER_PERIOD_MS * USEC_PER_MSEC ) )
-    {
-        // cap the wait time to maximum time timer can wait
-        // which is the value we loaded into the COMP0 register
-        // which is the period in ticks
-        waitUs = TIMER_PERIOD_MS * USEC_PER_MSEC;
-        LOG_WARN( "Requested wait time is longer than what is supported. Capped wait time to %lu usecs", waitUs );
-    }
-    uint16_t waitMs = waitUs / USEC_PER_MSEC;
-    uint16_t waitTicks = ( clockFrequencyHz * waitMs ) / MSEC_PER_SEC;
-    double stopTicks = 0;
+//! timerCancelWait()
+//! @brief Cancel the wait started by timerWaitUs(), if any, so that it
+//! does not signal EVENT_LETIMER0_COMP1
+//!
+//! @param void
+//! @returns void
+void timerCancelWait()
+{
+    swTimerStop( &waitTimer );
+    return;
+}
 
-    if( startTicks > waitTicks )
-    {
-        stopTicks = startTicks - waitTicks;
-    }
-    else
-    {
-        stopTicks = periodTicks - ( waitTicks - startTicks );
-    }
+//! timerUsToTicks()
+//! @brief Converts microseconds to LETIMER0 ticks using the precomputed
+//! fixed-point rate, rounding to the nearest tick
+//!
+//! @param us
+//! @returns number of ticks
+uint32_t timerUsToTicks( uint32_t us )
+{
+    return ( uint32_t ) ( ( ( uint64_t ) us * ticksPerUsQ32 + ( ( uint64_t ) 1 << ( TICKS_PER_US_FRAC_BITS - 1 ) ) )
+        >> TICKS_PER_US_FRAC_BITS );
+}
 
-    // Clear any pending COMP1 interrupt, load stopTicks into COMP1 register
-    // and enable the COMP1 interrupt
-    LETIMER_IntClear( LETIMER0, LETIMER_IFC_COMP1 );
-    LETIMER_CompareSet( LETIMER0, 1, ( uint16_t ) stopTicks );
-    LETIMER_IntEnable( LETIMER0, LETIMER_IEN_COMP1 );
+//! timerUsToTicksCeil()
+//! @brief Converts microseconds to LETIMER0 ticks using the precomputed
+//! fixed-point rate, rounding up. Used for minimum waits
+//!
+//! @param us
+//! @returns number of ticks
+uint32_t timerUsToTicksCeil( uint32_t us )
+{
+    return ( uint32_t ) ( ( ( uint64_t ) us * ticksPerUsQ32Ceil + ( ( ( uint64_t ) 1 << TICKS_PER_US_FRAC_BITS ) - 1 ) )
+        >> TICKS_PER_US_FRAC_BITS );
+}
 
-    // Re-enable interrupts now that we have loaded the COMP1 value
-    // and enabled the COMP1 interrupt
-    CORE_ATOMIC_IRQ_ENABLE();
-    return;
+//! timerMsToTicks()
+//! @brief Converts milliseconds to LETIMER0 ticks using the precomputed
+//! fixed-point rate, rounding to the nearest tick. Saturates at UINT32_MAX
+//!
+//! @param ms
+//! @returns number of ticks
+uint32_t timerMsToTicks( uint32_t ms )
+{
+    uint64_t ticks = ( ( uint64_t ) ms * USEC_PER_MSEC * ticksPerUsQ32 + ( ( uint64_t ) 1 << ( TICKS_PER_US_FRAC_BITS - 1 ) ) )
+        >> TICKS_PER_US_FRAC_BITS;
+    return ( ticks > UINT32_MAX ) ? UINT32_MAX : ( uint32_t ) ticks;
 }
 
-//! timerGetRunTimeMilliseconds()
-//! @brief Returns current runtime in milliseconds using LETIMER0 as a
-//! reference for the time returned
+//! timerGetPeriodTicks()
+//! @brief Returns the number of LETIMER0 ticks in one period
 //!
 //! @param void
-//! @returns uint32_t runtime in milliseconds
-uint32_t timerGetRunTimeMilliseconds()
+//! @returns period in ticks
+uint32_t timerGetPeriodTicks()
 {
-    uint32_t currentTicks = LETIMER_CounterGet( LETIMER0 );
+    return periodTicks;
+}
+
+//! timerGetPeriodStartTicks()
+//! @brief Returns the absolute tick count at the start of the current
+//! LETIMER0 period, i.e. at the last underflow
+//!
+//! @param void
+//! @returns ticks at start of period
+uint32_t timerGetPeriodStartTicks()
+{
+    return underflows * periodTicks;
+}
 
-    if( currentTicks != 0 )
+//! timerGetTicks()
+//! @brief Returns the number of LETIMER0 ticks since timerInit(). Accounts
+//! for an underflow that has happened but has not yet been serviced
+//!
+//! @param void
+//! @returns absolute time in ticks
+uint32_t timerGetTicks()
+{
+    CORE_DECLARE_IRQ_STATE;
+    CORE_ENTER_CRITICAL();
+    uint32_t currentTicks = LETIMER_CounterGet( LETIMER0 );
+    uint32_t start = underflows * periodTicks;
+    if( ( LETIMER_IntGet( LETIMER0 ) & LETIMER_IF_UF ) && ( currentTicks > ( periodTicks / 2 ) ) )
     {
-        fineRuntimeMs = periodTicks - currentTicks;
+        // Counter wrapped but underflow interrupt has not run yet
+        start += periodTicks;
     }
-
-    return (coarseRuntimeMs + fineRuntimeMs);
+    CORE_EXIT_CRITICAL();
+    return start + ( periodTicks - 1 - currentTicks );
 }
 
 //! timerUnderflowHandler()
-//! @brief Handle the change to runtime when underflow occurs
+//! @brief Handle the change to runtime when underflow occurs. Also
+//! samples the RTCC timebase so its software extension sees every wrap
 //!
 //! @param void
 //! @returns void
 void timerUnderflowHandler()
 {
     underflows++;
-    coarseRuntimeMs = underflows * TIMER_PERIOD_MS;
+    timeNowTicks();
 }
 
@@ -26,7 +26,19 @@ void timerInit();
 
 void timerWaitUs( uint32_t waitUs );
 
-uint32_t timerGetRunTimeMilliseconds();
+void timerCancelWait();
+
+uint32_t timerUsToTicks( uint32_t us );
+
+uint32_t timerUsToTicksCeil( uint32_t us );
+
+uint32_t timerMsToTicks( uint32_t ms );
+
+uint32_t timerGetPeriodTicks();
+
+uint32_t timerGetPeriodStartTicks();
+
+uint32_t timerGetTicks();
 
 void timerUnderflowHandler();
 
@@ -0,0 +1,201 @@
+//!
+//! @file txpower.c
+//! @brief Implements closed loop TX power control. Setting the power
+//! halts the Bluetooth stack, so the radio is only touched when the
+//! level needed by the links changes, and at most once per
+//! TX_POWER_MIN_CHANGE_MS
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources Silicon Labs Bluetooth API reference (UG136) for
+//! gecko_cmd_system_set_tx_power and gecko_cmd_system_halt
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#include "txpower.h"
+
+#include "log.h"
+#include "timebase.h"
+#include "native_gecko.h"
+#include "gecko_ble_errors.h"
+
+//! Number of power levels
+#define TX_POWER_NUMBER_OF_LEVELS   ( 7 )
+
+//! TX power of each level in steps of 0.1 dBm, weakest first
+static const int16_t LEVEL_POWER[ TX_POWER_NUMBER_OF_LEVELS ] =
+{
+    MIN_TX_POWER,   // RSSI above -35 dBm
+    -200,           // -20 dBm, RSSI above -45 dBm
+    -150,           // -15 dBm, RSSI above -55 dBm
+    -50,            // -5 dBm, RSSI above -65 dBm
+    0,              // 0 dBm, RSSI above -75 dBm
+    50,             // 5 dBm, RSSI above -85 dBm
+    MAX_TX_POWER    // RSSI at or below -85 dBm
+};
+
+//! Lowest RSSI in dBm of each level but the last
+static const int16_t LEVEL_MIN_RSSI[ TX_POWER_NUMBER_OF_LEVELS - 1 ] = { -35, -45, -55, -65, -75, -85 };
+
+//! Level of DEFAULT_TX_POWER
+static const uint8_t DEFAULT_LEVEL = 4;
+
+static txPowerStats_s stats;
+static int16_t radioPower = DEFAULT_TX_POWER;
+static uint64_t lastChangeMs = 0;
+
+//! getLevel()
+//! @brief Returns the power level for an RSSI, from the step table
+//!
+//! @param rssiQ4 RSSI in units of 1/16 dBm
+//! @returns level
+static uint8_t getLevel( int32_t rssiQ4 )
+{
+    uint8_t level = 0;
+    while( ( level < ( TX_POWER_NUMBER_OF_LEVELS - 1 ) ) && ( rssiQ4 <= ( LEVEL_MIN_RSSI[ level ] * 16 ) ) )
+    {
+        level++;
+    }
+    return level;
+}
+
+//! setRadioPower()
+//! @brief Set the TX power for bluetooth in a safe way while @n
+//! connection is open by: halting the system, calling BT API @n
+//! to set the TX power, and resuming system operation
+//!
+//! @param power
+//! @returns void
+static void setRadioPower( int16_t power )
+{
+    BTSTACK_CHECK_RESPONSE( gecko_cmd_system_halt( 1 ) );
+    // Set power
+    struct gecko_msg_system_set_tx_power_rsp_t *rsp;
+    rsp = gecko_cmd_system_set_tx_power( power );
+    if( rsp->set_power != power )
+    {
+        LOG_WARN( "SET TX POWER: %d (0.1 dBm) : REQUESTED TX POWER: %d (0.1 dBm)",
+            rsp->set_power, power );
+    }
+    BTSTACK_CHECK_RESPONSE( gecko_cmd_system_halt( 0 ) );
+
+    radioPower = power;
+    lastChangeMs = timeNowMs();
+    stats.changes++;
+    LOG_INFO( "TX POWER: %d (0.1 dBm) : %lu RSSI updates : %lu changes : %lu halts avoided : %lu rate limited",
+        power, stats.updates, stats.changes, stats.haltsAvoided, stats.rateLimited );
+    return;
+}
+
+//! txPowerLinkReset()
+//! @brief Forget the RSSI history of a link, e.g. when it opens
+//!
+//! @param link
+//! @returns void
+void txPowerLinkReset( txPowerLink_s *link )
+{
+    *link = ( txPowerLink_s ) { .valid = false, .rssiQ4 = 0, .level = DEFAULT_LEVEL };
+    return;
+}
+
+//! txPowerLinkUpdate()
+//! @brief Filter a new RSSI reading of a link and return the power level
+//! the link needs. The level moves only once the filtered RSSI is
+//! TX_POWER_HYSTERESIS_DB past the boundary of the current level
+//!
+//! @param link
+//! @param rssi reading in dBm
+//! @returns power level of the link
+uint8_t txPowerLinkUpdate( txPowerLink_s *link, int8_t rssi )
+{
+    int32_t sampleQ4 = ( int32_t ) rssi * 16;
+    if( !link->valid )
+    {
+        link->rssiQ4 = ( int16_t ) sampleQ4;
+        link->level = getLevel( sampleQ4 );
+        link->valid = true;
+        return link->level;
+    }
+
+    // Exponentially weighted moving average
+    link->rssiQ4 += ( int16_t ) ( ( sampleQ4 - link->rssiQ4 ) / ( 1 << TX_POWER_RSSI_SHIFT ) );
+
+    // Judge a rise in power against a stronger RSSI and a drop against a
+    // weaker one, so that readings near a boundary keep the current level
+    int32_t marginQ4 = TX_POWER_HYSTERESIS_DB * 16;
+    uint8_t raise = getLevel( link->rssiQ4 + marginQ4 );
+    uint8_t lower = getLevel( link->rssiQ4 - marginQ4 );
+    if( raise > link->level )
+    {
+        link->level = raise;
+    }
+    else if( lower < link->level )
+    {
+        link->level = lower;
+    }
+    return link->level;
+}
+
+//! txPowerApply()
+//! @brief Set the radio to the power of a level, if it differs from the
+//! current power and the last change is at least TX_POWER_MIN_CHANGE_MS
+//! old. Called once per RSSI reading with the highest level among the
+//! links
+//!
+//! @param level
+//! @returns void
+void txPowerApply( uint8_t level )
+{
+    stats.updates++;
+    if( level >= TX_POWER_NUMBER_OF_LEVELS )
+    {
+        level = TX_POWER_NUMBER_OF_LEVELS - 1;
+    }
+    if( LEVEL_POWER[ level ] == radioPower )
+    {
+        stats.haltsAvoided++;
+        return;
+    }
+    if( ( stats.changes > 0 ) && ( ( timeNowMs() - lastChangeMs ) < TX_POWER_MIN_CHANGE_MS ) )
+    {
+        stats.haltsAvoided++;
+        stats.rateLimited++;
+        return;
+    }
+    setRadioPower( LEVEL_POWER[ level ] );
+    return;
+}
+
+//! txPowerReset()
+//! @brief Return the radio to the default power once no link is open,
+//! without rate limiting
+//!
+//! @param void
+//! @returns void
+void txPowerReset()
+{
+    if( radioPower != DEFAULT_TX_POWER )
+    {
+        setRadioPower( DEFAULT_TX_POWER );
+    }
+    return;
+}
+
+//! txPowerGetStats()
+//! @brief Returns the counters of the power control loop
+//!
+//! @param void
+//! @returns pointer to the counters
+const txPowerStats_s *txPowerGetStats()
+{
+    return &stats;
+}
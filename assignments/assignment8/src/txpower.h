@@ -0,0 +1,70 @@
+//!
+//! @file txpower.h
+//! @brief Closed loop TX power control. The RSSI of each link is
+//! filtered, mapped to a power level with hysteresis, and the radio is
+//! set to the level the weakest link needs, no more often than a minimum
+//! period and only when the level changes
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources Silicon Labs Bluetooth API reference (UG136) for
+//! gecko_cmd_system_set_tx_power and gecko_cmd_system_halt
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#ifndef __TXPOWER_H___
+#define __TXPOWER_H___
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//! Maximum TX Power in steps of 0.1 dBm (10.5 dBm)
+static const int16_t MAX_TX_POWER = 105;
+//! Minimum TX Power in steps of 0.1 dBm (-30 dBm)
+static const int16_t MIN_TX_POWER = -300;
+//! TX power with no open connection, 0 dBm
+static const int16_t DEFAULT_TX_POWER = 0;
+
+//! Weight of a new RSSI reading in the filter, 1 / 2^TX_POWER_RSSI_SHIFT
+static const uint8_t TX_POWER_RSSI_SHIFT = 2;
+//! Margin in dB the filtered RSSI must cross past a level boundary
+//! before the level changes
+static const int16_t TX_POWER_HYSTERESIS_DB = 3;
+//! Shortest time between two changes of the radio power
+static const uint32_t TX_POWER_MIN_CHANGE_MS = 2000;
+
+//! Power control state of one link
+typedef struct {
+    bool valid;                 //! At least one RSSI reading was filtered
+    int16_t rssiQ4;             //! Filtered RSSI in units of 1/16 dBm
+    uint8_t level;              //! Power level chosen for the link
+} txPowerLink_s;
+
+//! Counters of the power control loop
+typedef struct {
+    uint32_t updates;           //! RSSI readings processed
+    uint32_t changes;           //! Times the radio power was set
+    uint32_t haltsAvoided;      //! Readings that left the radio alone
+    uint32_t rateLimited;       //! Changes deferred by TX_POWER_MIN_CHANGE_MS
+} txPowerStats_s;
+
+void txPowerLinkReset( txPowerLink_s *link );
+
+uint8_t txPowerLinkUpdate( txPowerLink_s *link, int8_t rssi );
+
+void txPowerApply( uint8_t level );
+
+void txPowerReset();
+
+const txPowerStats_s *txPowerGetStats();
+
+#endif // __TXPOWER_H___
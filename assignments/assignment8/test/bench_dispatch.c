@@ -0,0 +1,622 @@
+//!
+//! @file bench_dispatch.c
+//! @brief Host microbenchmark of the scheduler's dispatcher. Pushes
+//! millions of synthetic events through the transition table of
+//! scheduler.c and through the nested switch it replaced, written out for
+//! the same states, events and actions, and reports ns/event. Both run
+//! the same event stream and must end up in the same states and event
+//! counters. Code size is reported by make bench from the symbol sizes.
+//! The sensor, I2C, timers and the other modules behind the actions are
+//! stubbed, so only dispatch and the actions' own code are timed
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources None
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+// The transition table, the actions and the state are static
+#include "scheduler.c"
+
+#include "check.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//! Events in each synthetic stream
+#define STREAM_LENGTH   ( 1 << 22 )
+
+//! Timed passes over a stream, the fastest one is reported
+#define PASSES          ( 5 )
+
+//! Percentage of events in the mixed stream that are not the one the
+//! current state waits for: ticks while busy, stray timer and I2C events,
+//! I2C errors and lost connections
+#define NOISE_PERCENT   ( 20 )
+
+//! Measurement configurations the mixed stream is run in, so that every
+//! state is visited
+typedef struct
+{
+    const char *name;
+    si7021MeasurementMode_e mode;
+    si7021Acquisition_e acquisition;
+    uint8_t burstSize;
+} config_s;
+
+static const config_s CONFIGS[] =
+{
+    { "hold", SI7021_MODE_HOLD_MASTER, SI7021_ACQUIRE_TEMPERATURE, 1 },
+    { "no hold", SI7021_MODE_NO_HOLD_MASTER, SI7021_ACQUIRE_TEMPERATURE, 1 },
+    { "burst", SI7021_MODE_NO_HOLD_MASTER, SI7021_ACQUIRE_TEMPERATURE, 4 },
+    { "humidity", SI7021_MODE_HOLD_MASTER, SI7021_ACQUIRE_HUMIDITY_TEMPERATURE, 2 }
+};
+
+//! Event that moves a measurement along from each state
+static const schedulerEvents_e EXPECTED[ NUMBER_OF_STATES ] =
+{
+    [ STATE_SENSOR_OFF ]                = EVENT_MEASURE_TEMPERATURE,
+    [ STATE_WAIT_FOR_POWERUP ]          = EVENT_LETIMER0_COMP1,
+    [ STATE_WAIT_FOR_PROBE ]            = EVENT_I2C_TRANSACTION_DONE,
+    [ STATE_WAIT_FOR_I2C_CONFIG ]       = EVENT_I2C_TRANSACTION_DONE,
+    [ STATE_WAIT_FOR_I2C_WRITE ]        = EVENT_I2C_TRANSACTION_DONE,
+    [ STATE_WAIT_FOR_CONVERSION ]       = EVENT_LETIMER0_COMP1,
+    [ STATE_WAIT_FOR_I2C_READ ]         = EVENT_I2C_TRANSACTION_DONE,
+    [ STATE_WAIT_FOR_I2C_WRITE_READ ]   = EVENT_I2C_TRANSACTION_DONE,
+    [ STATE_WAIT_FOR_I2C_RH_TEMP ]      = EVENT_I2C_TRANSACTION_DONE,
+    [ STATE_WAIT_FOR_RETRY ]            = EVENT_LETIMER0_COMP1
+};
+
+static uint8_t stream[ STREAM_LENGTH ];
+static uint8_t tableStates[ STREAM_LENGTH ];
+static uint8_t switchStates[ STREAM_LENGTH ];
+
+static i2cData_s i2cData = { .temperatureMilliC = 21500 };
+
+//! Stack command and response buffers of the inline gecko_cmd_*()
+//! wrappers in native_gecko.h
+static struct gecko_cmd_packet commandBuffer;
+static struct gecko_cmd_packet responseBuffer;
+void *gecko_cmd_msg_buf = &commandBuffer;
+void *gecko_rsp_msg_buf = &responseBuffer;
+
+//! Firmware functions the actions call, doing nothing
+void sli_bt_cmd_handler_delegate( uint32_t header, gecko_cmd_handler handler, const void *payload )
+{
+    ( void ) header;
+    ( void ) handler;
+    ( void ) payload;
+    return;
+}
+
+void gpioSi7021Enable()
+{
+    return;
+}
+
+void gpioSi7021Disable()
+{
+    return;
+}
+
+void i2cInit()
+{
+    return;
+}
+
+void i2cDeinit()
+{
+    return;
+}
+
+void i2cClearEM1Time()
+{
+    return;
+}
+
+uint32_t i2cGetEM1TimeUs()
+{
+    return 1000;
+}
+
+I2C_TransferReturn_TypeDef i2cProbe()
+{
+    return i2cTransferInProgress;
+}
+
+I2C_TransferReturn_TypeDef i2cConfigureResolution()
+{
+    return i2cTransferInProgress;
+}
+
+I2C_TransferReturn_TypeDef i2cSendCommand( uint8_t cmd )
+{
+    ( void ) cmd;
+    return i2cTransferInProgress;
+}
+
+I2C_TransferReturn_TypeDef i2cReceiveData()
+{
+    return i2cTransferInProgress;
+}
+
+I2C_TransferReturn_TypeDef i2cMeasureTemperature()
+{
+    return i2cTransferInProgress;
+}
+
+I2C_TransferReturn_TypeDef i2cMeasureHumidity()
+{
+    return i2cTransferInProgress;
+}
+
+I2C_TransferReturn_TypeDef i2cReadPreviousTemperature()
+{
+    return i2cTransferInProgress;
+}
+
+bool i2cBusRecover()
+{
+    return true;
+}
+
+I2C_TransferReturn_TypeDef i2cGetTransferStatus()
+{
+    return i2cTransferNack;
+}
+
+uint32_t i2cGetConversionTimeUs( uint8_t cmd )
+{
+    ( void ) cmd;
+    return 10800;
+}
+
+i2cData_s *i2cGetDataBuffer()
+{
+    return &i2cData;
+}
+
+int32_t i2cGetHumidity()
+{
+    return 45000;
+}
+
+si7021Resolution_e i2cGetResolution()
+{
+    return SI7021_RESOLUTION_14_BIT;
+}
+
+bool i2cSetResolution( si7021Resolution_e resolution )
+{
+    ( void ) resolution;
+    return true;
+}
+
+uint32_t si7021PowerUpStart( int32_t temperatureMilliC )
+{
+    ( void ) temperatureMilliC;
+    return 80000;
+}
+
+void si7021PowerUpDone()
+{
+    return;
+}
+
+bool si7021PowerUpProbeNacked()
+{
+    return true;
+}
+
+si7021Resolution_e si7021ResolutionPolicy( si7021Resolution_e current, int32_t temperatureMilliC )
+{
+    ( void ) temperatureMilliC;
+    return current;
+}
+
+void timerWaitUs( uint32_t waitUs )
+{
+    ( void ) waitUs;
+    return;
+}
+
+void timerCancelWait()
+{
+    return;
+}
+
+uint64_t timeNowTicks()
+{
+    return 0;
+}
+
+uint64_t timeNowMs()
+{
+    return 0;
+}
+
+bool flashLogAppend( flashLogTag_e tag, uint64_t timestampMs, int32_t value )
+{
+    return true;
+}
+
+bool extFlashAppend( flashLogTag_e tag, uint64_t timestampMs, int32_t value )
+{
+    return true;
+}
+
+void batchAdd( uint64_t timestampMs, int32_t temperatureMilliC )
+{
+    return;
+}
+
+uint64_t timeTicksToUs( uint64_t ticks )
+{
+    return ticks;
+}
+
+uint32_t timerMsToTicks( uint32_t ms )
+{
+    return ms * 32;
+}
+
+void swTimerStartTicks( swTimer_s *timer, uint32_t delayTicks, uint32_t periodTicks,
+    swTimerCallback_f callback, void *arg )
+{
+    ( void ) timer;
+    ( void ) delayTicks;
+    ( void ) periodTicks;
+    ( void ) callback;
+    ( void ) arg;
+    return;
+}
+
+void swTimerSetPeriod( swTimer_s *timer, uint32_t periodTicks )
+{
+    ( void ) timer;
+    ( void ) periodTicks;
+    return;
+}
+
+bool isConnected()
+{
+    return true;
+}
+
+uint8_t bleSendToSubscribers( uint16_t characteristic, uint8_t length, const uint8_t *data )
+{
+    ( void ) characteristic;
+    ( void ) length;
+    ( void ) data;
+    return 1;
+}
+
+void displayPrintf( enum display_row row, const char *format, ... )
+{
+    ( void ) row;
+    ( void ) format;
+    return;
+}
+
+void gecko_external_signal( uint32 signals )
+{
+    ( void ) signals;
+    return;
+}
+
+//! Shorthands for switchDispatch(), the same as the table's
+#define GO( act, state ) \
+    nextState = ( state ); \
+    if( !act( event ) ) \
+    { \
+        nextState = currentState; \
+    } \
+    break
+#define IGNORE() \
+    eventStats[ event ].dropped++; \
+    nextState = currentState; \
+    break
+#define INVALID() \
+    eventStats[ event ].dropped++; \
+    nextState = STATE_SENSOR_OFF; \
+    actionInvalid( event ); \
+    break
+#define CONNECTION_LOST( state ) \
+    GO( actionConnectionLost, state )
+
+//! switchDispatch()
+//! @brief The dispatcher before the transition table: a switch on the
+//! state holding a switch on the event, one case per transition
+//!
+//! @param event
+//! @returns void
+__attribute__(( noinline )) static void switchDispatch( schedulerEvents_e event )
+{
+    switch( currentState )
+    {
+        case STATE_SENSOR_OFF:
+        {
+            switch( event )
+            {
+                case EVENT_IDLE:                    IGNORE();
+                case EVENT_MEASURE_TEMPERATURE:     GO( actionPowerUpSensor, STATE_WAIT_FOR_POWERUP );
+                case EVENT_BT_CONNECTION_LOST:      CONNECTION_LOST( STATE_SENSOR_OFF );
+                default:                            INVALID();
+            }
+            break;
+        }
+        case STATE_WAIT_FOR_POWERUP:
+        {
+            switch( event )
+            {
+                case EVENT_IDLE:
+                case EVENT_MEASURE_TEMPERATURE:     IGNORE();
+                case EVENT_LETIMER0_COMP1:          GO( actionProbeSensor, STATE_WAIT_FOR_PROBE );
+                case EVENT_BT_CONNECTION_LOST:      CONNECTION_LOST( STATE_WAIT_FOR_POWERUP );
+                default:                            INVALID();
+            }
+            break;
+        }
+        case STATE_WAIT_FOR_PROBE:
+        {
+            switch( event )
+            {
+                case EVENT_IDLE:
+                case EVENT_MEASURE_TEMPERATURE:     IGNORE();
+                case EVENT_I2C_TRANSACTION_DONE:    GO( actionSensorReady, STATE_WAIT_FOR_I2C_CONFIG );
+                case EVENT_I2C_TRANSACTION_ERROR:   GO( actionProbeError, STATE_WAIT_FOR_POWERUP );
+                case EVENT_BT_CONNECTION_LOST:      CONNECTION_LOST( STATE_WAIT_FOR_PROBE );
+                default:                            INVALID();
+            }
+            break;
+        }
+        case STATE_WAIT_FOR_I2C_CONFIG:
+        {
+            switch( event )
+            {
+                case EVENT_IDLE:
+                case EVENT_MEASURE_TEMPERATURE:     IGNORE();
+                case EVENT_I2C_TRANSACTION_DONE:    GO( actionSensorConfigured, STATE_WAIT_FOR_I2C_WRITE_READ );
+                case EVENT_I2C_TRANSACTION_ERROR:   GO( actionTransactionError, STATE_SENSOR_OFF );
+                case EVENT_BT_CONNECTION_LOST:      CONNECTION_LOST( STATE_WAIT_FOR_I2C_CONFIG );
+                default:                            INVALID();
+            }
+            break;
+        }
+        case STATE_WAIT_FOR_I2C_WRITE:
+        {
+            switch( event )
+            {
+                case EVENT_IDLE:
+                case EVENT_MEASURE_TEMPERATURE:     IGNORE();
+                case EVENT_I2C_TRANSACTION_DONE:    GO( actionWaitForConversion, STATE_WAIT_FOR_CONVERSION );
+                case EVENT_I2C_TRANSACTION_ERROR:   GO( actionTransactionError, STATE_SENSOR_OFF );
+                case EVENT_BT_CONNECTION_LOST:      CONNECTION_LOST( STATE_WAIT_FOR_I2C_WRITE );
+                default:                            INVALID();
+            }
+            break;
+        }
+        case STATE_WAIT_FOR_CONVERSION:
+        {
+            switch( event )
+            {
+                case EVENT_IDLE:
+                case EVENT_MEASURE_TEMPERATURE:     IGNORE();
+                case EVENT_LETIMER0_COMP1:          GO( actionReceiveData, STATE_WAIT_FOR_I2C_READ );
+                case EVENT_BT_CONNECTION_LOST:      CONNECTION_LOST( STATE_WAIT_FOR_CONVERSION );
+                default:                            INVALID();
+            }
+            break;
+        }
+        case STATE_WAIT_FOR_I2C_READ:
+        {
+            switch( event )
+            {
+                case EVENT_IDLE:
+                case EVENT_MEASURE_TEMPERATURE:     IGNORE();
+                case EVENT_I2C_TRANSACTION_DONE:    GO( actionConversionDone, STATE_SENSOR_OFF );
+                case EVENT_I2C_TRANSACTION_ERROR:   GO( actionReadError, STATE_WAIT_FOR_CONVERSION );
+                case EVENT_BT_CONNECTION_LOST:      CONNECTION_LOST( STATE_WAIT_FOR_I2C_READ );
+                default:                            INVALID();
+            }
+            break;
+        }
+        case STATE_WAIT_FOR_I2C_WRITE_READ:
+        {
+            switch( event )
+            {
+                case EVENT_IDLE:
+                case EVENT_MEASURE_TEMPERATURE:     IGNORE();
+                case EVENT_I2C_TRANSACTION_DONE:    GO( actionConversionDone, STATE_SENSOR_OFF );
+                case EVENT_I2C_TRANSACTION_ERROR:   GO( actionTransactionError, STATE_SENSOR_OFF );
+                case EVENT_BT_CONNECTION_LOST:      CONNECTION_LOST( STATE_WAIT_FOR_I2C_WRITE_READ );
+                default:                            INVALID();
+            }
+            break;
+        }
+        case STATE_WAIT_FOR_I2C_RH_TEMP:
+        {
+            switch( event )
+            {
+                case EVENT_IDLE:
+                case EVENT_MEASURE_TEMPERATURE:     IGNORE();
+                case EVENT_I2C_TRANSACTION_DONE:    GO( actionSampleDone, STATE_SENSOR_OFF );
+                case EVENT_I2C_TRANSACTION_ERROR:   GO( actionTransactionError, STATE_SENSOR_OFF );
+                case EVENT_BT_CONNECTION_LOST:      CONNECTION_LOST( STATE_WAIT_FOR_I2C_RH_TEMP );
+                default:                            INVALID();
+            }
+            break;
+        }
+        case STATE_WAIT_FOR_RETRY:
+        {
+            switch( event )
+            {
+                case EVENT_IDLE:
+                case EVENT_MEASURE_TEMPERATURE:     IGNORE();
+                case EVENT_LETIMER0_COMP1:          GO( actionRetryTransaction, STATE_SENSOR_OFF );
+                case EVENT_BT_CONNECTION_LOST:      CONNECTION_LOST( STATE_WAIT_FOR_RETRY );
+                default:                            INVALID();
+            }
+            break;
+        }
+        default:
+        {
+            break;
+        }
+    }
+
+    if( currentState != nextState )
+    {
+        LOG_INFO( "Transition [%s]-->[%s]",
+            getStateString( currentState ), getStateString( nextState ) );
+        currentState = nextState;
+    }
+    return;
+}
+
+#undef GO
+#undef IGNORE
+#undef INVALID
+#undef CONNECTION_LOST
+
+//! Configuration resetMachine() applies
+static const config_s *config = &CONFIGS[ 0 ];
+
+//! resetMachine()
+//! @brief Put the state machine and the state its actions keep back to
+//! how the firmware boots, measuring as set by config
+//!
+//! @param state to start in
+//! @returns void
+static void resetMachine( schedulerStates_e state )
+{
+    requestedMode = config->mode;
+    activeMode = config->mode;
+    requestedAcquisition = config->acquisition;
+    activeAcquisition = config->acquisition;
+    requestedBurstSize = config->burstSize;
+    activeBurstSize = config->burstSize;
+    currentState = state;
+    nextState = state;
+    memset( eventStats, 0, sizeof( eventStats ) );
+    nackRetries = 0;
+    transactionRetries = 0;
+    retryState = STATE_SENSOR_OFF;
+    burstCount = 0;
+    sensorPowered = false;
+    lastTemperatureMilliC = 25000;
+    energyReset( &sampleEnergy );
+    sampleRingInit( &temperatureHistory, temperatureHistoryBlocks, SCHEDULER_TEMPERATURE_HISTORY_BLOCKS,
+        SAMPLE_RING_OVERWRITE_OLDEST );
+    sampleRingInit( &humidityHistory, humidityHistoryBlocks, SCHEDULER_HUMIDITY_HISTORY_BLOCKS,
+        SAMPLE_RING_OVERWRITE_OLDEST );
+    return;
+}
+
+//! makeMixedStream()
+//! @brief Fill stream with measurements as the firmware sees them: mostly
+//! the event each state waits for, with NOISE_PERCENT of random events
+//!
+//! @returns void
+static void makeMixedStream()
+{
+    srand( 5823 );
+    resetMachine( STATE_SENSOR_OFF );
+    for( uint32_t i = 0; i < STREAM_LENGTH; i++ )
+    {
+        schedulerEvents_e event = EXPECTED[ currentState ];
+        if( ( rand() % 100 ) < NOISE_PERCENT )
+        {
+            event = ( schedulerEvents_e ) ( rand() % NUMBER_OF_EVENTS );
+        }
+        stream[ i ] = event;
+        schedulerDispatch( event );
+    }
+    return;
+}
+
+//! makeIgnoredStream()
+//! @brief Fill stream with events a busy state ignores, so no action runs
+//!
+//! @returns void
+static void makeIgnoredStream()
+{
+    for( uint32_t i = 0; i < STREAM_LENGTH; i++ )
+    {
+        stream[ i ] = ( i % 2 ) ? EVENT_IDLE : EVENT_MEASURE_TEMPERATURE;
+    }
+    return;
+}
+
+//! run()
+//! @brief Dispatch the stream PASSES times from the given state
+//!
+//! @param dispatch
+//! @param state
+//! @param states set to the state after each event of the first pass
+//! @returns fastest pass in ns/event
+static double run( void ( *dispatch )( schedulerEvents_e event ), schedulerStates_e state, uint8_t *states )
+{
+    double best = 0;
+    for( uint8_t pass = 0; pass < PASSES; pass++ )
+    {
+        resetMachine( state );
+        struct timespec start;
+        struct timespec end;
+        clock_gettime( CLOCK_MONOTONIC, &start );
+        for( uint32_t i = 0; i < STREAM_LENGTH; i++ )
+        {
+            dispatch( ( schedulerEvents_e ) stream[ i ] );
+            states[ i ] = ( uint8_t ) currentState;
+        }
+        clock_gettime( CLOCK_MONOTONIC, &end );
+        double ns = ( ( end.tv_sec - start.tv_sec ) * 1e9 + ( end.tv_nsec - start.tv_nsec ) ) / STREAM_LENGTH;
+        best = ( ( pass == 0 ) || ( ns < best ) ) ? ns : best;
+    }
+    return best;
+}
+
+//! compare()
+//! @brief Time the table and the switch on the stream. Both must go
+//! through the same states and drop the same events
+//!
+//! @param name of the stream
+//! @param state to start in
+//! @returns void
+static void compare( const char *name, schedulerStates_e state )
+{
+    double switchNs = run( switchDispatch, state, switchStates );
+    schedulerEventStats_s switchStats[ NUMBER_OF_EVENTS ];
+    memcpy( switchStats, eventStats, sizeof( switchStats ) );
+    double tableNs = run( schedulerDispatch, state, tableStates );
+
+    CHECK( memcmp( switchStates, tableStates, sizeof( tableStates ) ) == 0 );
+    CHECK( memcmp( switchStats, eventStats, sizeof( switchStats ) ) == 0 );
+    printf( "%-8s %-9s %9u %9.2f %9.2f\n", name, config->name, STREAM_LENGTH, switchNs, tableNs );
+    return;
+}
+
+int main()
+{
+    printf( "%-8s %-9s %9s %9s %9s\n", "stream", "config", "events", "switch ns", "table ns" );
+    for( uint8_t i = 0; i < sizeof( CONFIGS ) / sizeof( CONFIGS[ 0 ] ); i++ )
+    {
+        config = &CONFIGS[ i ];
+        makeMixedStream();
+        compare( "mixed", STATE_SENSOR_OFF );
+    }
+    config = &CONFIGS[ 0 ];
+    makeIgnoredStream();
+    compare( "ignored", STATE_WAIT_FOR_CONVERSION );
+    return checkResult( "bench_dispatch" );
+}
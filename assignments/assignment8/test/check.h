@@ -0,0 +1,67 @@
+//!
+//! @file check.h
+//! @brief Minimal assertions for the host checks. A failed check prints
+//! where it failed and the run continues, main() returns checkResult()
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources None
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#ifndef __CHECK_H___
+#define __CHECK_H___
+
+#include <stdio.h>
+
+static unsigned checkFailures = 0;
+static unsigned checkCount = 0;
+
+//! Check that cond holds
+#define CHECK( cond ) \
+    do \
+    { \
+        checkCount++; \
+        if( !( cond ) ) \
+        { \
+            checkFailures++; \
+            printf( "%s:%d: CHECK( %s ) failed\n", __FILE__, __LINE__, #cond ); \
+        } \
+    } while( 0 )
+
+//! Check that two integers are equal, printing both if they are not
+#define CHECK_EQ( a, b ) \
+    do \
+    { \
+        long long checkA = ( long long ) ( a ); \
+        long long checkB = ( long long ) ( b ); \
+        checkCount++; \
+        if( checkA != checkB ) \
+        { \
+            checkFailures++; \
+            printf( "%s:%d: CHECK_EQ( %s, %s ) failed: %lld != %lld\n", \
+                __FILE__, __LINE__, #a, #b, checkA, checkB ); \
+        } \
+    } while( 0 )
+
+//! checkResult()
+//! @brief Print a summary of the checks
+//!
+//! @param name of the check program
+//! @returns exit status, 0 if all checks passed
+static inline int checkResult( const char *name )
+{
+    printf( "%s: %u checks, %u failed\n", name, checkCount, checkFailures );
+    return ( checkFailures == 0 ) ? 0 : 1;
+}
+
+#endif // __CHECK_H___
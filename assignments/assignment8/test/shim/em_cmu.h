@@ -0,0 +1,92 @@
+//!
+//! @file em_cmu.h
+//! @brief Host stand-in for the emlib CMU API. Clocks are always running,
+//! the LETIMER0 divider is kept for the checks, see sim/platform.h
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources platform/emlib/inc/em_cmu.h for the API it replaces
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#ifndef __EM_CMU_H___
+#define __EM_CMU_H___
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum
+{
+    cmuClock_HFPER,
+    cmuClock_GPIO,
+    cmuClock_I2C0,
+    cmuClock_LDMA,
+    cmuClock_LETIMER0,
+    cmuClock_LFA,
+    cmuClock_RTCC,
+    cmuClock_USART1
+} CMU_Clock_TypeDef;
+
+typedef enum
+{
+    cmuOsc_LFXO,
+    cmuOsc_ULFRCO
+} CMU_Osc_TypeDef;
+
+typedef enum
+{
+    cmuSelect_LFXO,
+    cmuSelect_ULFRCO
+} CMU_Select_TypeDef;
+
+//! Frequency reported for every clock and LETIMER0 divider
+extern uint32_t simCmuClockHz;
+extern uint32_t simCmuLetimerDiv;
+
+static inline void CMU_ClockEnable( CMU_Clock_TypeDef clock, bool enable )
+{
+    ( void ) clock;
+    ( void ) enable;
+    return;
+}
+
+static inline void CMU_ClockDivSet( CMU_Clock_TypeDef clock, uint32_t div )
+{
+    if( clock == cmuClock_LETIMER0 )
+    {
+        simCmuLetimerDiv = div;
+    }
+    return;
+}
+
+static inline uint32_t CMU_ClockFreqGet( CMU_Clock_TypeDef clock )
+{
+    ( void ) clock;
+    return simCmuClockHz;
+}
+
+static inline void CMU_ClockSelectSet( CMU_Clock_TypeDef clock, CMU_Select_TypeDef ref )
+{
+    ( void ) clock;
+    ( void ) ref;
+    return;
+}
+
+static inline void CMU_OscillatorEnable( CMU_Osc_TypeDef osc, bool enable, bool wait )
+{
+    ( void ) osc;
+    ( void ) enable;
+    ( void ) wait;
+    return;
+}
+
+#endif // __EM_CMU_H___
@@ -0,0 +1,42 @@
+//!
+//! @file em_core.h
+//! @brief Host stand-in for the emlib critical section macros. The host
+//! checks are single threaded, interrupts are modelled by calling the
+//! handler directly, so the macros only count how often they are entered
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources platform/emlib/inc/em_core.h for the macros it replaces
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#ifndef __EM_CORE_H___
+#define __EM_CORE_H___
+
+#include <stdint.h>
+
+typedef uint32_t CORE_irqState_t;
+
+//! Depth of nested critical sections, checked by the tests
+extern int coreCriticalDepth;
+
+#define CORE_DECLARE_IRQ_STATE      CORE_irqState_t irqState = 0
+#define CORE_ENTER_CRITICAL()       do { ( void ) irqState; coreCriticalDepth++; } while( 0 )
+#define CORE_EXIT_CRITICAL()        do { coreCriticalDepth--; } while( 0 )
+#define CORE_ENTER_ATOMIC()         CORE_ENTER_CRITICAL()
+#define CORE_EXIT_ATOMIC()          CORE_EXIT_CRITICAL()
+#define CORE_ATOMIC_SECTION( x )    { CORE_DECLARE_IRQ_STATE; CORE_ENTER_ATOMIC(); { x } CORE_EXIT_ATOMIC(); }
+#define CORE_CRITICAL_SECTION( x )  { CORE_DECLARE_IRQ_STATE; CORE_ENTER_CRITICAL(); { x } CORE_EXIT_CRITICAL(); }
+#define CORE_ATOMIC_IRQ_DISABLE()   do { coreCriticalDepth++; } while( 0 )
+#define CORE_ATOMIC_IRQ_ENABLE()    do { coreCriticalDepth--; } while( 0 )
+
+#endif // __EM_CORE_H___
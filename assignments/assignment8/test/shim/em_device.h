@@ -0,0 +1,101 @@
+//!
+//! @file em_device.h
+//! @brief Host stand-in for the EFR32BG13 device header: the interrupt
+//! numbers and NVIC calls the firmware uses, the flash geometry, and the
+//! LDMA descriptor layout
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources platform/Device/SiliconLabs/EFR32BG13P/Include/efr32bg13p632f512gm48.h
+//! for the values it replaces
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#ifndef __EM_DEVICE_H___
+#define __EM_DEVICE_H___
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum
+{
+    LDMA_IRQn = 8,
+    I2C0_IRQn = 17,
+    LETIMER0_IRQn = 26,
+    USART1_IRQn = 20
+} IRQn_Type;
+
+//! Main flash of the EFR32BG13P632F512GM48
+#define FLASH_BASE          ( 0x00000000UL )
+#define FLASH_SIZE          ( 0x00080000UL )
+#define FLASH_PAGE_SIZE     ( 2048U )
+
+//! LDMA descriptor, as laid out in memory
+typedef struct
+{
+    volatile uint32_t CTRL;
+    volatile void *SRC;
+    volatile void *DST;
+    volatile void *LINK;
+} DMA_DESCRIPTOR_TypeDef;
+
+//! LDMA channel fields used by ldma.h
+#define LDMA_CH_CTRL_STRUCTTYPE_TRANSFER    ( 0UL )
+#define LDMA_CH_CTRL_STRUCTTYPE_WRITE       ( 2UL )
+#define _LDMA_CH_CTRL_STRUCTTYPE_MASK       ( 3UL )
+#define LDMA_CH_CTRL_STRUCTREQ              ( 1UL << 3 )
+#define _LDMA_CH_CTRL_XFERCNT_SHIFT         ( 4 )
+#define _LDMA_CH_CTRL_XFERCNT_MASK          ( 0x7FF0UL )
+#define LDMA_CH_CTRL_BLOCKSIZE_UNIT1        ( 0UL )
+#define LDMA_CH_CTRL_REQMODE_BLOCK          ( 0UL )
+#define LDMA_CH_CTRL_SRCINC_ONE             ( 0UL )
+#define LDMA_CH_CTRL_SRCINC_NONE            ( 3UL << 24 )
+#define LDMA_CH_CTRL_SIZE_BYTE              ( 0UL )
+#define LDMA_CH_CTRL_DSTINC_ONE             ( 0UL )
+#define LDMA_CH_CTRL_DSTINC_NONE            ( 3UL << 28 )
+#define LDMA_CH_LINK_LINK                   ( 1UL << 1 )
+#define _LDMA_CH_LINK_LINKADDR_MASK         ( ~( uintptr_t ) 0x3 )
+#define LDMA_CH_REQSEL_SIGSEL_I2C0RXDATAV   ( 0UL )
+#define LDMA_CH_REQSEL_SIGSEL_I2C0TXBL      ( 1UL )
+#define LDMA_CH_REQSEL_SOURCESEL_I2C0       ( 0x14UL << 16 )
+#define LDMA_CH_REQSEL_SIGSEL_USART1RXDATAV ( 0UL )
+#define LDMA_CH_REQSEL_SIGSEL_USART1TXBL    ( 1UL )
+#define LDMA_CH_REQSEL_SOURCESEL_USART1     ( 0x0DUL << 16 )
+
+//! Interrupts enabled in the NVIC, bit n for IRQ n
+extern uint32_t simNvicEnabled;
+
+static inline void NVIC_EnableIRQ( IRQn_Type irq )
+{
+    simNvicEnabled |= ( 1UL << irq );
+    return;
+}
+
+static inline void NVIC_DisableIRQ( IRQn_Type irq )
+{
+    simNvicEnabled &= ~( 1UL << irq );
+    return;
+}
+
+static inline void NVIC_ClearPendingIRQ( IRQn_Type irq )
+{
+    ( void ) irq;
+    return;
+}
+
+static inline void NVIC_SetPendingIRQ( IRQn_Type irq )
+{
+    ( void ) irq;
+    return;
+}
+
+#endif // __EM_DEVICE_H___
@@ -0,0 +1,40 @@
+//!
+//! @file em_gpio.h
+//! @brief Host stand-in for the emlib GPIO types native_gecko.h uses, and
+//! the pin outputs extflash.c drives chip select with
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources platform/emlib/inc/em_gpio.h for the types it replaces
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#ifndef __EM_GPIO_H___
+#define __EM_GPIO_H___
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum
+{
+    gpioPortA = 0,
+    gpioPortB = 1,
+    gpioPortC = 2,
+    gpioPortD = 3,
+    gpioPortF = 5
+} GPIO_Port_TypeDef;
+
+void GPIO_PinOutSet( GPIO_Port_TypeDef port, unsigned int pin );
+
+void GPIO_PinOutClear( GPIO_Port_TypeDef port, unsigned int pin );
+
+#endif // __EM_GPIO_H___
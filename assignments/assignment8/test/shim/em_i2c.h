@@ -0,0 +1,121 @@
+//!
+//! @file em_i2c.h
+//! @brief Host stand-in for the emlib I2C API. The transfer functions
+//! drive the bus simulator in sim/i2cbus.c
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources platform/emlib/inc/em_i2c.h for the API it replaces
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#ifndef __EM_I2C_H___
+#define __EM_I2C_H___
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "em_device.h"
+
+//! Transfer sequence flags
+#define I2C_FLAG_WRITE          ( 0x0001 )
+#define I2C_FLAG_READ           ( 0x0002 )
+#define I2C_FLAG_WRITE_READ     ( 0x0004 )
+#define I2C_FLAG_WRITE_WRITE    ( 0x0008 )
+#define I2C_FLAG_10BIT_ADDR     ( 0x0010 )
+
+#define I2C_FREQ_STANDARD_MAX   ( 92000 )
+
+//! Register bits used by the LDMA path of i2c.c
+#define I2C_CTRL_AUTOSE         ( 1UL << 3 )
+#define I2C_CTRL_AUTOSN         ( 1UL << 4 )
+#define I2C_CMD_START           ( 1UL << 0 )
+#define I2C_CMD_STOP            ( 1UL << 1 )
+#define I2C_CMD_ACK             ( 1UL << 2 )
+#define I2C_CMD_NACK            ( 1UL << 3 )
+#define I2C_CMD_ABORT           ( 1UL << 5 )
+#define I2C_CMD_CLEARTX         ( 1UL << 6 )
+#define I2C_CMD_CLEARPC         ( 1UL << 7 )
+#define I2C_STATE_BUSY          ( 1UL << 0 )
+#define I2C_STATUS_RXDATAV      ( 1UL << 8 )
+#define I2C_IF_ACK              ( 1UL << 6 )
+#define I2C_IF_NACK             ( 1UL << 7 )
+#define I2C_IF_MSTOP            ( 1UL << 8 )
+#define I2C_IF_ARBLOST          ( 1UL << 9 )
+#define I2C_IF_BUSERR           ( 1UL << 10 )
+#define I2C_IEN_MSTOP           I2C_IF_MSTOP
+#define I2C_IEN_ARBLOST         I2C_IF_ARBLOST
+#define I2C_IEN_BUSERR          I2C_IF_BUSERR
+#define _I2C_IF_MASK            ( 0x0007FFFFUL )
+
+typedef enum
+{
+    i2cTransferInProgress = 1,
+    i2cTransferDone = 0,
+    i2cTransferNack = -1,
+    i2cTransferBusErr = -2,
+    i2cTransferArbLost = -3,
+    i2cTransferUsageFault = -4,
+    i2cTransferSwFault = -5
+} I2C_TransferReturn_TypeDef;
+
+typedef enum
+{
+    i2cClockHLRStandard,
+    i2cClockHLRAsymetric,
+    i2cClockHLRFast
+} I2C_ClockHLR_TypeDef;
+
+typedef struct
+{
+    uint16_t addr;
+    uint16_t flags;
+    struct
+    {
+        uint8_t *data;
+        uint16_t len;
+    } buf[ 2 ];
+} I2C_TransferSeq_TypeDef;
+
+typedef struct
+{
+    volatile uint32_t CTRL;
+    volatile uint32_t CMD;
+    volatile uint32_t STATE;
+    volatile uint32_t STATUS;
+    volatile uint32_t IF;
+    volatile uint32_t IEN;
+    volatile uint32_t RXDATA;
+    volatile uint32_t TXDATA;
+    volatile uint32_t ROUTEPEN;
+} I2C_TypeDef;
+
+//! Simulated I2C0, see sim/i2cbus.h
+extern I2C_TypeDef simI2c0;
+#define I2C0                    ( &simI2c0 )
+
+void I2C_Enable( I2C_TypeDef *i2c, bool enable );
+
+void I2C_Reset( I2C_TypeDef *i2c );
+
+void I2C_IntClear( I2C_TypeDef *i2c, uint32_t flags );
+
+static inline uint32_t I2C_IntGet( I2C_TypeDef *i2c )
+{
+    return i2c->IF;
+}
+
+I2C_TransferReturn_TypeDef I2C_TransferInit( I2C_TypeDef *i2c, I2C_TransferSeq_TypeDef *seq );
+
+I2C_TransferReturn_TypeDef I2C_Transfer( I2C_TypeDef *i2c );
+
+#endif // __EM_I2C_H___
@@ -0,0 +1,146 @@
+//!
+//! @file em_letimer.h
+//! @brief Host stand-in for the emlib LETIMER API. LETIMER0 is a register
+//! block in RAM that sim/letimer.c counts down one tick at a time
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources platform/emlib/inc/em_letimer.h for the API it replaces
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#ifndef __EM_LETIMER_H___
+#define __EM_LETIMER_H___
+
+#include <stdint.h>
+#include <stdbool.h>
+
+//! Interrupt flags, same bits as the EFR32 LETIMER
+#define LETIMER_IF_COMP0        ( 0x1UL )
+#define LETIMER_IF_COMP1        ( 0x2UL )
+#define LETIMER_IF_UF           ( 0x4UL )
+#define LETIMER_IFC_COMP0       LETIMER_IF_COMP0
+#define LETIMER_IFC_COMP1       LETIMER_IF_COMP1
+#define LETIMER_IFC_UF          LETIMER_IF_UF
+#define LETIMER_IEN_COMP0       LETIMER_IF_COMP0
+#define LETIMER_IEN_COMP1       LETIMER_IF_COMP1
+#define LETIMER_IEN_UF          LETIMER_IF_UF
+
+typedef struct
+{
+    volatile uint32_t CNT;
+    volatile uint32_t COMP0;
+    volatile uint32_t COMP1;
+    volatile uint32_t IF;
+    volatile uint32_t IFC;
+    volatile uint32_t IEN;
+    volatile uint32_t SYNCBUSY;
+    bool enabled;
+} LETIMER_TypeDef;
+
+typedef enum
+{
+    letimerUFOANone,
+    letimerUFOAToggle,
+    letimerUFOAPulse,
+    letimerUFOAPwm
+} LETIMER_UFOA_TypeDef;
+
+typedef enum
+{
+    letimerRepeatFree,
+    letimerRepeatOneshot,
+    letimerRepeatBuffered,
+    letimerRepeatDouble
+} LETIMER_RepeatMode_TypeDef;
+
+typedef struct
+{
+    bool enable;
+    bool debugRun;
+    bool comp0Top;
+    bool bufTop;
+    uint8_t out0Pol;
+    uint8_t out1Pol;
+    LETIMER_UFOA_TypeDef ufoa0;
+    LETIMER_UFOA_TypeDef ufoa1;
+    LETIMER_RepeatMode_TypeDef repMode;
+    uint32_t topValue;
+} LETIMER_Init_TypeDef;
+
+//! Simulated LETIMER0, see sim/letimer.h
+extern LETIMER_TypeDef simLetimer0;
+#define LETIMER0                ( &simLetimer0 )
+
+static inline void LETIMER_Init( LETIMER_TypeDef *letimer, const LETIMER_Init_TypeDef *init )
+{
+    letimer->enabled = init->enable;
+    letimer->CNT = init->topValue;
+    return;
+}
+
+static inline void LETIMER_Enable( LETIMER_TypeDef *letimer, bool enable )
+{
+    letimer->enabled = enable;
+    return;
+}
+
+static inline void LETIMER_CompareSet( LETIMER_TypeDef *letimer, unsigned int comp, uint32_t value )
+{
+    if( comp == 0 )
+    {
+        letimer->COMP0 = value & 0xFFFF;
+    }
+    else
+    {
+        letimer->COMP1 = value & 0xFFFF;
+    }
+    return;
+}
+
+//! Implemented by the simulator, which may let time pass on each read
+uint32_t simLetimerCounterGet( LETIMER_TypeDef *letimer );
+
+static inline uint32_t LETIMER_CounterGet( LETIMER_TypeDef *letimer )
+{
+    return simLetimerCounterGet( letimer );
+}
+
+static inline uint32_t LETIMER_IntGet( LETIMER_TypeDef *letimer )
+{
+    return letimer->IF;
+}
+
+static inline uint32_t LETIMER_IntGetEnabled( LETIMER_TypeDef *letimer )
+{
+    return letimer->IF & letimer->IEN;
+}
+
+static inline void LETIMER_IntClear( LETIMER_TypeDef *letimer, uint32_t flags )
+{
+    letimer->IF &= ~flags;
+    return;
+}
+
+static inline void LETIMER_IntEnable( LETIMER_TypeDef *letimer, uint32_t flags )
+{
+    letimer->IEN |= flags;
+    return;
+}
+
+static inline void LETIMER_IntDisable( LETIMER_TypeDef *letimer, uint32_t flags )
+{
+    letimer->IEN &= ~flags;
+    return;
+}
+
+#endif // __EM_LETIMER_H___
@@ -0,0 +1,41 @@
+//!
+//! @file em_msc.h
+//! @brief Host stand-in for the emlib MSC flash programming calls,
+//! implemented on the flash simulator in sim/msc.c
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources platform/emlib/inc/em_msc.h for the interface it replaces
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#ifndef __EM_MSC_H___
+#define __EM_MSC_H___
+
+#include <stdint.h>
+
+typedef enum
+{
+    mscReturnOk = 0,
+    mscReturnInvalidAddr = -1,
+    mscReturnLocked = -2,
+    mscReturnTimeOut = -3,
+    mscReturnUnaligned = -4
+} MSC_Status_TypeDef;
+
+void MSC_Init();
+
+MSC_Status_TypeDef MSC_WriteWord( uint32_t *address, void const *data, uint32_t numBytes );
+
+MSC_Status_TypeDef MSC_ErasePage( uint32_t *startAddress );
+
+#endif // __EM_MSC_H___
@@ -0,0 +1,58 @@
+//!
+//! @file em_usart.h
+//! @brief Host stand-in for the emlib USART API. Transfers drive the SPI
+//! flash simulator in sim/spiflash.c
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources platform/emlib/inc/em_usart.h for the API it replaces
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#ifndef __EM_USART_H___
+#define __EM_USART_H___
+
+#include <stdint.h>
+
+#include "em_device.h"
+
+//! Register bits used by extflash.c
+#define USART_CMD_RXEN          ( 1UL << 0 )
+#define USART_CMD_RXDIS         ( 1UL << 1 )
+#define USART_CMD_TXEN          ( 1UL << 2 )
+#define USART_CMD_TXDIS         ( 1UL << 3 )
+#define USART_CMD_CLEARTX       ( 1UL << 10 )
+#define USART_CMD_CLEARRX       ( 1UL << 11 )
+#define USART_STATUS_RXENS      ( 1UL << 0 )
+#define USART_STATUS_TXENS      ( 1UL << 1 )
+
+//! Registers read and written by extflash.c
+typedef struct
+{
+    volatile uint32_t CTRL;
+    volatile uint32_t FRAME;
+    volatile uint32_t CMD;
+    volatile uint32_t STATUS;
+    volatile uint32_t CLKDIV;
+    volatile uint32_t RXDATA;
+    volatile uint32_t TXDATA;
+    volatile uint32_t ROUTEPEN;
+    volatile uint32_t ROUTELOC0;
+} USART_TypeDef;
+
+//! The one USART the flash is wired to
+extern USART_TypeDef simUsart1;
+#define USART1                  ( &simUsart1 )
+
+uint8_t USART_SpiTransfer( USART_TypeDef *usart, uint8_t data );
+
+#endif // __EM_USART_H___
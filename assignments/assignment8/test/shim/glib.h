@@ -0,0 +1,24 @@
+//!
+//! @file glib.h
+//! @brief Host stand-in for the graphics library header. display.h
+//! includes it, but nothing the checks build draws on the LCD
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources platform/middleware/glib/glib/glib.h for the API it replaces
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#ifndef __GLIB_H___
+#define __GLIB_H___
+
+#endif // __GLIB_H___
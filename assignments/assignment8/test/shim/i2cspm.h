@@ -0,0 +1,42 @@
+//!
+//! @file i2cspm.h
+//! @brief Host stand-in for the I2C simple polled master driver
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources hardware/kit/common/drivers/i2cspm.h for the API it replaces
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#ifndef __I2CSPM_H___
+#define __I2CSPM_H___
+
+#include "em_i2c.h"
+#include "em_gpio.h"
+
+typedef struct
+{
+    I2C_TypeDef *port;
+    GPIO_Port_TypeDef sclPort;
+    unsigned int sclPin;
+    GPIO_Port_TypeDef sdaPort;
+    unsigned int sdaPin;
+    uint8_t portLocationScl;
+    uint8_t portLocationSda;
+    uint32_t i2cRefFreq;
+    uint32_t i2cMaxFreq;
+    I2C_ClockHLR_TypeDef i2cClhr;
+} I2CSPM_Init_TypeDef;
+
+void I2CSPM_Init( I2CSPM_Init_TypeDef *init );
+
+#endif // __I2CSPM_H___
@@ -0,0 +1,70 @@
+//!
+//! @file mx25flash_spi.h
+//! @brief Host stand-in for the MX25 flash driver of the kit. The driver
+//! calls are served by the SPI flash simulator in sim/spiflash.c
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources hardware/kit/common/drivers/mx25flash_spi.h for the API it replaces
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#ifndef __MX25FLASH_SPI_H___
+#define __MX25FLASH_SPI_H___
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "em_gpio.h"
+#include "em_usart.h"
+
+//! Wiring of the flash on the BRD4104A, and its clock
+#define MX25_PORT_CS            gpioPortA
+#define MX25_PIN_CS             4
+#define MX25_USART              USART1
+#define MX25_BAUDRATE           1000000
+
+//! MX25R8035F geometry and identification
+#define Sector_Offset           0x1000
+#define FlashID                 0xc22814
+#define FlashSize               0x100000
+
+#define FLASH_WIP_MASK          0x01
+
+//! Commands used by extflash.c
+#define FLASH_CMD_RDID          0x9F
+#define FLASH_CMD_RDSR          0x05
+#define FLASH_CMD_READ          0x03
+#define FLASH_CMD_WREN          0x06
+#define FLASH_CMD_PP            0x02
+#define FLASH_CMD_SE            0x20
+#define FLASH_CMD_DP            0xB9
+
+typedef enum
+{
+    FlashOperationSuccess,
+    FlashWriteRegFailed,
+    FlashTimeOut,
+    FlashIsBusy,
+    FlashQuadNotEnable,
+    FlashAddressInvalid
+} ReturnMsg;
+
+void MX25_init( void );
+
+void MX25_deinit( void );
+
+ReturnMsg MX25_RDID( uint32_t *Identification );
+
+ReturnMsg MX25_READ( uint32_t flash_address, uint8_t *target_address, uint32_t byte_length );
+
+#endif // __MX25FLASH_SPI_H___
@@ -0,0 +1,51 @@
+//!
+//! @file sleep.h
+//! @brief Host stand-in for the emdrv sleep driver. Counts sleep blocks
+//! per energy mode so the checks can see which modes are blocked
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources platform/emdrv/sleep/inc/sleep.h for the API it replaces
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#ifndef __SLEEP_H___
+#define __SLEEP_H___
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum
+{
+    sleepEM0 = 0,
+    sleepEM1 = 1,
+    sleepEM2 = 2,
+    sleepEM3 = 3,
+    sleepEM4 = 4
+} SLEEP_EnergyMode_t;
+
+//! Outstanding blocks of each energy mode
+extern int simSleepBlocks[ sleepEM4 + 1 ];
+
+static inline void SLEEP_SleepBlockBegin( SLEEP_EnergyMode_t mode )
+{
+    simSleepBlocks[ mode ]++;
+    return;
+}
+
+static inline void SLEEP_SleepBlockEnd( SLEEP_EnergyMode_t mode )
+{
+    simSleepBlocks[ mode ]--;
+    return;
+}
+
+#endif // __SLEEP_H___
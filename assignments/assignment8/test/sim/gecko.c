@@ -0,0 +1,1212 @@
+//!
+//! @file gecko.c
+//! @brief Implements the Bluetooth stack stand-in. Time only passes in
+//! simGeckoWaitEvent(), which runs connection events, soft timers,
+//! advertising and measurements of the peers in time order until an
+//! event is queued
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources Silicon Labs Bluetooth API reference (UG136)
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#include "gecko.h"
+
+#include <string.h>
+
+//! Most notification buffers simGeckoReset() accepts
+#define MAX_TX_BUFFERS      ( 32 )
+
+//! Client writes waiting for their connection event
+#define MAX_PEER_WRITES     ( 16 )
+
+//! Soft timer handles 0 to MAX_SOFT_TIMERS - 1 can be used
+#define MAX_SOFT_TIMERS     ( 8 )
+
+//! Soft timer clock
+#define SOFT_TIMER_HZ       ( 32768 )
+
+//! Notifications a link opened by the firmware sends per connection event
+#define PACKETS_PER_EVENT   ( 4 )
+
+//! Random delay added to each advertising event, at most 10 ms
+#define ADV_DELAY_US        ( 10000 )
+
+//! 16-bit UUIDs of the Health Thermometer service and Temperature
+//! Measurement characteristic, little endian
+static const uint8_t HTM_SERVICE_UUID[] = { 0x09, 0x18 };
+static const uint8_t HTM_TEMPERATURE_UUID[] = { 0x1C, 0x2A };
+
+//! Temperature Measurement flags and exponent: Celsius, milli-degrees
+#define HTM_FLAGS_CELSIUS   ( 0x00 )
+#define HTM_EXPONENT_MILLI  ( -3 )
+
+//! GATT client procedure running on a link
+typedef enum
+{
+    PROCEDURE_NONE,
+    PROCEDURE_SERVICES,         //! gecko_cmd_gatt_discover_primary_services_by_uuid()
+    PROCEDURE_CHARACTERISTICS,  //! gecko_cmd_gatt_discover_characteristics_by_uuid()
+    PROCEDURE_NOTIFICATION      //! gecko_cmd_gatt_set_characteristic_notification()
+} procedure_e;
+
+//! Packet with room for the largest payload
+typedef union
+{
+    struct gecko_cmd_packet packet;
+    uint8_t bytes[ SIM_GECKO_PACKET_SIZE ];
+} packet_u;
+
+//! Link to a peer
+typedef struct
+{
+    bool open;
+    bool connecting;            //! gecko_cmd_le_gap_connect() waits for the peer
+    simGeckoPeer_s *peer;       //! Peer a link of the firmware's goes to, NULL for links the test opened
+    uint16_t mtu;
+    uint32_t intervalUs;
+    uint8_t packetsPerEvent;    //! Notifications sent per connection event
+    uint64_t nextEventUs;       //! Time of the next connection event
+    procedure_e procedure;      //! GATT procedure answered at the next connection event
+    bool procedureMatch;        //! The procedure's UUID is the Health Thermometer one
+    uint32_t procedureService;
+    uint16_t procedureCharacteristic;
+    uint8_t procedureFlags;
+} link_s;
+
+//! Notification or client write in flight
+typedef struct
+{
+    uint8_t connection;
+    uint16_t characteristic;
+    uint8_t len;
+    uint8_t data[ SIM_GECKO_PACKET_SIZE ];
+} message_s;
+
+//! Soft timer set with gecko_cmd_hardware_set_soft_timer()
+typedef struct
+{
+    bool active;
+    bool singleShot;
+    uint64_t periodUs;
+    uint64_t dueUs;
+} softTimer_s;
+
+static packet_u commandBuffer;
+static packet_u responseBuffer;
+
+//! Command and response buffers the gecko_cmd_* functions of
+//! native_gecko.h build their packets in
+void *gecko_cmd_msg_buf = &commandBuffer;
+void *gecko_rsp_msg_buf = &responseBuffer;
+
+simGeckoStats_s simGeckoStats;
+
+static uint64_t nowUs = 0;
+static link_s links[ SIM_GECKO_MAX_CONNECTIONS + 1 ];
+static softTimer_s softTimers[ MAX_SOFT_TIMERS ];
+static simGeckoNotify_f onNotification = NULL;
+
+//! Peers of a client build, and whether the firmware scans for them
+static simGeckoPeer_s *peers = NULL;
+static bool scanning = false;
+
+//! Whether the firmware halted the stack, as it does to set the TX power
+static bool halted = false;
+
+//! Pseudo-random state for advertising delays
+static uint32_t advDelayState = 0x5823;
+
+//! Notifications held in stack buffers, oldest first
+static message_s txQueue[ MAX_TX_BUFFERS ];
+static uint8_t txQueued = 0;
+static uint8_t txBuffers = SIM_GECKO_TX_BUFFERS;
+
+//! Client writes waiting for their connection event, oldest first
+static message_s writeQueue[ MAX_PEER_WRITES ];
+static uint8_t writesQueued = 0;
+
+//! Event queue and the event last handed out
+static packet_u events[ SIM_GECKO_MAX_EVENTS ];
+static uint8_t eventHead = 0;
+static uint8_t eventCount = 0;
+static packet_u currentEvent;
+
+//! response()
+//! @brief Returns the response packet of the command being handled
+//!
+//! @param void
+//! @returns response packet
+static struct gecko_cmd_packet *response()
+{
+    return &responseBuffer.packet;
+}
+
+//! pushEvent()
+//! @brief Queue an event
+//!
+//! @param id gecko_evt_*_id
+//! @param length payload length
+//! @returns event to fill in, NULL if the queue is full
+static struct gecko_cmd_packet *pushEvent( uint32_t id, uint16_t length )
+{
+    if( eventCount >= SIM_GECKO_MAX_EVENTS )
+    {
+        simGeckoStats.droppedEvents++;
+        return NULL;
+    }
+    packet_u *event = &events[ ( eventHead + eventCount ) % SIM_GECKO_MAX_EVENTS ];
+    eventCount++;
+    memset( event, 0, sizeof( *event ) );
+    event->packet.header = id | ( ( length & 0xFF ) << 8 ) | ( ( length >> 8 ) & 0x7 );
+    return &event->packet;
+}
+
+//! removeMessage()
+//! @brief Remove a message from a queue, keeping the others in order
+//!
+//! @param queue
+//! @param count number of messages in the queue, decremented
+//! @param index message to remove
+//! @returns void
+static void removeMessage( message_s *queue, uint8_t *count, uint8_t index )
+{
+    memmove( &queue[ index ], &queue[ index + 1 ], ( *count - index - 1 ) * sizeof( message_s ) );
+    ( *count )--;
+    return;
+}
+
+//! advDelay()
+//! @brief Returns the random delay of an advertising event
+//!
+//! @param void
+//! @returns delay in microseconds
+static uint32_t advDelay()
+{
+    advDelayState ^= advDelayState << 13;
+    advDelayState ^= advDelayState >> 17;
+    advDelayState ^= advDelayState << 5;
+    return advDelayState % ADV_DELAY_US;
+}
+
+//! isInUse()
+//! @brief Asserts whether a connection handle is open or being set up
+//!
+//! @param connection
+//! @returns true if in use
+static bool isInUse( uint8_t connection )
+{
+    return ( connection > 0 ) && ( connection <= SIM_GECKO_MAX_CONNECTIONS )
+        && ( links[ connection ].open || links[ connection ].connecting );
+}
+
+//! isOpen()
+//! @brief Asserts whether a connection handle is open
+//!
+//! @param connection
+//! @returns true if open
+static bool isOpen( uint8_t connection )
+{
+    return ( connection > 0 ) && ( connection <= SIM_GECKO_MAX_CONNECTIONS ) && links[ connection ].open;
+}
+
+//! closeLink()
+//! @brief Drop a link with what it had in flight, put its peer back to
+//! advertising and queue the connection closed event
+//!
+//! @param connection
+//! @param reason
+//! @returns void
+static void closeLink( uint8_t connection, uint16_t reason )
+{
+    link_s *link = &links[ connection ];
+    if( link->peer )
+    {
+        link->peer->connection = 0;
+        link->peer->subscribed = false;
+        link->peer->indicationQueued = false;
+        link->peer->indicationPending = false;
+        link->peer->nextAdvertisingUs = nowUs + link->peer->advertisingIntervalUs + advDelay();
+    }
+    memset( link, 0, sizeof( *link ) );
+    for( uint8_t i = txQueued; i > 0; i-- )
+    {
+        if( txQueue[ i - 1 ].connection == connection )
+        {
+            removeMessage( txQueue, &txQueued, i - 1 );
+        }
+    }
+    for( uint8_t i = writesQueued; i > 0; i-- )
+    {
+        if( writeQueue[ i - 1 ].connection == connection )
+        {
+            removeMessage( writeQueue, &writesQueued, i - 1 );
+        }
+    }
+    struct gecko_cmd_packet *event = pushEvent( gecko_evt_le_connection_closed_id,
+        sizeof( struct gecko_msg_le_connection_closed_evt_t ) );
+    if( event )
+    {
+        event->data.evt_le_connection_closed.connection = connection;
+        event->data.evt_le_connection_closed.reason = reason;
+    }
+    return;
+}
+
+//! procedureCompleted()
+//! @brief Queue the end of a GATT client procedure
+//!
+//! @param connection
+//! @param result
+//! @returns void
+static void procedureCompleted( uint8_t connection, uint16_t result )
+{
+    struct gecko_cmd_packet *event = pushEvent( gecko_evt_gatt_procedure_completed_id,
+        sizeof( struct gecko_msg_gatt_procedure_completed_evt_t ) );
+    if( event )
+    {
+        event->data.evt_gatt_procedure_completed.connection = connection;
+        event->data.evt_gatt_procedure_completed.result = result;
+    }
+    return;
+}
+
+//! runProcedure()
+//! @brief Answer the GATT client procedure of a link from its peer's
+//! database, which holds the Health Thermometer service if the peer is a
+//! thermometer
+//!
+//! @param connection
+//! @returns void
+static void runProcedure( uint8_t connection )
+{
+    link_s *link = &links[ connection ];
+    bool thermometer = link->peer->thermometer;
+    struct gecko_cmd_packet *event;
+    switch( link->procedure )
+    {
+        case PROCEDURE_SERVICES:
+            if( !thermometer || !link->procedureMatch )
+            {
+                procedureCompleted( connection, bg_err_att_att_not_found );
+                break;
+            }
+            event = pushEvent( gecko_evt_gatt_service_id,
+                sizeof( struct gecko_msg_gatt_service_evt_t ) + sizeof( HTM_SERVICE_UUID ) );
+            if( event )
+            {
+                event->data.evt_gatt_service.connection = connection;
+                event->data.evt_gatt_service.service = SIM_GECKO_HTM_SERVICE;
+                event->data.evt_gatt_service.uuid.len = sizeof( HTM_SERVICE_UUID );
+                memcpy( event->data.evt_gatt_service.uuid.data, HTM_SERVICE_UUID, sizeof( HTM_SERVICE_UUID ) );
+            }
+            procedureCompleted( connection, bg_err_success );
+            break;
+
+        case PROCEDURE_CHARACTERISTICS:
+            if( !thermometer || !link->procedureMatch || ( link->procedureService != SIM_GECKO_HTM_SERVICE ) )
+            {
+                procedureCompleted( connection, bg_err_att_att_not_found );
+                break;
+            }
+            event = pushEvent( gecko_evt_gatt_characteristic_id,
+                sizeof( struct gecko_msg_gatt_characteristic_evt_t ) + sizeof( HTM_TEMPERATURE_UUID ) );
+            if( event )
+            {
+                event->data.evt_gatt_characteristic.connection = connection;
+                event->data.evt_gatt_characteristic.characteristic = SIM_GECKO_HTM_TEMPERATURE;
+                event->data.evt_gatt_characteristic.properties = 0x20;
+                event->data.evt_gatt_characteristic.uuid.len = sizeof( HTM_TEMPERATURE_UUID );
+                memcpy( event->data.evt_gatt_characteristic.uuid.data, HTM_TEMPERATURE_UUID,
+                    sizeof( HTM_TEMPERATURE_UUID ) );
+            }
+            procedureCompleted( connection, bg_err_success );
+            break;
+
+        case PROCEDURE_NOTIFICATION:
+            if( !thermometer || ( link->procedureCharacteristic != SIM_GECKO_HTM_TEMPERATURE ) )
+            {
+                procedureCompleted( connection, bg_err_att_invalid_handle );
+                break;
+            }
+            link->peer->subscribed = ( link->procedureFlags & gatt_indication ) != 0;
+            link->peer->nextMeasurementUs = nowUs + link->peer->measurementIntervalUs;
+            procedureCompleted( connection, bg_err_success );
+            break;
+
+        default:
+            break;
+    }
+    link->procedure = PROCEDURE_NONE;
+    return;
+}
+
+//! indicate()
+//! @brief Send the queued temperature of a link's peer as a Temperature
+//! Measurement indication: flags, then an IEEE-11073 float of the
+//! temperature in milli-degrees
+//!
+//! @param connection
+//! @returns void
+static void indicate( uint8_t connection )
+{
+    simGeckoPeer_s *peer = links[ connection ].peer;
+    int32_t milliC = peer->milliC + ( int32_t ) peer->indications;
+    uint8_t value[ 5 ] =
+    {
+        HTM_FLAGS_CELSIUS, milliC & 0xFF, ( milliC >> 8 ) & 0xFF, ( milliC >> 16 ) & 0xFF,
+        ( uint8_t ) HTM_EXPONENT_MILLI
+    };
+    struct gecko_cmd_packet *event = pushEvent( gecko_evt_gatt_characteristic_value_id,
+        sizeof( struct gecko_msg_gatt_characteristic_value_evt_t ) + sizeof( value ) );
+    if( event )
+    {
+        event->data.evt_gatt_characteristic_value.connection = connection;
+        event->data.evt_gatt_characteristic_value.characteristic = SIM_GECKO_HTM_TEMPERATURE;
+        event->data.evt_gatt_characteristic_value.att_opcode = gatt_handle_value_indication;
+        event->data.evt_gatt_characteristic_value.offset = 0;
+        event->data.evt_gatt_characteristic_value.value.len = sizeof( value );
+        memcpy( event->data.evt_gatt_characteristic_value.value.data, value, sizeof( value ) );
+    }
+    peer->indicationQueued = false;
+    peer->indicationPending = true;
+    peer->indications++;
+    return;
+}
+
+//! advertise()
+//! @brief Advertising event of a peer. Completes a connection the
+//! firmware asked for, or is reported as a scan response while the
+//! firmware scans
+//!
+//! @param peer
+//! @returns void
+static void advertise( simGeckoPeer_s *peer )
+{
+    peer->nextAdvertisingUs = nowUs + peer->advertisingIntervalUs + advDelay();
+    for( uint8_t c = 1; c <= SIM_GECKO_MAX_CONNECTIONS; c++ )
+    {
+        link_s *link = &links[ c ];
+        if( link->connecting && ( link->peer == peer ) && peer->connectable )
+        {
+            link->connecting = false;
+            link->open = true;
+            link->mtu = 23;
+            link->intervalUs = SIM_GECKO_DEFAULT_INTERVAL_US;
+            link->packetsPerEvent = PACKETS_PER_EVENT;
+            link->nextEventUs = nowUs + link->intervalUs;
+            peer->connection = c;
+            peer->connects++;
+            struct gecko_cmd_packet *event = pushEvent( gecko_evt_le_connection_opened_id,
+                sizeof( struct gecko_msg_le_connection_opened_evt_t ) );
+            if( event )
+            {
+                event->data.evt_le_connection_opened.address = peer->address;
+                event->data.evt_le_connection_opened.master = 1;
+                event->data.evt_le_connection_opened.connection = c;
+                event->data.evt_le_connection_opened.bonding = 0xFF;
+                event->data.evt_le_connection_opened.advertiser = 0xFF;
+            }
+            return;
+        }
+    }
+    if( scanning )
+    {
+        simGeckoStats.scanResponses++;
+        struct gecko_cmd_packet *event = pushEvent( gecko_evt_le_gap_scan_response_id,
+            sizeof( struct gecko_msg_le_gap_scan_response_evt_t ) );
+        if( event )
+        {
+            event->data.evt_le_gap_scan_response.rssi = peer->rssi;
+            event->data.evt_le_gap_scan_response.packet_type = 0;
+            event->data.evt_le_gap_scan_response.address = peer->address;
+            event->data.evt_le_gap_scan_response.address_type = le_gap_address_type_public;
+            event->data.evt_le_gap_scan_response.bonding = 0xFF;
+        }
+    }
+    return;
+}
+
+//! measure()
+//! @brief Measurement of a peer. The temperature is indicated at the next
+//! connection event, unless the previous one is still unconfirmed
+//!
+//! @param peer
+//! @returns void
+static void measure( simGeckoPeer_s *peer )
+{
+    peer->nextMeasurementUs += peer->measurementIntervalUs;
+    if( peer->indicationQueued || peer->indicationPending )
+    {
+        peer->skipped++;
+        return;
+    }
+    peer->indicationQueued = true;
+    return;
+}
+
+//! connectionEvent()
+//! @brief Send the link's oldest notifications, as many as fit one
+//! connection event, then deliver the client's writes as events
+//!
+//! @param connection
+//! @returns void
+static void connectionEvent( uint8_t connection )
+{
+    link_s *link = &links[ connection ];
+    simGeckoStats.connectionEvents++;
+    uint8_t sent = 0;
+    uint8_t i = 0;
+    while( ( i < txQueued ) && ( sent < link->packetsPerEvent ) )
+    {
+        if( txQueue[ i ].connection != connection )
+        {
+            i++;
+            continue;
+        }
+        message_s message = txQueue[ i ];
+        removeMessage( txQueue, &txQueued, i );
+        sent++;
+        simGeckoStats.delivered++;
+        if( onNotification )
+        {
+            onNotification( connection, message.characteristic, message.data, message.len );
+        }
+    }
+
+    i = 0;
+    while( i < writesQueued )
+    {
+        if( writeQueue[ i ].connection != connection )
+        {
+            i++;
+            continue;
+        }
+        message_s *write = &writeQueue[ i ];
+        struct gecko_cmd_packet *event = pushEvent( gecko_evt_gatt_server_user_write_request_id,
+            sizeof( struct gecko_msg_gatt_server_user_write_request_evt_t ) + write->len );
+        if( event )
+        {
+            event->data.evt_gatt_server_user_write_request.connection = connection;
+            event->data.evt_gatt_server_user_write_request.characteristic = write->characteristic;
+            event->data.evt_gatt_server_user_write_request.att_opcode = gatt_write_request;
+            event->data.evt_gatt_server_user_write_request.offset = 0;
+            event->data.evt_gatt_server_user_write_request.value.len = write->len;
+            memcpy( event->data.evt_gatt_server_user_write_request.value.data, write->data, write->len );
+        }
+        removeMessage( writeQueue, &writesQueued, i );
+    }
+
+    if( link->peer && ( link->procedure != PROCEDURE_NONE ) )
+    {
+        runProcedure( connection );
+    }
+    if( link->peer && link->peer->indicationQueued )
+    {
+        indicate( connection );
+    }
+    link->nextEventUs += link->intervalUs;
+    return;
+}
+
+//! simGeckoReset()
+//! @brief Close every link, stop the soft timers, empty the queues and
+//! clear the counters. Time carries on
+//!
+//! @param buffers notifications the stack can hold, at most 32
+//! @returns void
+void simGeckoReset( uint8_t buffers )
+{
+    memset( links, 0, sizeof( links ) );
+    memset( softTimers, 0, sizeof( softTimers ) );
+    memset( &simGeckoStats, 0, sizeof( simGeckoStats ) );
+    txBuffers = ( buffers > MAX_TX_BUFFERS ) ? MAX_TX_BUFFERS : buffers;
+    txQueued = 0;
+    writesQueued = 0;
+    eventHead = 0;
+    eventCount = 0;
+    onNotification = NULL;
+    peers = NULL;
+    scanning = false;
+    halted = false;
+    return;
+}
+
+//! simGeckoOnNotification()
+//! @brief Set the function that receives the notifications peers get
+//!
+//! @param notify
+//! @returns void
+void simGeckoOnNotification( simGeckoNotify_f notify )
+{
+    onNotification = notify;
+    return;
+}
+
+//! simGeckoOpen()
+//! @brief Open a link to a peer and queue its connection opened and MTU
+//! exchanged events
+//!
+//! @param connection handle, 1 to SIM_GECKO_MAX_CONNECTIONS
+//! @param mtu ATT MTU
+//! @param intervalUs connection interval
+//! @param packetsPerEvent notifications sent per connection event
+//! @returns void
+void simGeckoOpen( uint8_t connection, uint16_t mtu, uint32_t intervalUs, uint8_t packetsPerEvent )
+{
+    link_s *link = &links[ connection ];
+    memset( link, 0, sizeof( *link ) );
+    link->open = true;
+    link->mtu = mtu;
+    link->intervalUs = intervalUs;
+    link->packetsPerEvent = packetsPerEvent;
+    link->nextEventUs = nowUs + intervalUs;
+    struct gecko_cmd_packet *event = pushEvent( gecko_evt_le_connection_opened_id,
+        sizeof( struct gecko_msg_le_connection_opened_evt_t ) );
+    if( event )
+    {
+        event->data.evt_le_connection_opened.connection = connection;
+    }
+    event = pushEvent( gecko_evt_gatt_mtu_exchanged_id, sizeof( struct gecko_msg_gatt_mtu_exchanged_evt_t ) );
+    if( event )
+    {
+        event->data.evt_gatt_mtu_exchanged.connection = connection;
+        event->data.evt_gatt_mtu_exchanged.mtu = mtu;
+    }
+    return;
+}
+
+//! simGeckoPeerSubscribe()
+//! @brief Queue the event of a peer writing a characteristic's CCCD
+//!
+//! @param connection
+//! @param characteristic
+//! @param flags gatt_notification, gatt_indication or gatt_disable
+//! @returns void
+void simGeckoPeerSubscribe( uint8_t connection, uint16_t characteristic, uint8_t flags )
+{
+    struct gecko_cmd_packet *event = pushEvent( gecko_evt_gatt_server_characteristic_status_id,
+        sizeof( struct gecko_msg_gatt_server_characteristic_status_evt_t ) );
+    if( event )
+    {
+        event->data.evt_gatt_server_characteristic_status.connection = connection;
+        event->data.evt_gatt_server_characteristic_status.characteristic = characteristic;
+        event->data.evt_gatt_server_characteristic_status.status_flags = gatt_server_client_config;
+        event->data.evt_gatt_server_characteristic_status.client_config_flags = flags;
+    }
+    return;
+}
+
+//! simGeckoClose()
+//! @brief Lose a link from the peer's side, as on a supervision timeout
+//!
+//! @param connection
+//! @param reason
+//! @returns void
+void simGeckoClose( uint8_t connection, uint16_t reason )
+{
+    closeLink( connection, reason );
+    return;
+}
+
+//! simGeckoAddPeer()
+//! @brief Add a peer. It starts advertising, if it does, one advertising
+//! interval from now
+//!
+//! @param peer
+//! @returns void
+void simGeckoAddPeer( simGeckoPeer_s *peer )
+{
+    peer->connection = 0;
+    peer->subscribed = false;
+    peer->indicationQueued = false;
+    peer->indicationPending = false;
+    peer->nextAdvertisingUs = nowUs + peer->advertisingIntervalUs + advDelay();
+    peer->connects = 0;
+    peer->indications = 0;
+    peer->confirmations = 0;
+    peer->skipped = 0;
+    peer->next = peers;
+    peers = peer;
+    return;
+}
+
+//! simGeckoBoot()
+//! @brief Queue the system boot event
+//!
+//! @param void
+//! @returns void
+void simGeckoBoot()
+{
+    pushEvent( gecko_evt_system_boot_id, sizeof( struct gecko_msg_system_boot_evt_t ) );
+    return;
+}
+
+//! simGeckoGetMtu()
+//! @brief Returns the ATT MTU of a link
+//!
+//! @param connection
+//! @returns MTU, 0 if the link is closed
+uint16_t simGeckoGetMtu( uint8_t connection )
+{
+    return links[ connection ].open ? links[ connection ].mtu : 0;
+}
+
+//! simGeckoQueued()
+//! @brief Returns the notifications a link has waiting in stack buffers
+//!
+//! @param connection
+//! @returns number of notifications
+uint8_t simGeckoQueued( uint8_t connection )
+{
+    uint8_t queued = 0;
+    for( uint8_t i = 0; i < txQueued; i++ )
+    {
+        queued += ( txQueue[ i ].connection == connection );
+    }
+    return queued;
+}
+
+//! simGeckoPeerWrite()
+//! @brief Write request from the peer to a characteristic of type user.
+//! It arrives as a gatt_server_user_write_request event at the link's
+//! next connection event
+//!
+//! @param connection
+//! @param characteristic
+//! @param data
+//! @param len
+//! @returns void
+void simGeckoPeerWrite( uint8_t connection, uint16_t characteristic, const uint8_t *data, uint8_t len )
+{
+    if( !links[ connection ].open || ( writesQueued >= MAX_PEER_WRITES ) )
+    {
+        simGeckoStats.droppedEvents++;
+        return;
+    }
+    message_s *write = &writeQueue[ writesQueued++ ];
+    write->connection = connection;
+    write->characteristic = characteristic;
+    write->len = len;
+    memcpy( write->data, data, len );
+    return;
+}
+
+//! simGeckoWaitEvent()
+//! @brief Returns the next stack event, letting time pass up to untilUs
+//! for one to happen
+//!
+//! @param untilUs time to give up at
+//! @returns event, valid until the next call, or NULL once untilUs is reached
+struct gecko_cmd_packet *simGeckoWaitEvent( uint64_t untilUs )
+{
+    while( eventCount == 0 )
+    {
+        uint64_t nextUs = untilUs;
+        for( uint8_t c = 1; c <= SIM_GECKO_MAX_CONNECTIONS; c++ )
+        {
+            if( links[ c ].open && ( links[ c ].nextEventUs < nextUs ) )
+            {
+                nextUs = links[ c ].nextEventUs;
+            }
+        }
+        for( uint8_t handle = 0; handle < MAX_SOFT_TIMERS; handle++ )
+        {
+            if( softTimers[ handle ].active && ( softTimers[ handle ].dueUs < nextUs ) )
+            {
+                nextUs = softTimers[ handle ].dueUs;
+            }
+        }
+        for( simGeckoPeer_s *peer = peers; peer != NULL; peer = peer->next )
+        {
+            if( peer->advertising && ( peer->connection == 0 ) && ( peer->nextAdvertisingUs < nextUs ) )
+            {
+                nextUs = peer->nextAdvertisingUs;
+            }
+            if( peer->subscribed && ( peer->nextMeasurementUs < nextUs ) )
+            {
+                nextUs = peer->nextMeasurementUs;
+            }
+        }
+        if( nextUs >= untilUs )
+        {
+            nowUs = ( untilUs > nowUs ) ? untilUs : nowUs;
+            return NULL;
+        }
+        nowUs = nextUs;
+
+        for( uint8_t handle = 0; handle < MAX_SOFT_TIMERS; handle++ )
+        {
+            softTimer_s *timer = &softTimers[ handle ];
+            if( timer->active && ( timer->dueUs <= nowUs ) )
+            {
+                timer->active = !timer->singleShot;
+                timer->dueUs += timer->periodUs;
+                struct gecko_cmd_packet *event = pushEvent( gecko_evt_hardware_soft_timer_id,
+                    sizeof( struct gecko_msg_hardware_soft_timer_evt_t ) );
+                if( event )
+                {
+                    event->data.evt_hardware_soft_timer.handle = handle;
+                }
+            }
+        }
+        for( simGeckoPeer_s *peer = peers; peer != NULL; peer = peer->next )
+        {
+            if( peer->advertising && ( peer->connection == 0 ) && ( peer->nextAdvertisingUs <= nowUs ) )
+            {
+                advertise( peer );
+            }
+            if( peer->subscribed && ( peer->nextMeasurementUs <= nowUs ) )
+            {
+                measure( peer );
+            }
+        }
+        for( uint8_t c = 1; c <= SIM_GECKO_MAX_CONNECTIONS; c++ )
+        {
+            if( links[ c ].open && ( links[ c ].nextEventUs <= nowUs ) )
+            {
+                connectionEvent( c );
+            }
+        }
+    }
+
+    currentEvent = events[ eventHead ];
+    eventHead = ( eventHead + 1 ) % SIM_GECKO_MAX_EVENTS;
+    eventCount--;
+    return &currentEvent.packet;
+}
+
+//! simGeckoNowUs()
+//! @brief Returns the simulated time
+//!
+//! @param void
+//! @returns microseconds since the program started
+uint64_t simGeckoNowUs()
+{
+    return nowUs;
+}
+
+//! sli_bt_cmd_handler_delegate()
+//! @brief Run the handler of a command built by a gecko_cmd_* function,
+//! as the stack does, after clearing the response
+//!
+//! @param header
+//! @param handler
+//! @param payload
+//! @returns void
+void sli_bt_cmd_handler_delegate( uint32_t header, gecko_cmd_handler handler, const void *payload )
+{
+    ( void ) header;
+    memset( &responseBuffer, 0, sizeof( responseBuffer ) );
+    simGeckoStats.commands++;
+    handler( payload );
+    return;
+}
+
+//! sli_bt_cmd_gatt_server_send_characteristic_notification()
+//! @brief Take a notification into a stack buffer until the link's next
+//! connection event
+//!
+//! @param payload
+//! @returns void
+void sli_bt_cmd_gatt_server_send_characteristic_notification( const void *payload )
+{
+    const struct gecko_msg_gatt_server_send_characteristic_notification_cmd_t *cmd = payload;
+    uint16_t result = bg_err_success;
+    if( ( cmd->connection == 0 ) || ( cmd->connection > SIM_GECKO_MAX_CONNECTIONS )
+        || !links[ cmd->connection ].open )
+    {
+        result = bg_err_invalid_conn_handle;
+    }
+    else if( cmd->value.len > links[ cmd->connection ].mtu - 3 )
+    {
+        simGeckoStats.oversized++;
+        result = bg_err_invalid_param;
+    }
+    else if( txQueued >= txBuffers )
+    {
+        simGeckoStats.outOfMemory++;
+        result = bg_err_out_of_memory;
+    }
+    else
+    {
+        message_s *message = &txQueue[ txQueued++ ];
+        message->connection = cmd->connection;
+        message->characteristic = cmd->characteristic;
+        message->len = cmd->value.len;
+        memcpy( message->data, cmd->value.data, cmd->value.len );
+        simGeckoStats.notifications++;
+    }
+    response()->data.rsp_gatt_server_send_characteristic_notification.result = result;
+    return;
+}
+
+//! sli_bt_cmd_gatt_server_send_user_write_response()
+//! @brief Record the answer to a client write
+//!
+//! @param payload
+//! @returns void
+void sli_bt_cmd_gatt_server_send_user_write_response( const void *payload )
+{
+    const struct gecko_msg_gatt_server_send_user_write_response_cmd_t *cmd = payload;
+    simGeckoStats.writeResponses++;
+    simGeckoStats.lastWriteError = cmd->att_errorcode;
+    response()->data.rsp_gatt_server_send_user_write_response.result = bg_err_success;
+    return;
+}
+
+//! sli_bt_cmd_hardware_set_soft_timer()
+//! @brief Start or, with a time of 0, stop a soft timer
+//!
+//! @param payload
+//! @returns void
+void sli_bt_cmd_hardware_set_soft_timer( const void *payload )
+{
+    const struct gecko_msg_hardware_set_soft_timer_cmd_t *cmd = payload;
+    if( cmd->handle >= MAX_SOFT_TIMERS )
+    {
+        response()->data.rsp_hardware_set_soft_timer.result = bg_err_invalid_param;
+        return;
+    }
+    softTimer_s *timer = &softTimers[ cmd->handle ];
+    timer->active = ( cmd->time != 0 );
+    timer->singleShot = cmd->single_shot;
+    timer->periodUs = ( ( uint64_t ) cmd->time * 1000000 ) / SOFT_TIMER_HZ;
+    timer->dueUs = nowUs + timer->periodUs;
+    response()->data.rsp_hardware_set_soft_timer.result = bg_err_success;
+    return;
+}
+
+//! sli_bt_cmd_le_gap_start_discovery()
+//! @brief Report the advertising peers as scan responses
+//!
+//! @param payload
+//! @returns void
+void sli_bt_cmd_le_gap_start_discovery( const void *payload )
+{
+    ( void ) payload;
+    scanning = true;
+    response()->data.rsp_le_gap_start_discovery.result = bg_err_success;
+    return;
+}
+
+//! sli_bt_cmd_le_gap_end_procedure()
+//! @brief Stop scanning
+//!
+//! @param payload
+//! @returns void
+void sli_bt_cmd_le_gap_end_procedure( const void *payload )
+{
+    ( void ) payload;
+    scanning = false;
+    response()->data.rsp_le_gap_end_procedure.result = bg_err_success;
+    return;
+}
+
+//! sli_bt_cmd_le_gap_connect()
+//! @brief Start setting up a link, completed at the peer's next
+//! advertising event. One link is set up at a time, and links being set
+//! up count against the stack's connections
+//!
+//! @param payload
+//! @returns void
+void sli_bt_cmd_le_gap_connect( const void *payload )
+{
+    const struct gecko_msg_le_gap_connect_cmd_t *cmd = payload;
+    struct gecko_msg_le_gap_connect_rsp_t *rsp = &response()->data.rsp_le_gap_connect;
+    uint8_t inUse = 0;
+    uint8_t free = 0;
+    for( uint8_t c = SIM_GECKO_MAX_CONNECTIONS; c > 0; c-- )
+    {
+        if( links[ c ].connecting )
+        {
+            simGeckoStats.connectRefused++;
+            rsp->result = bg_err_wrong_state;
+            return;
+        }
+        if( isInUse( c ) )
+        {
+            inUse++;
+        }
+        else
+        {
+            free = c;
+        }
+    }
+    if( ( inUse >= SIM_GECKO_STACK_CONNECTIONS ) || ( free == 0 ) )
+    {
+        simGeckoStats.connectRefused++;
+        rsp->result = bg_err_bt_connection_limit_exceeded;
+        return;
+    }
+
+    link_s *link = &links[ free ];
+    memset( link, 0, sizeof( *link ) );
+    link->connecting = true;
+    for( simGeckoPeer_s *peer = peers; peer != NULL; peer = peer->next )
+    {
+        if( 0 == memcmp( peer->address.addr, cmd->address.addr, sizeof( cmd->address.addr ) ) )
+        {
+            link->peer = peer;
+        }
+    }
+    simGeckoStats.connectAttempts++;
+    rsp->result = bg_err_success;
+    rsp->connection = free;
+    return;
+}
+
+//! sli_bt_cmd_le_connection_close()
+//! @brief Close a link, or cancel one being set up
+//!
+//! @param payload
+//! @returns void
+void sli_bt_cmd_le_connection_close( const void *payload )
+{
+    const struct gecko_msg_le_connection_close_cmd_t *cmd = payload;
+    if( !isInUse( cmd->connection ) )
+    {
+        response()->data.rsp_le_connection_close.result = bg_err_invalid_conn_handle;
+        return;
+    }
+    closeLink( cmd->connection, bg_err_bt_connection_terminated_by_local_host );
+    response()->data.rsp_le_connection_close.result = bg_err_success;
+    return;
+}
+
+//! sli_bt_cmd_le_connection_set_parameters()
+//! @brief Apply the shortest interval asked for and report the new
+//! parameters
+//!
+//! @param payload
+//! @returns void
+void sli_bt_cmd_le_connection_set_parameters( const void *payload )
+{
+    const struct gecko_msg_le_connection_set_parameters_cmd_t *cmd = payload;
+    if( !isOpen( cmd->connection ) )
+    {
+        response()->data.rsp_le_connection_set_parameters.result = bg_err_invalid_conn_handle;
+        return;
+    }
+    simGeckoStats.parameterRequests++;
+    simGeckoStats.lastMinInterval = cmd->min_interval;
+    links[ cmd->connection ].intervalUs = ( uint32_t ) cmd->min_interval * 1250;
+    struct gecko_cmd_packet *event = pushEvent( gecko_evt_le_connection_parameters_id,
+        sizeof( struct gecko_msg_le_connection_parameters_evt_t ) );
+    if( event )
+    {
+        event->data.evt_le_connection_parameters.connection = cmd->connection;
+        event->data.evt_le_connection_parameters.interval = cmd->min_interval;
+        event->data.evt_le_connection_parameters.latency = cmd->latency;
+        event->data.evt_le_connection_parameters.timeout = cmd->timeout;
+        event->data.evt_le_connection_parameters.txsize = 27;
+    }
+    response()->data.rsp_le_connection_set_parameters.result = bg_err_success;
+    return;
+}
+
+//! sli_bt_cmd_le_connection_get_rssi()
+//! @brief Report the RSSI of a link's peer
+//!
+//! @param payload
+//! @returns void
+void sli_bt_cmd_le_connection_get_rssi( const void *payload )
+{
+    const struct gecko_msg_le_connection_get_rssi_cmd_t *cmd = payload;
+    if( !isOpen( cmd->connection ) )
+    {
+        response()->data.rsp_le_connection_get_rssi.result = bg_err_invalid_conn_handle;
+        return;
+    }
+    struct gecko_cmd_packet *event = pushEvent( gecko_evt_le_connection_rssi_id,
+        sizeof( struct gecko_msg_le_connection_rssi_evt_t ) );
+    if( event )
+    {
+        event->data.evt_le_connection_rssi.connection = cmd->connection;
+        event->data.evt_le_connection_rssi.rssi = links[ cmd->connection ].peer ?
+            links[ cmd->connection ].peer->rssi : -60;
+    }
+    response()->data.rsp_le_connection_get_rssi.result = bg_err_success;
+    return;
+}
+
+//! startProcedure()
+//! @brief Start a GATT client procedure on a link to a peer. A link runs
+//! one procedure at a time
+//!
+//! @param connection
+//! @param procedure
+//! @returns result of the command
+static uint16_t startProcedure( uint8_t connection, procedure_e procedure )
+{
+    if( !isOpen( connection ) || ( links[ connection ].peer == NULL ) )
+    {
+        simGeckoStats.gattErrors++;
+        return bg_err_invalid_conn_handle;
+    }
+    if( links[ connection ].procedure != PROCEDURE_NONE )
+    {
+        simGeckoStats.gattErrors++;
+        return bg_err_wrong_state;
+    }
+    links[ connection ].procedure = procedure;
+    return bg_err_success;
+}
+
+//! sli_bt_cmd_gatt_discover_primary_services_by_uuid()
+//! @brief Look for a service on the peer
+//!
+//! @param payload
+//! @returns void
+void sli_bt_cmd_gatt_discover_primary_services_by_uuid( const void *payload )
+{
+    const struct gecko_msg_gatt_discover_primary_services_by_uuid_cmd_t *cmd = payload;
+    uint16_t result = startProcedure( cmd->connection, PROCEDURE_SERVICES );
+    if( result == bg_err_success )
+    {
+        links[ cmd->connection ].procedureMatch = ( cmd->uuid.len == sizeof( HTM_SERVICE_UUID ) )
+            && ( 0 == memcmp( cmd->uuid.data, HTM_SERVICE_UUID, sizeof( HTM_SERVICE_UUID ) ) );
+    }
+    response()->data.rsp_gatt_discover_primary_services_by_uuid.result = result;
+    return;
+}
+
+//! sli_bt_cmd_gatt_discover_characteristics_by_uuid()
+//! @brief Look for a characteristic of a service on the peer
+//!
+//! @param payload
+//! @returns void
+void sli_bt_cmd_gatt_discover_characteristics_by_uuid( const void *payload )
+{
+    const struct gecko_msg_gatt_discover_characteristics_by_uuid_cmd_t *cmd = payload;
+    uint16_t result = startProcedure( cmd->connection, PROCEDURE_CHARACTERISTICS );
+    if( result == bg_err_success )
+    {
+        links[ cmd->connection ].procedureService = cmd->service;
+        links[ cmd->connection ].procedureMatch = ( cmd->uuid.len == sizeof( HTM_TEMPERATURE_UUID ) )
+            && ( 0 == memcmp( cmd->uuid.data, HTM_TEMPERATURE_UUID, sizeof( HTM_TEMPERATURE_UUID ) ) );
+    }
+    response()->data.rsp_gatt_discover_characteristics_by_uuid.result = result;
+    return;
+}
+
+//! sli_bt_cmd_gatt_set_characteristic_notification()
+//! @brief Write the peer's client characteristic configuration
+//!
+//! @param payload
+//! @returns void
+void sli_bt_cmd_gatt_set_characteristic_notification( const void *payload )
+{
+    const struct gecko_msg_gatt_set_characteristic_notification_cmd_t *cmd = payload;
+    uint16_t result = startProcedure( cmd->connection, PROCEDURE_NOTIFICATION );
+    if( result == bg_err_success )
+    {
+        links[ cmd->connection ].procedureCharacteristic = cmd->characteristic;
+        links[ cmd->connection ].procedureFlags = cmd->flags;
+    }
+    response()->data.rsp_gatt_set_characteristic_notification.result = result;
+    return;
+}
+
+//! sli_bt_cmd_gatt_send_characteristic_confirmation()
+//! @brief Confirm the peer's outstanding indication, which lets it send
+//! the next one
+//!
+//! @param payload
+//! @returns void
+void sli_bt_cmd_gatt_send_characteristic_confirmation( const void *payload )
+{
+    const struct gecko_msg_gatt_send_characteristic_confirmation_cmd_t *cmd = payload;
+    simGeckoPeer_s *peer = isOpen( cmd->connection ) ? links[ cmd->connection ].peer : NULL;
+    if( ( peer == NULL ) || !peer->indicationPending )
+    {
+        response()->data.rsp_gatt_send_characteristic_confirmation.result = bg_err_wrong_state;
+        return;
+    }
+    peer->indicationPending = false;
+    peer->confirmations++;
+    response()->data.rsp_gatt_send_characteristic_confirmation.result = bg_err_success;
+    return;
+}
+
+//! sli_bt_cmd_system_get_bt_address()
+//! @brief Returns the address of the device under test
+//!
+//! @param payload
+//! @returns void
+void sli_bt_cmd_system_get_bt_address( const void *payload )
+{
+    static const bd_addr ADDRESS = {{ 0x00, 0x00, 0x00, 0x23, 0x58, 0xEC }};
+    ( void ) payload;
+    response()->data.rsp_system_get_bt_address.address = ADDRESS;
+    return;
+}
+
+//! sli_bt_cmd_system_halt()
+//! @brief Note whether the stack is halted, for the TX power checks
+//!
+//! @param payload
+//! @returns void
+void sli_bt_cmd_system_halt( const void *payload )
+{
+    const struct gecko_msg_system_halt_cmd_t *cmd = payload;
+    halted = ( cmd->halt != 0 );
+    if( halted )
+    {
+        simGeckoStats.halts++;
+    }
+    return;
+}
+
+//! sli_bt_cmd_system_set_tx_power()
+//! @brief Accept any TX power
+//!
+//! @param payload
+//! @returns void
+void sli_bt_cmd_system_set_tx_power( const void *payload )
+{
+    const struct gecko_msg_system_set_tx_power_cmd_t *cmd = payload;
+    simGeckoStats.txPowerSets++;
+    if( !halted )
+    {
+        simGeckoStats.txPowerUnhalted++;
+    }
+    simGeckoStats.lastTxPower = cmd->power;
+    response()->data.rsp_system_set_tx_power.set_power = cmd->power;
+    return;
+}
+
+//! sli_bt_cmd_flash_ps_load()
+//! @brief The persistent store of the stand-in is empty
+//!
+//! @param payload
+//! @returns void
+void sli_bt_cmd_flash_ps_load( const void *payload )
+{
+    ( void ) payload;
+    response()->data.rsp_flash_ps_load.result = bg_err_hardware_ps_key_not_found;
+    return;
+}
+
+//! Commands that only need to succeed: the delegate cleared the response,
+//! which leaves a result of bg_err_success
+void sli_bt_cmd_flash_ps_save( const void *payload ) { ( void ) payload; }
+void sli_bt_cmd_gatt_server_send_user_read_response( const void *payload ) { ( void ) payload; }
+void sli_bt_cmd_gatt_server_write_attribute_value( const void *payload ) { ( void ) payload; }
+void sli_bt_cmd_le_gap_set_advertise_timing( const void *payload ) { ( void ) payload; }
+void sli_bt_cmd_le_gap_set_discovery_timing( const void *payload ) { ( void ) payload; }
+void sli_bt_cmd_le_gap_set_discovery_type( const void *payload ) { ( void ) payload; }
+void sli_bt_cmd_le_gap_start_advertising( const void *payload ) { ( void ) payload; }
+void sli_bt_cmd_sm_configure( const void *payload ) { ( void ) payload; }
+void sli_bt_cmd_sm_delete_bondings( const void *payload ) { ( void ) payload; }
+void sli_bt_cmd_sm_set_bondable_mode( const void *payload ) { ( void ) payload; }
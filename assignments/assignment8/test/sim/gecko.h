@@ -0,0 +1,141 @@
+//!
+//! @file gecko.h
+//! @brief Bluetooth stack stand-in. Implements the sli_bt_cmd_* handlers
+//! behind the gecko_cmd_* calls of native_gecko.h, so firmware sources
+//! call the stack exactly as on the board. Links to peers are modelled
+//! as connection events at the connection interval, each carrying a
+//! limited number of packets, with notifications held in a shared pool
+//! of stack buffers until they are sent. Stack events are queued and
+//! handed to the test by simGeckoWaitEvent(), as gecko_wait_event() hands
+//! them to the firmware. For a client build, peers play the servers: they
+//! advertise, accept connections, answer GATT discovery of the Health
+//! Thermometer service and indicate temperatures
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources Silicon Labs Bluetooth API reference (UG136)
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#ifndef __SIM_GECKO_H___
+#define __SIM_GECKO_H___
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "native_gecko.h"
+
+//! Connection handles 1 to SIM_GECKO_MAX_CONNECTIONS can be open
+#define SIM_GECKO_MAX_CONNECTIONS   ( 8 )
+
+//! Bytes of a command, response or event packet, header included
+#define SIM_GECKO_PACKET_SIZE       ( 4 + 256 )
+
+//! Events the stack holds before it drops them
+#define SIM_GECKO_MAX_EVENTS        ( 64 )
+
+//! Notifications the stack buffers by default, over all connections
+#define SIM_GECKO_TX_BUFFERS        ( 10 )
+
+//! Links the stack can have open or being set up at once, MAX_CONNECTIONS
+//! in gecko_main.c
+#define SIM_GECKO_STACK_CONNECTIONS ( 4 )
+
+//! Connection interval a link opens with, before any parameter update
+#define SIM_GECKO_DEFAULT_INTERVAL_US   ( 50000 )
+
+//! Handles of the Health Thermometer service and of the Temperature
+//! Measurement value on a peer
+#define SIM_GECKO_HTM_SERVICE       ( 0x00010020 )
+#define SIM_GECKO_HTM_TEMPERATURE   ( 0x0023 )
+
+//! Called with each notification a peer receives
+typedef void ( *simGeckoNotify_f )( uint8_t connection, uint16_t characteristic,
+    const uint8_t *data, uint8_t len );
+
+//! Peer the firmware connects to as a client. The test sets the fields
+//! up to milliC, the stand-in keeps the others
+typedef struct simGeckoPeer_s
+{
+    struct simGeckoPeer_s *next;
+    bd_addr address;
+    bool advertising;               //! Advertises while not connected
+    bool connectable;               //! Accepts connection requests
+    bool thermometer;               //! Exposes the Health Thermometer service
+    uint32_t advertisingIntervalUs;
+    uint32_t measurementIntervalUs; //! Time between temperatures
+    int8_t rssi;
+    int32_t milliC;                 //! Temperature of the first indication, each one after is 1 mC higher
+
+    uint8_t connection;             //! Handle of the open link, 0 if none
+    bool subscribed;                //! Indications enabled by the client
+    bool indicationQueued;          //! Indication waiting for a connection event
+    bool indicationPending;         //! Indication sent and not confirmed
+    uint64_t nextAdvertisingUs;
+    uint64_t nextMeasurementUs;
+    uint32_t connects;              //! Links opened
+    uint32_t indications;           //! Temperatures indicated
+    uint32_t confirmations;         //! Confirmations received
+    uint32_t skipped;               //! Temperatures not indicated, the previous one being unconfirmed
+} simGeckoPeer_s;
+
+//! Counters of the stack
+typedef struct
+{
+    uint32_t notifications;         //! Notifications accepted
+    uint32_t delivered;             //! Notifications received by peers
+    uint32_t outOfMemory;           //! Notifications refused for want of a buffer
+    uint32_t oversized;             //! Notifications longer than ATT_MTU - 3
+    uint32_t connectionEvents;      //! Connection events on all links
+    uint32_t writeResponses;        //! gecko_cmd_gatt_server_send_user_write_response() calls
+    uint8_t lastWriteError;         //! ATT error of the last write response
+    uint32_t droppedEvents;         //! Events lost to a full event queue
+    uint32_t commands;              //! gecko_cmd_* calls
+    uint32_t scanResponses;         //! Scan responses reported
+    uint32_t connectAttempts;       //! gecko_cmd_le_gap_connect() calls accepted
+    uint32_t connectRefused;        //! gecko_cmd_le_gap_connect() calls refused
+    uint32_t gattErrors;            //! GATT procedures started on a busy or closed link
+    uint32_t parameterRequests;     //! gecko_cmd_le_connection_set_parameters() calls accepted
+    uint16_t lastMinInterval;       //! Minimum interval of the last one, in 1.25 ms units
+    uint32_t halts;                 //! gecko_cmd_system_halt( 1 ) calls
+    uint32_t txPowerSets;           //! gecko_cmd_system_set_tx_power() calls
+    uint32_t txPowerUnhalted;       //! Of those, calls made while the stack ran
+    int16_t lastTxPower;            //! TX power of the last one, in 0.1 dBm
+} simGeckoStats_s;
+
+extern simGeckoStats_s simGeckoStats;
+
+void simGeckoReset( uint8_t txBuffers );
+
+void simGeckoOnNotification( simGeckoNotify_f notify );
+
+void simGeckoOpen( uint8_t connection, uint16_t mtu, uint32_t intervalUs, uint8_t packetsPerEvent );
+
+void simGeckoPeerSubscribe( uint8_t connection, uint16_t characteristic, uint8_t flags );
+
+void simGeckoClose( uint8_t connection, uint16_t reason );
+
+void simGeckoAddPeer( simGeckoPeer_s *peer );
+
+void simGeckoBoot();
+
+uint16_t simGeckoGetMtu( uint8_t connection );
+
+uint8_t simGeckoQueued( uint8_t connection );
+
+void simGeckoPeerWrite( uint8_t connection, uint16_t characteristic, const uint8_t *data, uint8_t len );
+
+struct gecko_cmd_packet *simGeckoWaitEvent( uint64_t untilUs );
+
+uint64_t simGeckoNowUs();
+
+#endif // __SIM_GECKO_H___
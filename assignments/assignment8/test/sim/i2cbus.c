@@ -0,0 +1,470 @@
+//!
+//! @file i2cbus.c
+//! @brief Implements the I2C0 bus simulator
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources None
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#include "i2cbus.h"
+
+#include "em_core.h"
+#include "em_device.h"
+#include "i2cspm.h"
+#include "gpio.h"
+#include "irq.h"
+#include "ldma.h"
+
+#include <stddef.h>
+#include <string.h>
+
+I2C_TypeDef simI2c0;
+
+simI2cStats_s simI2cStats;
+
+uint32_t simI2cLdmaCommands[ SIM_I2C_COMMAND_MAX ];
+unsigned simI2cLdmaCommandsLen;
+
+//! Attached slaves
+static simI2cSlave_s *slaves = NULL;
+
+//! Transfer in progress, NULL while the bus is idle
+static const I2C_TransferSeq_TypeDef *current = NULL;
+static simI2cSlave_s *currentSlave = NULL;
+static simI2cReply_s currentReply;
+static unsigned interruptsLeft = 0;
+
+//! Descriptor list of the LDMA transfer in progress, NULL while the
+//! channel is disabled
+static const DMA_DESCRIPTOR_TypeDef *ldmaList = NULL;
+
+//! Whether the LDMA channel ran its whole descriptor list
+static bool ldmaDone = false;
+
+//! Whether I2C0 is enabled
+static bool enabled = false;
+
+//! Levels driven on the pins while they are GPIOs, and the SCL clocks
+//! left before a slave lets go of SDA
+static bool sclOut = true;
+static bool sdaOut = true;
+static uint8_t sdaHeldClocks = 0;
+
+//! checkAbort()
+//! @brief End the byte by byte transfer in progress if I2C_CMD_ABORT was
+//! written
+//!
+//! @param void
+//! @returns void
+static void checkAbort()
+{
+    if( simI2c0.CMD & I2C_CMD_ABORT )
+    {
+        simI2c0.CMD = 0;
+        if( current != NULL )
+        {
+            simI2cStats.aborts++;
+            current = NULL;
+        }
+    }
+    return;
+}
+
+//! copyWritten()
+//! @brief Append a write buffer to the bytes the slave records
+//!
+//! @param slave
+//! @param data
+//! @param len
+//! @returns void
+static void copyWritten( simI2cSlave_s *slave, const uint8_t *data, uint16_t len )
+{
+    for( uint16_t i = 0; ( i < len ) && ( slave->writtenLen < SIM_I2C_WRITE_MAX ); i++ )
+    {
+        slave->written[ slave->writtenLen++ ] = data[ i ];
+    }
+    return;
+}
+
+//! copyRead()
+//! @brief Fill a read buffer from the reply, 0xFF past its end as with a
+//! released bus
+//!
+//! @param reply
+//! @param offset first reply byte to copy
+//! @param data
+//! @param len
+//! @returns void
+static void copyRead( const simI2cReply_s *reply, uint16_t offset, uint8_t *data, uint16_t len )
+{
+    for( uint16_t i = 0; i < len; i++ )
+    {
+        data[ i ] = ( ( offset + i ) < reply->readLen ) ? reply->read[ offset + i ] : 0xFF;
+    }
+    return;
+}
+
+//! emlibInterrupts()
+//! @brief Number of interrupts I2C_Transfer() takes for a sequence: one
+//! per address and data byte, and the MSTOP after the STOP
+//!
+//! @param seq
+//! @returns interrupt count
+static unsigned emlibInterrupts( const I2C_TransferSeq_TypeDef *seq )
+{
+    unsigned interrupts = seq->buf[ 0 ].len + 2;
+    if( seq->flags & I2C_FLAG_WRITE_READ )
+    {
+        interrupts += seq->buf[ 1 ].len + 1;
+    }
+    else if( seq->flags & I2C_FLAG_WRITE_WRITE )
+    {
+        interrupts += seq->buf[ 1 ].len;
+    }
+    return interrupts;
+}
+
+//! startReply()
+//! @brief Look up the slave a transfer is addressed to and take its next
+//! scripted reply. Without a slave the address is NACKed, and while a
+//! slave holds SDA low the START is lost
+//!
+//! @param addr 7-bit address
+//! @returns void
+static void startReply( uint8_t addr )
+{
+    simI2cStats.starts++;
+    if( ( current != NULL ) || ( ldmaList != NULL ) )
+    {
+        simI2cStats.restarts++;
+    }
+    currentSlave = NULL;
+    interruptsLeft = 1;
+    memset( &currentReply, 0, sizeof( currentReply ) );
+    if( sdaHeldClocks > 0 )
+    {
+        currentReply.result = i2cTransferArbLost;
+        return;
+    }
+    for( simI2cSlave_s *slave = slaves; slave != NULL; slave = slave->next )
+    {
+        if( slave->addr == addr )
+        {
+            currentSlave = slave;
+        }
+    }
+    if( currentSlave == NULL )
+    {
+        currentReply.result = i2cTransferNack;
+        return;
+    }
+    unsigned index = currentSlave->transfers++;
+    if( index >= currentSlave->scriptLen )
+    {
+        index = currentSlave->scriptLen - 1;
+    }
+    currentReply = currentSlave->script[ index ];
+    if( currentReply.result == i2cTransferInProgress )
+    {
+        interruptsLeft = 0;
+    }
+    return;
+}
+
+//! ldmaRun()
+//! @brief Complete the LDMA transfer in progress. On success, walks the
+//! descriptor list as the channel would: reads from RXDATA get the reply
+//! bytes, writes to TXDATA are recorded by the slave and immediate writes
+//! to CMD are logged. Then raises the flags of the final I2C0 interrupt
+//!
+//! @param void
+//! @returns void
+static void ldmaRun()
+{
+    interruptsLeft = 0;
+    sdaHeldClocks = currentReply.holdSdaClocks;
+    if( currentReply.result == i2cTransferArbLost )
+    {
+        simI2c0.IF |= I2C_IF_ARBLOST;
+        return;
+    }
+    if( currentReply.result != i2cTransferDone )
+    {
+        simI2c0.IF |= ( currentReply.result == i2cTransferNack ) ? ( I2C_IF_MSTOP | I2C_IF_NACK ) : I2C_IF_BUSERR;
+        return;
+    }
+    uint16_t readLen = 0;
+    currentSlave->writtenLen = 0;
+    const DMA_DESCRIPTOR_TypeDef *desc = ldmaList;
+    while( desc != NULL )
+    {
+        uint16_t count = ( ( desc->CTRL & _LDMA_CH_CTRL_XFERCNT_MASK ) >> _LDMA_CH_CTRL_XFERCNT_SHIFT ) + 1;
+        if( ( desc->CTRL & _LDMA_CH_CTRL_STRUCTTYPE_MASK ) == LDMA_CH_CTRL_STRUCTTYPE_WRITE )
+        {
+            if( ( desc->DST == &simI2c0.CMD ) && ( simI2cLdmaCommandsLen < SIM_I2C_COMMAND_MAX ) )
+            {
+                simI2cLdmaCommands[ simI2cLdmaCommandsLen++ ] = ( uint32_t ) ( uintptr_t ) desc->SRC;
+            }
+        }
+        else if( desc->SRC == &simI2c0.RXDATA )
+        {
+            copyRead( &currentReply, readLen, ( uint8_t * ) desc->DST, count );
+            readLen += count;
+        }
+        else if( desc->DST == &simI2c0.TXDATA )
+        {
+            copyWritten( currentSlave, ( const uint8_t * ) desc->SRC, count );
+        }
+        desc = ( ( uintptr_t ) desc->LINK & LDMA_CH_LINK_LINK ) ?
+            ( const DMA_DESCRIPTOR_TypeDef * ) ( ( uintptr_t ) desc->LINK & _LDMA_CH_LINK_LINKADDR_MASK ) : NULL;
+    }
+    ldmaDone = true;
+    simI2c0.IF |= I2C_IF_MSTOP;
+    return;
+}
+
+//! simI2cReset()
+//! @brief Detach every slave and return the bus to idle
+//!
+//! @param void
+//! @returns void
+void simI2cReset()
+{
+    slaves = NULL;
+    current = NULL;
+    currentSlave = NULL;
+    interruptsLeft = 0;
+    ldmaList = NULL;
+    ldmaDone = false;
+    enabled = false;
+    sclOut = true;
+    sdaOut = true;
+    sdaHeldClocks = 0;
+    simI2cLdmaCommandsLen = 0;
+    memset( &simI2c0, 0, sizeof( simI2c0 ) );
+    memset( &simI2cStats, 0, sizeof( simI2cStats ) );
+    return;
+}
+
+//! simI2cAttach()
+//! @brief Put a slave on the bus. Its counters are reset
+//!
+//! @param slave
+//! @returns void
+void simI2cAttach( simI2cSlave_s *slave )
+{
+    slave->transfers = 0;
+    slave->writtenLen = 0;
+    slave->next = slaves;
+    slaves = slave;
+    return;
+}
+
+//! simI2cInterrupt()
+//! @brief Take one I2C0 interrupt if the transfer in progress is waiting
+//! for one and interrupts are enabled and not masked. An LDMA transfer
+//! runs to the end first
+//!
+//! @param void
+//! @returns true if I2C0_IRQHandler() was called
+bool simI2cInterrupt()
+{
+    checkAbort();
+    if( !simI2cBusy() || ( interruptsLeft == 0 ) || ( simI2c0.IEN == 0 ) ||
+        !( simNvicEnabled & ( 1UL << I2C0_IRQn ) ) || ( coreCriticalDepth != 0 ) )
+    {
+        return false;
+    }
+    simI2cStats.interrupts++;
+    if( ldmaList != NULL )
+    {
+        ldmaRun();
+    }
+    I2C0_IRQHandler();
+    return true;
+}
+
+//! simI2cBusy()
+//! @brief Returns whether a transfer is in progress
+//!
+//! @param void
+//! @returns true if busy
+bool simI2cBusy()
+{
+    checkAbort();
+    return ( current != NULL ) || ( ldmaList != NULL );
+}
+
+void I2CSPM_Init( I2CSPM_Init_TypeDef *init )
+{
+    ( void ) init;
+    simI2cStats.inits++;
+    I2C_Reset( I2C0 );
+    simI2c0.ROUTEPEN = 0x3;
+    enabled = true;
+    return;
+}
+
+void I2C_Enable( I2C_TypeDef *i2c, bool enable )
+{
+    ( void ) i2c;
+    enabled = enable;
+    return;
+}
+
+void I2C_Reset( I2C_TypeDef *i2c )
+{
+    ( void ) i2c;
+    current = NULL;
+    ldmaList = NULL;
+    interruptsLeft = 0;
+    memset( &simI2c0, 0, sizeof( simI2c0 ) );
+    return;
+}
+
+void I2C_IntClear( I2C_TypeDef *i2c, uint32_t flags )
+{
+    i2c->IF &= ~flags;
+    return;
+}
+
+I2C_TransferReturn_TypeDef I2C_TransferInit( I2C_TypeDef *i2c, I2C_TransferSeq_TypeDef *seq )
+{
+    ( void ) i2c;
+    checkAbort();
+    if( ( seq == NULL ) || !enabled )
+    {
+        return i2cTransferUsageFault;
+    }
+    startReply( seq->addr >> 1 );
+    current = seq;
+    simI2c0.IEN = _I2C_IF_MASK;
+    // A slave that hangs leaves no interrupts to take
+    if( interruptsLeft > 0 )
+    {
+        interruptsLeft = ( currentReply.interrupts > 0 ) ? currentReply.interrupts :
+            ( currentReply.result == i2cTransferDone ) ? emlibInterrupts( seq ) : 1;
+    }
+    return i2cTransferInProgress;
+}
+
+I2C_TransferReturn_TypeDef I2C_Transfer( I2C_TypeDef *i2c )
+{
+    ( void ) i2c;
+    checkAbort();
+    if( current == NULL )
+    {
+        return i2cTransferUsageFault;
+    }
+    if( interruptsLeft > 1 )
+    {
+        interruptsLeft--;
+        return i2cTransferInProgress;
+    }
+    const I2C_TransferSeq_TypeDef *seq = current;
+    simI2cSlave_s *slave = currentSlave;
+    current = NULL;
+    interruptsLeft = 0;
+    simI2c0.IEN = 0;
+    if( ( slave != NULL ) && ( currentReply.result == i2cTransferDone ) )
+    {
+        slave->writtenLen = 0;
+        if( seq->flags & ( I2C_FLAG_WRITE | I2C_FLAG_WRITE_READ | I2C_FLAG_WRITE_WRITE ) )
+        {
+            copyWritten( slave, seq->buf[ 0 ].data, seq->buf[ 0 ].len );
+        }
+        if( seq->flags & I2C_FLAG_WRITE_WRITE )
+        {
+            copyWritten( slave, seq->buf[ 1 ].data, seq->buf[ 1 ].len );
+        }
+        if( seq->flags & I2C_FLAG_READ )
+        {
+            copyRead( &currentReply, 0, seq->buf[ 0 ].data, seq->buf[ 0 ].len );
+        }
+        if( seq->flags & I2C_FLAG_WRITE_READ )
+        {
+            copyRead( &currentReply, 0, seq->buf[ 1 ].data, seq->buf[ 1 ].len );
+        }
+    }
+    sdaHeldClocks = currentReply.holdSdaClocks;
+    return currentReply.result;
+}
+
+void gpioI2cSdaDisable()
+{
+    return;
+}
+
+void gpioI2cSclDisable()
+{
+    return;
+}
+
+void gpioI2cBusRelease()
+{
+    sclOut = true;
+    sdaOut = true;
+    return;
+}
+
+void gpioI2cSclSet( bool high )
+{
+    if( high && !sclOut && ( sdaHeldClocks > 0 ) )
+    {
+        sdaHeldClocks--;
+    }
+    sclOut = high;
+    return;
+}
+
+void gpioI2cSdaSet( bool high )
+{
+    sdaOut = high;
+    return;
+}
+
+bool gpioI2cSclIsHigh()
+{
+    return sclOut;
+}
+
+bool gpioI2cSdaIsHigh()
+{
+    return sdaOut && ( sdaHeldClocks == 0 );
+}
+
+void ldmaStartTransfer( uint8_t channel, uint32_t reqsel, const DMA_DESCRIPTOR_TypeDef *desc )
+{
+    ( void ) channel;
+    ( void ) reqsel;
+    simI2cStats.ldmaStarts++;
+    startReply( ( simI2c0.TXDATA & 0xFF ) >> 1 );
+    ldmaList = desc;
+    ldmaDone = false;
+    simI2cLdmaCommandsLen = 0;
+    return;
+}
+
+void ldmaStopTransfer( uint8_t channel )
+{
+    ( void ) channel;
+    ldmaList = NULL;
+    return;
+}
+
+bool ldmaTransferDone( uint8_t channel )
+{
+    ( void ) channel;
+    return ldmaDone;
+}
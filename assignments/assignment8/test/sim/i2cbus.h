@@ -0,0 +1,89 @@
+//!
+//! @file i2cbus.h
+//! @brief I2C0 bus simulator with scripted slaves. Implements the emlib
+//! I2C and I2CSPM calls of shim/, the I2C pin functions of gpio.h and the
+//! LDMA channel calls of ldma.h. A transfer started with
+//! I2C_TransferInit() takes the number of interrupts its slave's reply
+//! asks for, each delivered by simI2cInterrupt() through the real
+//! I2C0_IRQHandler(), and then ends with the status of the reply. A
+//! transfer started with ldmaStartTransfer() after the address is written
+//! to TXDATA runs its descriptor list and ends in a single interrupt
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources None
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#ifndef __SIM_I2CBUS_H___
+#define __SIM_I2CBUS_H___
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "em_i2c.h"
+
+//! Bytes of the last transfer a slave records
+#define SIM_I2C_WRITE_MAX   ( 16 )
+
+//! Commands of the last LDMA transfer recorded
+#define SIM_I2C_COMMAND_MAX ( 32 )
+
+//! Reply of a slave to one transfer
+typedef struct
+{
+    I2C_TransferReturn_TypeDef result;  //! Final status, i2cTransferInProgress for a slave that hangs until aborted
+    uint8_t interrupts;                 //! I2C0 interrupts a byte by byte transfer takes, 0 for
+                                        //! as many as I2C_Transfer() takes on a real bus
+    const uint8_t *read;                //! Bytes returned in the read phase
+    uint16_t readLen;
+    uint8_t holdSdaClocks;              //! SCL clocks SDA stays held low for afterwards, as by a slave reset mid-byte
+} simI2cReply_s;
+
+//! Slave on the simulated bus
+typedef struct simI2cSlave_s
+{
+    struct simI2cSlave_s *next;
+    uint8_t addr;                           //! 7-bit address
+    const simI2cReply_s *script;            //! Replies to successive transfers, the last one repeats
+    unsigned scriptLen;
+    unsigned transfers;                     //! Transfers addressed to the slave
+    uint8_t written[ SIM_I2C_WRITE_MAX ];   //! Bytes written by the last transfer
+    uint16_t writtenLen;
+} simI2cSlave_s;
+
+//! Counters of the bus
+typedef struct
+{
+    unsigned inits;         //! I2CSPM_Init() calls
+    unsigned starts;        //! Transfers started, byte by byte or by the LDMA
+    unsigned ldmaStarts;    //! Transfers started by the LDMA
+    unsigned restarts;      //! Transfers started while one was in progress
+    unsigned aborts;        //! Byte by byte transfers ended with I2C_CMD_ABORT
+    unsigned interrupts;    //! Interrupts delivered
+} simI2cStats_s;
+
+extern simI2cStats_s simI2cStats;
+
+//! Values written to I2C0->CMD by the descriptors of the last LDMA transfer
+extern uint32_t simI2cLdmaCommands[ SIM_I2C_COMMAND_MAX ];
+extern unsigned simI2cLdmaCommandsLen;
+
+void simI2cReset();
+
+void simI2cAttach( simI2cSlave_s *slave );
+
+bool simI2cInterrupt();
+
+bool simI2cBusy();
+
+#endif // __SIM_I2CBUS_H___
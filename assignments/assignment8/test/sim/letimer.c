@@ -0,0 +1,201 @@
+//!
+//! @file letimer.c
+//! @brief Implements the LETIMER0 simulator
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources EFR32xG13 reference manual, LETIMER chapter
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#include "letimer.h"
+
+#include "em_core.h"
+#include "em_letimer.h"
+#include "irq.h"
+
+LETIMER_TypeDef simLetimer0;
+
+uint32_t simLetimerIrqLatency = 0;
+
+uint32_t simLetimerReadTicks = 0;
+
+//! Ticks simulated since simLetimerStart()
+static uint64_t elapsed = 0;
+
+//! Tick at which the pending flags were first raised, valid while
+//! an enabled flag is pending
+static uint64_t pendingSince = 0;
+static bool pending = false;
+
+//! simLetimerStart()
+//! @brief Start counting from COMP0, as LETIMER_Enable() does after
+//! timerInit() loaded it
+//!
+//! @param void
+//! @returns void
+void simLetimerStart()
+{
+    simLetimer0.CNT = simLetimer0.COMP0;
+    simLetimer0.enabled = true;
+    elapsed = 0;
+    pending = false;
+    return;
+}
+
+//! ticksToNextFlag()
+//! @brief Returns the number of ticks until the counter next raises UF
+//! or COMP1
+//!
+//! @param void
+//! @returns ticks, at least 1
+static uint64_t ticksToNextFlag()
+{
+    uint64_t toUnderflow = ( uint64_t ) simLetimer0.CNT + 1;
+    uint64_t toCompare;
+    if( simLetimer0.COMP1 < simLetimer0.CNT )
+    {
+        toCompare = simLetimer0.CNT - simLetimer0.COMP1;
+    }
+    else if( simLetimer0.COMP1 <= simLetimer0.COMP0 )
+    {
+        toCompare = toUnderflow + ( simLetimer0.COMP0 - simLetimer0.COMP1 );
+    }
+    else
+    {
+        // COMP1 above the top is never reached
+        toCompare = UINT64_MAX;
+    }
+    return ( toCompare < toUnderflow ) ? toCompare : toUnderflow;
+}
+
+//! step()
+//! @brief Advance the counter by at most ticksToNextFlag() ticks and
+//! raise the flags of the tick reached
+//!
+//! @param ticks
+//! @returns void
+static void step( uint64_t ticks )
+{
+    elapsed += ticks;
+    if( ticks > simLetimer0.CNT )
+    {
+        simLetimer0.CNT = simLetimer0.COMP0 - ( uint32_t ) ( ticks - simLetimer0.CNT - 1 );
+        if( simLetimer0.CNT == simLetimer0.COMP0 )
+        {
+            simLetimer0.IF |= LETIMER_IF_UF;
+        }
+    }
+    else
+    {
+        simLetimer0.CNT -= ( uint32_t ) ticks;
+    }
+    if( simLetimer0.CNT == simLetimer0.COMP1 )
+    {
+        simLetimer0.IF |= LETIMER_IF_COMP1;
+    }
+    return;
+}
+
+//! serviceInterrupt()
+//! @brief Take the LETIMER0 interrupt if an enabled flag has been pending
+//! for the latency and interrupts are not masked
+//!
+//! @param void
+//! @returns void
+static void serviceInterrupt()
+{
+    if( ( simLetimer0.IF & simLetimer0.IEN ) == 0 )
+    {
+        pending = false;
+        return;
+    }
+    if( !pending )
+    {
+        pending = true;
+        pendingSince = elapsed;
+    }
+    if( ( coreCriticalDepth == 0 ) && ( ( elapsed - pendingSince ) >= simLetimerIrqLatency ) )
+    {
+        pending = false;
+        LETIMER0_IRQHandler();
+        // The handler may leave flags it did not clear pending
+        if( ( simLetimer0.IF & simLetimer0.IEN ) != 0 )
+        {
+            pending = true;
+            pendingSince = elapsed;
+        }
+    }
+    return;
+}
+
+//! simLetimerRun()
+//! @brief Let ticks pass, taking interrupts as they come due
+//!
+//! @param ticks
+//! @returns void
+void simLetimerRun( uint64_t ticks )
+{
+    serviceInterrupt();
+    while( ticks > 0 )
+    {
+        uint64_t next = ticksToNextFlag();
+        if( pending && ( ( pendingSince + simLetimerIrqLatency - elapsed ) < next ) )
+        {
+            next = pendingSince + simLetimerIrqLatency - elapsed;
+        }
+        if( next > ticks )
+        {
+            next = ticks;
+        }
+        if( next == 0 )
+        {
+            next = 1;
+        }
+        step( next );
+        ticks -= next;
+        serviceInterrupt();
+    }
+    return;
+}
+
+//! simLetimerCounterGet()
+//! @brief Backs LETIMER_CounterGet(). Returns the counter, then lets
+//! @ref simLetimerReadTicks pass
+//!
+//! @param letimer
+//! @returns counter value
+uint32_t simLetimerCounterGet( LETIMER_TypeDef *letimer )
+{
+    uint32_t count = letimer->CNT;
+    for( uint32_t ticks = simLetimerReadTicks; ticks > 0; )
+    {
+        uint64_t next = ticksToNextFlag();
+        if( next > ticks )
+        {
+            next = ticks;
+        }
+        step( next );
+        ticks -= ( uint32_t ) next;
+    }
+    return count;
+}
+
+//! simLetimerTicks()
+//! @brief Returns the ticks simulated since simLetimerStart()
+//!
+//! @param void
+//! @returns ticks
+uint64_t simLetimerTicks()
+{
+    return elapsed;
+}
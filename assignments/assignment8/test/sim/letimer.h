@@ -0,0 +1,44 @@
+//!
+//! @file letimer.h
+//! @brief LETIMER0 simulator. The counter counts down from COMP0 to 0 and
+//! reloads on the next tick, raising UF, and raises COMP1 when it equals
+//! COMP1, as the EFR32 LETIMER does with comp0Top. Time advances only
+//! in simLetimerRun(), which jumps from one flag to the next and calls
+//! LETIMER0_IRQHandler() for enabled flags outside critical sections
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources EFR32xG13 reference manual, LETIMER chapter
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#ifndef __SIM_LETIMER_H___
+#define __SIM_LETIMER_H___
+
+#include <stdint.h>
+
+//! Ticks from a flag being raised until its interrupt is taken, as if
+//! the main loop had interrupts masked for that long
+extern uint32_t simLetimerIrqLatency;
+
+//! Ticks that pass after each read of the counter, as if the code using
+//! the value ran that long. Flags raised meanwhile are taken as
+//! interrupts only once simLetimerRun() is called again
+extern uint32_t simLetimerReadTicks;
+
+void simLetimerStart();
+
+void simLetimerRun( uint64_t ticks );
+
+uint64_t simLetimerTicks();
+
+#endif // __SIM_LETIMER_H___
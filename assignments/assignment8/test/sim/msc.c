@@ -0,0 +1,222 @@
+//!
+//! @file msc.c
+//! @brief Implements the flash simulator
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources EFR32xG13 reference manual, MSC chapter
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#include "msc.h"
+
+#include "em_msc.h"
+
+#include <setjmp.h>
+#include <stddef.h>
+#include <string.h>
+
+//! Words in the flash log region
+#define REGION_WORDS    ( ( FLASH_LOG_PAGES * FLASH_PAGE_SIZE ) / sizeof( uint32_t ) )
+
+//! The flash log region. flashlog.c takes the address of this symbol,
+//! which the linker script places below the NVM region on the board
+uint32_t __flashLogBase[ REGION_WORDS ];
+
+simMscStats_s simMscStats;
+
+//! Word writes and page erases completed since simMscErase()
+static uint32_t operations = 0;
+
+//! Operation at which power is lost, 0 for never
+static uint32_t powerLossAt = 0;
+
+//! Context of simMscRun() to return to on power loss
+static jmp_buf powerLoss;
+static bool running = false;
+
+//! Pseudo-random state for the bits left by torn operations
+static uint32_t tornState = 0x5823;
+
+//! tornBits()
+//! @brief Returns pseudo-random bits for a torn operation
+//!
+//! @param void
+//! @returns bits
+static uint32_t tornBits()
+{
+    tornState ^= tornState << 13;
+    tornState ^= tornState >> 17;
+    tornState ^= tornState << 5;
+    return tornState;
+}
+
+//! powerCheck()
+//! @brief Count an operation, and cut the power during it if it is the
+//! one simMscPowerLossAfter() asked for
+//!
+//! @param void
+//! @returns true if power is lost during this operation
+static bool powerCheck()
+{
+    operations++;
+    return running && ( powerLossAt != 0 ) && ( operations == powerLossAt );
+}
+
+//! wordIndex()
+//! @brief Returns the word of the region at an address
+//!
+//! @param address
+//! @param index set to the word index
+//! @returns status of the address check
+static MSC_Status_TypeDef wordIndex( const uint32_t *address, size_t *index )
+{
+    uintptr_t offset = ( uintptr_t ) address - ( uintptr_t ) __flashLogBase;
+    if( ( ( uintptr_t ) address < ( uintptr_t ) __flashLogBase ) || ( offset >= sizeof( __flashLogBase ) ) )
+    {
+        return mscReturnInvalidAddr;
+    }
+    if( offset % sizeof( uint32_t ) )
+    {
+        return mscReturnUnaligned;
+    }
+    *index = offset / sizeof( uint32_t );
+    return mscReturnOk;
+}
+
+//! simMscErase()
+//! @brief Erase the whole region and reset the counters, as for a new
+//! device
+//!
+//! @param void
+//! @returns void
+void simMscErase()
+{
+    memset( __flashLogBase, 0xFF, sizeof( __flashLogBase ) );
+    memset( &simMscStats, 0, sizeof( simMscStats ) );
+    operations = 0;
+    powerLossAt = 0;
+    return;
+}
+
+//! simMscPowerLossAfter()
+//! @brief Cut the power during the given operation from now, counting
+//! word writes and page erases
+//!
+//! @param count 1 for the next operation, 0 to never cut the power
+//! @returns void
+void simMscPowerLossAfter( uint32_t count )
+{
+    powerLossAt = ( count == 0 ) ? 0 : operations + count;
+    return;
+}
+
+//! simMscRun()
+//! @brief Call work, returning early if the power is cut. The firmware's
+//! RAM is left as it was, it must be reinitialized as after a reset
+//!
+//! @param work
+//! @param arg
+//! @returns true if work completed, false if the power was cut
+bool simMscRun( void ( *work )( void *arg ), void *arg )
+{
+    running = true;
+    if( setjmp( powerLoss ) != 0 )
+    {
+        running = false;
+        powerLossAt = 0;
+        return false;
+    }
+    work( arg );
+    running = false;
+    return true;
+}
+
+//! simMscOperations()
+//! @brief Returns the number of word writes and page erases so far
+//!
+//! @param void
+//! @returns count
+uint32_t simMscOperations()
+{
+    return operations;
+}
+
+void MSC_Init()
+{
+    return;
+}
+
+MSC_Status_TypeDef MSC_WriteWord( uint32_t *address, void const *data, uint32_t numBytes )
+{
+    size_t index;
+    MSC_Status_TypeDef status = wordIndex( address, &index );
+    if( mscReturnOk != status )
+    {
+        return status;
+    }
+    if( numBytes % sizeof( uint32_t ) )
+    {
+        return mscReturnUnaligned;
+    }
+    if( ( index + ( numBytes / sizeof( uint32_t ) ) ) > REGION_WORDS )
+    {
+        return mscReturnInvalidAddr;
+    }
+    const uint8_t *bytes = data;
+    for( uint32_t i = 0; i < numBytes / sizeof( uint32_t ); i++ )
+    {
+        uint32_t word;
+        memcpy( &word, bytes + ( i * sizeof( uint32_t ) ), sizeof( word ) );
+        if( powerCheck() )
+        {
+            // Only some of the bits get programmed
+            __flashLogBase[ index + i ] &= word | tornBits();
+            longjmp( powerLoss, 1 );
+        }
+        if( word & ~__flashLogBase[ index + i ] )
+        {
+            simMscStats.badWrites++;
+        }
+        __flashLogBase[ index + i ] &= word;
+        simMscStats.wordWrites++;
+    }
+    return mscReturnOk;
+}
+
+MSC_Status_TypeDef MSC_ErasePage( uint32_t *startAddress )
+{
+    size_t index;
+    MSC_Status_TypeDef status = wordIndex( startAddress, &index );
+    if( mscReturnOk != status )
+    {
+        return status;
+    }
+    if( ( index * sizeof( uint32_t ) ) % FLASH_PAGE_SIZE )
+    {
+        return mscReturnUnaligned;
+    }
+    uint32_t page = ( index * sizeof( uint32_t ) ) / FLASH_PAGE_SIZE;
+    if( powerCheck() )
+    {
+        // Only some of the bits get erased
+        for( uint32_t i = 0; i < FLASH_PAGE_SIZE / sizeof( uint32_t ); i++ )
+        {
+            __flashLogBase[ index + i ] |= tornBits() & tornBits();
+        }
+        longjmp( powerLoss, 1 );
+    }
+    memset( &__flashLogBase[ index ], 0xFF, FLASH_PAGE_SIZE );
+    simMscStats.pageErases++;
+    simMscStats.pageEraseCounts[ page ]++;
+    return mscReturnOk;
+}
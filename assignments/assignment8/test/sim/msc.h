@@ -0,0 +1,52 @@
+//!
+//! @file msc.h
+//! @brief Flash simulator behind shim/em_msc.h. Models the flash log
+//! region as NOR flash: erase sets a page to ones and programming only
+//! clears bits. Power can be cut at any word write or page erase, which
+//! leaves that operation torn and returns to the caller of
+//! simMscRun() as a reset would
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources EFR32xG13 reference manual, MSC chapter
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#ifndef __SIM_MSC_H___
+#define __SIM_MSC_H___
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "em_device.h"
+#include "flashlog.h"
+
+//! Counters of the simulated flash
+typedef struct
+{
+    uint32_t wordWrites;                        //! Words programmed
+    uint32_t pageErases;                        //! Pages erased
+    uint32_t badWrites;                         //! Words programmed that needed a bit set from 0 to 1
+    uint32_t pageEraseCounts[ FLASH_LOG_PAGES ];  //! Erases per page since simMscErase()
+} simMscStats_s;
+
+extern simMscStats_s simMscStats;
+
+void simMscErase();
+
+void simMscPowerLossAfter( uint32_t operations );
+
+bool simMscRun( void ( *work )( void *arg ), void *arg );
+
+uint32_t simMscOperations();
+
+#endif // __SIM_MSC_H___
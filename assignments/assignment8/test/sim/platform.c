@@ -0,0 +1,32 @@
+//!
+//! @file platform.c
+//! @brief State behind the emlib, emdrv and CMSIS stand-ins in shim/
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources None
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#include "em_core.h"
+#include "em_cmu.h"
+#include "em_device.h"
+#include "sleep.h"
+
+int coreCriticalDepth = 0;
+
+uint32_t simCmuClockHz = 32768;
+uint32_t simCmuLetimerDiv = 1;
+
+uint32_t simNvicEnabled = 0;
+
+int simSleepBlocks[ sleepEM4 + 1 ];
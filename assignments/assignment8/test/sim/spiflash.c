@@ -0,0 +1,447 @@
+//!
+//! @file spiflash.c
+//! @brief Implements the SPI flash simulator
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources MX25R8035F datasheet
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#include "spiflash.h"
+#include "letimer.h"
+
+#include "ldma.h"
+
+#include "em_cmu.h"
+#include "em_gpio.h"
+#include "em_usart.h"
+
+#include <string.h>
+
+//! Size of a program page
+#define PAGE_SIZE           ( 256 )
+
+//! Longest command kept: opcode, 3-byte address and a page of data
+#define COMMAND_MAX         ( 4 + PAGE_SIZE )
+
+//! LDMA channels tracked
+#define LDMA_CHANNELS       ( 8 )
+
+USART_TypeDef simUsart1;
+
+simSpiFlashStats_s simSpiFlashStats;
+
+uint8_t simSpiFlashMemory[ FlashSize ];
+
+//! Chip select is low, and the bytes clocked in since it went low
+static bool selected = false;
+static uint8_t command[ COMMAND_MAX ];
+static uint32_t commandLen = 0;
+
+//! In deep power-down, write enable latch set, and the LETIMER0 tick the
+//! running erase or program ends at
+static bool asleep = true;
+static bool writeEnabled = false;
+static uint64_t busyUntil = 0;
+
+//! Operations made to fail by simSpiFlashFail()
+static uint8_t failCommand = 0;
+static uint32_t failCount = 0;
+static uint32_t failBusyUs = 0;
+
+//! Descriptor lists of the running LDMA channels, and whether they ended
+static const DMA_DESCRIPTOR_TypeDef *ldmaLists[ LDMA_CHANNELS ];
+static bool ldmaDone[ LDMA_CHANNELS ];
+
+//! Pseudo-random state for the bits left by failed operations
+static uint32_t tornState = 0x5823;
+
+//! tornBits()
+//! @brief Returns pseudo-random bits for a failed operation
+//!
+//! @param void
+//! @returns bits
+static uint32_t tornBits()
+{
+    tornState ^= tornState << 13;
+    tornState ^= tornState >> 17;
+    tornState ^= tornState << 5;
+    return tornState;
+}
+
+//! isBusy()
+//! @brief Returns whether an erase or program is running
+//!
+//! @param void
+//! @returns true if busy
+static bool isBusy()
+{
+    return simLetimerTicks() < busyUntil;
+}
+
+//! busyFor()
+//! @brief Keep the flash busy from now on, counted in ticks of the
+//! prescaled LETIMER0 clock
+//!
+//! @param us
+//! @returns void
+static void busyFor( uint32_t us )
+{
+    busyUntil = simLetimerTicks() + ( ( ( uint64_t ) us * ( simCmuClockHz / simCmuLetimerDiv ) ) + 999999 ) / 1000000;
+    return;
+}
+
+//! takeFailure()
+//! @brief Returns whether this operation is one simSpiFlashFail() asked for
+//!
+//! @param opcode
+//! @returns true if it fails
+static bool takeFailure( uint8_t opcode )
+{
+    if( ( failCount == 0 ) || ( failCommand != opcode ) )
+    {
+        return false;
+    }
+    failCount--;
+    simSpiFlashStats.failures++;
+    return true;
+}
+
+//! sectorErase()
+//! @brief Erase the sector holding an address, or tear it if it fails
+//!
+//! @param address
+//! @returns void
+static void sectorErase( uint32_t address )
+{
+    uint32_t base = ( address % FlashSize ) & ~( uint32_t ) ( Sector_Offset - 1 );
+    simSpiFlashStats.sectorErases++;
+    if( takeFailure( FLASH_CMD_SE ) )
+    {
+        for( uint32_t i = 0; i < Sector_Offset; i++ )
+        {
+            simSpiFlashMemory[ base + i ] |= ( uint8_t ) ( tornBits() & tornBits() );
+        }
+        busyFor( failBusyUs );
+        return;
+    }
+    memset( &simSpiFlashMemory[ base ], 0xFF, Sector_Offset );
+    busyFor( SIM_SPI_FLASH_ERASE_US );
+    return;
+}
+
+//! pageProgram()
+//! @brief Program the data of the command into the page at its address,
+//! wrapping within the page as the flash does, or only some of the bits
+//! if it fails
+//!
+//! @param address
+//! @param data
+//! @param length
+//! @returns void
+static void pageProgram( uint32_t address, const uint8_t *data, uint32_t length )
+{
+    uint32_t base = ( address % FlashSize ) & ~( uint32_t ) ( PAGE_SIZE - 1 );
+    bool failed = takeFailure( FLASH_CMD_PP );
+    simSpiFlashStats.pagePrograms++;
+    simSpiFlashStats.lastProgramPage = base / PAGE_SIZE;
+    for( uint32_t i = 0; i < length; i++ )
+    {
+        uint8_t *byte = &simSpiFlashMemory[ base + ( ( address + i ) % PAGE_SIZE ) ];
+        if( failed )
+        {
+            *byte &= data[ i ] | ( uint8_t ) tornBits();
+            continue;
+        }
+        if( data[ i ] & ~*byte )
+        {
+            simSpiFlashStats.badPrograms++;
+        }
+        *byte &= data[ i ];
+    }
+    busyFor( failed ? failBusyUs : SIM_SPI_FLASH_PROGRAM_US );
+    return;
+}
+
+//! runCommand()
+//! @brief Carry out the command clocked in, as chip select goes high
+//!
+//! @param void
+//! @returns void
+static void runCommand()
+{
+    if( commandLen == 0 )
+    {
+        // Chip select pulse ends deep power-down
+        if( asleep )
+        {
+            asleep = false;
+            simSpiFlashStats.wakeUps++;
+        }
+        return;
+    }
+    uint8_t opcode = command[ 0 ];
+    if( asleep || ( isBusy() && ( FLASH_CMD_RDSR != opcode ) ) )
+    {
+        simSpiFlashStats.ignored++;
+        return;
+    }
+    uint32_t address = ( commandLen >= 4 ) ?
+        ( ( ( uint32_t ) command[ 1 ] << 16 ) | ( ( uint32_t ) command[ 2 ] << 8 ) | command[ 3 ] ) : 0;
+    switch( opcode )
+    {
+        case FLASH_CMD_WREN:
+            writeEnabled = true;
+            break;
+        case FLASH_CMD_DP:
+            asleep = true;
+            break;
+        case FLASH_CMD_SE:
+        case FLASH_CMD_PP:
+            if( !writeEnabled || ( commandLen < 4 ) )
+            {
+                simSpiFlashStats.ignored++;
+                break;
+            }
+            writeEnabled = false;
+            if( FLASH_CMD_SE == opcode )
+            {
+                sectorErase( address );
+            }
+            else
+            {
+                pageProgram( address, &command[ 4 ], commandLen - 4 );
+            }
+            break;
+        default:
+            break;
+    }
+    return;
+}
+
+//! clockByte()
+//! @brief Clock one byte out to the flash and one back in
+//!
+//! @param data byte sent
+//! @returns byte received
+static uint8_t clockByte( uint8_t data )
+{
+    if( !selected )
+    {
+        return 0xFF;
+    }
+    uint8_t received = 0xFF;
+    if( ( commandLen >= 1 ) && ( FLASH_CMD_RDSR == command[ 0 ] ) && !asleep )
+    {
+        received = isBusy() ? FLASH_WIP_MASK : 0;
+    }
+    if( commandLen < COMMAND_MAX )
+    {
+        command[ commandLen++ ] = data;
+    }
+    return received;
+}
+
+//! simSpiFlashErase()
+//! @brief Erase the whole flash and reset the counters, as for a new
+//! device, and power it up in deep power-down as initBoard() leaves it
+//!
+//! @param void
+//! @returns void
+void simSpiFlashErase()
+{
+    memset( simSpiFlashMemory, 0xFF, sizeof( simSpiFlashMemory ) );
+    memset( &simSpiFlashStats, 0, sizeof( simSpiFlashStats ) );
+    simSpiFlashPowerCycle();
+    return;
+}
+
+//! simSpiFlashPowerCycle()
+//! @brief Reset the board: the flash keeps its contents and is left in
+//! deep power-down, and a failure asked for is forgotten
+//!
+//! @param void
+//! @returns void
+void simSpiFlashPowerCycle()
+{
+    selected = false;
+    commandLen = 0;
+    asleep = true;
+    writeEnabled = false;
+    busyUntil = 0;
+    failCount = 0;
+    memset( ldmaLists, 0, sizeof( ldmaLists ) );
+    memset( ldmaDone, 0, sizeof( ldmaDone ) );
+    memset( &simUsart1, 0, sizeof( simUsart1 ) );
+    return;
+}
+
+//! simSpiFlashFail()
+//! @brief Make the next erases or programs fail: the sector or page is
+//! left torn and the flash stays busy for busyUs
+//!
+//! @param command FLASH_CMD_SE or FLASH_CMD_PP
+//! @param count number of operations that fail, 0 for none
+//! @param busyUs time each failed operation keeps the flash busy
+//! @returns void
+void simSpiFlashFail( uint8_t command, uint32_t count, uint32_t busyUs )
+{
+    failCommand = command;
+    failCount = count;
+    failBusyUs = busyUs;
+    return;
+}
+
+//! simSpiFlashIsAsleep()
+//! @brief Returns whether the flash is in deep power-down
+//!
+//! @param void
+//! @returns true if asleep
+bool simSpiFlashIsAsleep()
+{
+    return asleep;
+}
+
+void GPIO_PinOutSet( GPIO_Port_TypeDef port, unsigned int pin )
+{
+    if( ( MX25_PORT_CS == port ) && ( MX25_PIN_CS == pin ) && selected )
+    {
+        selected = false;
+        runCommand();
+    }
+    return;
+}
+
+void GPIO_PinOutClear( GPIO_Port_TypeDef port, unsigned int pin )
+{
+    if( ( MX25_PORT_CS == port ) && ( MX25_PIN_CS == pin ) )
+    {
+        selected = true;
+        commandLen = 0;
+    }
+    return;
+}
+
+uint8_t USART_SpiTransfer( USART_TypeDef *usart, uint8_t data )
+{
+    ( void ) usart;
+    return clockByte( data );
+}
+
+void MX25_init( void )
+{
+    // Synchronous master, 8-bit frames, pins routed, both directions on
+    simUsart1.CTRL = 0x00000401;
+    simUsart1.FRAME = 0x00001005;
+    simUsart1.CLKDIV = 0x00002E00;
+    simUsart1.ROUTELOC0 = 0x000B0B0B;
+    simUsart1.ROUTEPEN = 0x0000000B;
+    simUsart1.STATUS = USART_STATUS_RXENS | USART_STATUS_TXENS;
+    return;
+}
+
+void MX25_deinit( void )
+{
+    memset( &simUsart1, 0, sizeof( simUsart1 ) );
+    return;
+}
+
+ReturnMsg MX25_RDID( uint32_t *Identification )
+{
+    *Identification = asleep ? 0xFFFFFF : FlashID;
+    return FlashOperationSuccess;
+}
+
+ReturnMsg MX25_READ( uint32_t flash_address, uint8_t *target_address, uint32_t byte_length )
+{
+    if( asleep || isBusy() )
+    {
+        simSpiFlashStats.ignored++;
+        memset( target_address, 0xFF, byte_length );
+        return FlashIsBusy;
+    }
+    for( uint32_t i = 0; i < byte_length; i++ )
+    {
+        target_address[ i ] = simSpiFlashMemory[ ( flash_address + i ) % FlashSize ];
+    }
+    return FlashOperationSuccess;
+}
+
+void ldmaInit()
+{
+    return;
+}
+
+//! ldmaStartTransfer()
+//! @brief A channel reading RXDATA waits for the bytes clocked back. A
+//! channel writing TXDATA sends its whole descriptor list at once, and
+//! the bytes clocked back go to the reading channel
+void ldmaStartTransfer( uint8_t channel, uint32_t reqsel, const DMA_DESCRIPTOR_TypeDef *desc )
+{
+    ldmaLists[ channel ] = desc;
+    ldmaDone[ channel ] = false;
+    if( ( reqsel & 0xFF ) != LDMA_CH_REQSEL_SIGSEL_USART1TXBL )
+    {
+        return;
+    }
+
+    // Find the channel draining RXDATA
+    uint8_t rxChannel = LDMA_CHANNELS;
+    for( uint8_t i = 0; i < LDMA_CHANNELS; i++ )
+    {
+        if( ( ldmaLists[ i ] != NULL ) && !ldmaDone[ i ] && ( ldmaLists[ i ]->SRC == &simUsart1.RXDATA ) )
+        {
+            rxChannel = i;
+        }
+    }
+    uint32_t rxLeft = ( rxChannel < LDMA_CHANNELS ) ?
+        ( ( ( ldmaLists[ rxChannel ]->CTRL & _LDMA_CH_CTRL_XFERCNT_MASK ) >> _LDMA_CH_CTRL_XFERCNT_SHIFT ) + 1 ) : 0;
+
+    while( desc != NULL )
+    {
+        uint16_t count = ( ( desc->CTRL & _LDMA_CH_CTRL_XFERCNT_MASK ) >> _LDMA_CH_CTRL_XFERCNT_SHIFT ) + 1;
+        if( desc->DST == &simUsart1.TXDATA )
+        {
+            const uint8_t *src = ( const uint8_t * ) desc->SRC;
+            for( uint16_t i = 0; i < count; i++ )
+            {
+                uint8_t received = clockByte( src[ i ] );
+                if( rxLeft > 0 )
+                {
+                    *( volatile uint8_t * ) ldmaLists[ rxChannel ]->DST = received;
+                    rxLeft--;
+                }
+            }
+        }
+        desc = ( ( uintptr_t ) desc->LINK & LDMA_CH_LINK_LINK ) ?
+            ( const DMA_DESCRIPTOR_TypeDef * ) ( ( uintptr_t ) desc->LINK & _LDMA_CH_LINK_LINKADDR_MASK ) : NULL;
+    }
+    ldmaDone[ channel ] = true;
+    if( ( rxChannel < LDMA_CHANNELS ) && ( rxLeft == 0 ) )
+    {
+        ldmaDone[ rxChannel ] = true;
+    }
+    return;
+}
+
+void ldmaStopTransfer( uint8_t channel )
+{
+    ldmaLists[ channel ] = NULL;
+    ldmaDone[ channel ] = false;
+    return;
+}
+
+bool ldmaTransferDone( uint8_t channel )
+{
+    return ldmaDone[ channel ];
+}
@@ -0,0 +1,64 @@
+//!
+//! @file spiflash.h
+//! @brief MX25R8035F SPI flash simulator on USART1. Implements the emlib
+//! USART and GPIO calls of shim/, the MX25 driver calls of
+//! shim/mx25flash_spi.h and the LDMA channel calls of ldma.h. Bytes
+//! clocked out while chip select is low make up a command, which runs when
+//! chip select goes high, as on the flash. Erase sets a sector to ones and
+//! programming only clears bits. Erase and program keep the flash busy in
+//! LETIMER0 time, and can be made to fail, leaving the flash busy long
+//! after the firmware's timeout and the sector or page torn
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources MX25R8035F datasheet
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#ifndef __SIM_SPIFLASH_H___
+#define __SIM_SPIFLASH_H___
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "mx25flash_spi.h"
+
+//! Time a page program and a sector erase keep the flash busy
+#define SIM_SPI_FLASH_PROGRAM_US    ( 3000 )
+#define SIM_SPI_FLASH_ERASE_US      ( 40000 )
+
+//! Counters of the simulated flash
+typedef struct
+{
+    uint32_t pagePrograms;      //! Page programs run
+    uint32_t sectorErases;      //! Sector erases run
+    uint32_t failures;          //! Page programs and sector erases made to fail
+    uint32_t wakeUps;           //! Ends of deep power-down
+    uint32_t ignored;           //! Commands ignored while busy, asleep or not write enabled
+    uint32_t badPrograms;       //! Bytes programmed that needed a bit set from 0 to 1
+    uint32_t lastProgramPage;   //! Page of the last page program
+} simSpiFlashStats_s;
+
+extern simSpiFlashStats_s simSpiFlashStats;
+
+//! Contents of the flash
+extern uint8_t simSpiFlashMemory[ FlashSize ];
+
+void simSpiFlashErase();
+
+void simSpiFlashPowerCycle();
+
+void simSpiFlashFail( uint8_t command, uint32_t count, uint32_t busyUs );
+
+bool simSpiFlashIsAsleep();
+
+#endif // __SIM_SPIFLASH_H___
@@ -0,0 +1,338 @@
+//!
+//! @file test_batch.c
+//! @brief Host checks of the temperature batching in batch.c: batches
+//! close on their size, on the smallest subscriber MTU and on their
+//! deadline, which runs on a soft timer of the Bluetooth stack stand-in
+//! in sim/gecko.c. Each notification is decoded against the readings
+//! added
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources None
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#include "batch.h"
+#include "ble.h"
+#include "gatt_db.h"
+#include "check.h"
+
+#include "sim/gecko.h"
+
+#include <string.h>
+
+#define PERIOD_MS           ( 1000 )
+
+//! Readings the checks keep to decode the notifications against
+#define MAX_READINGS        ( 256 )
+
+//! A Batch Data notification as the subscribers received it
+typedef struct
+{
+    uint16_t sequence;
+    uint8_t count;
+    uint64_t timestampMs;
+    uint64_t sentUs;            //! Stack time it was sent
+    uint64_t readingMs[ BATCH_MAX_READINGS ];
+    int16_t centiC[ BATCH_MAX_READINGS ];
+} packet_s;
+
+static packet_s packets[ MAX_READINGS ];
+static uint32_t packetCount;
+
+//! Smallest ATT MTU among the Batch Data subscribers
+static uint16_t subscriberMtu;
+
+//! Firmware functions batch.c calls, backed by the checks
+uint16_t bleGetSubscriberMtu( uint16_t characteristic )
+{
+    CHECK_EQ( characteristic, gattdb_batch_data );
+    return subscriberMtu;
+}
+
+uint8_t bleSendToSubscribers( uint16_t characteristic, uint8_t length, const uint8_t *data )
+{
+    CHECK_EQ( characteristic, gattdb_batch_data );
+    CHECK( length >= BATCH_HEADER_SIZE );
+    CHECK( length <= subscriberMtu - 3 );
+    CHECK_EQ( ( length - BATCH_HEADER_SIZE ) % BATCH_RECORD_SIZE, 0 );
+    if( packetCount >= MAX_READINGS )
+    {
+        return 0;
+    }
+
+    packet_s *packet = &packets[ packetCount++ ];
+    packet->sequence = data[ 0 ] | ( data[ 1 ] << 8 );
+    packet->count = data[ 2 ];
+    packet->timestampMs = 0;
+    for( uint8_t i = 8; i > 0; i-- )
+    {
+        packet->timestampMs = ( packet->timestampMs << 8 ) | data[ 2 + i ];
+    }
+    packet->sentUs = simGeckoNowUs();
+    CHECK_EQ( length, BATCH_HEADER_SIZE + ( packet->count * BATCH_RECORD_SIZE ) );
+
+    const uint8_t *record = data + BATCH_HEADER_SIZE;
+    for( uint8_t i = 0; i < packet->count; i++ )
+    {
+        uint32_t offsetMs = record[ 0 ] | ( record[ 1 ] << 8 ) | ( record[ 2 ] << 16 ) | ( ( uint32_t ) record[ 3 ] << 24 );
+        packet->readingMs[ i ] = packet->timestampMs + offsetMs;
+        packet->centiC[ i ] = ( int16_t ) ( record[ 4 ] | ( record[ 5 ] << 8 ) );
+        record += BATCH_RECORD_SIZE;
+    }
+    return 1;
+}
+
+//! temperatureOf()
+//! @brief Temperature of the nth reading, in milli-degrees
+//!
+//! @param n
+//! @returns temperature
+static int32_t temperatureOf( uint32_t n )
+{
+    return 21000 + ( int32_t ) ( ( n * 370 ) % 2000 ) - 1000;
+}
+
+//! runFor()
+//! @brief Let the stack run, handing the batch deadline to batch.c the
+//! way ble.c does
+//!
+//! @param us
+//! @returns void
+static void runFor( uint64_t us )
+{
+    uint64_t until = simGeckoNowUs() + us;
+    struct gecko_cmd_packet *evt;
+    while( ( evt = simGeckoWaitEvent( until ) ) != NULL )
+    {
+        if( ( BGLIB_MSG_ID( evt->header ) == gecko_evt_hardware_soft_timer_id )
+            && ( evt->data.evt_hardware_soft_timer.handle == BATCH_SOFT_TIMER_HANDLE ) )
+        {
+            batchFlush();
+        }
+    }
+    return;
+}
+
+//! addReadings()
+//! @brief Add readings one period apart, numbered from first
+//!
+//! @param first
+//! @param count
+//! @returns void
+static void addReadings( uint32_t first, uint32_t count )
+{
+    for( uint32_t n = first; n < first + count; n++ )
+    {
+        batchAdd( ( uint64_t ) n * PERIOD_MS, temperatureOf( n ) );
+        runFor( PERIOD_MS * 1000 / 100 );
+    }
+    return;
+}
+
+//! checkReadings()
+//! @brief The packets from index from on carry readings first to first
+//! + count, in order and intact, with consecutive sequence numbers
+//!
+//! @param from
+//! @param first
+//! @param count
+//! @returns void
+static void checkReadings( uint32_t from, uint32_t first, uint32_t count )
+{
+    uint32_t n = first;
+    for( uint32_t i = from; i < packetCount; i++ )
+    {
+        if( i > from )
+        {
+            CHECK_EQ( packets[ i ].sequence, ( uint16_t ) ( packets[ i - 1 ].sequence + 1 ) );
+        }
+        CHECK_EQ( packets[ i ].timestampMs, ( uint64_t ) n * PERIOD_MS );
+        for( uint8_t r = 0; r < packets[ i ].count; r++, n++ )
+        {
+            CHECK_EQ( packets[ i ].readingMs[ r ], ( uint64_t ) n * PERIOD_MS );
+            CHECK_EQ( packets[ i ].centiC[ r ], temperatureOf( n ) / 10 );
+        }
+    }
+    CHECK_EQ( n, first + count );
+    return;
+}
+
+//! reset()
+//! @brief Fresh stack and no packets, batches of size readings with a
+//! deadline of deadlineS, subscribers at an MTU of mtu
+//!
+//! @param size
+//! @param deadlineS
+//! @param mtu
+//! @returns void
+static void reset( uint8_t size, uint16_t deadlineS, uint16_t mtu )
+{
+    subscriberMtu = 247;
+    batchFlush();
+    simGeckoReset( SIM_GECKO_TX_BUFFERS );
+    CHECK( batchSetConfig( size, deadlineS ) );
+    subscriberMtu = mtu;
+    memset( packets, 0, sizeof( packets ) );
+    packetCount = 0;
+    return;
+}
+
+//! testSize()
+//! @brief A batch is sent as soon as it holds the configured number of
+//! readings, up to BATCH_MAX_READINGS at an MTU of 247
+//!
+//! @returns void
+static void testSize()
+{
+    static const uint8_t SIZES[] = { 1, 4, 8, BATCH_MAX_READINGS };
+    for( uint8_t s = 0; s < sizeof( SIZES ) / sizeof( SIZES[ 0 ] ); s++ )
+    {
+        reset( SIZES[ s ], 600, 247 );
+        addReadings( 0, 3 * SIZES[ s ] );
+        CHECK_EQ( packetCount, 3 );
+        for( uint32_t i = 0; i < packetCount; i++ )
+        {
+            CHECK_EQ( packets[ i ].count, SIZES[ s ] );
+        }
+
+        // A partial batch waits for the deadline or a flush
+        addReadings( 3 * SIZES[ s ], 1 );
+        CHECK_EQ( packetCount, ( SIZES[ s ] == 1 ) ? 4 : 3 );
+        batchFlush();
+        CHECK_EQ( packetCount, 4 );
+        CHECK_EQ( packets[ 3 ].count, 1 );
+        checkReadings( 0, 0, 3 * SIZES[ s ] + 1 );
+    }
+    CHECK_EQ( BATCH_MAX_READINGS, 38 );
+    return;
+}
+
+//! testMtu()
+//! @brief A batch closes early when the smallest subscriber MTU cannot
+//! carry the configured number of readings
+//!
+//! @returns void
+static void testMtu()
+{
+    static const uint16_t MTUS[] = { 23, 29, 50, 131 };
+    for( uint8_t m = 0; m < sizeof( MTUS ) / sizeof( MTUS[ 0 ] ); m++ )
+    {
+        uint8_t fit = ( MTUS[ m ] - 3 - BATCH_HEADER_SIZE ) / BATCH_RECORD_SIZE;
+        uint8_t expected = ( fit < 20 ) ? fit : 20;
+        reset( 20, 600, MTUS[ m ] );
+        addReadings( 100, 5 * expected );
+        CHECK_EQ( packetCount, 5 );
+        CHECK_EQ( packets[ 0 ].count, expected );
+        checkReadings( 0, 100, 5 * expected );
+    }
+    return;
+}
+
+//! testDeadline()
+//! @brief A batch that does not fill is sent when its first reading has
+//! waited for the deadline, and the deadline starts over with the next
+//! batch
+//!
+//! @returns void
+static void testDeadline()
+{
+    reset( 8, 5, 247 );
+    uint64_t startUs = simGeckoNowUs();
+    batchAdd( 0, temperatureOf( 0 ) );
+    runFor( 4900000 );
+    CHECK_EQ( packetCount, 0 );
+    runFor( 200000 );
+    CHECK_EQ( packetCount, 1 );
+    CHECK_EQ( packets[ 0 ].count, 1 );
+    CHECK( packets[ 0 ].sentUs - startUs >= 5000000 );
+
+    // A batch that fills stops its deadline
+    addReadings( 1, 8 );
+    CHECK_EQ( packetCount, 2 );
+    runFor( 10000000 );
+    CHECK_EQ( packetCount, 2 );
+    checkReadings( 0, 0, 9 );
+    return;
+}
+
+//! testConfig()
+//! @brief Settings out of range are refused and leave the current ones.
+//! New settings send the readings batched under the previous ones
+//!
+//! @returns void
+static void testConfig()
+{
+    reset( 8, 60, 247 );
+    CHECK( !batchSetConfig( 0, 60 ) );
+    CHECK( !batchSetConfig( BATCH_MAX_READINGS + 1, 60 ) );
+    CHECK( !batchSetConfig( 8, 0 ) );
+    CHECK_EQ( batchGetSize(), 8 );
+    CHECK_EQ( batchGetDeadline(), 60 );
+
+    addReadings( 0, 3 );
+    CHECK_EQ( packetCount, 0 );
+    CHECK( batchSetConfig( 2, 30 ) );
+    CHECK_EQ( packetCount, 1 );
+    CHECK_EQ( packets[ 0 ].count, 3 );
+    CHECK_EQ( batchGetSize(), 2 );
+    CHECK_EQ( batchGetDeadline(), 30 );
+    addReadings( 3, 2 );
+    CHECK_EQ( packetCount, 2 );
+    checkReadings( 0, 0, 5 );
+    return;
+}
+
+//! testValues()
+//! @brief Temperatures are rounded to hundredths and saturated to the
+//! record field, and a reading too late for the record offset starts a
+//! new batch
+//!
+//! @returns void
+static void testValues()
+{
+    static const int32_t MILLI_C[] = { -1234, -1235, -5, 4, 5, 1234, 1235, 400000, -400000 };
+    static const int16_t CENTI_C[] = { -123, -124, -1, 0, 1, 123, 124, INT16_MAX, INT16_MIN };
+    uint8_t count = sizeof( MILLI_C ) / sizeof( MILLI_C[ 0 ] );
+    reset( count, 600, 247 );
+    for( uint8_t i = 0; i < count; i++ )
+    {
+        batchAdd( i, MILLI_C[ i ] );
+    }
+    CHECK_EQ( packetCount, 1 );
+    for( uint8_t i = 0; i < count; i++ )
+    {
+        CHECK_EQ( packets[ 0 ].centiC[ i ], CENTI_C[ i ] );
+    }
+
+    uint64_t lateMs = 1000 + ( uint64_t ) UINT32_MAX + 1;
+    batchAdd( 1000, 20000 );
+    batchAdd( lateMs, 21000 );
+    batchFlush();
+    CHECK_EQ( packetCount, 3 );
+    CHECK_EQ( packets[ 1 ].count, 1 );
+    CHECK_EQ( packets[ 1 ].timestampMs, 1000 );
+    CHECK_EQ( packets[ 2 ].count, 1 );
+    CHECK_EQ( packets[ 2 ].timestampMs, lateMs );
+    CHECK_EQ( packets[ 2 ].centiC[ 0 ], 2100 );
+    return;
+}
+
+int main()
+{
+    testSize();
+    testMtu();
+    testDeadline();
+    testConfig();
+    testValues();
+    return checkResult( "test_batch" );
+}
@@ -0,0 +1,426 @@
+//!
+//! @file test_bleclient.c
+//! @brief Host checks of the client in ble.c against several thermometers
+//! played by the Bluetooth stack stand-in in sim/gecko.c: time to connect
+//! to all of them, readings/s of the aggregated stream as servers are
+//! added, servers that cannot be reached, and a server that drops out
+//! and comes back
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources None
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#include "ble.h"
+#include "batch.h"
+#include "display.h"
+#include "history.h"
+#include "i2c.h"
+#include "scheduler.h"
+#include "timebase.h"
+#include "check.h"
+
+#include "sim/gecko.h"
+
+#include <stdarg.h>
+#include <string.h>
+
+//! Servers in SERVER_BT_ADDRESSES, as set by test_bleclient.h
+#define NUM_SERVERS             ( BLE_MAX_CONNECTIONS )
+
+#define ADVERTISING_INTERVAL_US ( 100000 )
+#define MEASUREMENT_INTERVAL_US ( 1000000 )
+
+//! Time allowed for the client to connect to every server it can reach
+#define SETUP_TIMEOUT_US        ( 10000000 )
+
+//! Steady state time over which readings/s is measured
+#define STEADY_US               ( 60000000 )
+
+static const bd_addr ADDRESSES[ NUM_SERVERS ] = SERVER_BT_ADDRESSES;
+
+static simGeckoPeer_s peers[ NUM_SERVERS ];
+
+//! The aggregated stream as collected from bleGetClientReadings(), and
+//! per server what is expected of it next
+typedef struct
+{
+    uint32_t lastSequence;          //! Stream sequence of the newest reading
+    uint64_t lastTimeMs;
+    uint32_t readings;
+    uint32_t gaps;                  //! Readings lost from the stream
+    uint32_t errors;                //! Readings that are not what a server sent
+    uint32_t received[ NUM_SERVERS ];
+    uint32_t nextServerSequence[ NUM_SERVERS ];
+    uint32_t restarts[ NUM_SERVERS ];   //! Server sequences restarted by a reconnection
+    uint64_t firstUs[ NUM_SERVERS ];    //! Time of the server's first reading
+} stream_s;
+
+static stream_s stream;
+
+static uint64_t startUs;
+
+static char rows[ DISPLAY_ROW_MAX ][ 32 ];
+
+//! Firmware functions ble.c calls that the client does not use
+void displayPrintf( enum display_row row, const char *format, ... )
+{
+    va_list args;
+    va_start( args, format );
+    vsnprintf( rows[ row ], sizeof( rows[ row ] ), format, args );
+    va_end( args );
+    return;
+}
+
+bool batchSetConfig( uint8_t size, uint16_t deadlineS )
+{
+    ( void ) size;
+    ( void ) deadlineS;
+    return true;
+}
+
+uint8_t batchGetSize()
+{
+    return 1;
+}
+
+uint16_t batchGetDeadline()
+{
+    return 0;
+}
+
+void batchFlush()
+{
+    return;
+}
+
+void historyConnectionClosed( uint8_t connection )
+{
+    ( void ) connection;
+    return;
+}
+
+void historySetNotifications( uint8_t connection, bool enabled )
+{
+    ( void ) connection;
+    ( void ) enabled;
+    return;
+}
+
+void historyHandleControlWrite( const struct gecko_msg_gatt_server_user_write_request_evt_t *request )
+{
+    ( void ) request;
+    return;
+}
+
+void historyPump()
+{
+    return;
+}
+
+bool historyIsActive( uint8_t connection )
+{
+    ( void ) connection;
+    return false;
+}
+
+const i2cErrorStats_s *i2cGetErrorStats()
+{
+    static i2cErrorStats_s stats;
+    return &stats;
+}
+
+bool schedulerSetMeasurementInterval( uint16_t seconds )
+{
+    ( void ) seconds;
+    return true;
+}
+
+uint16_t schedulerGetMeasurementInterval()
+{
+    return MEASUREMENT_INTERVAL_US / 1000000;
+}
+
+void schedulerSignalEvent( schedulerEvents_e ev )
+{
+    ( void ) ev;
+    return;
+}
+
+uint64_t timeNowMs()
+{
+    return simGeckoNowUs() / 1000;
+}
+
+//! collect()
+//! @brief Take the readings added to the client's stream since the last
+//! call, and check each is the next one of its server: consecutive server
+//! sequence numbers, restarting at 1 on a new connection, and the
+//! temperature the server indicated
+//!
+//! @returns void
+static void collect()
+{
+    clientReading_s latest[ CLIENT_STREAM_LENGTH ];
+    uint8_t count = bleGetClientReadings( latest, CLIENT_STREAM_LENGTH );
+    for( uint8_t i = 0; i < count; i++ )
+    {
+        clientReading_s *reading = &latest[ i ];
+        if( reading->sequence <= stream.lastSequence )
+        {
+            continue;
+        }
+        stream.gaps += reading->sequence - stream.lastSequence - 1;
+        stream.lastSequence = reading->sequence;
+        stream.readings++;
+        if( ( reading->server >= NUM_SERVERS ) || ( reading->timeMs < stream.lastTimeMs ) )
+        {
+            stream.errors++;
+            continue;
+        }
+        stream.lastTimeMs = reading->timeMs;
+
+        uint8_t s = reading->server;
+        if( ( reading->serverSequence == 1 ) && ( stream.nextServerSequence[ s ] != 1 ) )
+        {
+            stream.restarts[ s ]++;
+            stream.nextServerSequence[ s ] = 1;
+        }
+        if( stream.received[ s ] == 0 )
+        {
+            stream.firstUs[ s ] = simGeckoNowUs();
+        }
+        stream.errors += ( reading->serverSequence != stream.nextServerSequence[ s ] )
+            || ( reading->milliC != peers[ s ].milliC + ( int32_t ) stream.received[ s ] );
+        stream.nextServerSequence[ s ]++;
+        stream.received[ s ]++;
+    }
+    return;
+}
+
+//! runFor()
+//! @brief Let the stack and the client run
+//!
+//! @param us
+//! @returns void
+static void runFor( uint64_t us )
+{
+    uint64_t until = simGeckoNowUs() + us;
+    struct gecko_cmd_packet *evt;
+    while( ( evt = simGeckoWaitEvent( until ) ) != NULL )
+    {
+        handleClientEvent( evt );
+        collect();
+    }
+    return;
+}
+
+//! runUntilReceiving()
+//! @brief Let the stack and the client run until the given servers have
+//! each sent a reading, or SETUP_TIMEOUT_US passed
+//!
+//! @param count servers 0 to count - 1
+//! @returns true if all of them sent a reading
+static bool runUntilReceiving( uint8_t count )
+{
+    uint64_t until = simGeckoNowUs() + SETUP_TIMEOUT_US;
+    while( simGeckoNowUs() < until )
+    {
+        uint8_t receiving = 0;
+        for( uint8_t s = 0; s < count; s++ )
+        {
+            receiving += ( stream.received[ s ] > 0 );
+        }
+        if( receiving == count )
+        {
+            return true;
+        }
+        runFor( ADVERTISING_INTERVAL_US );
+    }
+    return false;
+}
+
+//! reset()
+//! @brief Start the given thermometers and boot the client
+//!
+//! @param count servers 0 to count - 1 are present
+//! @returns void
+static void reset( uint8_t count )
+{
+    simGeckoReset( SIM_GECKO_TX_BUFFERS );
+    uint32_t lastSequence = stream.lastSequence;
+    memset( &stream, 0, sizeof( stream ) );
+    stream.lastSequence = lastSequence;
+    for( uint8_t s = 0; s < NUM_SERVERS; s++ )
+    {
+        stream.nextServerSequence[ s ] = 1;
+        peers[ s ] = ( simGeckoPeer_s ) {
+            .address = ADDRESSES[ s ],
+            .advertising = true,
+            .connectable = true,
+            .thermometer = true,
+            .advertisingIntervalUs = ADVERTISING_INTERVAL_US,
+            .measurementIntervalUs = MEASUREMENT_INTERVAL_US,
+            .rssi = -60 - ( 5 * s ),
+            .milliC = 20000 + ( 1000 * s )
+        };
+        if( s < count )
+        {
+            simGeckoAddPeer( &peers[ s ] );
+        }
+    }
+    startUs = simGeckoNowUs();
+    simGeckoBoot();
+    return;
+}
+
+//! checkServers()
+//! @brief Every reachable server indicated each of its temperatures and
+//! got them confirmed, and the client used the stack correctly
+//!
+//! @param count servers 0 to count - 1
+//! @returns void
+static void checkServers( uint8_t count )
+{
+    for( uint8_t s = 0; s < count; s++ )
+    {
+        CHECK_EQ( peers[ s ].skipped, 0 );
+        CHECK_EQ( peers[ s ].confirmations, peers[ s ].indications );
+        CHECK_EQ( stream.received[ s ], peers[ s ].indications );
+    }
+    CHECK_EQ( stream.gaps, 0 );
+    CHECK_EQ( stream.errors, 0 );
+    CHECK_EQ( simGeckoStats.connectRefused, 0 );
+    CHECK_EQ( simGeckoStats.gattErrors, 0 );
+    CHECK_EQ( simGeckoStats.droppedEvents, 0 );
+    return;
+}
+
+//! testScaling()
+//! @brief From one to NUM_SERVERS thermometers: the client connects to
+//! all of them, and the stream carries every reading of each, so
+//! readings/s grows with the number of servers. Prints the time to set
+//! up all links and the readings/s
+//!
+//! @returns void
+static void testScaling()
+{
+    printf( "%7s %8s %9s %10s %10s %11s\n", "servers", "setup ms", "readings", "readings/s",
+        "scan resp", "commands/s" );
+    for( uint8_t count = 1; count <= NUM_SERVERS; count++ )
+    {
+        reset( count );
+        CHECK( runUntilReceiving( count ) );
+        uint64_t setupUs = 0;
+        for( uint8_t s = 0; s < count; s++ )
+        {
+            setupUs = ( stream.firstUs[ s ] - startUs > setupUs ) ? stream.firstUs[ s ] - startUs : setupUs;
+        }
+        uint32_t readings = stream.readings;
+        uint32_t commands = simGeckoStats.commands;
+        runFor( STEADY_US );
+        readings = stream.readings - readings;
+        commands = simGeckoStats.commands - commands;
+
+        uint32_t perSecondX100 = ( uint32_t ) ( ( uint64_t ) readings * 100000000 / STEADY_US );
+        printf( "%7u %8u %9u %7u.%02u %10u %11u\n", count, ( uint32_t ) ( setupUs / 1000 ), readings,
+            perSecondX100 / 100, perSecondX100 % 100, simGeckoStats.scanResponses,
+            ( uint32_t ) ( ( uint64_t ) commands * 1000000 / STEADY_US ) );
+
+        uint32_t expected = count * ( STEADY_US / MEASUREMENT_INTERVAL_US );
+        CHECK( ( readings + count ) >= expected );
+        CHECK( readings <= expected + count );
+        for( uint8_t s = 0; s < count; s++ )
+        {
+            CHECK_EQ( peers[ s ].connects, 1 );
+            CHECK_EQ( stream.restarts[ s ], 0 );
+        }
+        checkServers( count );
+        // Each link is set to the fast profile for discovery, once
+        CHECK_EQ( simGeckoStats.parameterRequests, count );
+        CHECK_EQ( simGeckoStats.lastMinInterval, FAST_MIN_CONNECTION_INTERVAL );
+        char row[ 32 ];
+        snprintf( row, sizeof( row ), "Servers %u/%u", count, NUM_SERVERS );
+        CHECK( strcmp( rows[ DISPLAY_ROW_CONNECTION ], row ) == 0 );
+    }
+    return;
+}
+
+//! testUnreachable()
+//! @brief A server that advertises but never accepts the connection, one
+//! without the Health Thermometer service and one that is missing do not
+//! hold up the server that works, and the client keeps trying them
+//!
+//! @returns void
+static void testUnreachable()
+{
+    reset( 3 );
+    peers[ 1 ].connectable = false;
+    peers[ 2 ].thermometer = false;
+    CHECK( runUntilReceiving( 1 ) );
+    // A connect attempt to server 1 may time out first
+    CHECK( ( stream.firstUs[ 0 ] - startUs ) < ( 3 + 2 ) * 1000000ULL );
+    uint32_t received = stream.received[ 0 ];
+    runFor( STEADY_US );
+
+    CHECK( ( stream.received[ 0 ] - received + 1 ) >= STEADY_US / MEASUREMENT_INTERVAL_US );
+    CHECK_EQ( stream.received[ 1 ] + stream.received[ 2 ] + stream.received[ 3 ], 0 );
+    CHECK_EQ( peers[ 1 ].connects, 0 );
+    CHECK( peers[ 2 ].connects > 1 );
+    CHECK_EQ( peers[ 2 ].indications, 0 );
+    CHECK( simGeckoStats.connectAttempts > 2 * STEADY_US / ( CLIENT_CONNECT_TIMEOUT_TICKS / 32768 * 1000000ULL ) );
+    checkServers( 1 );
+    CHECK( strcmp( rows[ DISPLAY_ROW_CONNECTION ], "Servers 1/4" ) == 0 );
+    return;
+}
+
+//! testReconnect()
+//! @brief A server whose link drops is connected again: its sequence
+//! numbers start over, it loses no temperature measured while connected,
+//! and the other servers carry on without a gap
+//!
+//! @returns void
+static void testReconnect()
+{
+    reset( 3 );
+    CHECK( runUntilReceiving( 3 ) );
+    runFor( 10000000 );
+    uint32_t received[ 3 ];
+    for( uint8_t s = 0; s < 3; s++ )
+    {
+        received[ s ] = stream.received[ s ];
+    }
+    simGeckoClose( peers[ 1 ].connection, bg_err_bt_connection_timeout );
+    runFor( 1000 );
+    CHECK( strcmp( rows[ DISPLAY_ROW_CONNECTION ], "Servers 2/4" ) == 0 );
+    runFor( 20000000 );
+
+    CHECK_EQ( peers[ 1 ].connects, 2 );
+    CHECK_EQ( stream.restarts[ 1 ], 1 );
+    CHECK( ( stream.received[ 1 ] - received[ 1 ] + 3 ) >= 20 );
+    CHECK_EQ( peers[ 0 ].connects, 1 );
+    CHECK_EQ( peers[ 2 ].connects, 1 );
+    CHECK( ( stream.received[ 0 ] - received[ 0 ] + 1 ) >= 20 );
+    CHECK( ( stream.received[ 2 ] - received[ 2 ] + 1 ) >= 20 );
+    checkServers( 3 );
+    CHECK( strcmp( rows[ DISPLAY_ROW_CONNECTION ], "Servers 3/4" ) == 0 );
+    return;
+}
+
+int main()
+{
+    testScaling();
+    testUnreachable();
+    testReconnect();
+    return checkResult( "test_bleclient" );
+}
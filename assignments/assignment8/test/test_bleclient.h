@@ -0,0 +1,35 @@
+//!
+//! @file test_bleclient.h
+//! @brief Build configuration of ble.c in test_bleclient: a client of
+//! BLE_MAX_CONNECTIONS thermometers. Included ahead of every source of
+//! that check
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources None
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#ifndef __TEST_BLECLIENT_H___
+#define __TEST_BLECLIENT_H___
+
+#define DEVICE_IS_BLE_SERVER 0
+
+#define SERVER_BT_ADDRESSES \
+    { \
+        {{ 0x01, 0x2C, 0x61, 0xCC, 0xCC, 0xCC }}, \
+        {{ 0x02, 0x2C, 0x61, 0xCC, 0xCC, 0xCC }}, \
+        {{ 0x03, 0x2C, 0x61, 0xCC, 0xCC, 0xCC }}, \
+        {{ 0x04, 0x2C, 0x61, 0xCC, 0xCC, 0xCC }} \
+    }
+
+#endif // __TEST_BLECLIENT_H___
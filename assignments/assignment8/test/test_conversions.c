@@ -0,0 +1,282 @@
+//!
+//! @file test_conversions.c
+//! @brief Host sweep of the integer and single precision conversions
+//! against the double precision and pow() expressions they replaced:
+//! every 16-bit Si7021 code, every 24-bit IEEE-11073 mantissa for the
+//! exponents that matter, and every LETIMER0 period up to the largest
+//! prescaler
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources None
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#include "conversions.h"
+#include "check.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+//! Range of 24-bit two's complement mantissas
+#define MANTISSA_MIN    ( -( 1 << 23 ) )
+#define MANTISSA_MAX    ( ( 1 << 23 ) - 1 )
+
+//! Largest LETIMER0 prescaler, CMU_ClockDivSet() takes up to 32768
+#define LETIMER_MAX_SHIFT   ( 15 )
+
+//! Number of mismatches printed per sweep before the rest are only counted
+#define MAX_REPORTED    ( 5 )
+
+//! Counts mismatches of a sweep as one check, printing the first few
+static unsigned mismatches;
+
+//! mismatch()
+//! @brief Record a mismatch of the current sweep
+//!
+//! @param what
+//! @param input
+//! @param expected
+//! @param actual
+//! @returns void
+static void mismatch( const char *what, long long input, double expected, double actual )
+{
+    if( mismatches < MAX_REPORTED )
+    {
+        printf( "%s( %lld ): expected %.10g, got %.10g\n", what, input, expected, actual );
+    }
+    mismatches++;
+    return;
+}
+
+//! encodeFloat32()
+//! @brief Pack a mantissa and exponent as a flags byte followed by an
+//! IEEE-11073 FLOAT, the layout the conversions read
+//!
+//! @param buffer 5 bytes
+//! @param mantissa
+//! @param exponent
+//! @returns void
+static void encodeFloat32( uint8_t *buffer, int32_t mantissa, int8_t exponent )
+{
+    buffer[ 0 ] = 0;
+    buffer[ 1 ] = ( uint8_t ) mantissa;
+    buffer[ 2 ] = ( uint8_t ) ( mantissa >> 8 );
+    buffer[ 3 ] = ( uint8_t ) ( mantissa >> 16 );
+    buffer[ 4 ] = ( uint8_t ) exponent;
+    return;
+}
+
+//! testTemperature()
+//! @brief si7021TemperatureMilliC() equals the previous
+//! ( int32_t ) ( ( ( 175.72 * code ) / 65536 - 46.85 ) * 1000 ) for
+//! every code
+//!
+//! @returns void
+static void testTemperature()
+{
+    mismatches = 0;
+    for( uint32_t code = 0; code <= UINT16_MAX; code++ )
+    {
+        double temperature = ( ( 175.72 * code ) / 65536 ) - 46.85;
+        int32_t expected = ( int32_t ) ( temperature * 1000 );
+        int32_t actual = si7021TemperatureMilliC( ( uint16_t ) code );
+        if( actual != expected )
+        {
+            mismatch( "si7021TemperatureMilliC", code, expected, actual );
+        }
+    }
+    CHECK_EQ( mismatches, 0 );
+    return;
+}
+
+//! testHumidity()
+//! @brief si7021HumidityMilliPct() equals the datasheet formula
+//! ( ( 125 * code ) / 65536 - 6 ) * 1000 evaluated in double precision,
+//! truncated and clamped to 0..100 %, for every code
+//!
+//! @returns void
+static void testHumidity()
+{
+    mismatches = 0;
+    for( uint32_t code = 0; code <= UINT16_MAX; code++ )
+    {
+        double humidity = ( ( 125.0 * code ) / 65536 ) - 6;
+        int32_t expected = ( int32_t ) ( humidity * 1000 );
+        expected = ( expected < 0 ) ? 0 : ( expected > 100000 ) ? 100000 : expected;
+        int32_t actual = si7021HumidityMilliPct( ( uint16_t ) code );
+        if( actual != expected )
+        {
+            mismatch( "si7021HumidityMilliPct", code, expected, actual );
+        }
+    }
+    CHECK_EQ( mismatches, 0 );
+    return;
+}
+
+//! testPrescaler()
+//! @brief The shifts of calculateAndLoadCompValues() give the period and
+//! tick frequency the previous pow( 2, i ) divisions gave, for every
+//! period up to the largest prescaler and a range of clock frequencies
+//!
+//! @returns void
+static void testPrescaler()
+{
+    mismatches = 0;
+    for( uint32_t ticks = 0; ticks < ( uint32_t ) UINT16_MAX * ( LETIMER_MAX_SHIFT + 1 ); ticks++ )
+    {
+        uint8_t shift = letimerPrescalerShift( ticks );
+        uint16_t expectedPeriod = ( uint16_t ) ticks;
+        if( ticks > UINT16_MAX )
+        {
+            int i = ( int ) ( ( double ) ticks / UINT16_MAX );
+            double prescaler = pow( 2, i );
+            expectedPeriod = ( uint16_t ) ( ( double ) ticks / prescaler );
+            if( shift != i )
+            {
+                mismatch( "letimerPrescalerShift", ticks, i, shift );
+            }
+        }
+        else if( shift != 0 )
+        {
+            mismatch( "letimerPrescalerShift", ticks, 0, shift );
+        }
+        if( ( uint16_t ) ( ticks >> shift ) != expectedPeriod )
+        {
+            mismatch( "period", ticks, expectedPeriod, ticks >> shift );
+        }
+    }
+    for( uint32_t clock = 1000; clock <= 1000000; clock += 7 )
+    {
+        for( int i = 0; i <= LETIMER_MAX_SHIFT; i++ )
+        {
+            uint32_t expected = ( uint32_t ) ( clock / pow( 2, i ) );
+            if( ( clock >> i ) != expected )
+            {
+                mismatch( "tick frequency", clock, expected, clock >> i );
+            }
+        }
+    }
+    CHECK_EQ( mismatches, 0 );
+    return;
+}
+
+//! testFloat32ToInt()
+//! @brief gattFloat32ToInt() equals the previous
+//! ( int32_t ) ( pow( 10, exponent ) * mantissa ) for every mantissa and
+//! every exponent where that conversion is defined, and saturates where
+//! it overflowed
+//!
+//! @returns void
+static void testFloat32ToInt()
+{
+    uint8_t buffer[ 5 ];
+    mismatches = 0;
+    for( int exponent = INT8_MIN; exponent <= INT8_MAX; exponent++ )
+    {
+        double scale = pow( 10, exponent );
+        // Beyond +-12 every value is 0 or saturated, a stride covers it
+        int32_t stride = ( ( exponent >= -12 ) && ( exponent <= 12 ) ) ? 1 : 4099;
+        for( int32_t mantissa = MANTISSA_MIN; mantissa <= MANTISSA_MAX; mantissa += stride )
+        {
+            encodeFloat32( buffer, mantissa, ( int8_t ) exponent );
+            double value = scale * mantissa;
+            int32_t expected;
+            if( value >= 2147483648.0 )
+            {
+                expected = INT32_MAX;
+            }
+            else if( value <= -2147483649.0 )
+            {
+                expected = INT32_MIN;
+            }
+            else
+            {
+                expected = ( int32_t ) value;
+            }
+            int32_t actual = gattFloat32ToInt( buffer );
+            if( actual != expected )
+            {
+                mismatch( "gattFloat32ToInt", ( ( long long ) exponent << 32 ) | ( mantissa & 0xFFFFFF ),
+                    expected, actual );
+            }
+        }
+    }
+    CHECK_EQ( mismatches, 0 );
+    return;
+}
+
+//! testUint32ToFloat()
+//! @brief gattUint32ToFloat() equals the previous
+//! ( float ) ( pow( 10, exponent ) * mantissa ) bit for bit for every
+//! mantissa with exponents of -10 to 10. For the other exponents a float
+//! can hold it is within one unit in the last place per scaling step
+//!
+//! @returns void
+static void testUint32ToFloat()
+{
+    uint8_t buffer[ 5 ];
+    mismatches = 0;
+    for( int exponent = -10; exponent <= 10; exponent++ )
+    {
+        double scale = pow( 10, exponent );
+        for( int32_t mantissa = MANTISSA_MIN; mantissa <= MANTISSA_MAX; mantissa++ )
+        {
+            encodeFloat32( buffer, mantissa, ( int8_t ) exponent );
+            float expected = ( float ) ( scale * mantissa );
+            float actual = gattUint32ToFloat( buffer );
+            if( memcmp( &actual, &expected, sizeof( float ) ) != 0 )
+            {
+                mismatch( "gattUint32ToFloat", ( ( long long ) exponent << 32 ) | ( mantissa & 0xFFFFFF ),
+                    expected, actual );
+            }
+        }
+    }
+    CHECK_EQ( mismatches, 0 );
+
+    mismatches = 0;
+    for( int exponent = -38; exponent <= 31; exponent++ )
+    {
+        if( ( exponent >= -10 ) && ( exponent <= 10 ) )
+        {
+            continue;
+        }
+        double scale = pow( 10, exponent );
+        // One rounding per scaling by up to 10^10
+        float steps = ( float ) ( 1 + ( abs( exponent ) - 1 ) / 10 );
+        for( int32_t mantissa = MANTISSA_MIN; mantissa <= MANTISSA_MAX; mantissa += 997 )
+        {
+            encodeFloat32( buffer, mantissa, ( int8_t ) exponent );
+            float expected = ( float ) ( scale * mantissa );
+            float actual = gattUint32ToFloat( buffer );
+            float ulp = nextafterf( fabsf( expected ), INFINITY ) - fabsf( expected );
+            if( fabsf( actual - expected ) > steps * ulp )
+            {
+                mismatch( "gattUint32ToFloat", ( ( long long ) exponent << 32 ) | ( mantissa & 0xFFFFFF ),
+                    expected, actual );
+            }
+        }
+    }
+    CHECK_EQ( mismatches, 0 );
+    return;
+}
+
+int main()
+{
+    testTemperature();
+    testHumidity();
+    testPrescaler();
+    testFloat32ToInt();
+    testUint32ToFloat();
+    return checkResult( "test_conversions" );
+}
@@ -0,0 +1,476 @@
+//!
+//! @file test_extflash.c
+//! @brief Host checks of the external flash log: pages are programmed in
+//! order with consecutive sequence numbers, the write position is found
+//! again at boot, also once the log has wrapped, and failed erases and
+//! programs leave no hole in the sequence numbers the boot search relies on
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources None
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#include "extflash.h"
+#include "crc.h"
+#include "deltacode.h"
+#include "timers.h"
+#include "scheduler.h"
+#include "timebase.h"
+#include "main.h"
+#include "check.h"
+
+#include "em_cmu.h"
+#include "em_letimer.h"
+
+#include "sim/letimer.h"
+#include "sim/spiflash.h"
+
+#include <stddef.h>
+#include <string.h>
+
+//! LFXO frequency, the LETIMER0 clock in EM2 and EM3
+#define CLOCK_HZ            ( 32768 )
+
+//! Geometry of the simulated flash, in log pages
+#define PAGES               ( FlashSize / EXT_FLASH_PAGE_SIZE )
+#define PAGES_PER_SECTOR    ( Sector_Offset / EXT_FLASH_PAGE_SIZE )
+
+//! Time between samples, both quantities are sampled together
+#define PERIOD_MS           ( 1000 )
+
+//! Set by oscillatorsInit() on the board
+uint32_t clockFrequencyHz = CLOCK_HZ;
+
+//! Time base read by extflash.c. Advances on every read so the wake-up
+//! wait at boot ends
+static uint64_t rtccTicks;
+
+//! Index of the next sample of each quantity, and number of samples the
+//! log accepted
+static uint32_t nextSample[ FLASH_LOG_NUMBER_OF_TAGS ];
+static uint32_t accepted;
+
+void schedulerSignalEvent( schedulerEvents_e ev )
+{
+    ( void ) ev;
+    return;
+}
+
+//! Called by I2C0_IRQHandler(), which is linked in with LETIMER0_IRQHandler()
+void i2cIrqHandler()
+{
+    return;
+}
+
+uint64_t timeNowTicks()
+{
+    return rtccTicks++;
+}
+
+uint64_t timeTicksToUs( uint64_t ticks )
+{
+    return ( ticks * USEC_PER_SEC ) / CLOCK_HZ;
+}
+
+//! valueOf()
+//! @brief Value of the nth sample of a quantity, in thousandths: a walk
+//! on the 0.1 grid of the log with steps of up to 0.5 either way
+//!
+//! @param tag
+//! @param n
+//! @returns value
+static int32_t valueOf( flashLogTag_e tag, uint32_t n )
+{
+    return 20000 + ( ( int32_t ) tag * 25000 ) + ( ( int32_t ) ( ( n * 37 ) % 11 ) * EXT_FLASH_QUANTUM );
+}
+
+//! boot()
+//! @brief Reset the board: LETIMER0 and the software timers start over,
+//! the flash keeps its contents, and the log is opened again
+//!
+//! @returns void
+static void boot()
+{
+    simSpiFlashPowerCycle();
+    simLetimer0 = ( LETIMER_TypeDef ) { 0 };
+    simLetimerIrqLatency = 0;
+    simLetimerReadTicks = 0;
+    timerInit();
+    simLetimerStart();
+    NVIC_EnableIRQ( LETIMER0_IRQn );
+    CHECK( extFlashInit() );
+    CHECK( simSpiFlashIsAsleep() );
+    return;
+}
+
+//! appendSamples()
+//! @brief Append samples alternating between the quantities, letting
+//! half a sample period pass after each
+//!
+//! @param count number of samples
+//! @returns void
+static void appendSamples( uint32_t count )
+{
+    for( uint32_t i = 0; i < count; i++ )
+    {
+        flashLogTag_e tag = ( flashLogTag_e ) ( i % FLASH_LOG_NUMBER_OF_TAGS );
+        uint32_t n = nextSample[ tag ]++;
+        if( extFlashAppend( tag, ( uint64_t ) n * PERIOD_MS, valueOf( tag, n ) ) )
+        {
+            accepted++;
+        }
+        simLetimerRun( CLOCK_HZ / simCmuLetimerDiv / 2 );
+    }
+    return;
+}
+
+//! settle()
+//! @brief Queue the partial pages and let every burst finish
+//!
+//! @returns void
+static void settle()
+{
+    extFlashFlush();
+    simLetimerRun( 4 * CLOCK_HZ / simCmuLetimerDiv );
+    CHECK( simSpiFlashIsAsleep() );
+    CHECK_EQ( simSleepBlocks[ sleepEM2 ], 0 );
+    return;
+}
+
+//! readPage()
+//! @brief Copy a page out of the simulated flash
+//!
+//! @param page
+//! @param copy
+//! @returns void
+static void readPage( uint32_t page, extFlashPage_s *copy )
+{
+    memcpy( copy, &simSpiFlashMemory[ page * EXT_FLASH_PAGE_SIZE ], sizeof( *copy ) );
+    return;
+}
+
+//! writeSequence()
+//! @brief Write the sequence number of a page straight into the
+//! simulated flash, leaving the rest of the page as it is
+//!
+//! @param page
+//! @param sequence
+//! @returns void
+static void writeSequence( uint32_t page, uint32_t sequence )
+{
+    memcpy( &simSpiFlashMemory[ page * EXT_FLASH_PAGE_SIZE ], &sequence, sizeof( sequence ) );
+    return;
+}
+
+//! checkPage()
+//! @brief Decode an intact page and compare its samples with the ones
+//! appendSamples() gave the log
+//!
+//! @param page copy of the page
+//! @param lastN index of the last sample read of each quantity, updated
+//! @returns number of samples in the page
+static uint32_t checkPage( const extFlashPage_s *page, int64_t *lastN )
+{
+    CHECK( page->tag < FLASH_LOG_NUMBER_OF_TAGS );
+    CHECK( ( page->count > 0 ) && ( ( page->count == 1 ) || ( page->periodMs == PERIOD_MS ) ) );
+    if( page->tag >= FLASH_LOG_NUMBER_OF_TAGS )
+    {
+        return 0;
+    }
+    flashLogTag_e tag = ( flashLogTag_e ) page->tag;
+    uint32_t n = ( uint32_t ) ( page->timestampMs / PERIOD_MS );
+    CHECK( ( int64_t ) n > lastN[ tag ] );
+
+    deltaReader_s reader;
+    deltaReaderInit( &reader, page->codes, sizeof( page->codes ) );
+    int32_t value = page->value;
+    uint32_t mismatches = ( value != valueOf( tag, n ) / EXT_FLASH_QUANTUM );
+    for( uint16_t i = 1; i < page->count; i++ )
+    {
+        int32_t delta;
+        if( !deltaReaderGet( &reader, &delta ) )
+        {
+            mismatches++;
+            break;
+        }
+        value += delta;
+        mismatches += ( value != valueOf( tag, n + i ) / EXT_FLASH_QUANTUM );
+    }
+    CHECK_EQ( mismatches, 0 );
+    lastN[ tag ] = n + page->count - 1;
+    return page->count;
+}
+
+//! verifyLog()
+//! @brief Walk the pages the boot search sees as written, from page 0 up
+//! to the first page whose sequence number does not follow, and check
+//! that no page after it follows either, as a hole would. Intact pages
+//! must decode to the samples given to the log, in order
+//!
+//! @param samples set to the number of samples in intact pages
+//! @param torn set to the number of pages that fail their CRC
+//! @returns number of pages up to the write position
+static uint32_t verifyLog( uint32_t *samples, uint32_t *torn )
+{
+    extFlashPage_s page;
+    int64_t lastN[ FLASH_LOG_NUMBER_OF_TAGS ] = { -1, -1 };
+    *samples = 0;
+    *torn = 0;
+    readPage( 0, &page );
+    uint32_t first = page.sequence;
+    uint32_t written = 0;
+    while( ( written < PAGES ) && ( page.sequence == first + written ) )
+    {
+        if( page.crc == crc32( &page, offsetof( extFlashPage_s, crc ) ) )
+        {
+            *samples += checkPage( &page, lastN );
+        }
+        else
+        {
+            ( *torn )++;
+        }
+        written++;
+        readPage( written % PAGES, &page );
+    }
+    uint32_t holes = 0;
+    for( uint32_t p = written + 1; p < PAGES; p++ )
+    {
+        readPage( p, &page );
+        holes += ( page.sequence == first + p );
+    }
+    CHECK_EQ( holes, 0 );
+    return written;
+}
+
+//! freshLog()
+//! @brief Start a blank device and open its log
+//!
+//! @returns void
+static void freshLog()
+{
+    simSpiFlashErase();
+    memset( nextSample, 0, sizeof( nextSample ) );
+    accepted = 0;
+    boot();
+    return;
+}
+
+//! testFresh()
+//! @brief A blank flash gets a log from page 0. Full pages are
+//! programmed in order with one erase per sector, every sample is kept,
+//! and the flash is back in deep power-down between bursts
+//!
+//! @returns void
+static void testFresh()
+{
+    freshLog();
+    appendSamples( 6000 );
+    settle();
+    uint32_t samples;
+    uint32_t torn;
+    uint32_t written = verifyLog( &samples, &torn );
+    CHECK( written > PAGES_PER_SECTOR );
+    CHECK_EQ( torn, 0 );
+    CHECK_EQ( samples, accepted );
+    CHECK_EQ( accepted, 6000 );
+    CHECK_EQ( written, extFlashGetStats()->pagesProgrammed );
+    CHECK_EQ( simSpiFlashStats.sectorErases, ( written + PAGES_PER_SECTOR - 1 ) / PAGES_PER_SECTOR );
+    CHECK_EQ( simSpiFlashStats.badPrograms, 0 );
+    CHECK_EQ( extFlashGetStats()->errors, 0 );
+    CHECK_EQ( extFlashGetStats()->samplesDropped, 0 );
+    return;
+}
+
+//! testReboot()
+//! @brief The write position is found again after a reset, and the log
+//! carries on with the next sequence number
+//!
+//! @returns void
+static void testReboot()
+{
+    freshLog();
+    uint32_t samples;
+    uint32_t torn;
+    for( uint8_t i = 0; i < 4; i++ )
+    {
+        appendSamples( 1500 );
+        settle();
+        uint32_t written = verifyLog( &samples, &torn );
+        boot();
+        appendSamples( 2 * 300 );
+        settle();
+        CHECK( extFlashGetStats()->pagesProgrammed > 0 );
+        CHECK_EQ( simSpiFlashStats.lastProgramPage + 1, written + extFlashGetStats()->pagesProgrammed );
+        CHECK_EQ( verifyLog( &samples, &torn ), simSpiFlashStats.lastProgramPage + 1 );
+    }
+    CHECK_EQ( torn, 0 );
+    CHECK_EQ( samples, accepted );
+    CHECK_EQ( simSpiFlashStats.badPrograms, 0 );
+    return;
+}
+
+//! testWrapped()
+//! @brief Once the log has wrapped, the write position is found from the
+//! sequence numbers alone, at and around sector boundaries
+//!
+//! @returns void
+static void testWrapped()
+{
+    static const uint32_t positions[] =
+    {
+        0, 1, PAGES_PER_SECTOR - 1, PAGES_PER_SECTOR, PAGES_PER_SECTOR + 1, PAGES / 2 + 3, PAGES - 1
+    };
+    const uint32_t base = 0xFFFFF800;
+    for( uint8_t i = 0; i < sizeof( positions ) / sizeof( positions[ 0 ] ); i++ )
+    {
+        // Pages before the position were written in this pass, the rest of
+        // its sector is erased and the pages after it were written last pass
+        uint32_t position = positions[ i ];
+        simSpiFlashErase();
+        uint32_t sectorEnd = ( position + PAGES_PER_SECTOR - 1 ) / PAGES_PER_SECTOR * PAGES_PER_SECTOR;
+        for( uint32_t page = 0; page < PAGES; page++ )
+        {
+            if( page < position )
+            {
+                writeSequence( page, base + PAGES + page );
+            }
+            else if( ( page >= sectorEnd ) || ( ( position % PAGES_PER_SECTOR ) == 0 ) )
+            {
+                writeSequence( page, base + page );
+            }
+        }
+        memset( nextSample, 0, sizeof( nextSample ) );
+        boot();
+        appendSamples( 2 * 300 );
+        settle();
+        CHECK( extFlashGetStats()->pagesProgrammed > 0 );
+        CHECK_EQ( simSpiFlashStats.lastProgramPage,
+            ( position + extFlashGetStats()->pagesProgrammed - 1 ) % PAGES );
+        extFlashPage_s page;
+        readPage( position, &page );
+        CHECK_EQ( page.sequence, base + PAGES + position );
+        CHECK_EQ( page.crc, crc32( &page, offsetof( extFlashPage_s, crc ) ) );
+    }
+    return;
+}
+
+//! testFailedProgram()
+//! @brief A page program that times out is tried again on the same page
+//! with the same sequence number, so no sample is lost and the next boot
+//! finds the write position
+//!
+//! @returns void
+static void testFailedProgram()
+{
+    freshLog();
+    appendSamples( 3000 );
+    simSpiFlashFail( FLASH_CMD_PP, 1, 100000 );
+    appendSamples( 3000 );
+    settle();
+    CHECK_EQ( simSpiFlashStats.failures, 1 );
+    CHECK_EQ( extFlashGetStats()->errors, 1 );
+    CHECK_EQ( extFlashGetStats()->samplesDropped, 0 );
+
+    boot();
+    appendSamples( 2 * 300 );
+    settle();
+    uint32_t samples;
+    uint32_t torn;
+    CHECK_EQ( simSpiFlashStats.lastProgramPage + 1, verifyLog( &samples, &torn ) );
+    CHECK_EQ( torn, 0 );
+    CHECK_EQ( samples, accepted );
+    CHECK_EQ( simSpiFlashStats.badPrograms, 0 );
+    return;
+}
+
+//! testFailedErase()
+//! @brief A sector erase that times out is done again before its first
+//! page is programmed
+//!
+//! @returns void
+static void testFailedErase()
+{
+    freshLog();
+    simSpiFlashFail( FLASH_CMD_SE, 1, 600000 );
+    appendSamples( 3000 );
+    settle();
+    CHECK_EQ( simSpiFlashStats.failures, 1 );
+    CHECK_EQ( extFlashGetStats()->errors, 1 );
+    CHECK_EQ( simSpiFlashStats.sectorErases, 2 );
+
+    boot();
+    appendSamples( 2 * 300 );
+    settle();
+    uint32_t samples;
+    uint32_t torn;
+    CHECK_EQ( simSpiFlashStats.lastProgramPage + 1, verifyLog( &samples, &torn ) );
+    CHECK_EQ( torn, 0 );
+    CHECK_EQ( samples, accepted );
+    CHECK_EQ( simSpiFlashStats.badPrograms, 0 );
+    return;
+}
+
+//! testStoppedLog()
+//! @brief A page that keeps failing stops the log rather than being
+//! skipped. The next boot starts its sector over, and the boot after that
+//! still finds the write position
+//!
+//! @returns void
+static void testStoppedLog()
+{
+    freshLog();
+    uint32_t samples;
+    uint32_t torn;
+    uint32_t failedPage = PAGES_PER_SECTOR + 4;
+    while( extFlashGetStats()->pagesProgrammed < failedPage )
+    {
+        appendSamples( 2 );
+    }
+    simSpiFlashFail( FLASH_CMD_PP, EXT_FLASH_ATTEMPTS, 100000 );
+    appendSamples( 1500 );
+    settle();
+    CHECK_EQ( extFlashGetStats()->errors, EXT_FLASH_ATTEMPTS );
+    CHECK( extFlashGetStats()->samplesDropped > 0 );
+    CHECK( !extFlashAppend( FLASH_LOG_TEMPERATURE, ( uint64_t ) nextSample[ 0 ] * PERIOD_MS, 0 ) );
+    CHECK_EQ( simSpiFlashStats.lastProgramPage, failedPage );
+    CHECK( verifyLog( &samples, &torn ) <= failedPage + 1 );
+
+    // Either the torn page ends the search and its sector is started over,
+    // or its sequence number made it and it is skipped as torn
+    boot();
+    appendSamples( 2 * 300 );
+    settle();
+    uint32_t restart = simSpiFlashStats.lastProgramPage + 1 - extFlashGetStats()->pagesProgrammed;
+    CHECK( ( restart == failedPage - ( failedPage % PAGES_PER_SECTOR ) ) || ( restart == failedPage + 1 ) );
+
+    boot();
+    appendSamples( 3000 );
+    settle();
+    CHECK_EQ( simSpiFlashStats.lastProgramPage + 1, verifyLog( &samples, &torn ) );
+    CHECK( torn <= 1 );
+    CHECK_EQ( extFlashGetStats()->errors, 0 );
+    CHECK_EQ( simSpiFlashStats.badPrograms, 0 );
+    return;
+}
+
+int main()
+{
+    testFresh();
+    testReboot();
+    testWrapped();
+    testFailedProgram();
+    testFailedErase();
+    testStoppedLog();
+    CHECK_EQ( coreCriticalDepth, 0 );
+    return checkResult( "test_extflash" );
+}
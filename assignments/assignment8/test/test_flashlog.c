@@ -0,0 +1,393 @@
+//!
+//! @file test_flashlog.c
+//! @brief Host checks of the flash log in flashlog.c on the flash
+//! simulator in sim/msc.c: batching, recovery of the write position at
+//! boot, wraparound with even wear, and power loss at every kind of
+//! flash operation
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources None
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#include "flashlog.h"
+#include "check.h"
+
+#include "sim/msc.h"
+
+#include <stdlib.h>
+
+//! Records the log holds once it has wrapped, at least
+#define HELD_RECORDS    ( ( FLASH_LOG_PAGES - 1 ) * FLASH_LOG_RECORDS_PER_PAGE )
+
+//! Number of power cycles in the power loss test
+#define POWER_CYCLES    ( 3000 )
+
+//! Index of the next sample of each quantity. Sample n of a quantity is
+//! taken at n seconds and has the value n * 10 + tag, so every record can
+//! be checked on its own
+static uint32_t nextSample[ FLASH_LOG_NUMBER_OF_TAGS ];
+
+//! Sequence numbers of records cut short by a power loss, in order. The
+//! slot of such a record is used up, so the log is expected to skip it
+static uint32_t tornSequences[ POWER_CYCLES ];
+static uint32_t tornCount;
+
+//! missingBetween()
+//! @brief Count the records from first up to before last that are not
+//! known to have been cut short by a power loss
+//!
+//! @param first
+//! @param last
+//! @returns number of records expected to have been read
+static uint32_t missingBetween( uint32_t first, uint32_t last )
+{
+    uint32_t missing = last - first;
+    for( uint32_t i = 0; i < tornCount; i++ )
+    {
+        if( ( tornSequences[ i ] - first ) < ( last - first ) )
+        {
+            missing--;
+        }
+    }
+    return missing;
+}
+
+//! appendSamples()
+//! @brief Append samples alternating between the quantities
+//!
+//! @param count number of samples
+//! @returns void
+static void appendSamples( uint32_t count )
+{
+    for( uint32_t i = 0; i < count; i++ )
+    {
+        flashLogTag_e tag = ( flashLogTag_e ) ( i % FLASH_LOG_NUMBER_OF_TAGS );
+        uint32_t n = nextSample[ tag ];
+        if( flashLogAppend( tag, ( uint64_t ) n * 1000, ( int32_t ) ( n * 10 + tag ) ) )
+        {
+            nextSample[ tag ]++;
+        }
+    }
+    return;
+}
+
+//! appendWork()
+//! @brief simMscRun() work appending *( uint32_t * ) arg samples
+//!
+//! @param arg
+//! @returns void
+static void appendWork( void *arg )
+{
+    appendSamples( *( uint32_t * ) arg );
+    return;
+}
+
+//! flushWork()
+//! @brief simMscRun() work programming the partial batches
+//!
+//! @param arg unused
+//! @returns void
+static void flushWork( void *arg )
+{
+    ( void ) arg;
+    flashLogFlush();
+    return;
+}
+
+//! verifyLog()
+//! @brief Read the whole log and check every record is one written by
+//! appendSamples(), that each quantity's samples come in order, and that
+//! every record before committed is there, except torn ones, back to the oldest one the
+//! log is expected to hold
+//!
+//! @param committed sequence number of the first record not known to
+//! have been programmed completely
+//! @returns number of records read
+static uint32_t verifyLog( uint32_t committed )
+{
+    flashLogRecord_s record;
+    uint32_t oldest = flashLogOldestSequence();
+    uint32_t sequence = oldest;
+    uint32_t expected = oldest;
+    uint32_t records = 0;
+    uint32_t missing = 0;
+    uint32_t bad = 0;
+    int64_t lastValue[ FLASH_LOG_NUMBER_OF_TAGS ] = { -1, -1 };
+    uint16_t lastBoot = 0;
+    while( flashLogRead( &sequence, &record ) )
+    {
+        records++;
+        if( ( int32_t ) ( record.sequence - committed ) < 0 )
+        {
+            missing += missingBetween( expected, record.sequence );
+        }
+        expected = record.sequence + 1;
+        bool ok = ( record.tag < FLASH_LOG_NUMBER_OF_TAGS ) && ( record.count > 0 )
+            && ( record.count <= FLASH_LOG_BATCH_SAMPLES ) && ( record.boot >= lastBoot )
+            && ( record.boot <= flashLogGetBoot() );
+        if( ok )
+        {
+            int32_t first = record.entries[ 0 ].value;
+            ok = ( ( first % 10 ) == record.tag ) && ( first > lastValue[ record.tag ] )
+                && ( record.timestampMs == ( uint64_t ) ( first / 10 ) * 1000 );
+            for( uint8_t i = 0; ok && ( i < record.count ); i++ )
+            {
+                ok = ( record.entries[ i ].value == first + ( 10 * i ) )
+                    && ( record.entries[ i ].offsetMs == 1000U * i );
+            }
+            lastValue[ record.tag ] = first + ( 10 * ( record.count - 1 ) );
+            lastBoot = record.boot;
+        }
+        bad += !ok;
+    }
+    if( ( int32_t ) ( expected - committed ) < 0 )
+    {
+        missing += missingBetween( expected, committed );
+    }
+    CHECK_EQ( bad, 0 );
+    CHECK_EQ( missing, 0 );
+    CHECK( ( committed - oldest ) >= ( ( committed < HELD_RECORDS ) ? committed : HELD_RECORDS ) );
+    return records;
+}
+
+//! powerUp()
+//! @brief Boot: the batches in RAM are lost and the log is opened again
+//!
+//! @returns void
+static void powerUp()
+{
+    flashLogInit();
+    return;
+}
+
+//! testFresh()
+//! @brief A blank device gets an empty log, and samples are programmed
+//! once per full batch, one record at a time
+//!
+//! @returns void
+static void testFresh()
+{
+    simMscErase();
+    nextSample[ 0 ] = nextSample[ 1 ] = 0;
+    powerUp();
+    CHECK_EQ( flashLogNextSequence(), 0 );
+    CHECK_EQ( flashLogOldestSequence(), 0 );
+    CHECK_EQ( flashLogGetBoot(), 0 );
+    CHECK_EQ( simMscStats.pageErases, 1 );
+    flashLogRecord_s record;
+    uint32_t sequence = 0;
+    CHECK( !flashLogRead( &sequence, &record ) );
+
+    uint32_t writes = simMscStats.wordWrites;
+    appendSamples( 2 * ( FLASH_LOG_BATCH_SAMPLES - 1 ) );
+    CHECK_EQ( simMscStats.wordWrites, writes );
+    appendSamples( 2 );
+    CHECK_EQ( simMscStats.wordWrites, writes + ( 2 * sizeof( flashLogRecord_s ) / sizeof( uint32_t ) ) );
+    CHECK_EQ( flashLogNextSequence(), 2 );
+    CHECK_EQ( verifyLog( 2 ), 2 );
+    return;
+}
+
+//! testReboot()
+//! @brief The write position, the records and the boot number survive a
+//! reset, and batches flushed before it are kept
+//!
+//! @returns void
+static void testReboot()
+{
+    simMscErase();
+    nextSample[ 0 ] = nextSample[ 1 ] = 0;
+    powerUp();
+    appendSamples( 1001 );
+    flashLogFlush();
+    uint32_t next = flashLogNextSequence();
+    CHECK_EQ( verifyLog( next ), next );
+
+    powerUp();
+    CHECK_EQ( flashLogNextSequence(), next );
+    CHECK_EQ( flashLogGetBoot(), 1 );
+    CHECK_EQ( verifyLog( next ), next );
+    appendSamples( 500 );
+    flashLogFlush();
+    powerUp();
+    CHECK_EQ( flashLogGetBoot(), 2 );
+    CHECK_EQ( verifyLog( flashLogNextSequence() ), flashLogNextSequence() );
+    CHECK_EQ( simMscStats.badWrites, 0 );
+    return;
+}
+
+//! testWraparound()
+//! @brief Appending many times the log's capacity keeps the newest
+//! records, erases every page equally often and recovers the write
+//! position at every point of the page rotation
+//!
+//! @returns void
+static void testWraparound()
+{
+    simMscErase();
+    nextSample[ 0 ] = nextSample[ 1 ] = 0;
+    powerUp();
+    srand( 5823 );
+    uint32_t perWrap = FLASH_LOG_PAGES * FLASH_LOG_RECORDS_PER_PAGE * FLASH_LOG_BATCH_SAMPLES;
+    while( nextSample[ 0 ] < 6 * perWrap )
+    {
+        appendSamples( rand() % ( 3 * FLASH_LOG_BATCH_SAMPLES * FLASH_LOG_RECORDS_PER_PAGE ) );
+        flashLogFlush();
+        uint32_t next = flashLogNextSequence();
+        powerUp();
+        CHECK_EQ( flashLogNextSequence(), next );
+        verifyLog( next );
+    }
+    uint32_t minErases = UINT32_MAX;
+    uint32_t maxErases = 0;
+    for( uint8_t page = 0; page < FLASH_LOG_PAGES; page++ )
+    {
+        uint32_t erases = simMscStats.pageEraseCounts[ page ];
+        minErases = ( erases < minErases ) ? erases : minErases;
+        maxErases = ( erases > maxErases ) ? erases : maxErases;
+    }
+    CHECK( minErases >= 6 );
+    CHECK( ( maxErases - minErases ) <= 1 );
+    CHECK_EQ( flashLogGetStats()->minEraseCount, minErases );
+    CHECK_EQ( flashLogGetStats()->maxEraseCount, maxErases );
+    CHECK_EQ( simMscStats.badWrites, 0 );
+    return;
+}
+
+//! recordWork()
+//! @brief simMscRun() work appending one full batch of temperatures, so
+//! exactly one record is programmed
+//!
+//! @param arg unused
+//! @returns void
+static void recordWork( void *arg )
+{
+    ( void ) arg;
+    for( uint8_t i = 0; i < FLASH_LOG_BATCH_SAMPLES; i++ )
+    {
+        uint32_t n = nextSample[ FLASH_LOG_TEMPERATURE ];
+        if( flashLogAppend( FLASH_LOG_TEMPERATURE, ( uint64_t ) n * 1000, ( int32_t ) ( n * 10 ) ) )
+        {
+            nextSample[ FLASH_LOG_TEMPERATURE ]++;
+        }
+    }
+    return;
+}
+
+//! testLostHeader()
+//! @brief Power cut between erasing a page and writing its header leaves
+//! the page without a header. Its wear is not forgotten at boot, and the
+//! log carries on
+//!
+//! @returns void
+static void testLostHeader()
+{
+    simMscErase();
+    nextSample[ 0 ] = nextSample[ 1 ] = 0;
+    powerUp();
+    while( flashLogGetStats()->minEraseCount < 3 )
+    {
+        appendSamples( 2 * FLASH_LOG_BATCH_SAMPLES * FLASH_LOG_RECORDS_PER_PAGE );
+    }
+
+    // Write records until one starts a page, then fill that page
+    uint32_t erases = simMscStats.pageErases;
+    while( simMscStats.pageErases == erases )
+    {
+        simMscRun( recordWork, NULL );
+    }
+    for( uint32_t slot = 1; slot < FLASH_LOG_RECORDS_PER_PAGE; slot++ )
+    {
+        simMscRun( recordWork, NULL );
+    }
+    erases = simMscStats.pageErases;
+    uint32_t committed = flashLogNextSequence();
+
+    // Erase of the next page completes, power is lost on the header
+    simMscPowerLossAfter( 2 );
+    CHECK( !simMscRun( recordWork, NULL ) );
+    CHECK_EQ( simMscStats.pageErases, erases + 1 );
+
+    powerUp();
+    CHECK_EQ( flashLogNextSequence(), committed );
+    CHECK( flashLogGetStats()->minEraseCount >= 3 );
+    CHECK( ( flashLogGetStats()->maxEraseCount - flashLogGetStats()->minEraseCount ) <= 1 );
+    verifyLog( committed );
+
+    // The page is started again with its erase count carried on
+    appendSamples( 4 * FLASH_LOG_BATCH_SAMPLES * FLASH_LOG_RECORDS_PER_PAGE );
+    flashLogFlush();
+    powerUp();
+    CHECK( flashLogGetStats()->minEraseCount >= 3 );
+    CHECK( ( flashLogGetStats()->maxEraseCount - flashLogGetStats()->minEraseCount ) <= 1 );
+    verifyLog( flashLogNextSequence() );
+    CHECK_EQ( simMscStats.badWrites, 0 );
+    return;
+}
+
+//! testPowerLoss()
+//! @brief Power cut during any word write or page erase, while appending
+//! or flushing, loses no record programmed before it, leaves no damaged
+//! record readable, and the log carries on from where it was
+//!
+//! @returns void
+static void testPowerLoss()
+{
+    simMscErase();
+    nextSample[ 0 ] = nextSample[ 1 ] = 0;
+    powerUp();
+    srand( 18 );
+    tornCount = 0;
+    uint32_t losses = 0;
+    for( uint32_t cycle = 0; cycle < POWER_CYCLES; cycle++ )
+    {
+        uint32_t samples = rand() % ( 4 * FLASH_LOG_BATCH_SAMPLES * FLASH_LOG_RECORDS_PER_PAGE );
+        // Up to the number of operations the samples take
+        simMscPowerLossAfter( 1 + rand() % ( ( samples / FLASH_LOG_BATCH_SAMPLES + 2 )
+            * ( sizeof( flashLogRecord_s ) / sizeof( uint32_t ) ) ) );
+        bool completed = simMscRun( appendWork, &samples );
+        if( completed && ( rand() % 2 ) )
+        {
+            completed = simMscRun( flushWork, NULL );
+        }
+        simMscPowerLossAfter( 0 );
+        uint32_t committed = flashLogNextSequence();
+        losses += !completed;
+
+        powerUp();
+        CHECK( ( flashLogNextSequence() == committed ) || ( flashLogNextSequence() == committed + 1 ) );
+        if( flashLogNextSequence() == committed + 1 )
+        {
+            // Power was lost programming the record, its slot is used up
+            CHECK( !completed );
+            tornSequences[ tornCount++ ] = committed;
+            committed++;
+        }
+        verifyLog( committed );
+    }
+    CHECK( losses > POWER_CYCLES / 2 );
+    CHECK( nextSample[ 0 ] > 3 * FLASH_LOG_PAGES * FLASH_LOG_RECORDS_PER_PAGE * FLASH_LOG_BATCH_SAMPLES );
+    CHECK_EQ( simMscStats.badWrites, 0 );
+    return;
+}
+
+int main()
+{
+    testFresh();
+    testReboot();
+    testWraparound();
+    testLostHeader();
+    testPowerLoss();
+    return checkResult( "test_flashlog" );
+}
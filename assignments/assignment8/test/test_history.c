@@ -0,0 +1,633 @@
+//!
+//! @file test_history.c
+//! @brief Host checks of the bulk history download in history.c, driven
+//! through the Bluetooth stack stand-in in sim/gecko.c by a stand-in
+//! client that requests ranges, grants credits and decodes the
+//! notifications. Reports the effective throughput in bytes/s for a
+//! range of MTUs and connection intervals
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources None
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#include "history.h"
+#include "samplering.h"
+#include "scheduler.h"
+#include "timebase.h"
+#include "ble.h"
+#include "gatt_db.h"
+#include "check.h"
+
+#include "sim/gecko.h"
+
+#include <string.h>
+
+#define NUM_BLOCKS          ( 64 )
+#define PERIOD_MS           ( 1000 )
+
+//! Connection the client downloads over
+#define CONNECTION          ( 1 )
+
+//! Connection interval of BLE_CONN_PARAMS_FAST, and a slower one
+#define FAST_INTERVAL_US    ( 7500 )
+#define SLOW_INTERVAL_US    ( 30000 )
+
+//! Notifications the link sends per connection event
+#define PACKETS_PER_EVENT   ( 4 )
+
+//! Credits the client keeps granted
+#define CREDIT_WINDOW       ( 16 )
+
+//! Longest a download may take in the checks
+#define TIMEOUT_US          ( 60000000ULL )
+
+//! Size of a Health Thermometer indication, the only way samples left
+//! the device before the history service
+#define INDICATION_BYTES    ( 5 )
+
+static sampleRingBlock_s temperatureBlocks[ NUM_BLOCKS ];
+static sampleRingBlock_s humidityBlocks[ NUM_BLOCKS ];
+static sampleRing_s temperatureRing;
+static sampleRing_s humidityRing;
+
+//! State of the stand-in client
+typedef struct
+{
+    uint8_t tag;            //! Quantity being downloaded
+    uint32_t nextSample;    //! Sample number expected next
+    uint32_t received;      //! Samples received
+    uint32_t packets;       //! Notifications received
+    uint32_t bytes;         //! Payload bytes received
+    uint32_t gaps;          //! Notifications flagged HISTORY_FLAG_GAP
+    uint32_t errors;        //! Notifications that did not decode to the samples appended
+    uint16_t window;        //! Credits to keep granted, 0 to grant none
+    uint16_t credits;       //! Credits granted and not used yet
+    bool ended;             //! HISTORY_FLAG_END received
+    uint64_t startUs;       //! Time of the request
+    uint64_t endUs;         //! Time the last notification arrived
+} client_s;
+
+static client_s client;
+
+//! History Data CCCD of each connection, as ble.c keeps it
+static bool subscribed[ SIM_GECKO_MAX_CONNECTIONS + 1 ];
+
+static bleConnParamsMode_e connParams = BLE_CONN_PARAMS_NONE;
+
+//! Firmware functions history.c calls, backed by the stand-ins
+uint16_t bleGetMtu( uint8_t connection )
+{
+    return simGeckoGetMtu( connection );
+}
+
+bool bleIsSubscribed( uint8_t connection, uint16_t characteristic )
+{
+    return subscribed[ connection ] && ( characteristic == gattdb_history_data );
+}
+
+void bleRequestConnParams( uint8_t connection, bleConnParamsMode_e mode )
+{
+    ( void ) connection;
+    connParams = mode;
+    return;
+}
+
+uint64_t timeNowMs()
+{
+    return simGeckoNowUs() / 1000;
+}
+
+const sampleRing_s *schedulerGetTemperatureHistory()
+{
+    return &temperatureRing;
+}
+
+const sampleRing_s *schedulerGetHumidityHistory()
+{
+    return &humidityRing;
+}
+
+//! valueOf()
+//! @brief Value of the nth sample of a quantity, a slow walk with noise
+//!
+//! @param tag
+//! @param n
+//! @returns value
+static int32_t valueOf( uint8_t tag, uint32_t n )
+{
+    return ( tag ? 45000 : 21000 ) + ( int32_t ) ( ( n * 37 ) % 2000 ) - 1000 + ( int32_t ) ( n / 10 );
+}
+
+//! appendSamples()
+//! @brief Append the next samples to both rings
+//!
+//! @param count
+//! @returns void
+static void appendSamples( uint32_t count )
+{
+    for( uint32_t i = 0; i < count; i++ )
+    {
+        uint32_t n = temperatureRing.appended;
+        sampleRingAppend( &temperatureRing, ( uint64_t ) n * PERIOD_MS, valueOf( FLASH_LOG_TEMPERATURE, n ) );
+        sampleRingAppend( &humidityRing, ( uint64_t ) n * PERIOD_MS, valueOf( FLASH_LOG_HUMIDITY, n ) );
+    }
+    return;
+}
+
+//! readLe()
+//! @brief Read a little endian field
+//!
+//! @param p
+//! @param size bytes, up to 8
+//! @returns value
+static uint64_t readLe( const uint8_t *p, uint8_t size )
+{
+    uint64_t value = 0;
+    for( uint8_t i = size; i > 0; i-- )
+    {
+        value = ( value << 8 ) | p[ i - 1 ];
+    }
+    return value;
+}
+
+//! onNotification()
+//! @brief Decode a History Data notification, check each sample against
+//! the one appended, and grant more credits once half the window is used
+//!
+//! @returns void
+static void onNotification( uint8_t connection, uint16_t characteristic, const uint8_t *data, uint8_t len )
+{
+    CHECK_EQ( characteristic, gattdb_history_data );
+    CHECK( len >= HISTORY_HEADER_SIZE );
+    CHECK( len <= simGeckoGetMtu( connection ) - 3 );
+    client.packets++;
+    client.bytes += len;
+    client.credits -= ( client.credits > 0 );
+    client.endUs = simGeckoNowUs();
+
+    uint32_t first = ( uint32_t ) readLe( data, 4 );
+    uint8_t count = data[ 4 ];
+    uint8_t flags = data[ 5 ];
+    uint64_t timestampMs = readLe( data + 6, 8 );
+    int32_t value = ( int32_t ) readLe( data + 14, 4 );
+    bool ok = ( len == HISTORY_HEADER_SIZE + ( ( count > 0 ) ? ( count - 1 ) * HISTORY_RECORD_SIZE : 0 ) );
+    if( flags & HISTORY_FLAG_GAP )
+    {
+        client.gaps++;
+        ok = ok && ( ( int32_t ) ( first - client.nextSample ) >= 0 );
+    }
+    else if( count > 0 )
+    {
+        ok = ok && ( first == client.nextSample );
+    }
+
+    const uint8_t *record = data + HISTORY_HEADER_SIZE;
+    for( uint8_t i = 0; ok && ( i < count ); i++ )
+    {
+        if( i > 0 )
+        {
+            timestampMs += readLe( record, 4 );
+            value += ( int16_t ) readLe( record + 4, 2 );
+            record += HISTORY_RECORD_SIZE;
+        }
+        ok = ( timestampMs == ( uint64_t ) ( first + i ) * PERIOD_MS )
+            && ( value == valueOf( client.tag, first + i ) );
+    }
+    client.errors += !ok;
+    if( count > 0 )
+    {
+        client.nextSample = first + count;
+        client.received += count;
+    }
+    client.ended = client.ended || ( flags & HISTORY_FLAG_END );
+
+    if( !client.ended && ( client.window > 0 ) && ( client.credits <= client.window / 2 ) )
+    {
+        uint16_t grant = client.window - client.credits;
+        uint8_t request[ HISTORY_CREDIT_LENGTH ] = { HISTORY_OP_CREDIT, grant & 0xFF, grant >> 8 };
+        simGeckoPeerWrite( connection, gattdb_history_control, request, sizeof( request ) );
+        client.credits += grant;
+    }
+    return;
+}
+
+//! dispatch()
+//! @brief Hand a stack event to history.c the way ble.c does
+//!
+//! @param evt
+//! @returns void
+static void dispatch( struct gecko_cmd_packet *evt )
+{
+    switch( BGLIB_MSG_ID( evt->header ) )
+    {
+        case gecko_evt_gatt_server_user_write_request_id:
+            if( evt->data.evt_gatt_server_user_write_request.characteristic == gattdb_history_control )
+            {
+                historyHandleControlWrite( &evt->data.evt_gatt_server_user_write_request );
+            }
+            break;
+
+        case gecko_evt_hardware_soft_timer_id:
+            if( evt->data.evt_hardware_soft_timer.handle == HISTORY_SOFT_TIMER_HANDLE )
+            {
+                historyPump();
+            }
+            break;
+
+        case gecko_evt_gatt_server_characteristic_status_id:
+            if( ( evt->data.evt_gatt_server_characteristic_status.status_flags == gatt_server_client_config )
+                && ( evt->data.evt_gatt_server_characteristic_status.characteristic == gattdb_history_data ) )
+            {
+                uint8_t connection = evt->data.evt_gatt_server_characteristic_status.connection;
+                subscribed[ connection ] =
+                    ( evt->data.evt_gatt_server_characteristic_status.client_config_flags == gatt_notification );
+                historySetNotifications( connection, subscribed[ connection ] );
+            }
+            break;
+
+        case gecko_evt_le_connection_closed_id:
+            subscribed[ evt->data.evt_le_connection_closed.connection ] = false;
+            historyConnectionClosed( evt->data.evt_le_connection_closed.connection );
+            break;
+
+        default:
+            break;
+    }
+    return;
+}
+
+//! runFor()
+//! @brief Let the stack and the firmware run
+//!
+//! @param us
+//! @returns void
+static void runFor( uint64_t us )
+{
+    uint64_t until = simGeckoNowUs() + us;
+    struct gecko_cmd_packet *evt;
+    while( ( evt = simGeckoWaitEvent( until ) ) != NULL )
+    {
+        dispatch( evt );
+    }
+    return;
+}
+
+//! runUntil()
+//! @brief Let the stack and the firmware run until the client has
+//! received samples up to before sample, or the download ended
+//!
+//! @param sample
+//! @returns void
+static void runUntil( uint32_t sample )
+{
+    uint64_t until = simGeckoNowUs() + TIMEOUT_US;
+    while( !client.ended && ( ( int32_t ) ( client.nextSample - sample ) < 0 ) && ( simGeckoNowUs() < until ) )
+    {
+        runFor( FAST_INTERVAL_US );
+    }
+    return;
+}
+
+//! request()
+//! @brief Have the client write a request to History Control
+//!
+//! @param connection
+//! @param data
+//! @param len
+//! @returns void
+static void request( uint8_t connection, const uint8_t *data, uint8_t len )
+{
+    simGeckoPeerWrite( connection, gattdb_history_control, data, len );
+    return;
+}
+
+//! startDownload()
+//! @brief Have the client request a range
+//!
+//! @param connection
+//! @param tag
+//! @param first
+//! @param count 0 for every sample stored
+//! @param window credits to grant, and to keep granted unless refill is false
+//! @param refill
+//! @returns void
+static void startDownload( uint8_t connection, uint8_t tag, uint32_t first, uint32_t count,
+    uint16_t window, bool refill )
+{
+    uint8_t start[ HISTORY_START_LENGTH ] =
+    {
+        HISTORY_OP_START, tag,
+        first & 0xFF, ( first >> 8 ) & 0xFF, ( first >> 16 ) & 0xFF, first >> 24,
+        count & 0xFF, ( count >> 8 ) & 0xFF, ( count >> 16 ) & 0xFF, count >> 24,
+        window & 0xFF, window >> 8
+    };
+    client.tag = tag;
+    client.nextSample = first;
+    client.ended = false;
+    client.window = refill ? window : 0;
+    client.credits = window;
+    client.startUs = simGeckoNowUs();
+    request( connection, start, sizeof( start ) );
+    return;
+}
+
+//! connect()
+//! @brief Open a link and enable History Data notifications on it
+//!
+//! @param connection
+//! @param mtu
+//! @param intervalUs
+//! @param packetsPerEvent
+//! @returns void
+static void connect( uint8_t connection, uint16_t mtu, uint32_t intervalUs, uint8_t packetsPerEvent )
+{
+    simGeckoOpen( connection, mtu, intervalUs, packetsPerEvent );
+    simGeckoPeerSubscribe( connection, gattdb_history_data, gatt_notification );
+    return;
+}
+
+//! reset()
+//! @brief Fresh stack, rings and client, with a link open on CONNECTION
+//!
+//! @param mtu
+//! @param intervalUs
+//! @param txBuffers
+//! @param packetsPerEvent
+//! @returns void
+static void reset( uint16_t mtu, uint32_t intervalUs, uint8_t txBuffers, uint8_t packetsPerEvent )
+{
+    // End a download left running by the previous check
+    historyConnectionClosed( CONNECTION );
+    simGeckoReset( txBuffers );
+    memset( subscribed, 0, sizeof( subscribed ) );
+    simGeckoOnNotification( onNotification );
+    connect( CONNECTION, mtu, intervalUs, packetsPerEvent );
+    sampleRingInit( &temperatureRing, temperatureBlocks, NUM_BLOCKS, SAMPLE_RING_OVERWRITE_OLDEST );
+    sampleRingInit( &humidityRing, humidityBlocks, NUM_BLOCKS, SAMPLE_RING_OVERWRITE_OLDEST );
+    memset( &client, 0, sizeof( client ) );
+    connParams = BLE_CONN_PARAMS_NONE;
+    runFor( intervalUs );
+    return;
+}
+
+//! samplesPerPacket()
+//! @brief Samples a notification holds at an MTU
+//!
+//! @param mtu
+//! @returns number of samples
+static uint32_t samplesPerPacket( uint16_t mtu )
+{
+    uint32_t payload = ( mtu - 3 > HISTORY_MAX_PAYLOAD ) ? HISTORY_MAX_PAYLOAD : mtu - 3;
+    return 1 + ( payload - HISTORY_HEADER_SIZE ) / HISTORY_RECORD_SIZE;
+}
+
+//! testThroughput()
+//! @brief Every stored sample arrives once, in order and intact, in
+//! notifications packed to the MTU. Prints the effective throughput
+//! against one 5-byte indication per connection interval
+//!
+//! @returns void
+static void testThroughput()
+{
+    static const uint16_t MTUS[] = { 23, 65, 131, 247 };
+    static const uint32_t INTERVALS_US[] = { FAST_INTERVAL_US, SLOW_INTERVAL_US };
+    uint32_t total = NUM_BLOCKS * SAMPLE_RING_SAMPLES_PER_BLOCK;
+
+    printf( "%5s %11s %8s %8s %10s %9s %10s %11s\n", "MTU", "interval us", "packets", "bytes",
+        "ms", "bytes/s", "samples/s", "indications" );
+    for( uint8_t i = 0; i < sizeof( INTERVALS_US ) / sizeof( INTERVALS_US[ 0 ] ); i++ )
+    {
+        for( uint8_t m = 0; m < sizeof( MTUS ) / sizeof( MTUS[ 0 ] ); m++ )
+        {
+            reset( MTUS[ m ], INTERVALS_US[ i ], SIM_GECKO_TX_BUFFERS, PACKETS_PER_EVENT );
+            appendSamples( total );
+            startDownload( CONNECTION, FLASH_LOG_TEMPERATURE, 0, 0, CREDIT_WINDOW, true );
+            runUntil( total );
+            runFor( INTERVALS_US[ i ] );
+
+            uint32_t perPacket = samplesPerPacket( MTUS[ m ] );
+            CHECK( client.ended );
+            CHECK_EQ( client.errors, 0 );
+            CHECK_EQ( client.gaps, 0 );
+            CHECK_EQ( client.received, total );
+            CHECK_EQ( client.packets, ( total + perPacket - 1 ) / perPacket );
+            CHECK_EQ( simGeckoStats.oversized, 0 );
+            CHECK_EQ( simGeckoStats.lastWriteError, 0 );
+            CHECK_EQ( historyGetStats()->packets, client.packets );
+            CHECK_EQ( historyGetStats()->bytes, client.bytes );
+            CHECK_EQ( historyGetStats()->lost, 0 );
+            CHECK_EQ( connParams, BLE_CONN_PARAMS_STEADY );
+            CHECK( !historyIsActive( CONNECTION ) );
+
+            uint64_t elapsedUs = client.endUs - client.startUs;
+            uint32_t bytesPerSecond = ( uint32_t ) ( ( uint64_t ) client.bytes * 1000000 / elapsedUs );
+            uint32_t samplesPerSecond = ( uint32_t ) ( ( uint64_t ) client.received * 1000000 / elapsedUs );
+            uint32_t indicationBytesPerSecond = INDICATION_BYTES * 1000000 / INTERVALS_US[ i ];
+            printf( "%5u %11u %8u %8u %10u %9u %10u %11u\n", MTUS[ m ], INTERVALS_US[ i ], client.packets,
+                client.bytes, ( uint32_t ) ( elapsedUs / 1000 ), bytesPerSecond, samplesPerSecond,
+                indicationBytesPerSecond );
+            if( MTUS[ m ] == 247 )
+            {
+                CHECK( bytesPerSecond > 10 * indicationBytesPerSecond );
+            }
+        }
+    }
+    return;
+}
+
+//! testRange()
+//! @brief A range in the middle of the history, and the other quantity,
+//! come back exactly
+//!
+//! @returns void
+static void testRange()
+{
+    reset( 131, FAST_INTERVAL_US, SIM_GECKO_TX_BUFFERS, PACKETS_PER_EVENT );
+    appendSamples( 1000 );
+    startDownload( CONNECTION, FLASH_LOG_HUMIDITY, 400, 250, CREDIT_WINDOW, true );
+    runUntil( 650 );
+    runFor( FAST_INTERVAL_US );
+    CHECK( client.ended );
+    CHECK_EQ( client.errors, 0 );
+    CHECK_EQ( client.received, 250 );
+    CHECK_EQ( client.nextSample, 650 );
+    return;
+}
+
+//! testCredits()
+//! @brief The server stops when the client's credits run out, carries on
+//! with each grant, and an abort ends the download
+//!
+//! @returns void
+static void testCredits()
+{
+    reset( 247, FAST_INTERVAL_US, SIM_GECKO_TX_BUFFERS, PACKETS_PER_EVENT );
+    appendSamples( 1000 );
+    startDownload( CONNECTION, FLASH_LOG_TEMPERATURE, 0, 0, 2, false );
+    runFor( 100000 );
+    CHECK_EQ( client.packets, 2 );
+    CHECK_EQ( client.errors, 0 );
+    CHECK( historyIsActive( CONNECTION ) );
+    CHECK_EQ( connParams, BLE_CONN_PARAMS_FAST );
+
+    uint8_t credit[ HISTORY_CREDIT_LENGTH ] = { HISTORY_OP_CREDIT, 3, 0 };
+    request( CONNECTION, credit, sizeof( credit ) );
+    runFor( 100000 );
+    CHECK_EQ( client.packets, 5 );
+    CHECK_EQ( client.received, 5 * samplesPerPacket( 247 ) );
+    CHECK_EQ( client.errors, 0 );
+
+    uint8_t abort[ HISTORY_ABORT_LENGTH ] = { HISTORY_OP_ABORT };
+    request( CONNECTION, abort, sizeof( abort ) );
+    runFor( 100000 );
+    CHECK( !historyIsActive( CONNECTION ) );
+    CHECK_EQ( connParams, BLE_CONN_PARAMS_STEADY );
+    CHECK( !client.ended );
+    request( CONNECTION, credit, sizeof( credit ) );
+    runFor( 100000 );
+    CHECK_EQ( client.packets, 5 );
+    return;
+}
+
+//! testOutOfBuffers()
+//! @brief Notifications the stack has no buffer for are rebuilt and sent
+//! later, so no sample is lost or repeated
+//!
+//! @returns void
+static void testOutOfBuffers()
+{
+    uint32_t total = NUM_BLOCKS * SAMPLE_RING_SAMPLES_PER_BLOCK;
+    reset( 247, FAST_INTERVAL_US, 2, 1 );
+    appendSamples( total );
+    startDownload( CONNECTION, FLASH_LOG_TEMPERATURE, 0, 0, 64, true );
+    runUntil( total );
+    runFor( FAST_INTERVAL_US );
+    CHECK( simGeckoStats.outOfMemory > 0 );
+    CHECK( client.ended );
+    CHECK_EQ( client.errors, 0 );
+    CHECK_EQ( client.gaps, 0 );
+    CHECK_EQ( client.received, total );
+    CHECK_EQ( historyGetStats()->packets, client.packets );
+    return;
+}
+
+//! testResume()
+//! @brief A download cut by a disconnect resumes on a new connection from
+//! the sample after the last one received. Samples overwritten meanwhile
+//! are flagged as a gap and counted as lost
+//!
+//! @returns void
+static void testResume()
+{
+    uint32_t total = NUM_BLOCKS * SAMPLE_RING_SAMPLES_PER_BLOCK;
+    reset( 247, FAST_INTERVAL_US, SIM_GECKO_TX_BUFFERS, PACKETS_PER_EVENT );
+    appendSamples( total );
+    startDownload( CONNECTION, FLASH_LOG_TEMPERATURE, 0, 0, CREDIT_WINDOW, true );
+    runUntil( total / 3 );
+    simGeckoClose( CONNECTION, 0x0208 );
+    runFor( FAST_INTERVAL_US );
+    CHECK( !historyIsActive( CONNECTION ) );
+    CHECK( !client.ended );
+    uint32_t resumeAt = client.nextSample;
+    uint32_t received = client.received;
+    CHECK( ( resumeAt > 0 ) && ( resumeAt < total ) );
+    CHECK_EQ( received, resumeAt );
+
+    // Nothing lost: carry on from where the download stopped
+    connect( CONNECTION + 1, 131, FAST_INTERVAL_US, PACKETS_PER_EVENT );
+    startDownload( CONNECTION + 1, FLASH_LOG_TEMPERATURE, resumeAt, 200, CREDIT_WINDOW, true );
+    runUntil( resumeAt + 200 );
+    CHECK( client.ended );
+    CHECK_EQ( client.errors, 0 );
+    CHECK_EQ( client.gaps, 0 );
+    CHECK_EQ( client.received, received + 200 );
+    simGeckoClose( CONNECTION + 1, 0x0208 );
+    runFor( FAST_INTERVAL_US );
+    resumeAt += 200;
+    received += 200;
+
+    // Samples after resumeAt are overwritten before the client is back
+    uint32_t overwrite = resumeAt + 10 * SAMPLE_RING_SAMPLES_PER_BLOCK;
+    appendSamples( overwrite );
+    uint32_t lost = temperatureRing.firstBlock * SAMPLE_RING_SAMPLES_PER_BLOCK - resumeAt;
+    CHECK( ( int32_t ) lost > 0 );
+    connect( CONNECTION, 247, FAST_INTERVAL_US, PACKETS_PER_EVENT );
+    startDownload( CONNECTION, FLASH_LOG_TEMPERATURE, resumeAt, 0, CREDIT_WINDOW, true );
+    runUntil( temperatureRing.appended );
+    runFor( FAST_INTERVAL_US );
+    CHECK( client.ended );
+    CHECK_EQ( client.errors, 0 );
+    CHECK_EQ( client.gaps, 1 );
+    CHECK_EQ( client.nextSample, temperatureRing.appended );
+    CHECK_EQ( client.received, received + ( temperatureRing.appended - resumeAt - lost ) );
+    CHECK_EQ( historyGetStats()->lost, lost );
+    return;
+}
+
+//! testRejected()
+//! @brief Requests that cannot be served are answered with an ATT error
+//! and send nothing
+//!
+//! @returns void
+static void testRejected()
+{
+    reset( 247, FAST_INTERVAL_US, SIM_GECKO_TX_BUFFERS, PACKETS_PER_EVENT );
+    appendSamples( 100 );
+
+    simGeckoPeerSubscribe( CONNECTION, gattdb_history_data, gatt_disable );
+    startDownload( CONNECTION, FLASH_LOG_TEMPERATURE, 0, 0, CREDIT_WINDOW, true );
+    runFor( 100000 );
+    CHECK_EQ( simGeckoStats.lastWriteError, 0xFD );
+    simGeckoPeerSubscribe( CONNECTION, gattdb_history_data, gatt_notification );
+
+    startDownload( CONNECTION, FLASH_LOG_NUMBER_OF_TAGS, 0, 0, CREDIT_WINDOW, true );
+    runFor( 100000 );
+    CHECK_EQ( simGeckoStats.lastWriteError, ( uint8_t ) bg_err_att_value_not_allowed );
+
+    uint8_t shortStart[ HISTORY_START_LENGTH - 1 ] = { HISTORY_OP_START };
+    request( CONNECTION, shortStart, sizeof( shortStart ) );
+    runFor( 100000 );
+    CHECK_EQ( simGeckoStats.lastWriteError, ( uint8_t ) bg_err_att_invalid_att_length );
+
+    uint8_t unknown[ 1 ] = { 0x7F };
+    request( CONNECTION, unknown, sizeof( unknown ) );
+    runFor( 100000 );
+    CHECK_EQ( simGeckoStats.lastWriteError, ( uint8_t ) bg_err_att_value_not_allowed );
+    CHECK_EQ( client.packets, 0 );
+    CHECK_EQ( simGeckoStats.writeResponses, 4 );
+
+    // A second client is turned away while the first one downloads
+    startDownload( CONNECTION, FLASH_LOG_TEMPERATURE, 0, 0, 1, false );
+    runFor( 100000 );
+    CHECK_EQ( simGeckoStats.lastWriteError, 0 );
+    CHECK( historyIsActive( CONNECTION ) );
+    connect( CONNECTION + 1, 247, FAST_INTERVAL_US, PACKETS_PER_EVENT );
+    startDownload( CONNECTION + 1, FLASH_LOG_TEMPERATURE, 0, 0, 1, false );
+    runFor( 100000 );
+    CHECK_EQ( simGeckoStats.lastWriteError, 0xFE );
+    CHECK( historyIsActive( CONNECTION ) );
+    CHECK_EQ( client.packets, 1 );
+    return;
+}
+
+int main()
+{
+    testThroughput();
+    testRange();
+    testCredits();
+    testOutOfBuffers();
+    testResume();
+    testRejected();
+    return checkResult( "test_history" );
+}
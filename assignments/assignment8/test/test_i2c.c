@@ -0,0 +1,631 @@
+//!
+//! @file test_i2c.c
+//! @brief Host checks of the I2C0 transaction queue in i2c.c on the bus
+//! simulator in sim/i2cbus.c: back to back completion in submission order
+//! from interrupt context, error and timeout handling, the Si7021
+//! transfers, bus recovery, i2cDeinit(), the LDMA path, and the EM2 block
+//! being held exactly while the queue is not empty
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources None
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#include "i2c.h"
+#include "timers.h"
+#include "scheduler.h"
+#include "timebase.h"
+#include "conversions.h"
+#include "main.h"
+#include "check.h"
+
+#include "em_cmu.h"
+#include "em_letimer.h"
+
+#include "sim/i2cbus.h"
+#include "sim/letimer.h"
+
+#include <string.h>
+
+//! LFXO frequency, the LETIMER0 clock in EM2 and EM3
+#define CLOCK_HZ            ( 32768 )
+
+//! Transactions in the queue tests
+#define QUEUED              ( 6 )
+
+//! Set by oscillatorsInit() on the board
+uint32_t clockFrequencyHz = CLOCK_HZ;
+
+//! Number of I2C done and error events signalled to the scheduler
+static unsigned doneEvents;
+static unsigned errorEvents;
+
+//! Time base read by i2c.c. Advances on every read so the busy waits of
+//! the bus recovery end
+static uint64_t rtccTicks;
+
+void schedulerSignalEvent( schedulerEvents_e ev )
+{
+    if( ev == EVENT_I2C_TRANSACTION_DONE )
+    {
+        doneEvents++;
+    }
+    else if( ev == EVENT_I2C_TRANSACTION_ERROR )
+    {
+        errorEvents++;
+    }
+    return;
+}
+
+uint64_t timeNowTicks()
+{
+    return rtccTicks++;
+}
+
+uint64_t timeTicksToUs( uint64_t ticks )
+{
+    return ( ticks * USEC_PER_SEC ) / CLOCK_HZ;
+}
+
+//! Completion record of a queued transaction
+typedef struct
+{
+    i2cTransaction_s transaction;
+    uint8_t data[ 4 ];
+    unsigned completions;
+    unsigned order;                     //! Position among all completions
+    uint64_t completedAt;               //! Simulated LETIMER0 ticks
+    bool resubmit;                      //! Submit again from the callback
+    int criticalDepth;                  //! coreCriticalDepth in the callback
+} record_s;
+
+//! Number of completions so far
+static unsigned completions;
+
+//! onComplete()
+//! @brief Transaction callback. Records the completion and checks it
+//! happens in interrupt context with the transaction off the queue
+//!
+//! @param transaction
+//! @returns void
+static void onComplete( i2cTransaction_s *transaction )
+{
+    record_s *r = transaction->arg;
+    CHECK( transaction->status != i2cTransferInProgress );
+    CHECK( transaction->next == NULL );
+    r->criticalDepth = coreCriticalDepth;
+    r->completions++;
+    r->order = completions++;
+    r->completedAt = simLetimerTicks();
+    if( r->resubmit )
+    {
+        r->resubmit = false;
+        CHECK_EQ( i2cSubmit( transaction ), i2cTransferInProgress );
+    }
+    return;
+}
+
+//! prepare()
+//! @brief Fill in a transaction for the tests
+//!
+//! @param r
+//! @param addr 7-bit address
+//! @param flags
+//! @param writeLen bytes of r->data written first
+//! @param readLen bytes read into r->data afterwards
+//! @returns void
+static void prepare( record_s *r, uint8_t addr, uint16_t flags, uint16_t writeLen, uint16_t readLen )
+{
+    memset( r, 0, sizeof( *r ) );
+    r->transaction.seq.addr = addr << 1;
+    r->transaction.seq.flags = flags;
+    r->transaction.seq.buf[ 0 ].data = r->data;
+    r->transaction.seq.buf[ 0 ].len = ( flags == I2C_FLAG_READ ) ? readLen : writeLen;
+    r->transaction.seq.buf[ 1 ].data = r->data + writeLen;
+    r->transaction.seq.buf[ 1 ].len = readLen;
+    r->transaction.callback = onComplete;
+    r->transaction.arg = r;
+    return;
+}
+
+//! Number of ticks run with the EM2 block not matching the queue
+static unsigned em2Mismatches;
+
+//! runBus()
+//! @brief Let ticks pass, delivering at most one I2C0 interrupt per tick.
+//! Checks the EM2 block is held exactly while the queue is not empty
+//!
+//! @param ticks
+//! @returns void
+static void runBus( uint32_t ticks )
+{
+    for( uint32_t i = 0; i < ticks; i++ )
+    {
+        simI2cInterrupt();
+        simLetimerRun( 1 );
+        if( simSleepBlocks[ sleepEM2 ] != ( i2cQueueIsEmpty() ? 0 : 1 ) )
+        {
+            em2Mismatches++;
+        }
+    }
+    return;
+}
+
+//! reset()
+//! @brief Restart the bus, LETIMER0 and I2C0 from a known state
+//!
+//! @returns void
+static void reset()
+{
+    simI2cReset();
+    simLetimer0 = ( LETIMER_TypeDef ) { 0 };
+    simLetimerIrqLatency = 0;
+    simLetimerReadTicks = 0;
+    timerInit();
+    simLetimerStart();
+    NVIC_EnableIRQ( LETIMER0_IRQn );
+    i2cInit();
+    completions = 0;
+    return;
+}
+
+//! testQueue()
+//! @brief Transactions to several slaves submitted back to back complete
+//! in submission order, each with the status, written bytes and read
+//! bytes its slave scripted, started from the interrupt of the previous
+//! one without a return to the main loop
+//!
+//! @returns void
+static void testQueue()
+{
+    reset();
+    static const uint8_t sensorData[] = { 0x12, 0x34 };
+    static const simI2cReply_s sensorScript[] = { { i2cTransferDone, 3, sensorData, 2, 0 } };
+    static const simI2cReply_s eepromScript[] =
+    {
+        { i2cTransferDone, 4, NULL, 0, 0 },
+        { i2cTransferNack, 1, NULL, 0, 0 },
+        { i2cTransferDone, 2, NULL, 0, 0 }
+    };
+    simI2cSlave_s sensor = { .addr = 0x44, .script = sensorScript, .scriptLen = 1 };
+    simI2cSlave_s eeprom = { .addr = 0x50, .script = eepromScript, .scriptLen = 3 };
+    simI2cAttach( &sensor );
+    simI2cAttach( &eeprom );
+
+    record_s r[ QUEUED ];
+    prepare( &r[ 0 ], 0x44, I2C_FLAG_WRITE_READ, 1, 2 );
+    prepare( &r[ 1 ], 0x50, I2C_FLAG_WRITE_WRITE, 2, 0 );
+    prepare( &r[ 2 ], 0x50, I2C_FLAG_WRITE, 1, 0 );
+    prepare( &r[ 3 ], 0x51, I2C_FLAG_READ, 0, 2 );
+    prepare( &r[ 4 ], 0x50, I2C_FLAG_WRITE, 3, 0 );
+    prepare( &r[ 5 ], 0x44, I2C_FLAG_READ, 0, 2 );
+    r[ 0 ].data[ 0 ] = 0xE3;
+    r[ 1 ].data[ 0 ] = 0x00;
+    r[ 1 ].data[ 1 ] = 0x10;
+    r[ 1 ].transaction.seq.buf[ 1 ].len = 2;
+    memcpy( r[ 4 ].data, "\x01\x02\x03", 3 );
+
+    em2Mismatches = 0;
+    CHECK( i2cQueueIsEmpty() );
+    CHECK_EQ( simSleepBlocks[ sleepEM2 ], 0 );
+    for( unsigned i = 0; i < QUEUED; i++ )
+    {
+        CHECK_EQ( i2cSubmit( &r[ i ].transaction ), i2cTransferInProgress );
+    }
+    CHECK_EQ( simSleepBlocks[ sleepEM2 ], 1 );
+    CHECK_EQ( simI2cStats.starts, 1 );
+    // Already queued
+    CHECK_EQ( i2cSubmit( &r[ 2 ].transaction ), i2cTransferUsageFault );
+    runBus( 100 );
+
+    for( unsigned i = 0; i < QUEUED; i++ )
+    {
+        CHECK_EQ( r[ i ].completions, 1 );
+        CHECK_EQ( r[ i ].order, i );
+        CHECK( r[ i ].criticalDepth > 0 );
+    }
+    CHECK_EQ( r[ 0 ].transaction.status, i2cTransferDone );
+    CHECK_EQ( r[ 0 ].data[ 1 ], 0x12 );
+    CHECK_EQ( r[ 0 ].data[ 2 ], 0x34 );
+    CHECK_EQ( r[ 1 ].transaction.status, i2cTransferDone );
+    CHECK_EQ( r[ 2 ].transaction.status, i2cTransferNack );
+    CHECK_EQ( r[ 3 ].transaction.status, i2cTransferNack );
+    CHECK_EQ( r[ 4 ].transaction.status, i2cTransferDone );
+    CHECK_EQ( eeprom.writtenLen, 3 );
+    CHECK( memcmp( eeprom.written, "\x01\x02\x03", 3 ) == 0 );
+    CHECK_EQ( r[ 5 ].transaction.status, i2cTransferDone );
+    CHECK_EQ( r[ 5 ].data[ 0 ], 0x12 );
+    CHECK_EQ( sensor.transfers, 2 );
+    CHECK_EQ( eeprom.transfers, 3 );
+    // Each transaction ends in the interrupt that starts the next one
+    CHECK_EQ( simI2cStats.interrupts, 3 + 4 + 1 + 1 + 2 + 3 );
+    CHECK_EQ( simI2cStats.starts, QUEUED );
+    CHECK_EQ( simI2cStats.restarts, 0 );
+    CHECK_EQ( i2cGetErrorStats()->nack, 2 );
+    for( unsigned i = 1; i < QUEUED; i++ )
+    {
+        uint64_t gap = r[ i ].completedAt - r[ i - 1 ].completedAt;
+        uint8_t interrupts = ( i == 1 ) ? 4 : ( i == 4 ) ? 2 : ( i == 5 ) ? 3 : 1;
+        CHECK_EQ( gap, interrupts );
+    }
+    CHECK( i2cQueueIsEmpty() );
+    CHECK_EQ( simSleepBlocks[ sleepEM2 ], 0 );
+    CHECK_EQ( em2Mismatches, 0 );
+    CHECK_EQ( coreCriticalDepth, 0 );
+    return;
+}
+
+//! testResubmit()
+//! @brief A transaction submitted again from its own callback, or a new
+//! one submitted from a callback, runs after the rest of the queue and is
+//! started only once
+//!
+//! @returns void
+static void testResubmit()
+{
+    reset();
+    static const simI2cReply_s script[] = { { i2cTransferDone, 2, NULL, 0, 0 } };
+    simI2cSlave_s slave = { .addr = 0x20, .script = script, .scriptLen = 1 };
+    simI2cAttach( &slave );
+    record_s alone;
+    prepare( &alone, 0x20, I2C_FLAG_WRITE, 1, 0 );
+    alone.resubmit = true;
+    em2Mismatches = 0;
+    i2cSubmit( &alone.transaction );
+    runBus( 20 );
+    CHECK_EQ( alone.completions, 2 );
+    CHECK_EQ( slave.transfers, 2 );
+    CHECK_EQ( simI2cStats.restarts, 0 );
+
+    record_s first;
+    record_s second;
+    prepare( &first, 0x20, I2C_FLAG_WRITE, 1, 0 );
+    prepare( &second, 0x20, I2C_FLAG_WRITE, 1, 0 );
+    first.resubmit = true;
+    i2cSubmit( &first.transaction );
+    i2cSubmit( &second.transaction );
+    runBus( 20 );
+    CHECK_EQ( first.completions, 2 );
+    CHECK_EQ( second.completions, 1 );
+    CHECK( second.order < first.order );
+    CHECK_EQ( simI2cStats.restarts, 0 );
+    CHECK_EQ( em2Mismatches, 0 );
+    CHECK_EQ( simSleepBlocks[ sleepEM2 ], 0 );
+    return;
+}
+
+//! testTimeout()
+//! @brief A slave that hangs the bus is aborted at the transaction's
+//! deadline and not before, completes with I2C_TRANSFER_TIMEOUT, and the
+//! transaction queued behind it then runs, on the byte by byte path and
+//! on the LDMA path
+//!
+//! @returns void
+static void testTimeout()
+{
+    reset();
+    static const simI2cReply_s hangScript[] = { { i2cTransferInProgress, 0, NULL, 0, 0 } };
+    static const simI2cReply_s okScript[] = { { i2cTransferDone, 1, NULL, 0, 0 } };
+    simI2cSlave_s hang = { .addr = 0x30, .script = hangScript, .scriptLen = 1 };
+    simI2cSlave_s ok = { .addr = 0x31, .script = okScript, .scriptLen = 1 };
+    simI2cAttach( &hang );
+    simI2cAttach( &ok );
+    record_s stuck;
+    record_s behind;
+    prepare( &stuck, 0x30, I2C_FLAG_WRITE_READ, 1, 2 );
+    prepare( &behind, 0x31, I2C_FLAG_WRITE, 1, 0 );
+    stuck.transaction.stretchUs = 5000;
+    em2Mismatches = 0;
+    uint64_t start = simLetimerTicks();
+    i2cSubmit( &stuck.transaction );
+    i2cSubmit( &behind.transaction );
+    runBus( timerGetPeriodTicks() );
+
+    uint64_t tickHz = CLOCK_HZ / simCmuLetimerDiv;
+    uint64_t timeoutUs = I2C_TIMEOUT_BASE_US + ( 2 + 3 ) * I2C_TIMEOUT_PER_BYTE_US + 5000;
+    uint64_t elapsedUs = ( ( stuck.completedAt - start ) * USEC_PER_SEC ) / tickHz;
+    CHECK_EQ( stuck.completions, 1 );
+    CHECK_EQ( stuck.transaction.status, I2C_TRANSFER_TIMEOUT );
+    CHECK( elapsedUs >= timeoutUs );
+    CHECK( elapsedUs <= timeoutUs + ( 2 * USEC_PER_SEC ) / tickHz + 1 );
+    CHECK_EQ( simI2cStats.aborts, 1 );
+    CHECK_EQ( behind.completions, 1 );
+    CHECK_EQ( behind.transaction.status, i2cTransferDone );
+    CHECK_EQ( i2cGetErrorStats()->timeout, 1 );
+    CHECK_EQ( em2Mismatches, 0 );
+    CHECK_EQ( simSleepBlocks[ sleepEM2 ], 0 );
+
+    // A transaction that completes does not time out later
+    prepare( &behind, 0x31, I2C_FLAG_WRITE, 1, 0 );
+    i2cSubmit( &behind.transaction );
+    runBus( 2 * timerGetPeriodTicks() );
+    CHECK_EQ( behind.completions, 1 );
+    CHECK_EQ( i2cGetErrorStats()->timeout, 1 );
+
+    // The same on the LDMA path
+    uint8_t buffer[ 8 ];
+    prepare( &stuck, 0x30, I2C_FLAG_READ, 0, 0 );
+    stuck.transaction.seq.buf[ 0 ].data = buffer;
+    stuck.transaction.seq.buf[ 0 ].len = sizeof( buffer );
+    prepare( &behind, 0x31, I2C_FLAG_WRITE, 1, 0 );
+    unsigned ldmaStarts = simI2cStats.ldmaStarts;
+    i2cSubmit( &stuck.transaction );
+    i2cSubmit( &behind.transaction );
+    CHECK_EQ( simI2cStats.ldmaStarts, ldmaStarts + 1 );
+    runBus( timerGetPeriodTicks() );
+    CHECK_EQ( stuck.transaction.status, I2C_TRANSFER_TIMEOUT );
+    CHECK_EQ( behind.transaction.status, i2cTransferDone );
+    CHECK_EQ( i2cGetErrorStats()->timeout, 2 );
+    CHECK_EQ( simI2c0.CTRL & ( I2C_CTRL_AUTOSE | I2C_CTRL_AUTOSN ), 0 );
+    CHECK( !simI2cBusy() );
+    CHECK_EQ( em2Mismatches, 0 );
+    return;
+}
+
+//! testSi7021()
+//! @brief The Si7021 transfers write the command and convert the result
+//! read in the same transaction, signal the scheduler, and share the
+//! queue with other devices
+//!
+//! @returns void
+static void testSi7021()
+{
+    reset();
+    static const uint8_t code[] = { 0x66, 0x4E };
+    static const simI2cReply_s siScript[] =
+    {
+        { i2cTransferNack, 1, NULL, 0, 0 },
+        { i2cTransferDone, 2, NULL, 0, 0 },
+        { i2cTransferDone, 5, code, 2, 0 }
+    };
+    static const simI2cReply_s otherScript[] = { { i2cTransferDone, 1, NULL, 0, 0 } };
+    simI2cSlave_s si7021 = { .addr = SI7021_ADDR, .script = siScript, .scriptLen = 3 };
+    simI2cSlave_s other = { .addr = 0x77, .script = otherScript, .scriptLen = 1 };
+    simI2cAttach( &si7021 );
+    simI2cAttach( &other );
+    doneEvents = 0;
+    errorEvents = 0;
+
+    // Probe NACKed while the sensor powers up
+    CHECK_EQ( i2cProbe(), i2cTransferInProgress );
+    runBus( 10 );
+    CHECK_EQ( errorEvents, 1 );
+    CHECK_EQ( i2cGetTransferStatus(), i2cTransferNack );
+    CHECK_EQ( i2cProbe(), i2cTransferInProgress );
+    runBus( 10 );
+    CHECK_EQ( doneEvents, 1 );
+
+    record_s r;
+    prepare( &r, 0x77, I2C_FLAG_WRITE, 1, 0 );
+    i2cSubmit( &r.transaction );
+    CHECK_EQ( i2cMeasureTemperature(), i2cTransferInProgress );
+    runBus( 20 );
+    CHECK_EQ( r.completions, 1 );
+    CHECK_EQ( doneEvents, 2 );
+    CHECK_EQ( si7021.writtenLen, 1 );
+    CHECK_EQ( si7021.written[ 0 ], TEMP_READ_CMD );
+    CHECK_EQ( i2cGetTemperature(), si7021TemperatureMilliC( 0x664C ) );
+    CHECK_EQ( simSleepBlocks[ sleepEM2 ], 0 );
+    return;
+}
+
+//! testRecovery()
+//! @brief A slave left holding SDA makes transfers lose arbitration until
+//! i2cBusRecover() clocks it free, after which the bus works again
+//!
+//! @returns void
+static void testRecovery()
+{
+    reset();
+    static const simI2cReply_s script[] =
+    {
+        { i2cTransferBusErr, 2, NULL, 0, 6 },
+        { i2cTransferDone, 1, NULL, 0, 0 }
+    };
+    simI2cSlave_s slave = { .addr = 0x10, .script = script, .scriptLen = 2 };
+    simI2cAttach( &slave );
+    record_s r;
+    prepare( &r, 0x10, I2C_FLAG_WRITE, 1, 0 );
+    i2cSubmit( &r.transaction );
+    runBus( 10 );
+    CHECK_EQ( r.transaction.status, i2cTransferBusErr );
+    prepare( &r, 0x10, I2C_FLAG_WRITE, 1, 0 );
+    i2cSubmit( &r.transaction );
+    runBus( 10 );
+    CHECK_EQ( r.transaction.status, i2cTransferArbLost );
+    CHECK_EQ( slave.transfers, 1 );
+    CHECK_EQ( i2cGetErrorStats()->busErr, 1 );
+    CHECK_EQ( i2cGetErrorStats()->arbLost, 1 );
+
+    unsigned inits = simI2cStats.inits;
+    CHECK( i2cBusRecover() );
+    CHECK_EQ( simI2cStats.inits, inits + 1 );
+    CHECK_EQ( i2cGetErrorStats()->busRecoveries, 1 );
+    prepare( &r, 0x10, I2C_FLAG_WRITE, 1, 0 );
+    i2cSubmit( &r.transaction );
+    runBus( 10 );
+    CHECK_EQ( r.transaction.status, i2cTransferDone );
+
+    // Not while a transaction is queued
+    static const simI2cReply_s slow[] = { { i2cTransferDone, 5, NULL, 0, 0 } };
+    slave.script = slow;
+    slave.scriptLen = 1;
+    prepare( &r, 0x10, I2C_FLAG_WRITE, 1, 0 );
+    i2cSubmit( &r.transaction );
+    CHECK( !i2cBusRecover() );
+    runBus( 10 );
+    CHECK_EQ( r.transaction.status, i2cTransferDone );
+    return;
+}
+
+//! testDeinit()
+//! @brief i2cDeinit() releases the EM2 block and the bus, and completes
+//! the queued transactions with i2cTransferSwFault outside the critical
+//! section. The dropped Si7021 transaction does not signal the scheduler,
+//! which powered the sensor down itself
+//!
+//! @returns void
+static void testDeinit()
+{
+    reset();
+    static const simI2cReply_s script[] = { { i2cTransferDone, 5, NULL, 0, 0 } };
+    simI2cSlave_s slave = { .addr = 0x10, .script = script, .scriptLen = 1 };
+    simI2cSlave_s si7021 = { .addr = SI7021_ADDR, .script = script, .scriptLen = 1 };
+    simI2cAttach( &slave );
+    simI2cAttach( &si7021 );
+    doneEvents = 0;
+    errorEvents = 0;
+    uint32_t timeouts = i2cGetErrorStats()->timeout;
+    record_s r[ 3 ];
+    for( unsigned i = 0; i < 3; i++ )
+    {
+        prepare( &r[ i ], 0x10, I2C_FLAG_WRITE, 1, 0 );
+        i2cSubmit( &r[ i ].transaction );
+    }
+    CHECK_EQ( i2cMeasureTemperature(), i2cTransferInProgress );
+    runBus( 2 );
+    i2cDeinit();
+    unsigned interrupts = simI2cStats.interrupts;
+    CHECK( i2cQueueIsEmpty() );
+    CHECK( !simI2cBusy() );
+    CHECK_EQ( simSleepBlocks[ sleepEM2 ], 0 );
+    for( unsigned i = 0; i < 3; i++ )
+    {
+        CHECK_EQ( r[ i ].completions, 1 );
+        CHECK_EQ( r[ i ].order, i );
+        CHECK_EQ( r[ i ].criticalDepth, 0 );
+        CHECK_EQ( r[ i ].transaction.status, i2cTransferSwFault );
+    }
+    CHECK_EQ( i2cGetTransferStatus(), i2cTransferSwFault );
+    CHECK_EQ( doneEvents, 0 );
+    CHECK_EQ( errorEvents, 0 );
+    // Nothing completes afterwards, nor does the deadline fire
+    runBus( timerGetPeriodTicks() );
+    CHECK_EQ( r[ 0 ].completions, 1 );
+    CHECK_EQ( simI2cStats.interrupts, interrupts );
+    CHECK_EQ( i2cGetErrorStats()->timeout, timeouts );
+
+    // Each dropped transaction can be submitted again once the bus is up
+    i2cInit();
+    i2cSubmit( &r[ 0 ].transaction );
+    runBus( 20 );
+    CHECK_EQ( r[ 0 ].completions, 2 );
+    CHECK_EQ( r[ 0 ].transaction.status, i2cTransferDone );
+    CHECK_EQ( coreCriticalDepth, 0 );
+    return;
+}
+
+//! testLdma()
+//! @brief Plain reads and writes of I2C_LDMA_MIN_LEN bytes or more are
+//! moved by the LDMA and take one interrupt, where byte by byte they take
+//! one per byte. A read is ACKed by descriptors up to its last byte,
+//! which is NACKed before the STOP. Shorter transfers, the Si7021 ones
+//! included, stay byte by byte, and a NACKed address ends an LDMA
+//! transfer with i2cTransferNack
+//!
+//! @returns void
+static void testLdma()
+{
+    reset();
+    static const uint8_t stored[ 8 ] = { 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88 };
+    static const uint8_t page[ 8 ] = { 0x00, 0x40, 0xA1, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6 };
+    static const simI2cReply_s eepromScript[] = { { i2cTransferDone, 0, stored, 8, 0 } };
+    simI2cSlave_s eeprom = { .addr = 0x50, .script = eepromScript, .scriptLen = 1 };
+    simI2cAttach( &eeprom );
+    em2Mismatches = 0;
+    uint8_t buffer[ 8 ];
+    i2cTransaction_s transaction = { .seq = { .addr = 0x50 << 1 } };
+    transaction.seq.buf[ 0 ].data = buffer;
+    transaction.seq.buf[ 0 ].len = 8;
+
+    // The same 8 byte read and write byte by byte, then by the LDMA
+    for( int ldma = 0; ldma <= 1; ldma++ )
+    {
+        i2cSetLdmaEnabled( ldma );
+        i2cInterruptStats_s before = *i2cGetInterruptStats( ldma );
+        unsigned ldmaStarts = simI2cStats.ldmaStarts;
+
+        memset( buffer, 0, sizeof( buffer ) );
+        transaction.seq.flags = I2C_FLAG_READ;
+        CHECK_EQ( i2cSubmit( &transaction ), i2cTransferInProgress );
+        runBus( 20 );
+        CHECK_EQ( transaction.status, i2cTransferDone );
+        CHECK( memcmp( buffer, stored, sizeof( buffer ) ) == 0 );
+        if( ldma )
+        {
+            CHECK_EQ( simI2cLdmaCommandsLen, 9 );
+            for( unsigned i = 0; i < 7; i++ )
+            {
+                CHECK_EQ( simI2cLdmaCommands[ i ], I2C_CMD_ACK );
+            }
+            CHECK_EQ( simI2cLdmaCommands[ 7 ], I2C_CMD_NACK );
+            CHECK_EQ( simI2cLdmaCommands[ 8 ], I2C_CMD_STOP );
+        }
+
+        memcpy( buffer, page, sizeof( buffer ) );
+        transaction.seq.flags = I2C_FLAG_WRITE;
+        CHECK_EQ( i2cSubmit( &transaction ), i2cTransferInProgress );
+        runBus( 20 );
+        CHECK_EQ( transaction.status, i2cTransferDone );
+        CHECK_EQ( eeprom.writtenLen, 8 );
+        CHECK( memcmp( eeprom.written, page, sizeof( page ) ) == 0 );
+
+        const i2cInterruptStats_s *after = i2cGetInterruptStats( ldma );
+        CHECK_EQ( after->transactions - before.transactions, 2 );
+        CHECK_EQ( after->interrupts - before.interrupts, ldma ? 2 : 2 * ( 8 + 2 ) );
+        CHECK_EQ( simI2cStats.ldmaStarts - ldmaStarts, ldma ? 2 : 0 );
+    }
+    CHECK_EQ( eeprom.transfers, 4 );
+    CHECK_EQ( simI2c0.CTRL & ( I2C_CTRL_AUTOSE | I2C_CTRL_AUTOSN ), 0 );
+
+    // Too short for the LDMA
+    unsigned ldmaStarts = simI2cStats.ldmaStarts;
+    transaction.seq.buf[ 0 ].len = I2C_LDMA_MIN_LEN - 1;
+    i2cSubmit( &transaction );
+    static const uint8_t code[] = { 0x66, 0x4E };
+    static const simI2cReply_s siScript[] = { { i2cTransferDone, 0, code, 2, 0 } };
+    simI2cSlave_s si7021 = { .addr = SI7021_ADDR, .script = siScript, .scriptLen = 1 };
+    simI2cAttach( &si7021 );
+    CHECK_EQ( i2cMeasureTemperature(), i2cTransferInProgress );
+    runBus( 20 );
+    CHECK_EQ( transaction.status, i2cTransferDone );
+    CHECK_EQ( i2cGetTransferStatus(), i2cTransferDone );
+    CHECK_EQ( i2cGetTemperature(), si7021TemperatureMilliC( 0x664C ) );
+    CHECK_EQ( simI2cStats.ldmaStarts, ldmaStarts );
+
+    // No slave at the address
+    transaction.seq.addr = 0x51 << 1;
+    transaction.seq.buf[ 0 ].len = 8;
+    transaction.seq.flags = I2C_FLAG_READ;
+    i2cSubmit( &transaction );
+    runBus( 20 );
+    CHECK_EQ( transaction.status, i2cTransferNack );
+    CHECK_EQ( simI2cStats.ldmaStarts, ldmaStarts + 1 );
+    CHECK_EQ( simI2c0.IEN, 0 );
+    CHECK( i2cQueueIsEmpty() );
+    CHECK_EQ( em2Mismatches, 0 );
+    CHECK_EQ( coreCriticalDepth, 0 );
+    return;
+}
+
+int main()
+{
+    testQueue();
+    testResubmit();
+    testTimeout();
+    testSi7021();
+    testRecovery();
+    testDeinit();
+    testLdma();
+    return checkResult( "test_i2c" );
+}
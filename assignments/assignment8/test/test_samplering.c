@@ -0,0 +1,294 @@
+//!
+//! @file test_samplering.c
+//! @brief Host checks of the sample ring: delta encode and decode round
+//! trips, block boundaries, both full policies, wraparound of the block
+//! storage and of the sample sequence numbers, and reader cursors
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources None
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#include "samplering.h"
+#include "check.h"
+#include "em_core.h"
+
+#include <stdlib.h>
+
+#define NUM_BLOCKS      ( 4 )
+#define PERIOD_MS       ( 1000 )
+
+static sampleRingBlock_s blocks[ NUM_BLOCKS ];
+
+//! valueOf()
+//! @brief Value of the nth test sample, a slow walk with some noise
+//!
+//! @param n
+//! @returns value
+static int32_t valueOf( uint32_t n )
+{
+    return 21000 + ( int32_t ) ( ( n * 37 ) % 2000 ) - 1000 + ( int32_t ) ( n / 10 );
+}
+
+//! testRoundTrip()
+//! @brief Samples on a regular grid come back with the same values and
+//! timestamps, and fill whole blocks
+//!
+//! @returns void
+static void testRoundTrip()
+{
+    sampleRing_s ring;
+    sampleRingInit( &ring, blocks, NUM_BLOCKS, SAMPLE_RING_STOP_WHEN_FULL );
+    uint32_t total = NUM_BLOCKS * SAMPLE_RING_SAMPLES_PER_BLOCK;
+    for( uint32_t n = 0; n < total; n++ )
+    {
+        CHECK( sampleRingAppend( &ring, 5000 + ( uint64_t ) n * PERIOD_MS, valueOf( n ) ) );
+    }
+    CHECK_EQ( sampleRingStored( &ring ), total );
+    CHECK_EQ( ring.nextBlock - ring.firstBlock, NUM_BLOCKS );
+
+    sampleRingCursor_s cursor;
+    sampleRingSample_s sample;
+    sampleRingCursorOldest( &ring, &cursor );
+    CHECK_EQ( sampleRingUnread( &ring, &cursor ), total );
+    for( uint32_t n = 0; n < total; n++ )
+    {
+        CHECK( sampleRingRead( &ring, &cursor, &sample ) );
+        CHECK_EQ( sample.timestampMs, 5000 + ( uint64_t ) n * PERIOD_MS );
+        CHECK_EQ( sample.value, valueOf( n ) );
+    }
+    CHECK( !sampleRingRead( &ring, &cursor, &sample ) );
+    CHECK_EQ( sampleRingUnread( &ring, &cursor ), 0 );
+    CHECK_EQ( cursor.lost, 0 );
+    return;
+}
+
+//! testBlockBreaks()
+//! @brief A value jump beyond 16 bits or a timestamp off the grid starts
+//! a new block, and jitter within SAMPLE_RING_JITTER_MS does not.
+//! Timestamps read back on the grid
+//!
+//! @returns void
+static void testBlockBreaks()
+{
+    sampleRing_s ring;
+    sampleRingInit( &ring, blocks, NUM_BLOCKS, SAMPLE_RING_STOP_WHEN_FULL );
+    CHECK( sampleRingAppend( &ring, 0, 0 ) );
+    CHECK( sampleRingAppend( &ring, 1000, INT16_MAX ) );
+    CHECK( sampleRingAppend( &ring, 2000 + SAMPLE_RING_JITTER_MS, INT16_MIN ) );
+    CHECK_EQ( ring.nextBlock, 1 );
+
+    // Jump of one more than a delta holds
+    CHECK( sampleRingAppend( &ring, 3000, INT16_MAX + 1 ) );
+    CHECK_EQ( ring.nextBlock, 2 );
+
+    // Late by more than the jitter allowance
+    CHECK( sampleRingAppend( &ring, 4000, INT16_MAX + 1 ) );
+    CHECK( sampleRingAppend( &ring, 5000 + SAMPLE_RING_JITTER_MS + 1, INT16_MAX + 1 ) );
+    CHECK_EQ( ring.nextBlock, 3 );
+
+    // Time going backwards
+    CHECK( sampleRingAppend( &ring, 5000, 7 ) );
+    CHECK_EQ( ring.nextBlock, 4 );
+
+    static const struct
+    {
+        uint64_t timestampMs;
+        int32_t value;
+    } expected[] =
+    {
+        { 0, 0 }, { 1000, INT16_MAX }, { 2000, INT16_MIN },
+        { 3000, INT16_MAX + 1 }, { 4000, INT16_MAX + 1 },
+        { 5000 + SAMPLE_RING_JITTER_MS + 1, INT16_MAX + 1 },
+        { 5000, 7 },
+    };
+    sampleRingCursor_s cursor;
+    sampleRingSample_s sample;
+    sampleRingCursorOldest( &ring, &cursor );
+    for( size_t i = 0; i < sizeof( expected ) / sizeof( expected[ 0 ] ); i++ )
+    {
+        CHECK( sampleRingRead( &ring, &cursor, &sample ) );
+        CHECK_EQ( sample.timestampMs, expected[ i ].timestampMs );
+        CHECK_EQ( sample.value, expected[ i ].value );
+    }
+    CHECK( !sampleRingRead( &ring, &cursor, &sample ) );
+
+    // Ring is full of blocks, a sample that needs a new one is rejected
+    CHECK( !sampleRingAppend( &ring, 4999, 7 ) );
+    CHECK_EQ( sampleRingDropped( &ring ), 1 );
+    CHECK_EQ( sampleRingStored( &ring ), 7 );
+    return;
+}
+
+//! testOverwriteWraparound()
+//! @brief Many times the capacity goes through a ring that overwrites.
+//! A reader keeping up loses nothing, a reader that stalls is told how
+//! many samples it lost and resumes at the oldest
+//!
+//! @returns void
+static void testOverwriteWraparound()
+{
+    sampleRing_s ring;
+    sampleRingInit( &ring, blocks, NUM_BLOCKS, SAMPLE_RING_OVERWRITE_OLDEST );
+    // Sample sequence numbers wrap during the test
+    ring.appended = UINT32_MAX - 100;
+
+    sampleRingCursor_s live;
+    sampleRingCursor_s stalled;
+    sampleRingSample_s sample;
+    sampleRingCursorNewest( &ring, &live );
+    sampleRingCursorNewest( &ring, &stalled );
+
+    uint32_t capacity = NUM_BLOCKS * SAMPLE_RING_SAMPLES_PER_BLOCK;
+    uint32_t total = capacity * 10 + 5;
+    for( uint32_t n = 0; n < total; n++ )
+    {
+        CHECK( sampleRingAppend( &ring, ( uint64_t ) n * PERIOD_MS, valueOf( n ) ) );
+        CHECK( sampleRingRead( &ring, &live, &sample ) );
+        CHECK_EQ( sample.value, valueOf( n ) );
+        CHECK_EQ( sample.timestampMs, ( uint64_t ) n * PERIOD_MS );
+        CHECK( !sampleRingRead( &ring, &live, &sample ) );
+    }
+    CHECK_EQ( live.lost, 0 );
+
+    // Whole blocks are dropped, the newest block holds the last 5
+    uint32_t stored = ( NUM_BLOCKS - 1 ) * SAMPLE_RING_SAMPLES_PER_BLOCK + 5;
+    CHECK_EQ( sampleRingStored( &ring ), stored );
+    CHECK_EQ( sampleRingDropped( &ring ), total - stored );
+    CHECK_EQ( sampleRingUnread( &ring, &stalled ), stored );
+
+    uint32_t n = total - stored;
+    CHECK( sampleRingRead( &ring, &stalled, &sample ) );
+    CHECK_EQ( stalled.lost, total - stored );
+    CHECK_EQ( sample.value, valueOf( n ) );
+    while( sampleRingRead( &ring, &stalled, &sample ) )
+    {
+        n++;
+        CHECK_EQ( sample.value, valueOf( n ) );
+        CHECK_EQ( sample.timestampMs, ( uint64_t ) n * PERIOD_MS );
+    }
+    CHECK_EQ( n, total - 1 );
+    CHECK_EQ( stalled.sample, live.sample );
+    return;
+}
+
+//! testSeek()
+//! @brief Seeking by sequence number lands on the right sample, before
+//! the oldest counts the lost samples, past the newest reads nothing
+//!
+//! @returns void
+static void testSeek()
+{
+    sampleRing_s ring;
+    sampleRingInit( &ring, blocks, NUM_BLOCKS, SAMPLE_RING_OVERWRITE_OLDEST );
+    ring.appended = UINT32_MAX - 10;
+    uint32_t base = ring.appended;
+    uint32_t total = NUM_BLOCKS * SAMPLE_RING_SAMPLES_PER_BLOCK + 40;
+    for( uint32_t n = 0; n < total; n++ )
+    {
+        sampleRingAppend( &ring, ( uint64_t ) n * PERIOD_MS, valueOf( n ) );
+    }
+    uint32_t oldest = total - sampleRingStored( &ring );
+
+    sampleRingCursor_s cursor;
+    sampleRingSample_s sample;
+    for( uint32_t n = oldest; n < total; n += 7 )
+    {
+        sampleRingCursorSeek( &ring, &cursor, base + n );
+        CHECK_EQ( cursor.lost, 0 );
+        CHECK( sampleRingRead( &ring, &cursor, &sample ) );
+        CHECK_EQ( sample.value, valueOf( n ) );
+        CHECK_EQ( cursor.sample, base + n + 1 );
+    }
+
+    sampleRingCursorSeek( &ring, &cursor, base + oldest - 3 );
+    CHECK_EQ( cursor.lost, 3 );
+    CHECK( sampleRingRead( &ring, &cursor, &sample ) );
+    CHECK_EQ( sample.value, valueOf( oldest ) );
+
+    sampleRingCursorSeek( &ring, &cursor, base + total + 3 );
+    CHECK( !sampleRingRead( &ring, &cursor, &sample ) );
+    sampleRingAppend( &ring, ( uint64_t ) total * PERIOD_MS, valueOf( total ) );
+    CHECK( sampleRingRead( &ring, &cursor, &sample ) );
+    CHECK_EQ( sample.value, valueOf( total ) );
+
+    // Clearing moves readers past everything stored
+    sampleRingClear( &ring );
+    CHECK_EQ( sampleRingStored( &ring ), 0 );
+    sampleRingCursorSeek( &ring, &cursor, base );
+    CHECK( !sampleRingRead( &ring, &cursor, &sample ) );
+    return;
+}
+
+//! testRandomRoundTrip()
+//! @brief Random values and timestamps, some off the grid, against a
+//! plain array of everything appended
+//!
+//! @returns void
+static void testRandomRoundTrip()
+{
+    static sampleRingSample_s appended[ 20000 ];
+    sampleRing_s ring;
+    sampleRingInit( &ring, blocks, NUM_BLOCKS, SAMPLE_RING_OVERWRITE_OLDEST );
+    srand( 5823 );
+
+    sampleRingCursor_s cursor;
+    sampleRingSample_s sample;
+    sampleRingCursorOldest( &ring, &cursor );
+    uint64_t timeMs = 0;
+    int32_t value = 0;
+    uint32_t next = 0;
+    uint32_t read = 0;
+    for( uint32_t n = 0; n < 20000; n++ )
+    {
+        int r = rand() % 100;
+        timeMs += ( r < 5 ) ? ( uint64_t ) ( rand() % 5000 ) : PERIOD_MS;
+        value += ( r < 3 ) ? ( rand() % 200000 ) - 100000 : ( rand() % 21 ) - 10;
+        CHECK( sampleRingAppend( &ring, timeMs, value ) );
+        appended[ n ].timestampMs = timeMs;
+        appended[ n ].value = value;
+
+        // Read in bursts, sometimes falling behind
+        if( ( ( rand() % 50 ) == 0 ) || ( n == 19999 ) )
+        {
+            while( sampleRingRead( &ring, &cursor, &sample ) )
+            {
+                next += cursor.lost;
+                read += cursor.lost;
+                cursor.lost = 0;
+                // Off grid samples start a block, they keep their timestamp
+                CHECK_EQ( sample.value, appended[ next ].value );
+                uint64_t errorMs = ( sample.timestampMs > appended[ next ].timestampMs ) ?
+                    ( sample.timestampMs - appended[ next ].timestampMs ) :
+                    ( appended[ next ].timestampMs - sample.timestampMs );
+                CHECK( errorMs <= SAMPLE_RING_JITTER_MS );
+                next++;
+                read++;
+            }
+        }
+    }
+    CHECK_EQ( read, 20000 );
+    CHECK_EQ( sampleRingUnread( &ring, &cursor ), 0 );
+    return;
+}
+
+int main()
+{
+    testRoundTrip();
+    testBlockBreaks();
+    testOverwriteWraparound();
+    testSeek();
+    testRandomRoundTrip();
+    CHECK_EQ( coreCriticalDepth, 0 );
+    return checkResult( "test_samplering" );
+}
@@ -0,0 +1,450 @@
+//!
+//! @file test_swtimers.c
+//! @brief Host checks of the software timer service running on the real
+//! timers.c, swtimers.c and LETIMER0_IRQHandler() over the simulated
+//! LETIMER0 in sim/letimer.c. Every expiration is checked against the
+//! deadline it was due at, in the firmware time base and in simulated time
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources None
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#include "swtimers.h"
+#include "timers.h"
+#include "scheduler.h"
+#include "timebase.h"
+#include "main.h"
+#include "check.h"
+
+#include "em_cmu.h"
+#include "em_i2c.h"
+#include "em_letimer.h"
+
+#include "sim/letimer.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+//! LFXO frequency, the LETIMER0 clock in EM2 and EM3
+#define CLOCK_HZ            ( 32768 )
+
+//! Number of timers in the random test
+#define RANDOM_TIMERS       ( 16 )
+
+//! Counter reads the timer service may make between a deadline and the
+//! expiration, each letting simLetimerReadTicks pass
+#define MAX_READS_LATE      ( 64 )
+
+//! Shortest period in the random test
+#define MIN_RANDOM_PERIOD   ( 100 )
+
+//! Set by oscillatorsInit() on the board
+uint32_t clockFrequencyHz = CLOCK_HZ;
+
+//! Number of times timerWaitUs() signalled the scheduler
+static unsigned timerDoneEvents;
+
+void schedulerSignalEvent( schedulerEvents_e ev )
+{
+    if( ev == EVENT_LETIMER0_COMP1 )
+    {
+        timerDoneEvents++;
+    }
+    return;
+}
+
+uint64_t timeNowTicks()
+{
+    return 0;
+}
+
+//! Called by I2C0_IRQHandler(), which is linked in with LETIMER0_IRQHandler()
+void i2cIrqHandler()
+{
+    return;
+}
+
+//! Expectations of one timer under test
+typedef struct
+{
+    swTimer_s timer;
+    uint32_t deadline;      //! Firmware ticks the next expiration is due at
+    uint64_t due;           //! Simulated ticks the next expiration is due at
+    uint32_t period;        //! Expected reload period in ticks, 0 for one-shot
+    uint32_t slack;         //! Ticks the next expiration may come late by
+    unsigned expirations;
+    bool armed;             //! Started and not yet expired or stopped
+    bool restart;           //! Restart from the callback with the same delay
+    uint32_t restartDelay;
+} expect_s;
+
+//! allowedLateness()
+//! @brief Returns how many ticks after its deadline an expiration may come
+//!
+//! @param e
+//! @returns ticks
+static uint32_t allowedLateness( const expect_s *e )
+{
+    return simLetimerIrqLatency + ( simLetimerReadTicks * MAX_READS_LATE ) + e->slack;
+}
+
+//! startExpect()
+//! @brief Start the timer of e with swTimerStartTicks() and record when
+//! it is due
+//!
+//! @param e
+//! @param delay ticks
+//! @param period ticks, 0 for one-shot
+//! @returns void
+static void startExpect( expect_s *e, uint32_t delay, uint32_t period );
+
+//! onExpiry()
+//! @brief Timer callback. Checks the expiration happened in interrupt
+//! context, no earlier than its deadline and no later than the interrupt
+//! latency allows, then moves the expectation on to the next period
+//!
+//! @param arg expect_s of the timer
+//! @returns void
+static void onExpiry( void *arg )
+{
+    expect_s *e = arg;
+    uint32_t now = timerGetTicks();
+    uint64_t real = simLetimerTicks();
+    CHECK( coreCriticalDepth > 0 );
+    CHECK( e->armed );
+    CHECK( ( int32_t ) ( now - e->deadline ) >= 0 );
+    CHECK( ( now - e->deadline ) <= allowedLateness( e ) );
+    CHECK( real >= e->due );
+    CHECK( real <= e->due + allowedLateness( e ) );
+    CHECK_EQ( swTimerIsActive( &e->timer ), e->period != 0 );
+    e->expirations++;
+    e->deadline += e->period;
+    e->due += e->period;
+    e->slack = 0;
+    e->armed = ( e->period != 0 );
+    if( e->restart )
+    {
+        startExpect( e, e->restartDelay, 0 );
+    }
+    return;
+}
+
+static void startExpect( expect_s *e, uint32_t delay, uint32_t period )
+{
+    e->deadline = timerGetTicks() + delay;
+    e->due = simLetimerTicks() + delay;
+    e->period = period;
+    e->slack = 0;
+    e->armed = true;
+    swTimerStartTicks( &e->timer, delay, period, onExpiry, e );
+    return;
+}
+
+//! stopExpect()
+//! @brief Stop the timer of e, it must not expire after this
+//!
+//! @param e
+//! @returns void
+static void stopExpect( expect_s *e )
+{
+    e->armed = false;
+    swTimerStop( &e->timer );
+    return;
+}
+
+//! overdue()
+//! @brief Returns whether e has an expiration outstanding that should
+//! have happened by now
+//!
+//! @param e
+//! @returns true if an expiration was missed
+static bool overdue( const expect_s *e )
+{
+    return e->armed && ( ( e->due + allowedLateness( e ) ) < simLetimerTicks() );
+}
+
+//! reset()
+//! @brief Restart LETIMER0 and the timer service from a known state
+//!
+//! @param latency interrupt latency in ticks
+//! @param readTicks ticks that pass on each counter read
+//! @returns void
+static void reset( uint32_t latency, uint32_t readTicks )
+{
+    simLetimer0 = ( LETIMER_TypeDef ) { 0 };
+    simLetimerIrqLatency = latency;
+    simLetimerReadTicks = readTicks;
+    timerInit();
+    simLetimerStart();
+    return;
+}
+
+//! testTicks()
+//! @brief timerGetTicks() advances by exactly one every tick across
+//! underflows, including while the underflow interrupt is still pending
+//!
+//! @returns void
+static void testTicks()
+{
+    const uint32_t latencies[] = { 0, 1, 100 };
+    for( unsigned l = 0; l < sizeof( latencies ) / sizeof( latencies[ 0 ] ); l++ )
+    {
+        reset( latencies[ l ], 0 );
+        CHECK_EQ( timerGetPeriodTicks(), ( CLOCK_HZ * 3 ) / 2 );
+        CHECK_EQ( simCmuLetimerDiv, 2 );
+        unsigned mismatches = 0;
+        for( uint32_t i = 0; i < 3 * timerGetPeriodTicks(); i++ )
+        {
+            if( timerGetTicks() != simLetimerTicks() )
+            {
+                mismatches++;
+            }
+            simLetimerRun( 1 );
+        }
+        CHECK_EQ( mismatches, 0 );
+        CHECK_EQ( coreCriticalDepth, 0 );
+    }
+    return;
+}
+
+//! testOneShot()
+//! @brief One-shot timers expire exactly once, at their deadline, for
+//! delays around period boundaries and from every part of the period
+//!
+//! @returns void
+static void testOneShot()
+{
+    reset( 0, 0 );
+    uint32_t period = timerGetPeriodTicks();
+    const uint32_t delays[] =
+    {
+        1, 2, 3, 100, period / 2, period - 2, period - 1, period, period + 1,
+        2 * period - 1, 2 * period, 5 * period + 7
+    };
+    const uint32_t offsets[] = { 0, 1, period / 3, period - 2, period - 1, period };
+    for( unsigned d = 0; d < sizeof( delays ) / sizeof( delays[ 0 ] ); d++ )
+    {
+        for( unsigned o = 0; o < sizeof( offsets ) / sizeof( offsets[ 0 ] ); o++ )
+        {
+            expect_s e = { 0 };
+            simLetimerRun( offsets[ o ] );
+            startExpect( &e, delays[ d ], 0 );
+            simLetimerRun( delays[ d ] - 1 );
+            CHECK_EQ( e.expirations, 0 );
+            CHECK( swTimerIsActive( &e.timer ) );
+            simLetimerRun( 1 );
+            CHECK_EQ( e.expirations, 1 );
+            CHECK( !swTimerIsActive( &e.timer ) );
+            simLetimerRun( 3 * period );
+            CHECK_EQ( e.expirations, 1 );
+        }
+    }
+    CHECK_EQ( coreCriticalDepth, 0 );
+    return;
+}
+
+//! testPeriodic()
+//! @brief Periodic timers with periods shorter than, equal to and longer
+//! than the LETIMER0 period expire at every multiple of their period,
+//! alongside each other and a timer restarted from its own callback
+//!
+//! @returns void
+static void testPeriodic()
+{
+    reset( 0, 0 );
+    uint32_t period = timerGetPeriodTicks();
+    const uint32_t periods[] = { 1, 7, 1000, period - 1, period, period + 1, 3 * period + 11 };
+    expect_s e[ sizeof( periods ) / sizeof( periods[ 0 ] ) ];
+    memset( e, 0, sizeof( e ) );
+    expect_s chained = { 0 };
+    simLetimerRun( 123 );
+    for( unsigned i = 0; i < sizeof( periods ) / sizeof( periods[ 0 ] ); i++ )
+    {
+        startExpect( &e[ i ], periods[ i ], periods[ i ] );
+    }
+    chained.restart = true;
+    chained.restartDelay = 333;
+    startExpect( &chained, 333, 0 );
+
+    uint32_t run = 20 * period;
+    simLetimerRun( run );
+    for( unsigned i = 0; i < sizeof( periods ) / sizeof( periods[ 0 ] ); i++ )
+    {
+        CHECK_EQ( e[ i ].expirations, run / periods[ i ] );
+        stopExpect( &e[ i ] );
+    }
+    CHECK_EQ( chained.expirations, run / 333 );
+    chained.restart = false;
+    stopExpect( &chained );
+    CHECK_EQ( coreCriticalDepth, 0 );
+    return;
+}
+
+//! testStopAndSetPeriod()
+//! @brief A stopped timer never expires, and swTimerSetPeriod() moves the
+//! next expiration to one new period after the previous one, or to now if
+//! that has passed
+//!
+//! @returns void
+static void testStopAndSetPeriod()
+{
+    reset( 0, 0 );
+    uint32_t period = timerGetPeriodTicks();
+    expect_s stopped = { 0 };
+    expect_s other = { 0 };
+    startExpect( &stopped, period / 2, 0 );
+    startExpect( &other, period / 2, 0 );
+    simLetimerRun( period / 2 - 1 );
+    stopExpect( &stopped );
+    CHECK( !swTimerIsActive( &stopped.timer ) );
+    stopExpect( &stopped );
+    simLetimerRun( 2 * period );
+    CHECK_EQ( stopped.expirations, 0 );
+    CHECK_EQ( other.expirations, 1 );
+
+    expect_s e = { 0 };
+    startExpect( &e, 1000, 1000 );
+    simLetimerRun( 1500 );
+    CHECK_EQ( e.expirations, 1 );
+    // Longer period, next expiration 5000 after the first
+    swTimerSetPeriod( &e.timer, 5000 );
+    e.deadline += 4000;
+    e.due += 4000;
+    e.period = 5000;
+    simLetimerRun( 4499 );
+    CHECK_EQ( e.expirations, 1 );
+    simLetimerRun( 1 );
+    CHECK_EQ( e.expirations, 2 );
+    // Shorter period whose next expiration has already passed
+    simLetimerRun( 3000 );
+    e.deadline -= 3000;
+    e.due -= 3000;
+    e.period = 2000;
+    e.slack = 1000;
+    swTimerSetPeriod( &e.timer, 2000 );
+    CHECK_EQ( e.expirations, 3 );
+    // It keeps the phase of the previous expiration
+    simLetimerRun( 10000 );
+    CHECK_EQ( e.expirations, 8 );
+    stopExpect( &e );
+    CHECK_EQ( coreCriticalDepth, 0 );
+    return;
+}
+
+//! testMicroseconds()
+//! @brief swTimerStart() and timerWaitUs() never expire before the
+//! requested time has passed, and at most two ticks after
+//!
+//! @returns void
+static void testMicroseconds()
+{
+    reset( 0, 0 );
+    uint64_t tickHz = CLOCK_HZ / simCmuLetimerDiv;
+    for( uint32_t us = 0; us < 20000000; us = ( us * 3 ) / 2 + 1 )
+    {
+        simLetimerRun( rand() % timerGetPeriodTicks() );
+        unsigned events = timerDoneEvents;
+        uint64_t start = simLetimerTicks();
+        timerWaitUs( us );
+        while( timerDoneEvents == events )
+        {
+            simLetimerRun( 1 );
+        }
+        uint64_t elapsedUs = ( ( simLetimerTicks() - start ) * USEC_PER_SEC ) / tickHz;
+        uint64_t slackUs = ( 2 * USEC_PER_SEC + tickHz - 1 ) / tickHz;
+        CHECK( elapsedUs >= us );
+        CHECK( elapsedUs <= us + slackUs );
+    }
+    // A cancelled wait does not signal
+    unsigned events = timerDoneEvents;
+    timerWaitUs( 1000 );
+    timerCancelWait();
+    simLetimerRun( 2 * timerGetPeriodTicks() );
+    CHECK_EQ( timerDoneEvents, events );
+    CHECK_EQ( coreCriticalDepth, 0 );
+    return;
+}
+
+//! testRandom()
+//! @brief Timers started, restarted, re-periodised and stopped at random
+//! points expire at every deadline and only then. With time passing on
+//! counter reads the counter passes COMP1 while it is being loaded, and
+//! no expiration may be lost to that
+//!
+//! @param latency interrupt latency in ticks
+//! @param readTicks ticks that pass on each counter read
+//! @param startTicks ticks to run before the test, to cross the wrap of
+//! the 32-bit tick count
+//! @returns void
+static void testRandom( uint32_t latency, uint32_t readTicks, uint64_t startTicks )
+{
+    reset( latency, 0 );
+    simLetimerRun( startTicks );
+    simLetimerReadTicks = readTicks;
+    uint32_t period = timerGetPeriodTicks();
+    expect_s e[ RANDOM_TIMERS ];
+    memset( e, 0, sizeof( e ) );
+    unsigned missed = 0;
+    srand( 5823 + latency + readTicks );
+    for( unsigned step = 0; step < 4000; step++ )
+    {
+        unsigned i = rand() % RANDOM_TIMERS;
+        switch( rand() % 4 )
+        {
+            case 0:
+                stopExpect( &e[ i ] );
+                break;
+            case 1:
+                startExpect( &e[ i ], 1 + rand() % ( 3 * period ), 0 );
+                break;
+            default:
+                // Periods shorter than the time an expiration takes to
+                // service would never let the service catch up
+                startExpect( &e[ i ], 1 + rand() % ( 2 * period ), MIN_RANDOM_PERIOD + rand() % ( 2 * period ) );
+                break;
+        }
+        simLetimerRun( rand() % ( period / 4 ) );
+        for( unsigned j = 0; j < RANDOM_TIMERS; j++ )
+        {
+            missed += overdue( &e[ j ] );
+        }
+    }
+    // Every one-shot timer still pending expires in time
+    simLetimerRun( 3 * period + latency + 1 );
+    for( unsigned i = 0; i < RANDOM_TIMERS; i++ )
+    {
+        missed += overdue( &e[ i ] );
+        CHECK( !e[ i ].armed || ( e[ i ].period != 0 ) );
+        stopExpect( &e[ i ] );
+    }
+    CHECK_EQ( missed, 0 );
+    CHECK_EQ( coreCriticalDepth, 0 );
+    return;
+}
+
+int main()
+{
+    testTicks();
+    testOneShot();
+    testPeriodic();
+    testStopAndSetPeriod();
+    testMicroseconds();
+    testRandom( 0, 0, 0 );
+    testRandom( 5, 0, 0 );
+    testRandom( 0, 1, 0 );
+    testRandom( 3, 2, 0 );
+    testRandom( 0, 0, UINT32_MAX - 200000 );
+    testRandom( 7, 1, UINT32_MAX - 200000 );
+    return checkResult( "test_swtimers" );
+}
@@ -0,0 +1,179 @@
+//!
+//! @file test_txpower.c
+//! @brief Host checks of the TX power control loop in txpower.c: the RSSI
+//! filter and hysteresis of a link, and the rate limit and halts of the
+//! radio power changes, which go to the Bluetooth stack stand-in in
+//! sim/gecko.c
+//! @version 0.1
+//!
+//! @date 2020-10-24
+//! @author Roberto Baquerizo (roba8460@colorado.edu)
+//!
+//! @institution University of Colorado Boulder (UCB)
+//! @course ECEN 5823-001: IoT Embedded Firmware (Fall 2020)
+//! @instructor David Sluiter
+//!
+//! @assignment ecen5823-assignment7-baquerrj
+//!
+//! @resources None
+//!
+//! @copyright All rights reserved. Distribution allowed only for the use of assignment grading. Use of code excerpts allowed at the discretion of author. Contact for permission.
+//!
+
+#include "txpower.h"
+#include "check.h"
+
+#include "sim/gecko.h"
+
+//! Time of the firmware, moved by the checks
+static uint64_t nowMs = 0;
+
+uint64_t timeNowMs()
+{
+    return nowMs;
+}
+
+//! settle()
+//! @brief Feed a link the same RSSI reading count times
+//!
+//! @param link
+//! @param rssi
+//! @param count
+//! @returns power level of the link after the last reading
+static uint8_t settle( txPowerLink_s *link, int8_t rssi, uint8_t count )
+{
+    uint8_t level = link->level;
+    for( uint8_t i = 0; i < count; i++ )
+    {
+        level = txPowerLinkUpdate( link, rssi );
+    }
+    return level;
+}
+
+//! testFirstReading()
+//! @brief The first reading of a link sets its level straight from the
+//! step table, with no filter and no hysteresis
+//!
+//! @returns void
+static void testFirstReading()
+{
+    static const int8_t RSSI[] = { -20, -35, -36, -50, -60, -70, -80, -85, -86, -127 };
+    static const uint8_t LEVEL[] = { 0, 1, 1, 2, 3, 4, 5, 6, 6, 6 };
+    txPowerLink_s link;
+    for( uint8_t i = 0; i < sizeof( RSSI ) / sizeof( RSSI[ 0 ] ); i++ )
+    {
+        txPowerLinkReset( &link );
+        CHECK( !link.valid );
+        CHECK_EQ( link.level, 4 );
+        CHECK_EQ( txPowerLinkUpdate( &link, RSSI[ i ] ), LEVEL[ i ] );
+        CHECK( link.valid );
+        CHECK_EQ( link.rssiQ4, RSSI[ i ] * 16 );
+    }
+    return;
+}
+
+//! testFilter()
+//! @brief A single outlier moves the filtered RSSI by a quarter of its
+//! distance and leaves the level alone, a lasting change moves it
+//!
+//! @returns void
+static void testFilter()
+{
+    txPowerLink_s link;
+    txPowerLinkReset( &link );
+    CHECK_EQ( settle( &link, -50, 1 ), 2 );
+    CHECK_EQ( txPowerLinkUpdate( &link, -70 ), 2 );
+    CHECK_EQ( link.rssiQ4, -55 * 16 );
+    CHECK_EQ( settle( &link, -50, 20 ), 2 );
+    CHECK( link.rssiQ4 > -51 * 16 );
+
+    CHECK_EQ( settle( &link, -70, 40 ), 4 );
+    CHECK( link.rssiQ4 < -69 * 16 );
+    return;
+}
+
+//! testHysteresis()
+//! @brief Readings within TX_POWER_HYSTERESIS_DB of the -65 dBm boundary
+//! between levels 3 and 4 keep the current level on either side of it
+//!
+//! @returns void
+static void testHysteresis()
+{
+    txPowerLink_s link;
+    txPowerLinkReset( &link );
+    CHECK_EQ( settle( &link, -66, 1 ), 4 );
+    CHECK_EQ( settle( &link, -63, 40 ), 4 );
+    CHECK_EQ( settle( &link, -61, 40 ), 3 );
+    CHECK_EQ( settle( &link, -67, 40 ), 3 );
+    CHECK_EQ( settle( &link, -69, 40 ), 4 );
+
+    // Readings swinging across the boundary every time do not flip it
+    for( uint8_t i = 0; i < 40; i++ )
+    {
+        CHECK_EQ( txPowerLinkUpdate( &link, ( i & 1 ) ? -62 : -68 ), 4 );
+    }
+    return;
+}
+
+//! testApply()
+//! @brief The radio power changes under a halted stack, only when it
+//! differs from the current power, and at most once per
+//! TX_POWER_MIN_CHANGE_MS. Levels past the table saturate, and the return
+//! to the default power is not rate limited
+//!
+//! @returns void
+static void testApply()
+{
+    simGeckoReset( SIM_GECKO_TX_BUFFERS );
+    txPowerStats_s before = *txPowerGetStats();
+
+    // Level 4 is the default power: nothing to do
+    txPowerApply( 4 );
+    CHECK_EQ( simGeckoStats.txPowerSets, 0 );
+    CHECK_EQ( txPowerGetStats()->haltsAvoided, before.haltsAvoided + 1 );
+
+    txPowerApply( 6 );
+    CHECK_EQ( simGeckoStats.txPowerSets, 1 );
+    CHECK_EQ( simGeckoStats.lastTxPower, MAX_TX_POWER );
+
+    // Too soon after the last change
+    nowMs += TX_POWER_MIN_CHANGE_MS - 1;
+    txPowerApply( 5 );
+    CHECK_EQ( simGeckoStats.txPowerSets, 1 );
+    CHECK_EQ( txPowerGetStats()->rateLimited, before.rateLimited + 1 );
+
+    nowMs += 1;
+    txPowerApply( 5 );
+    CHECK_EQ( simGeckoStats.txPowerSets, 2 );
+    CHECK_EQ( simGeckoStats.lastTxPower, 50 );
+
+    nowMs += TX_POWER_MIN_CHANGE_MS;
+    txPowerApply( 200 );
+    CHECK_EQ( simGeckoStats.txPowerSets, 3 );
+    CHECK_EQ( simGeckoStats.lastTxPower, MAX_TX_POWER );
+
+    nowMs += TX_POWER_MIN_CHANGE_MS;
+    txPowerApply( 0 );
+    CHECK_EQ( simGeckoStats.lastTxPower, MIN_TX_POWER );
+    txPowerReset();
+    CHECK_EQ( simGeckoStats.txPowerSets, 5 );
+    CHECK_EQ( simGeckoStats.lastTxPower, DEFAULT_TX_POWER );
+    txPowerReset();
+    CHECK_EQ( simGeckoStats.txPowerSets, 5 );
+
+    CHECK_EQ( simGeckoStats.halts, simGeckoStats.txPowerSets );
+    CHECK_EQ( simGeckoStats.txPowerUnhalted, 0 );
+    CHECK_EQ( txPowerGetStats()->changes, before.changes + 5 );
+    CHECK_EQ( txPowerGetStats()->updates, before.updates + 6 );
+    CHECK_EQ( txPowerGetStats()->haltsAvoided, before.haltsAvoided + 2 );
+    return;
+}
+
+int main()
+{
+    testFirstReading();
+    testFilter();
+    testHysteresis();
+    testApply();
+    return checkResult( "test_txpower" );
+}